@@ -0,0 +1,105 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#include "Teuchos_stacktrace.hpp"
+
+#include "basic.h"
+#include "add.h"
+#include "symbol.h"
+#include "integer.h"
+#include "mul.h"
+#include "pow.h"
+#include "functions.h"
+#include "eval_double.h"
+#include "eval_llvm.h"
+
+using CSymPy::Basic;
+using CSymPy::RCP;
+using CSymPy::symbol;
+using CSymPy::integer;
+using CSymPy::vec_basic;
+using CSymPy::CompiledDouble;
+using CSymPy::compile_double;
+#ifdef HAVE_CSYMPY_LLVM
+using CSymPy::LLVMDouble;
+using CSymPy::compile_llvm_double;
+#endif
+
+// Usage: eval_jit [points]
+// Evaluates the same expression at `points` points (default: 1000000) with
+// eval_double() (tree walk), CompiledDouble (bytecode, one point at a time
+// and in batches) and the function compiled by LLVM.
+
+typedef std::chrono::high_resolution_clock clock_type;
+
+long long ms(clock_type::time_point t1, clock_type::time_point t2)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t2-t1).count();
+}
+
+int main(int argc, char* argv[])
+{
+    Teuchos::print_stack_on_segfault();
+    std::size_t n = 1000000;
+    if (argc > 1) n = std::atol(argv[1]);
+
+    RCP<const Basic> x = symbol("x"), y = symbol("y"), z = symbol("z");
+    vec_basic symbols = {x, y, z};
+    RCP<const Basic> e = expand(pow(add(add(x, y), z), integer(6)));
+    e = add(e, mul(sin(add(x, y)), cos(mul(y, z))));
+
+    std::vector<double> points(3 * n);
+    for (std::size_t i = 0; i < points.size(); i++)
+        points[i] = 0.5 + (i % 1000) * 1e-3;
+    std::vector<double> out(n);
+    double sum;
+
+    auto t1 = clock_type::now();
+    sum = 0;
+    for (std::size_t i = 0; i < n; i++)
+        sum += eval_double(*e, symbols, {points[3*i], points[3*i + 1],
+            points[3*i + 2]});
+    auto t2 = clock_type::now();
+    std::cout << "eval_double:    " << ms(t1, t2) << "ms  (" << sum << ")"
+        << std::endl;
+
+    t1 = clock_type::now();
+    CompiledDouble f = compile_double(*e, symbols);
+    t2 = clock_type::now();
+    sum = 0;
+    for (std::size_t i = 0; i < n; i++) sum += f(&points[3*i]);
+    auto t3 = clock_type::now();
+    std::cout << "compile_double: " << ms(t2, t3) << "ms  (" << sum
+        << ", compiled in " << ms(t1, t2) << "ms)" << std::endl;
+
+    t1 = clock_type::now();
+    f.eval_batch(points.data(), n, out.data());
+    t2 = clock_type::now();
+    sum = 0;
+    for (double v: out) sum += v;
+    std::cout << "eval_batch:     " << ms(t1, t2) << "ms  (" << sum << ")"
+        << std::endl;
+
+#ifdef HAVE_CSYMPY_LLVM
+    t1 = clock_type::now();
+    LLVMDouble g = compile_llvm_double(*e, symbols);
+    t2 = clock_type::now();
+    sum = 0;
+    double r;
+    for (std::size_t i = 0; i < n; i++) {
+        g(&points[3*i], &r);
+        sum += r;
+    }
+    t3 = clock_type::now();
+    std::cout << "LLVM:           " << ms(t2, t3) << "ms  (" << sum
+        << ", compiled in " << ms(t1, t2) << "ms)" << std::endl;
+#else
+    std::cout << "LLVM:           not available (configure with WITH_LLVM=yes)"
+        << std::endl;
+#endif
+
+    return 0;
+}
@@ -18,6 +18,8 @@ using CSymPy::Integer;
 using CSymPy::expr2poly;
 using CSymPy::poly_mul;
 using CSymPy::umap_vec_mpz;
+using CSymPy::umap_ull_mpz;
+using CSymPy::MonomialPacking;
 using CSymPy::RCP;
 using CSymPy::rcp;
 using CSymPy::print_stack_on_segfault;
@@ -69,6 +71,23 @@ int main(int argc, char* argv[])
     std::cout << "number of terms: "
         << C.size() << std::endl;
 
+    // The same with packed exponents; the product has degree 31
+    MonomialPacking packing(4, 31);
+    umap_ull_mpz Q1, Q2, D;
+
+    expr2poly(f1, syms, packing, Q1);
+    expr2poly(f2, syms, packing, Q2);
+    std::cout << "poly_mul (packed) start" << std::endl;
+    t1 = std::chrono::high_resolution_clock::now();
+    poly_mul(Q1, Q2, D, packing);
+    t2 = std::chrono::high_resolution_clock::now();
+    std::cout << "poly_mul (packed) stop" << std::endl;
+    std::cout
+        << std::chrono::duration_cast<std::chrono::milliseconds>(t2-t1).count()
+        << "ms" << std::endl;
+    std::cout << "number of terms: "
+        << D.size() << std::endl;
+
 
 
     return 0;
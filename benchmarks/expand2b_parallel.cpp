@@ -0,0 +1,78 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+#include "basic.h"
+#include "add.h"
+#include "symbol.h"
+#include "dict.h"
+#include "integer.h"
+#include "mul.h"
+#include "pow.h"
+#include "rings.h"
+#include "monomials.h"
+
+using CSymPy::Basic;
+using CSymPy::Symbol;
+using CSymPy::umap_basic_num;
+using CSymPy::Integer;
+using CSymPy::expr2poly;
+using CSymPy::poly_mul_parallel;
+using CSymPy::umap_ull_mpz;
+using CSymPy::MonomialPacking;
+using CSymPy::RCP;
+using CSymPy::rcp;
+using CSymPy::print_stack_on_segfault;
+
+// Usage: expand2b_parallel [max_threads]
+// Runs the expand2b multiplication with 1, 2, ..., max_threads threads
+// (default: the number of hardware threads) and reports the speedup.
+int main(int argc, char* argv[])
+{
+    print_stack_on_segfault();
+    unsigned max_threads = std::thread::hardware_concurrency();
+    if (argc > 1) max_threads = std::atoi(argv[1]);
+    if (max_threads == 0) max_threads = 1;
+
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> z = rcp(new Symbol("z"));
+    RCP<const Basic> w = rcp(new Symbol("w"));
+    RCP<const Basic> i15 = rcp(new Integer(15));
+
+    RCP<const Basic> e, f1, f2;
+
+    e = pow(add(add(add(x, y), z), w), i15);
+    f1 = expand(e);
+    f2 = expand(add(e, w));
+
+    umap_basic_num syms;
+    insert(syms, x, rcp(new Integer(0)));
+    insert(syms, y, rcp(new Integer(1)));
+    insert(syms, z, rcp(new Integer(2)));
+    insert(syms, w, rcp(new Integer(3)));
+
+    // The product has degree 31
+    MonomialPacking packing(4, 31);
+    umap_ull_mpz P1, P2;
+    expr2poly(f1, syms, packing, P1);
+    expr2poly(f2, syms, packing, P2);
+
+    long long t_serial = 0;
+    for (unsigned threads = 1; threads <= max_threads; threads++) {
+        umap_ull_mpz C;
+        auto t1 = std::chrono::high_resolution_clock::now();
+        poly_mul_parallel(P1, P2, C, packing, threads);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        long long t =
+            std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
+        if (threads == 1) t_serial = t;
+        std::cout << "threads: " << threads
+            << "  time: " << t / 1000 << "ms"
+            << "  speedup: " << (double)t_serial / t
+            << "  number of terms: " << C.size() << std::endl;
+    }
+
+    return 0;
+}
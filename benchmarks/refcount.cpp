@@ -0,0 +1,106 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+#include "Teuchos_stacktrace.hpp"
+
+#include "basic.h"
+#include "add.h"
+#include "symbol.h"
+#include "dict.h"
+#include "integer.h"
+#include "mul.h"
+#include "pow.h"
+
+using CSymPy::Basic;
+using CSymPy::Add;
+using CSymPy::Symbol;
+using CSymPy::Integer;
+using CSymPy::RCP;
+using CSymPy::rcp;
+using CSymPy::rcp_dynamic_cast;
+
+// Usage: refcount [threads]
+// Measures the cost of reference counting: copying and dropping an RCP in a
+// loop, and expand2 (which copies RCPs all the time), first in the main
+// thread, then in `threads` threads at once (default: the number of hardware
+// threads). Compare the builds configured
+// with the default options, with WITH_CSYMPY_THREAD_SAFE=yes and with
+// WITH_CSYMPY_THREAD_SAFE=yes WITH_CSYMPY_BIASED_REFCOUNT=yes.
+
+long long copies(const RCP<const Basic> &x)
+{
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<RCP<const Basic>> v(100);
+    for (int i = 0; i < 100000; i++)
+        for (auto &p: v) p = x;
+    auto t2 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t2-t1).count();
+}
+
+long long expand2(const RCP<const Basic> &x, const RCP<const Basic> &y,
+        const RCP<const Basic> &z, const RCP<const Basic> &w)
+{
+    RCP<const Basic> e = pow(add(add(add(x, y), z), w), rcp(new Integer(15)));
+    RCP<const Basic> f = mul(e, add(e, w));
+    auto t1 = std::chrono::high_resolution_clock::now();
+    RCP<const Basic> r = expand(f);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t2-t1).count();
+}
+
+int main(int argc, char* argv[])
+{
+    Teuchos::print_stack_on_segfault();
+    unsigned nthreads = std::thread::hardware_concurrency();
+    if (argc > 1) nthreads = std::atoi(argv[1]);
+    if (nthreads == 0) nthreads = 1;
+
+#if defined(WITH_CSYMPY_BIASED_REFCOUNT)
+    std::cout << "reference counts: biased" << std::endl;
+#elif defined(WITH_CSYMPY_THREAD_SAFE)
+    std::cout << "reference counts: atomic" << std::endl;
+#else
+    std::cout << "reference counts: not thread safe" << std::endl;
+#endif
+
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> z = rcp(new Symbol("z"));
+    RCP<const Basic> w = rcp(new Symbol("w"));
+
+    std::cout << "1 thread:  copies: " << copies(x) << "ms"
+        << "  expand2: " << expand2(x, y, z, w) << "ms" << std::endl;
+
+#if defined(WITH_CSYMPY_THREAD_SAFE)
+    // Each thread copies its own symbol and `x`, which it shares with the
+    // other threads, and expands with its own symbols
+    std::vector<long long> t_own(nthreads), t_shared(nthreads),
+        t_expand2(nthreads);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nthreads; i++) {
+        threads.push_back(std::thread([&, i]() {
+            RCP<const Basic> a = rcp(new Symbol("a"));
+            RCP<const Basic> b = rcp(new Symbol("b"));
+            RCP<const Basic> c = rcp(new Symbol("c"));
+            RCP<const Basic> d = rcp(new Symbol("d"));
+            t_own[i] = copies(a);
+            t_shared[i] = copies(x);
+            t_expand2[i] = expand2(a, b, c, d);
+        }));
+    }
+    for (auto &t: threads) t.join();
+    std::cout << nthreads << " threads (slowest):  copies: "
+        << *std::max_element(t_own.begin(), t_own.end()) << "ms"
+        << "  shared copies: "
+        << *std::max_element(t_shared.begin(), t_shared.end()) << "ms"
+        << "  expand2: "
+        << *std::max_element(t_expand2.begin(), t_expand2.end()) << "ms"
+        << std::endl;
+#endif
+
+    return 0;
+}
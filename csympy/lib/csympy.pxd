@@ -118,6 +118,9 @@ cdef extern from "add.h" namespace "CSymPy":
     cdef cppclass Add(Basic):
         void as_two_terms(const Ptr[RCP[Basic]] &a, const Ptr[RCP[Basic]] &b)
 
+cdef extern from "add.h":
+    cdef RCP[const Basic] add_from_terms "CSymPy::Add::from_terms"(const vec_basic &terms) nogil except+
+
 cdef extern from "mul.h" namespace "CSymPy":
     cdef RCP[const Basic] mul(RCP[const Basic] &a, RCP[const Basic] &b) nogil except+
     cdef RCP[const Basic] div(RCP[const Basic] &a, RCP[const Basic] &b) nogil except+
@@ -126,6 +129,9 @@ cdef extern from "mul.h" namespace "CSymPy":
     cdef cppclass Mul(Basic):
         void as_two_terms(const Ptr[RCP[Basic]] &a, const Ptr[RCP[Basic]] &b)
 
+cdef extern from "mul.h":
+    cdef RCP[const Basic] mul_from_factors "CSymPy::Mul::from_factors"(const vec_basic &factors) nogil except+
+
 cdef extern from "pow.h" namespace "CSymPy":
     cdef RCP[const Basic] pow(RCP[const Basic] &a, RCP[const Basic] &b) nogil except+
     cdef RCP[const Basic] sqrt(RCP[const Basic] &x) nogil except+
@@ -772,6 +772,24 @@ def function_symbol(name, *args):
             v.push_back(e_.thisptr)
     return c2py(csympy.function_symbol(name.encode("utf-8"), v))
 
+def add(*args):
+    """Returns the sum of args, built in one pass (faster than folding with +)."""
+    cdef csympy.vec_basic v
+    cdef Basic e_
+    for e in args:
+        e_ = sympify(e)
+        v.push_back(e_.thisptr)
+    return c2py(csympy.add_from_terms(v))
+
+def mul(*args):
+    """Returns the product of args, built in one pass (faster than folding with *)."""
+    cdef csympy.vec_basic v
+    cdef Basic e_
+    for e in args:
+        e_ = sympify(e)
+        v.push_back(e_.thisptr)
+    return c2py(csympy.mul_from_factors(v))
+
 def sqrt(x):
     cdef Basic X = sympify(x)
     return c2py(csympy.sqrt(X.thisptr))
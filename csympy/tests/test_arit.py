@@ -1,6 +1,6 @@
 from nose.tools import raises
 
-from csympy import Symbol, Integer, Add, Pow
+from csympy import Symbol, Integer, Add, Pow, add, mul
 
 def test_arit1():
     x = Symbol("x")
@@ -119,3 +119,13 @@ def test_args():
     assert set((x**2 + 2*x*y + 5).args) == set((x**2, 2*x*y, 5))
     assert (2*x**2).args == (2, x**2)
     assert set((2*x**2*y).args) == set((2, x**2, y))
+
+def test_add_mul_many():
+    x = Symbol("x")
+    y = Symbol("y")
+    assert add(x, y, 2*x, 3) == 3*x + y + 3
+    assert add(x, -x) == 0
+    assert add() == 0
+    assert mul(x, y, 2, x) == 2*x**2*y
+    assert mul(x, 1/x) == 1
+    assert mul() == 1
@@ -6,6 +6,7 @@
 #include "pow.h"
 #include "complex.h"
 #include "functions.h"
+#include "unique_table.h"
 
 
 namespace CSymPy {
@@ -55,13 +56,18 @@ bool Add::is_canonical(const RCP<const Number> &coef,
 
 std::size_t Add::__hash__() const
 {
+    // The terms are combined by a sum, which does not depend on the
+    // iteration order of `dict_`, so they don't have to be sorted first. Each
+    // term is mixed on its own, so that e.g. `x + 2y` and `2x + y` differ.
+    std::size_t terms = 0;
+    for (auto &p: dict_) {
+        std::size_t term = p.first->hash();
+        hash_combine<Basic>(term, *(p.second));
+        terms += term;
+    }
     std::size_t seed = ADD;
     hash_combine<Basic>(seed, *coef_);
-    map_basic_num ordered(dict_.begin(), dict_.end());
-    for (auto &p: ordered) {
-        hash_combine<Basic>(seed, *(p.first));
-        hash_combine<Basic>(seed, *(p.second));
-    }
+    hash_combine<std::size_t>(seed, terms);
     return seed;
 }
 
@@ -171,13 +177,15 @@ RCP<const Basic> Add::from_dict(const RCP<const Number> &coef, umap_basic_num &&
             }
             if (is_a<Mul>(*(p->first))) {
 #if !defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
-                if (rcp_static_cast<const Mul>(p->first)->refcount_ == 1) {
+                if (rcp_static_cast<const Mul>(p->first)->refcount_ == 1 &&
+                        !p->first->is_interned()) {
                     // We can steal the dictionary:
                     // Cast away const'ness, so that we can move 'dict_', since
                     // 'p->first' will be destroyed when 'd' is at the end of
                     // this function, so we "steal" its dict_ to avoid an
                     // unnecessary copy. We know the refcount_ is one, so
-                    // nobody else is using the Mul except us.
+                    // nobody else is using the Mul except us (interned nodes
+                    // are never modified, as the unique table still sees them).
                     const map_basic_basic &d2 =
                         rcp_static_cast<const Mul>(p->first)->dict_;
                     map_basic_basic &d3 = const_cast<map_basic_basic &>(d2);
@@ -205,13 +213,15 @@ RCP<const Basic> Add::from_dict(const RCP<const Number> &coef, umap_basic_num &&
         if (is_a_Number(*p->second)) {
             if (is_a<Mul>(*(p->first))) {
 #if !defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
-                if (rcp_static_cast<const Mul>(p->first)->refcount_ == 1) {
+                if (rcp_static_cast<const Mul>(p->first)->refcount_ == 1 &&
+                        !p->first->is_interned()) {
                     // We can steal the dictionary:
                     // Cast away const'ness, so that we can move 'dict_', since
                     // 'p->first' will be destroyed when 'd' is at the end of
                     // this function, so we "steal" its dict_ to avoid an
                     // unnecessary copy. We know the refcount_ is one, so
-                    // nobody else is using the Mul except us.
+                    // nobody else is using the Mul except us (interned nodes
+                    // are never modified, as the unique table still sees them).
                     const map_basic_basic &d2 =
                         rcp_static_cast<const Mul>(p->first)->dict_;
                     map_basic_basic &d3 = const_cast<map_basic_basic &>(d2);
@@ -276,37 +286,41 @@ void Add::as_coef_term(const RCP<const Basic> &self,
     }
 }
 
+namespace {
+
+// Adds `b` to the sum `coef` + `d`
+void add_to_dict(const Ptr<RCP<const Number>> &coef, umap_basic_num &d,
+        const RCP<const Basic> &b)
+{
+    if (is_a<Add>(*b)) {
+        for (auto &p: (rcp_static_cast<const Add>(b))->dict_)
+            Add::dict_add_term(d, p.second, p.first);
+        iaddnum(coef, rcp_static_cast<const Add>(b)->coef_);
+    } else if (is_a_Number(*b)) {
+        iaddnum(coef, rcp_static_cast<const Number>(b));
+    } else {
+        RCP<const Number> coef2;
+        RCP<const Basic> t;
+        Add::as_coef_term(b, outArg(coef2), outArg(t));
+        Add::dict_add_term(d, coef2, t);
+    }
+}
+
+} // anonymous namespace
+
 RCP<const Basic> add(const RCP<const Basic> &a, const RCP<const Basic> &b)
 {
     CSymPy::umap_basic_num d;
     RCP<const Number> coef;
     RCP<const Basic> t;
-    if (CSymPy::is_a<Add>(*a) && CSymPy::is_a<Add>(*b)) {
+    if (CSymPy::is_a<Add>(*a)) {
         coef = (rcp_static_cast<const Add>(a))->coef_;
         d = (rcp_static_cast<const Add>(a))->dict_;
-        for (auto &p: (rcp_static_cast<const Add>(b))->dict_)
-            Add::dict_add_term(d, p.second, p.first);
-        iaddnum(outArg(coef), rcp_static_cast<const Add>(b)->coef_);
-    } else if (CSymPy::is_a<Add>(*a)) {
-        coef = (rcp_static_cast<const Add>(a))->coef_;
-        d = (rcp_static_cast<const Add>(a))->dict_;
-        if (is_a_Number(*b)) {
-            iaddnum(outArg(coef), rcp_static_cast<const Number>(b));
-        } else {
-            RCP<const Number> coef2;
-            Add::as_coef_term(b, outArg(coef2), outArg(t));
-            Add::dict_add_term(d, coef2, t);
-        }
+        add_to_dict(outArg(coef), d, b);
     } else if (CSymPy::is_a<Add>(*b)) {
         coef = (rcp_static_cast<const Add>(b))->coef_;
         d = (rcp_static_cast<const Add>(b))->dict_;
-        if (is_a_Number(*a)) {
-            iaddnum(outArg(coef), rcp_static_cast<const Number>(a));
-        } else {
-            RCP<const Number> coef2;
-            Add::as_coef_term(a, outArg(coef2), outArg(t));
-            Add::dict_add_term(d, coef2, t);
-        }
+        add_to_dict(outArg(coef), d, a);
     } else {
         Add::as_coef_term(a, outArg(coef), outArg(t));
         Add::dict_add_term(d, coef, t);
@@ -319,9 +333,39 @@ RCP<const Basic> add(const RCP<const Basic> &a, const RCP<const Basic> &b)
             coef = it->second;
             d.erase(it);
         }
-        return Add::from_dict(coef, std::move(d));
+        return intern(Add::from_dict(coef, std::move(d)));
     }
-    return Add::from_dict(coef, std::move(d));
+    return intern(Add::from_dict(coef, std::move(d)));
+}
+
+RCP<const Basic> Add::from_terms(const vec_basic &terms)
+{
+    umap_basic_num d;
+    d.reserve(terms.size());
+    RCP<const Number> coef = zero;
+    for (auto &t: terms)
+        add_to_dict(outArg(coef), d, t);
+    return intern(Add::from_dict(coef, std::move(d)));
+}
+
+void iadd(const Ptr<RCP<const Basic>> &self, const RCP<const Basic> &b)
+{
+#if !defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+    if (is_a<Add>(**self) && (*self)->refcount_ == 1 &&
+            !(*self)->is_interned()) {
+        // We hold the only reference, so we take over the dictionary instead
+        // of copying it. The emptied Add is destroyed when `*self` is
+        // assigned below (interned nodes are never modified, as the unique
+        // table still sees them).
+        Add &a = const_cast<Add &>(static_cast<const Add &>(**self));
+        RCP<const Number> coef = a.coef_;
+        umap_basic_num d = std::move(a.dict_);
+        add_to_dict(outArg(coef), d, b);
+        *self = intern(Add::from_dict(coef, std::move(d)));
+        return;
+    }
+#endif
+    *self = add(*self, b);
 }
 
 RCP<const Basic> sub(const RCP<const Basic> &a, const RCP<const Basic> &b)
@@ -329,6 +373,16 @@ RCP<const Basic> sub(const RCP<const Basic> &a, const RCP<const Basic> &b)
     return add(a, mul(minus_one, b));
 }
 
+std::size_t add_term_bytes(const Basic &t)
+{
+    // 16 and 32 bytes: allocator overhead of the hash and tree nodes
+    std::size_t bytes = sizeof(umap_basic_num::value_type) + 16;
+    if (is_a<Mul>(t))
+        bytes += sizeof(Mul) + static_cast<const Mul &>(t).dict_.size() *
+            (sizeof(map_basic_basic::value_type) + 32);
+    return bytes;
+}
+
 RCP<const Basic> add_expand(const RCP<const Add> &self)
 {
     umap_basic_num d;
@@ -345,6 +399,7 @@ RCP<const Basic> add_expand(const RCP<const Add> &self)
             }
             iaddnum(outArg(coef_overall), mulnum(p.second,
                         rcp_static_cast<const Add>(tmp)->coef_));
+            expand_check_size(d.size(), d.size() * add_term_bytes(*tmp2));
         } else {
             Add::as_coef_term(tmp, outArg(coef), outArg(tmp));
             Add::dict_add_term(d, mulnum(p.second, coef), tmp);
@@ -355,11 +410,12 @@ RCP<const Basic> add_expand(const RCP<const Add> &self)
 
 RCP<const Basic> Add::diff(const RCP<const Symbol> &x) const
 {
+    DiffMemo memo;
     CSymPy::umap_basic_num d;
     RCP<const Number> coef=zero, coef2;
     RCP<const Basic> t;
     for (auto &p: dict_) {
-        RCP<const Basic> term = p.first->diff(x);
+        RCP<const Basic> term = memo.diff(p.first, x);
         if (is_a<Integer>(*term) && rcp_static_cast<const Integer>(term)->is_zero()) {
             continue;
         } else if (is_a_Number(*term)) {
@@ -394,14 +450,26 @@ RCP<const Basic> Add::subs(const map_basic_basic &subs_dict) const
     if (it != subs_dict.end())
         return it->second;
 
+    SubsMemo memo(subs_dict);
     CSymPy::umap_basic_num d;
     RCP<const Number> coef=coef_, coef2;
     RCP<const Basic> t;
+    bool changed = false;
     for (auto &p: dict_) {
-        RCP<const Basic> term = p.first->subs(subs_dict);
+        RCP<const Basic> term = memo.subs(p.first);
         if (term == p.first) {
-            Add::dict_add_term(d, p.second, p.first);
-        } else if (is_a<Integer>(*term) &&
+            if (changed) Add::dict_add_term(d, p.second, p.first);
+            continue;
+        }
+        if (!changed) {
+            // The first substituted term, copy the terms before it
+            for (auto &q: dict_) {
+                if (&q == &p) break;
+                Add::dict_add_term(d, q.second, q.first);
+            }
+            changed = true;
+        }
+        if (is_a<Integer>(*term) &&
                 rcp_static_cast<const Integer>(term)->is_zero()) {
             continue;
         } else if (is_a_Number(*term)) {
@@ -416,6 +484,8 @@ RCP<const Basic> Add::subs(const map_basic_basic &subs_dict) const
             Add::dict_add_term(d, coef2, t);
         }
     }
+    // Nothing was substituted, no need for a new Add
+    if (!changed) return self;
     return Add::from_dict(coef, std::move(d));
 }
 
@@ -428,4 +498,11 @@ vec_basic Add::get_args() const {
     return args;
 }
 
+bool Add::for_each_arg(const ArgCallback &f) const {
+    if (!coef_->is_zero() && !f(*coef_)) return false;
+    for (auto &p: dict_)
+        if (!f(*p.first) || !f(*p.second)) return false;
+    return true;
+}
+
 } // CSymPy
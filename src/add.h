@@ -41,6 +41,10 @@ public:
     * Mul) depending on the size of dictionary `d`.
     */
     static RCP<const Basic> from_dict(const RCP<const Number> &coef, umap_basic_num &&d);
+    /*! \return the sum of `terms`, built in one dictionary (presized for
+    * `terms`) and canonicalized once, instead of folding with `add()`.
+    */
+    static RCP<const Basic> from_terms(const vec_basic &terms);
     /*!
     * Adds `(coeff*t)` to the dict `d`
     */
@@ -61,6 +65,7 @@ public:
     virtual RCP<const Basic> subs(const map_basic_basic &subs_dict) const;
 
     virtual vec_basic get_args() const;
+    virtual bool for_each_arg(const ArgCallback &f) const;
 
     virtual void accept(Visitor &v) const;
 };
@@ -68,11 +73,23 @@ public:
 //! \return Add made from `a + b`
 RCP<const Basic> add(const RCP<const Basic> &a,
         const RCP<const Basic> &b);
+/*! Replaces `*self` by `*self + b`. If `*self` is an Add that nobody else
+ * references, its dictionary is reused instead of copied, so that summing
+ * `n` terms in a loop is O(n) instead of O(n^2):
+ *
+ *     RCP<const Basic> r = zero;
+ *     for (auto &t: terms) iadd(outArg(r), t);
+ * */
+void iadd(const Ptr<RCP<const Basic>> &self, const RCP<const Basic> &b);
 //! \return Add made from `a - b`
 RCP<const Basic> sub(const RCP<const Basic> &a,
         const RCP<const Basic> &b);
 //! \return expanded version of Add
 RCP<const Basic> add_expand(const RCP<const Add> &self);
+//! \return rough estimate of the memory taken by the term `t` of an Add (its
+//! dictionary entry and, for a Mul, the node and its dictionary), used to
+//! check the limits of `expand(self, limits)`
+std::size_t add_term_bytes(const Basic &t);
 
 } // CSymPy
 
@@ -17,12 +17,14 @@ inline bool Basic::__neq__(const Basic &o) const
 //! \return true if  `a` equal `b`
 inline bool eq(const RCP<const Basic> &a, const RCP<const Basic> &b)
 {
+    // Identical (e.g. hash-consed) nodes are equal without a deep comparison
+    if (a.get() == b.get()) return true;
     return a->__eq__(*b);
 }
 //! \return true if  `a` not equal `b`
 inline bool neq(const RCP<const Basic> &a, const RCP<const Basic> &b)
 {
-    return !(a->__eq__(*b));
+    return !eq(a, b);
 }
 
 //! Templatised version to check is_a type
@@ -8,9 +8,21 @@
 #include "pow.h"
 #include "constants.h"
 #include "functions.h"
+#include "unique_table.h"
+#include "polynomial.h"
+
+#if defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+#include <thread>
+#include <exception>
+#endif
 
 namespace CSymPy {
 
+Basic::~Basic()
+{
+    if (interned_) unique_table_erase(this, hash_);
+}
+
 int Basic::__cmp__(const Basic &o) const
 {
     auto a = this->get_type_code();
@@ -32,16 +44,195 @@ std::string Basic::__str__() const
     return s.str();
 }
 
+bool Basic::for_each_arg(const ArgCallback &f) const
+{
+    for (auto &p: get_args())
+        if (!f(*p)) return false;
+    return true;
+}
+
 RCP<const Basic> expand(const RCP<const Basic> &self)
 {
     if (is_a<Symbol>(*self)) return self;
     if (is_a_Number(*self)) return self;
+    // Products of polynomials with integer coefficients are expanded in the
+    // compact Polynomial representation, without building the intermediate
+    // Add/Mul expressions. (A single power is expanded just as fast by
+    // pow_expand() directly.)
+    if (is_a<Mul>(*self) && is_polynomial(*self))
+        return polynomial(self)->as_basic();
     if (is_a<Add>(*self)) return add_expand(rcp_static_cast<const Add>(self));
     if (is_a<Mul>(*self)) return mul_expand(rcp_static_cast<const Mul>(self));
     if (is_a<Pow>(*self)) return pow_expand(rcp_static_cast<const Pow>(self));
     return self;
 }
 
+#if defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+namespace {
+
+// Fork-join over a fixed budget of threads: `fork()` runs its first task on a
+// new thread while threads are left in the budget and in the calling thread
+// otherwise, so nested (recursive) forks never oversubscribe the machine.
+class ThreadBudget {
+    std::atomic<int> free_;
+public:
+    ThreadBudget(unsigned threads) : free_{(int)threads - 1} {}
+    bool available() const { return free_.load() > 0; }
+    template <class F, class G>
+    void fork(F f, G g) {
+        if (free_.fetch_sub(1) <= 0) {
+            ++free_;
+            f();
+            g();
+            return;
+        }
+        std::exception_ptr error;
+        std::thread t([&]() {
+            try {
+                f();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        });
+        try {
+            g();
+        } catch (...) {
+            t.join();
+            ++free_;
+            throw;
+        }
+        t.join();
+        ++free_;
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+// Splits the terms of `a` into two halves, `a = a1 + a2`
+void split_add(const Add &a, const Ptr<RCP<const Basic>> &a1,
+        const Ptr<RCP<const Basic>> &a2)
+{
+    umap_basic_num d1, d2;
+    std::size_t half = a.dict_.size() / 2, i = 0;
+    for (auto &p: a.dict_) {
+        if (i++ < half)
+            d1.insert(p);
+        else
+            d2.insert(p);
+    }
+    *a1 = Add::from_dict(a.coef_, std::move(d1));
+    *a2 = Add::from_dict(zero, std::move(d2));
+}
+
+// Products with fewer terms than this are expanded sequentially
+const std::size_t parallel_grain = 1000;
+
+RCP<const Basic> expand_parallel(const RCP<const Basic> &self,
+        ThreadBudget &budget);
+
+// Expands `a * b`, `a` and `b` being expanded
+RCP<const Basic> mul_expand_two_parallel(const RCP<const Basic> &a,
+        const RCP<const Basic> &b, ThreadBudget &budget)
+{
+    if (!is_a<Add>(*a) || !is_a<Add>(*b) || !budget.available())
+        return mul_expand_two(a, b);
+    const Add &A = static_cast<const Add &>(*a);
+    const Add &B = static_cast<const Add &>(*b);
+    if (A.dict_.size() * B.dict_.size() < parallel_grain)
+        return mul_expand_two(a, b);
+    if (A.dict_.size() < B.dict_.size())
+        return mul_expand_two_parallel(b, a, budget);
+    RCP<const Basic> a1, a2, r1, r2;
+    split_add(A, outArg(a1), outArg(a2));
+    budget.fork(
+        [&]() { r1 = mul_expand_two_parallel(a1, b, budget); },
+        [&]() { r2 = mul_expand_two_parallel(a2, b, budget); });
+    return add(r1, r2);
+}
+
+RCP<const Basic> expand_parallel(const RCP<const Basic> &self,
+        ThreadBudget &budget)
+{
+    if (!budget.available()) return expand(self);
+    if (is_a<Mul>(*self) && is_polynomial(*self))
+        return polynomial(self)->as_basic();
+    if (is_a<Add>(*self)) {
+        RCP<const Basic> a1, a2, r1, r2;
+        split_add(static_cast<const Add &>(*self), outArg(a1), outArg(a2));
+        budget.fork(
+            [&]() { r1 = expand_parallel(a1, budget); },
+            [&]() { r2 = expand_parallel(a2, budget); });
+        return add(r1, r2);
+    }
+    if (is_a<Mul>(*self)) {
+        RCP<const Basic> a, b;
+        static_cast<const Mul &>(*self).as_two_terms(outArg(a), outArg(b));
+        budget.fork(
+            [&]() { a = expand_parallel(a, budget); },
+            [&]() { b = expand_parallel(b, budget); });
+        return mul_expand_two_parallel(a, b, budget);
+    }
+    return expand(self);
+}
+
+} // anonymous namespace
+#endif
+
+RCP<const Basic> expand_parallel(const RCP<const Basic> &self,
+        unsigned threads)
+{
+#if defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads <= 1) return expand(self);
+    ThreadBudget budget(threads);
+    return expand_parallel(self, budget);
+#else
+    return expand(self);
+#endif
+}
+
+namespace {
+
+// The limits of the `expand(self, limits)` running in this thread, if any
+thread_local const ExpandLimits *expand_limits = nullptr;
+
+// Sets `expand_limits` for the lifetime of the object
+class ExpandLimitsGuard {
+    const ExpandLimits *saved_;
+public:
+    ExpandLimitsGuard(const ExpandLimits &limits) : saved_{expand_limits} {
+        expand_limits = &limits;
+    }
+    ~ExpandLimitsGuard() { expand_limits = saved_; }
+};
+
+} // anonymous namespace
+
+RCP<const Basic> expand(const RCP<const Basic> &self,
+        const ExpandLimits &limits)
+{
+    ExpandLimitsGuard guard(limits);
+    return expand(self);
+}
+
+void expand_check_size(double terms, double bytes)
+{
+    if (expand_limits == nullptr) return;
+    std::size_t max_terms = expand_limits->max_terms;
+    std::size_t max_bytes = expand_limits->max_bytes;
+    if (max_terms != 0 && terms > max_terms) {
+        std::ostringstream s;
+        s << "expand: about " << terms << " terms needed, the limit is "
+            << max_terms;
+        throw ExpandLimitExceeded(s.str());
+    }
+    if (max_bytes != 0 && bytes > max_bytes) {
+        std::ostringstream s;
+        s << "expand: about " << bytes << " bytes needed, the limit is "
+            << max_bytes;
+        throw ExpandLimitExceeded(s.str());
+    }
+}
+
 RCP<const Basic> Basic::subs(const map_basic_basic &subs_dict) const
 {
     RCP<const Basic> self = rcp_const_cast<Basic>(rcp(this));
@@ -52,6 +243,97 @@ RCP<const Basic> Basic::subs(const map_basic_basic &subs_dict) const
         return it->second;
 }
 
+namespace {
+
+// The innermost SubsMemo of this thread, if any
+thread_local SubsMemo *subs_memo = nullptr;
+
+} // anonymous namespace
+
+SubsMemo::SubsMemo(const map_basic_basic &subs_dict)
+    : subs_dict_(subs_dict), saved_{subs_memo}, table_{&own_}
+{
+    if (saved_ != nullptr && &saved_->subs_dict_ == &subs_dict)
+        table_ = saved_->table_;
+    subs_memo = this;
+}
+
+SubsMemo::~SubsMemo()
+{
+    subs_memo = saved_;
+}
+
+RCP<const Basic> SubsMemo::subs(const RCP<const Basic> &arg)
+{
+    auto it = table_->find(arg);
+    if (it != table_->end())
+        return it->second;
+    RCP<const Basic> r = arg->subs(subs_dict_);
+    table_->insert(std::make_pair(arg, r));
+    return r;
+}
+
+namespace {
+
+// The Differentiator used by the diff() running in this thread, if any
+thread_local Differentiator *differentiator = nullptr;
+
+// Sets `differentiator` for the lifetime of the object
+class DifferentiatorGuard {
+    Differentiator *saved_;
+public:
+    DifferentiatorGuard(Differentiator *d) : saved_{differentiator} {
+        differentiator = d;
+    }
+    ~DifferentiatorGuard() { differentiator = saved_; }
+};
+
+} // anonymous namespace
+
+RCP<const Basic> Differentiator::diff(const RCP<const Basic> &b,
+        const RCP<const Symbol> &x)
+{
+    {
+        umap_basic_basic &table = cache_[x];
+        auto it = table.find(b);
+        if (it != table.end())
+            return it->second;
+    }
+    RCP<const Basic> r;
+    {
+        DifferentiatorGuard guard(this);
+        r = b->diff(x);
+    }
+    // The table may have been rehashed by the nested calls
+    cache_[x].insert(std::make_pair(b, r));
+    return r;
+}
+
+DiffMemo::DiffMemo()
+    : saved_{differentiator}
+{
+    if (saved_ == nullptr)
+        differentiator = &own_;
+}
+
+DiffMemo::~DiffMemo()
+{
+    differentiator = saved_;
+}
+
+RCP<const Basic> DiffMemo::diff(const RCP<const Basic> &arg,
+        const RCP<const Symbol> &x)
+{
+    return differentiator->diff(arg, x);
+}
+
+RCP<const Basic> diff_arg(const RCP<const Basic> &arg,
+        const RCP<const Symbol> &x)
+{
+    DiffMemo memo;
+    return memo.diff(arg, x);
+}
+
 RCP<const Basic> Basic::diff(const RCP<const Symbol> &x) const
 {
     return rcp(new Derivative(rcp(this), {x}));
@@ -18,16 +18,41 @@
 #include <unordered_map>
 #include <cassert>
 #include <atomic>
+#include <type_traits>
 
 #include "csympy_config.h"
 #include "csympy_assert.h"
 #include "csympy_rcp.h"
 #include "dict.h"
+#if defined(WITH_CSYMPY_BIASED_REFCOUNT)
+#include "biased_refcount.h"
+#endif
 
 namespace CSymPy {
 
 class Visitor;
 class Symbol;
+class Polynomial;
+class Basic;
+
+/*! Non-owning reference to a callable `bool f(const Basic &arg)`, the
+    argument of Basic::for_each_arg(). Unlike `std::function` it never
+    allocates, so it must not outlive the callable (e.g. a lambda passed
+    directly to for_each_arg()).
+*/
+class ArgCallback {
+private:
+    const void *f_;
+    bool (*call_)(const void *, const Basic &);
+    template <class F>
+    static bool call(const void *f, const Basic &arg) {
+        return (*static_cast<const F *>(f))(arg);
+    }
+public:
+    template <class F>
+    ArgCallback(const F &f) : f_{&f}, call_{&call<F>} {}
+    bool operator()(const Basic &arg) const { return call_(f_, arg); }
+};
 
 /*!
     Any Basic class can be used in a "dictionary", due to the methods:
@@ -69,7 +94,8 @@ enum TypeID {
     ASINH, ACOSH, ATANH, ACOTH,
     LAMBERTW, ZETA, DIRICHLET_ETA, KRONECKERDELTA,
     LEVICIVITA, GAMMA, LOWERGAMMA, UPPERGAMMA,
-    FUNCTIONSYMBOL, FUNCTIONWRAPPER, DERIVATIVE, SUBS, ABS
+    FUNCTIONSYMBOL, FUNCTIONWRAPPER, DERIVATIVE, SUBS, ABS,
+    POLYNOMIAL
 };
 
 class Basic {
@@ -84,6 +110,9 @@ private:
 #else
     mutable std::size_t hash_; // This holds the hash value
 #endif // WITH_CSYMPY_THREAD_SAFE
+    // true if this instance is registered in the unique table (see
+    // unique_table.h). It is only ever set once, by intern_basic().
+    mutable bool interned_;
 #if defined(WITH_CSYMPY_RCP)
 public:
     //! Public variables if defined with CSYMPY_RCP
@@ -95,7 +124,11 @@ public:
     // The refcount_ is defined as mutable, because it does not change the
     // state of the instance, but changes when more copies
     // of the same instance are made.
-#if defined(WITH_CSYMPY_THREAD_SAFE)
+#if defined(WITH_CSYMPY_BIASED_REFCOUNT)
+    // Non-atomic for the thread that owns the instance (see
+    // biased_refcount.h)
+    mutable BiasedRefCount refcount_; // reference counter
+#elif defined(WITH_CSYMPY_THREAD_SAFE)
     mutable std::atomic<unsigned int> refcount_; // reference counter
 #else
     mutable unsigned int refcount_; // reference counter
@@ -104,14 +137,27 @@ public:
 public:
     virtual TypeID get_type_code() const = 0;
     //! Constructor
-    Basic() : hash_{0}
+    Basic() : hash_{0}, interned_{false}
 #if defined(WITH_CSYMPY_RCP)
         , refcount_(0)
 #endif
         {}
     //! Destructor must be explicitly defined as virtual here to avoid problems
     //! with undefined behavior while deallocating derived classes.
-    virtual ~Basic() {}
+    //! It also removes the instance from the unique table if it was interned.
+    virtual ~Basic();
+
+#if defined(WITH_CSYMPY_POOL_ALLOCATOR)
+    //! All nodes are allocated from the pool (see pool_allocator.h). The
+    //! sized `operator delete` receives the size of the most derived class,
+    //! because the destructor is virtual.
+    static void *operator new(std::size_t size) {
+        return pool_allocate(size);
+    }
+    static void operator delete(void *p, std::size_t size) {
+        pool_deallocate(p, size);
+    }
+#endif
 
     //! Delete the copy constructor and assignment
     Basic(const Basic&) = delete;
@@ -134,6 +180,9 @@ public:
     //! This caches the hash:
     std::size_t hash() const;
 
+    //! \return true if this instance is the canonical node in the unique table
+    inline bool is_interned() const { return interned_; }
+
     //! true if `this` is equal to `o`.
     virtual bool __eq__(const Basic &o) const = 0;
 
@@ -169,9 +218,37 @@ public:
     //! Returns the list of arguments
     virtual vec_basic get_args() const = 0;
 
+    /*! Calls `f(arg)` for each argument of `self`, stopping as soon as `f`
+        returns false. \return false if it was stopped.
+
+        The arguments are references into `self`, valid as long as `self`
+        is: nothing is allocated and no reference counts change. Unlike
+        get_args(), which builds new `coef*term` and `base**exp` nodes for
+        Add and Mul, these are the parts stored in the instance: for Add the
+        coefficient (unless zero) then each term followed by its
+        coefficient, for Mul the coefficient (unless one) then each base
+        followed by its exponent. The default implementation iterates over
+        get_args().
+    */
+    virtual bool for_each_arg(const ArgCallback &f) const;
+
     virtual void accept(Visitor &v) const = 0;
+
+    friend RCP<const Basic> intern_basic(const RCP<const Basic> &b);
 };
 
+#if defined(WITH_CSYMPY_DEFERRED_RELEASE)
+//! Deletes `b` (or queues it for deletion), see deferred_release.h
+void release_basic(const Basic *b);
+
+// RCPs of Basic subclasses delete through release_basic()
+template <class T>
+struct RCPDeleter<T,
+        typename std::enable_if<std::is_base_of<Basic, T>::value>::type> {
+    static void apply(T *p) { release_basic(p); }
+};
+#endif
+
 //! Our hash:
 struct RCPBasicHash {
     //! Returns the hashed value.
@@ -184,7 +261,7 @@ struct RCPBasicHash {
 struct RCPBasicKeyEq {
     //! Comparison Operator `==`
     bool operator() (const RCP<const Basic> &x, const RCP<const Basic> &y) const {
-        return x->__eq__(*y);
+        return x.get() == y.get() || x->__eq__(*y);
     }
 };
 
@@ -221,6 +298,106 @@ bool is_a_sub(const Basic &b);
 
 //! Expands `self`
 RCP<const Basic> expand(const RCP<const Basic> &self);
+/*! Expands `self` using up to `threads` threads (`0` means one per core).
+    The terms of an Add and the factors of a Mul are expanded in parallel, and
+    so are the row blocks of large products. The result is the same as
+    `expand(self)`. Without WITH_CSYMPY_THREAD_SAFE (and the CSymPy RCP) the
+    reference counts are not atomic, in which case this just calls
+    `expand(self)`.
+*/
+RCP<const Basic> expand_parallel(const RCP<const Basic> &self,
+        unsigned threads = 0);
+
+//! Thrown by `expand(self, limits)` when the expansion would exceed `limits`
+class ExpandLimitExceeded : public std::runtime_error {
+public:
+    ExpandLimitExceeded(const std::string &msg) : std::runtime_error(msg) {}
+};
+
+//! Size limits for `expand(self, limits)`, `0` means no limit
+struct ExpandLimits {
+    //! Maximum number of terms of the result and of any intermediate result
+    std::size_t max_terms;
+    //! Maximum (estimated) memory in bytes of the result and of any
+    //! intermediate result
+    std::size_t max_bytes;
+    ExpandLimits(std::size_t max_terms = 0, std::size_t max_bytes = 0)
+        : max_terms{max_terms}, max_bytes{max_bytes} {}
+};
+
+/*! Expands `self`, but throws `ExpandLimitExceeded` as soon as the result or
+    an intermediate result is estimated to exceed `limits`. Powers of sums are
+    checked before the multinomial coefficients are computed (their number is
+    known in advance), products while their terms are being collected.
+*/
+RCP<const Basic> expand(const RCP<const Basic> &self,
+        const ExpandLimits &limits);
+
+//! Called by the expansion code before (or while) building `terms` terms that
+//! take about `bytes` bytes. Throws `ExpandLimitExceeded` if this exceeds the
+//! limits of the `expand(self, limits)` running in the calling thread.
+void expand_check_size(double terms, double bytes);
+
+/*! The memo of the `subs(subs_dict)` running in the calling thread. The
+    overrides of `Basic::subs()` create one and substitute into their
+    arguments with `SubsMemo::subs()`: the outermost one owns the memo, the
+    nested ones (with the same `subs_dict`) share it. So each distinct
+    subtree of a DAG is substituted once, and the substituted copies of a
+    shared subtree are shared as well.
+*/
+class SubsMemo {
+public:
+    SubsMemo(const map_basic_basic &subs_dict);
+    ~SubsMemo();
+    //! \return `arg->subs(subs_dict)`, computed once per outermost `subs()`
+    RCP<const Basic> subs(const RCP<const Basic> &arg);
+private:
+    const map_basic_basic &subs_dict_;
+    SubsMemo *saved_;
+    umap_basic_basic own_;
+    umap_basic_basic *table_;
+};
+
+/*! Differentiation with a cache of the derivatives by (expression, symbol):
+    while `Differentiator::diff()` runs, the overrides of `Basic::diff()`
+    look up the derivatives of their arguments in the cache, so each
+    distinct subtree is differentiated once per symbol. Keep one instance to
+    share the work between many derivatives of the same expressions (e.g.
+    the entries of a Jacobian, see `jacobian()`).
+*/
+class Differentiator {
+public:
+    //! \return `b->diff(x)`
+    RCP<const Basic> diff(const RCP<const Basic> &b,
+            const RCP<const Symbol> &x);
+private:
+    // symbol -> (expression -> derivative)
+    std::unordered_map<RCP<const Basic>, umap_basic_basic,
+        RCPBasicHash, RCPBasicKeyEq> cache_;
+};
+
+/*! The Differentiator of the `diff()` running in the calling thread. The
+    overrides of `Basic::diff()` create one and differentiate their
+    arguments with `DiffMemo::diff()`: the outermost one (unless called by
+    `Differentiator::diff()`) owns a Differentiator, the nested ones share
+    it.
+*/
+class DiffMemo {
+public:
+    DiffMemo();
+    ~DiffMemo();
+    //! \return `arg->diff(x)`, computed once per outermost `diff()`
+    RCP<const Basic> diff(const RCP<const Basic> &arg,
+            const RCP<const Symbol> &x);
+private:
+    Differentiator *saved_;
+    Differentiator own_;
+};
+
+//! \return `arg->diff(x)` through a DiffMemo, for the overrides of
+//! `Basic::diff()` with one argument
+RCP<const Basic> diff_arg(const RCP<const Basic> &arg,
+        const RCP<const Symbol> &x);
 
 } // CSymPy
 
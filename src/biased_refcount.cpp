@@ -0,0 +1,178 @@
+#include "basic.h"
+
+#if defined(WITH_CSYMPY_BIASED_REFCOUNT)
+
+namespace CSymPy {
+
+namespace {
+
+// Records of exited threads, reused by new threads. Records are never freed,
+// as counters may still point to them. Never destroyed, so that objects
+// released during static destruction can still be merged.
+struct RefCountRegistry {
+    std::mutex mutex;
+    RefCountThread *free = nullptr;
+};
+
+RefCountRegistry &registry()
+{
+    static RefCountRegistry *r = new RefCountRegistry();
+    return *r;
+}
+
+thread_local bool thread_exited = false;
+
+} // anonymous namespace
+
+// Merges the queue of an exiting thread and hands its record over to the
+// registry. References dropped by the thread after this point (e.g. by
+// thread locals destroyed later) take the path of a non-owning thread.
+struct RefCountThreadExit {
+    RefCountThread *t = nullptr;
+    ~RefCountThreadExit() {
+        if (t == nullptr) return;
+        for (;;) {
+            t->drain();
+            std::lock_guard<std::mutex> lock(t->mutex_);
+            if (t->queue_.empty()) {
+                t->alive_ = false;
+                break;
+            }
+        }
+        RefCountThread::current_ref() = nullptr;
+        thread_exited = true;
+        RefCountRegistry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        t->next_free_ = r.free;
+        r.free = t;
+    }
+};
+
+namespace {
+
+thread_local RefCountThreadExit thread_exit;
+
+} // anonymous namespace
+
+RefCountThread *RefCountThread::register_thread()
+{
+    if (thread_exited) return nullptr;
+    RefCountThread *t;
+    {
+        RefCountRegistry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        t = r.free;
+        if (t != nullptr) r.free = t->next_free_;
+    }
+    if (t == nullptr) t = new RefCountThread();
+    {
+        // Objects still owned by the previous thread of a reused record are
+        // taken over by this thread
+        std::lock_guard<std::mutex> lock(t->mutex_);
+        t->alive_ = true;
+    }
+    thread_exit.t = t;
+    current_ref() = t;
+    return t;
+}
+
+void RefCountThread::drain()
+{
+    std::vector<const Basic *> q;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        q.swap(queue_);
+        pending.store(false, std::memory_order_relaxed);
+    }
+    for (const Basic *b: q)
+        if (b->refcount_.merge(this)) RCPDeleter<const Basic>::apply(b);
+}
+
+bool RefCountThread::enqueue(const Basic *b)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (alive_) {
+        queue_.push_back(b);
+        pending.store(true, std::memory_order_release);
+        return false;
+    }
+    // The owner has exited. The lock keeps a new thread from taking over
+    // this record while we merge.
+    return b->refcount_.merge(this);
+}
+
+void BiasedRefCount::acquire_slow(RefCountThread *me)
+{
+    if (owner_.load(std::memory_order_relaxed) == nullptr &&
+            shared_.load(std::memory_order_relaxed) == 0) {
+        // The first reference to a new object, no other thread can see it yet
+        if (me != nullptr) {
+            owner_.store(me, std::memory_order_relaxed);
+            biased_ = 1;
+        } else {
+            shared_.store(unit + merged, std::memory_order_relaxed);
+        }
+        return;
+    }
+    shared_.fetch_add(unit, std::memory_order_relaxed);
+}
+
+bool BiasedRefCount::release_slow(const Basic *b)
+{
+    // The owner must be read before our reference is dropped: afterwards it
+    // may merge the counter at any time.
+    RefCountThread *owner = owner_.load(std::memory_order_acquire);
+    long s = shared_.fetch_sub(unit, std::memory_order_acq_rel) - unit;
+    if (s & merged) return count(s) == 0 && !(s & queued);
+    // Not merged yet, so the owner holds references and `count(s) < 0` means
+    // that some of them were handed to other threads and dropped there
+    while (count(s) < 0 && !(s & (merged | queued))) {
+        if (shared_.compare_exchange_weak(s, s + queued,
+                std::memory_order_acq_rel)) {
+            CSYMPY_ASSERT(owner != nullptr)
+            return owner->enqueue(b);
+        }
+    }
+    return false;
+}
+
+bool BiasedRefCount::release_last_biased(RefCountThread *me)
+{
+    owner_.store(nullptr, std::memory_order_relaxed);
+    long s = shared_.fetch_add(merged, std::memory_order_acq_rel) + merged;
+    // If it is queued, drain() finishes the merge
+    return count(s) == 0 && !(s & queued);
+}
+
+bool BiasedRefCount::merge(RefCountThread *t)
+{
+    long add = -queued;
+    if (owner_.load(std::memory_order_relaxed) == t) {
+        owner_.store(nullptr, std::memory_order_relaxed);
+        add += biased_ * unit + merged;
+        biased_ = 0;
+    }
+    long s = shared_.fetch_add(add, std::memory_order_acq_rel) + add;
+    return count(s) == 0;
+}
+
+bool BiasedRefCount::try_acquire()
+{
+    RefCountThread *me = RefCountThread::current();
+    if (me != nullptr && owner_.load(std::memory_order_relaxed) == me) {
+        biased_++;
+        return true;
+    }
+    // Alive while the owner still holds references or other threads do
+    long s = shared_.load(std::memory_order_relaxed);
+    while (!(s & merged) || count(s) > 0) {
+        if (shared_.compare_exchange_weak(s, s + unit,
+                std::memory_order_acq_rel))
+            return true;
+    }
+    return false;
+}
+
+} // CSymPy
+
+#endif
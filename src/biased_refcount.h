@@ -0,0 +1,142 @@
+/**
+ *  \file biased_refcount.h
+ *  Reference counter that is non-atomic for the owning thread
+ *
+ **/
+#ifndef CSYMPY_BIASED_REFCOUNT_H
+#define CSYMPY_BIASED_REFCOUNT_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "csympy_config.h"
+
+namespace CSymPy {
+
+class Basic;
+class RefCountThread;
+
+/*  Biased reference counting: most objects are only ever referenced from the
+    thread that created them, so that thread (the owner) counts its references
+    in `biased_` with plain (non-atomic) instructions. Other threads count
+    theirs in the atomic `shared_`, which becomes negative when they drop
+    references that the owner handed to them.
+
+    When the owner drops its last reference, it gives up the ownership and
+    marks the counter as merged: from then on all threads use `shared_` only,
+    and the object is deleted when it drops to zero. When another thread makes
+    `shared_` negative, it queues the object to the owner, which merges it
+    (moves `biased_` into `shared_`) the next time it drops a reference, or
+    when it exits. Objects of threads that have exited are merged right away
+    by the thread that would queue them.
+
+    When CSymPy is configured with WITH_CSYMPY_THREAD_SAFE and
+    WITH_CSYMPY_BIASED_REFCOUNT, `Basic::refcount_` is a BiasedRefCount: code
+    running in one thread pays a thread local load and a compare for each
+    reference count operation instead of an atomic read-modify-write.
+*/
+class BiasedRefCount {
+    // The owner: null before the first reference is taken and after the
+    // counter is merged
+    std::atomic<RefCountThread *> owner_;
+    // References counted by the owner, only accessed by the owner
+    unsigned int biased_;
+    // (References counted by other threads) * `unit` + flags
+    std::atomic<long> shared_;
+
+    static const long merged = 1;
+    static const long queued = 2;
+    static const long unit = 4;
+    static long count(long s) { return (s - (s & 3)) / unit; }
+
+    void acquire_slow(RefCountThread *me);
+    bool release_slow(const Basic *b);
+    bool release_last_biased(RefCountThread *me);
+    // Moves the references counted by `t` (if it is still the owner) into
+    // `shared_` and clears the queued flag, \return true if none are left
+    bool merge(RefCountThread *t);
+
+    friend class RefCountThread;
+
+public:
+    BiasedRefCount(unsigned int) : owner_{nullptr}, biased_{0}, shared_{0} {}
+
+    //! Takes one reference
+    inline void operator++(int);
+    //! Drops one reference to `b`, the object this counter belongs to.
+    //! \return true if it was the last one, then the caller deletes `b`
+    inline bool release(const Basic *b);
+    //! Takes one reference if the object is still alive (for the unique
+    //! table, which holds non-owning pointers). \return true on success
+    bool try_acquire();
+};
+
+//! The reference counting state of a thread
+class RefCountThread {
+public:
+    //! Objects were queued to this thread
+    std::atomic<bool> pending;
+
+    //! \return the calling thread (registering it on first use), or null
+    //! if the calling thread is exiting
+    static inline RefCountThread *current();
+    //! Merges the objects queued to this thread, must be called by it
+    void drain();
+    //! Queues `b` (whose counter became negative) to this thread.
+    //! \return true if `b` has to be deleted by the caller
+    bool enqueue(const Basic *b);
+
+private:
+    std::mutex mutex_;
+    std::vector<const Basic *> queue_;
+    bool alive_;
+    RefCountThread *next_free_;
+
+    RefCountThread() : pending{false}, alive_{false}, next_free_{nullptr} {}
+    static RefCountThread *&current_ref() {
+        static thread_local RefCountThread *t = nullptr;
+        return t;
+    }
+    static RefCountThread *register_thread();
+
+    friend struct RefCountThreadExit;
+};
+
+inline RefCountThread *RefCountThread::current()
+{
+    RefCountThread *t = current_ref();
+    if (t != nullptr) return t;
+    return register_thread();
+}
+
+inline void BiasedRefCount::operator++(int)
+{
+    RefCountThread *me = RefCountThread::current();
+    if (owner_.load(std::memory_order_relaxed) == me && me != nullptr)
+        biased_++;
+    else
+        acquire_slow(me);
+}
+
+inline bool BiasedRefCount::release(const Basic *b)
+{
+    RefCountThread *me = RefCountThread::current();
+    if (owner_.load(std::memory_order_relaxed) == me && me != nullptr) {
+        bool last = (--biased_ == 0) && release_last_biased(me);
+        if (me->pending.load(std::memory_order_relaxed)) me->drain();
+        return last;
+    }
+    return release_slow(b);
+}
+
+//! Drops a reference counted by a BiasedRefCount (see `rcp_release()`)
+template <class T>
+inline bool rcp_release(BiasedRefCount &count, T *p)
+{
+    return count.release(p);
+}
+
+} // CSymPy
+
+#endif
@@ -0,0 +1,608 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "basic.h"
+#include "symbol.h"
+#include "add.h"
+#include "integer.h"
+#include "rational.h"
+#include "complex.h"
+#include "mul.h"
+#include "pow.h"
+#include "functions.h"
+#include "constants.h"
+#include "polynomial.h"
+#include "visitor.h"
+#include "ccode.h"
+
+namespace CSymPy {
+
+namespace {
+
+// The shortest decimal literal that reads back as `d`, with a decimal
+// point so that C reads it as a double
+std::string double_literal(double d)
+{
+    char s[32];
+    for (int digits = 15; digits <= 17; digits++) {
+        snprintf(s, sizeof(s), "%.*g", digits, d);
+        if (strtod(s, nullptr) == d) break;
+    }
+    std::string r = s;
+    if (r.find_first_of(".en") == std::string::npos) r += ".0";
+    return r;
+}
+
+} // anonymous namespace
+
+// Prints expressions as C code, see ccode.h
+class CCodePrinter : public Visitor {
+public:
+    //! Highest integer power printed as a product, higher ones use `pow`
+    static const int max_mul_power = 8;
+
+    //! \return `b` as a C expression
+    std::string apply(const Basic &b);
+
+    //! \return the C function of ccode_function()
+    std::string function(const std::string &name, const vec_basic &exprs,
+            const vec_basic &symbols, const std::string &qualifiers = "");
+
+    void visit(const Symbol &x);
+    void visit(const Add &x);
+    void visit(const Mul &x);
+    void visit(const Pow &x);
+    void visit(const Integer &x);
+    void visit(const Rational &x);
+    void visit(const Complex &x);
+    void visit(const Log &x);
+    void visit(const Derivative &x);
+    void visit(const Sin &x);
+    void visit(const Cos &x);
+    void visit(const Tan &x);
+    void visit(const Cot &x);
+    void visit(const Csc &x);
+    void visit(const Sec &x);
+    void visit(const ASin &x);
+    void visit(const ACos &x);
+    void visit(const ASec &x);
+    void visit(const ACsc &x);
+    void visit(const ATan &x);
+    void visit(const ACot &x);
+    void visit(const ATan2 &x);
+    void visit(const LambertW &x);
+    void visit(const FunctionSymbol &x);
+    void visit(const Sinh &x);
+    void visit(const Cosh &x);
+    void visit(const Tanh &x);
+    void visit(const Coth &x);
+    void visit(const ASinh &x);
+    void visit(const ACosh &x);
+    void visit(const ATanh &x);
+    void visit(const ACoth &x);
+    void visit(const KroneckerDelta &x);
+    void visit(const LeviCivita &x);
+    void visit(const Zeta &x);
+    void visit(const Dirichlet_eta &x);
+    void visit(const Gamma &x);
+    void visit(const LowerGamma &x);
+    void visit(const UpperGamma &x);
+    void visit(const Constant &x);
+    void visit(const Abs &x);
+    void visit(const Subs &x);
+    void visit(const Polynomial &x);
+
+private:
+    // Precedence of a printed expression, its operands of lower
+    // precedence are parenthesized
+    enum Precedence {
+        SUM, PRODUCT, ATOM
+    };
+
+    struct PtrHash {
+        std::size_t operator()(const Basic *b) const { return b->hash(); }
+    };
+    struct PtrEq {
+        bool operator()(const Basic *a, const Basic *b) const {
+            return a == b || a->__eq__(*b);
+        }
+    };
+    typedef std::unordered_map<const Basic *, std::string, PtrHash, PtrEq>
+        names_type;
+
+    std::string result_;
+    Precedence precedence_;
+    // Set by function(): number of occurrences of the subexpressions,
+    // indices of the symbols in `in`, names of the local variables and
+    // their definitions
+    bool in_function_ = false;
+    std::unordered_map<const Basic *, unsigned, PtrHash, PtrEq> counts_;
+    std::unordered_map<const Basic *, std::size_t, PtrHash, PtrEq> inputs_;
+    names_type names_;
+    std::string body_;
+    std::size_t inputs_used_ = 0;
+    // Nodes built while printing, kept alive as they may be keys of names_
+    vec_basic temporaries_;
+
+    void count(const Basic &b);
+    // Prints `b` into `result_` and `precedence_`
+    void print(const Basic &b);
+    // \return `b` printed with at least the precedence `p`
+    std::string operand(const Basic &b, Precedence p);
+    // \return `b` as a local variable (in function()), or as an operand
+    // of a product
+    std::string bind(const Basic &b);
+    // Assigns `result_` (the printed `b`) to a new local variable
+    void assign(const Basic &b);
+    // \return `f(arg)` and `f(1.0/arg)`
+    std::string call(const std::string &f, const Basic &arg);
+    std::string reciprocal(const std::string &f, const Basic &arg);
+    // \return `base**exp`, `precedence_` is set to its precedence
+    std::string power(const Basic &base, const Basic &exp);
+};
+
+std::string CCodePrinter::apply(const Basic &b)
+{
+    print(b);
+    return result_;
+}
+
+void CCodePrinter::print(const Basic &b)
+{
+    if (in_function_) {
+        auto it = names_.find(&b);
+        if (it != names_.end()) {
+            result_ = it->second;
+            precedence_ = ATOM;
+            return;
+        }
+    }
+    b.accept(*this);
+    if (in_function_) {
+        auto it = counts_.find(&b);
+        if (it != counts_.end() && it->second > 1) assign(b);
+    }
+}
+
+std::string CCodePrinter::operand(const Basic &b, Precedence p)
+{
+    print(b);
+    if (precedence_ < p) return "(" + result_ + ")";
+    return result_;
+}
+
+std::string CCodePrinter::bind(const Basic &b)
+{
+    if (!in_function_) return operand(b, ATOM);
+    print(b);
+    if (!is_a<Symbol>(b) && !is_a_Number(b) && names_.find(&b) == names_.end())
+        assign(b);
+    return result_;
+}
+
+void CCodePrinter::assign(const Basic &b)
+{
+    std::string name = "cse" + std::to_string(names_.size() - inputs_used_);
+    body_ += "    const double " + name + " = " + result_ + ";\n";
+    names_[&b] = name;
+    result_ = name;
+    precedence_ = ATOM;
+}
+
+std::string CCodePrinter::call(const std::string &f, const Basic &arg)
+{
+    std::string r = f + "(" + apply(arg) + ")";
+    precedence_ = ATOM;
+    return r;
+}
+
+std::string CCodePrinter::reciprocal(const std::string &f, const Basic &arg)
+{
+    std::string r = f + "(1.0/" + operand(arg, ATOM) + ")";
+    precedence_ = ATOM;
+    return r;
+}
+
+std::string CCodePrinter::power(const Basic &base, const Basic &exp)
+{
+    std::string r;
+    if (is_a<Constant>(base) && base.__eq__(*E)) return call("exp", exp);
+    if (is_a<Integer>(exp)) {
+        const mpz_class &e = static_cast<const Integer &>(exp).i;
+        if (e == 1) {
+            print(base);
+            return result_;
+        }
+        if (e == 0) {
+            precedence_ = ATOM;
+            return "1.0";
+        }
+        if (abs(e) <= max_mul_power) {
+            long n = mpz_class(abs(e)).get_si();
+            std::string b = bind(base);
+            r = b;
+            for (long i = 1; i < n; i++) r += "*" + b;
+            if (e < 0) r = "1.0/" + ((n == 1) ? r : "(" + r + ")");
+            precedence_ = (n == 1 && e > 0) ? ATOM : PRODUCT;
+            return r;
+        }
+    }
+    if (is_a<Rational>(exp)) {
+        const mpq_class &e = static_cast<const Rational &>(exp).i;
+        if (e == mpq_class(1, 2)) return call("sqrt", base);
+        if (e == mpq_class(-1, 2)) {
+            r = "1.0/" + call("sqrt", base);
+            precedence_ = PRODUCT;
+            return r;
+        }
+    }
+    r = apply(base);
+    r = "pow(" + r + ", " + apply(exp) + ")";
+    precedence_ = ATOM;
+    return r;
+}
+
+void CCodePrinter::visit(const Symbol &x)
+{
+    if (in_function_) {
+        auto it = inputs_.find(&x);
+        if (it == inputs_.end())
+            throw std::runtime_error("Symbol not in the list of symbols.");
+        body_ += "    const double " + x.get_name() + " = in["
+            + std::to_string(it->second) + "];\n";
+        names_[&x] = x.get_name();
+        inputs_used_++;
+    }
+    result_ = x.get_name();
+    precedence_ = ATOM;
+}
+
+void CCodePrinter::visit(const Integer &x)
+{
+    result_ = x.i.get_str() + ".0";
+    precedence_ = (x.is_negative()) ? SUM : ATOM;
+}
+
+void CCodePrinter::visit(const Rational &x)
+{
+    result_ = double_literal(x.i.get_d());
+    precedence_ = (x.is_negative()) ? SUM : ATOM;
+}
+
+void CCodePrinter::visit(const Constant &x)
+{
+    if (x.__eq__(*pi))
+        result_ = double_literal(::acos(-1.0));
+    else if (x.__eq__(*E))
+        result_ = double_literal(::exp(1.0));
+    else
+        throw std::runtime_error("Not implemented.");
+    precedence_ = ATOM;
+}
+
+void CCodePrinter::visit(const Add &x)
+{
+    std::string r;
+    for (auto &p: x.dict_) {
+        std::string t;
+        if (p.second->is_one())
+            t = operand(*(p.first), SUM);
+        else if (p.second->is_minus_one())
+            t = "-" + operand(*(p.first), PRODUCT);
+        else
+            t = apply(*(p.second)) + "*" + operand(*(p.first), PRODUCT);
+        if (r.empty())
+            r = t;
+        else if (t[0] == '-')
+            r += " - " + t.substr(1);
+        else
+            r += " + " + t;
+    }
+    if (!x.coef_->is_zero()) {
+        std::string c = apply(*(x.coef_));
+        if (c[0] == '-')
+            r += " - " + c.substr(1);
+        else
+            r += " + " + c;
+    }
+    result_ = r;
+    precedence_ = SUM;
+}
+
+void CCodePrinter::visit(const Mul &x)
+{
+    // Factors with negative exponents go to the denominator
+    std::string num, den;
+    unsigned nden = 0;
+    for (auto &p: x.dict_) {
+        if (is_a_Number(*(p.second)) &&
+                rcp_static_cast<const Number>(p.second)->is_negative()) {
+            RCP<const Number> e =
+                rcp_static_cast<const Number>(p.second)->mul(*minus_one);
+            temporaries_.push_back(e);
+            std::string f = power(*(p.first), *e);
+            if (precedence_ == SUM) f = "(" + f + ")";
+            den += (den.empty() ? "" : "*") + f;
+            nden += (precedence_ == PRODUCT) ? 2 : 1;
+        } else {
+            std::string f = power(*(p.first), *(p.second));
+            if (precedence_ == SUM) f = "(" + f + ")";
+            num += (num.empty() ? "" : "*") + f;
+        }
+    }
+    std::string r;
+    if (x.coef_->is_minus_one()) {
+        r = "-" + (num.empty() ? "1.0" : num);
+    } else if (x.coef_->is_one()) {
+        r = (num.empty() ? "1.0" : num);
+    } else {
+        r = apply(*(x.coef_));
+        if (!num.empty()) r += "*" + num;
+    }
+    if (!den.empty()) r += "/" + ((nden > 1) ? "(" + den + ")" : den);
+    result_ = r;
+    precedence_ = (r[0] == '-') ? SUM : PRODUCT;
+}
+
+void CCodePrinter::visit(const Pow &x)
+{
+    result_ = power(*(x.base_), *(x.exp_));
+}
+
+void CCodePrinter::visit(const Sin &x)
+{
+    result_ = call("sin", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Cos &x)
+{
+    result_ = call("cos", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Tan &x)
+{
+    result_ = call("tan", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ASin &x)
+{
+    result_ = call("asin", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ACos &x)
+{
+    result_ = call("acos", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ATan &x)
+{
+    result_ = call("atan", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Sinh &x)
+{
+    result_ = call("sinh", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Cosh &x)
+{
+    result_ = call("cosh", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Tanh &x)
+{
+    result_ = call("tanh", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ASinh &x)
+{
+    result_ = call("asinh", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ACosh &x)
+{
+    result_ = call("acosh", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ATanh &x)
+{
+    result_ = call("atanh", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Log &x)
+{
+    result_ = call("log", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Gamma &x)
+{
+    result_ = call("tgamma", *x.get_args()[0]);
+}
+
+void CCodePrinter::visit(const Abs &x)
+{
+    result_ = call("fabs", *x.get_arg());
+}
+
+void CCodePrinter::visit(const Cot &x)
+{
+    result_ = "1.0/" + call("tan", *x.get_arg());
+    precedence_ = PRODUCT;
+}
+
+void CCodePrinter::visit(const Csc &x)
+{
+    result_ = "1.0/" + call("sin", *x.get_arg());
+    precedence_ = PRODUCT;
+}
+
+void CCodePrinter::visit(const Sec &x)
+{
+    result_ = "1.0/" + call("cos", *x.get_arg());
+    precedence_ = PRODUCT;
+}
+
+void CCodePrinter::visit(const Coth &x)
+{
+    result_ = "1.0/" + call("tanh", *x.get_arg());
+    precedence_ = PRODUCT;
+}
+
+void CCodePrinter::visit(const ASec &x)
+{
+    result_ = reciprocal("acos", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ACsc &x)
+{
+    result_ = reciprocal("asin", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ACot &x)
+{
+    result_ = reciprocal("atan", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ACoth &x)
+{
+    result_ = reciprocal("atanh", *x.get_arg());
+}
+
+void CCodePrinter::visit(const ATan2 &x)
+{
+    std::string num = apply(*x.get_num());
+    result_ = "atan2(" + num + ", " + apply(*x.get_den()) + ")";
+    precedence_ = ATOM;
+}
+
+void CCodePrinter::visit(const Polynomial &x)
+{
+    temporaries_.push_back(x.as_basic());
+    print(*temporaries_.back());
+}
+
+void CCodePrinter::visit(const Complex &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const Derivative &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const LambertW &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const FunctionSymbol &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const KroneckerDelta &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const LeviCivita &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const Zeta &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const Dirichlet_eta &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const LowerGamma &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const UpperGamma &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::visit(const Subs &)
+{
+    throw std::runtime_error("Not implemented.");
+}
+
+void CCodePrinter::count(const Basic &b)
+{
+    if (is_a_Number(b) || is_a<Symbol>(b)) return;
+    if (++counts_[&b] > 1) return;
+    b.for_each_arg([this](const Basic &arg) {
+        count(arg);
+        return true;
+    });
+}
+
+std::string CCodePrinter::function(const std::string &name,
+        const vec_basic &exprs, const vec_basic &symbols,
+        const std::string &qualifiers)
+{
+    counts_.clear();
+    names_.clear();
+    inputs_.clear();
+    body_.clear();
+    inputs_used_ = 0;
+    for (std::size_t i = 0; i < symbols.size(); i++) {
+        if (!is_a<Symbol>(*symbols[i]))
+            throw std::runtime_error("Only symbols can be arguments.");
+        inputs_[symbols[i].get()] = i;
+    }
+    for (auto &e: exprs) count(*e);
+
+    std::string out;
+    in_function_ = true;
+    try {
+        for (std::size_t i = 0; i < exprs.size(); i++)
+            out += "    out[" + std::to_string(i) + "] = "
+                + apply(*exprs[i]) + ";\n";
+    } catch (...) {
+        in_function_ = false;
+        throw;
+    }
+    in_function_ = false;
+
+    std::string r = qualifiers.empty() ? "" : qualifiers + " ";
+    r += "void " + name + "(const double *in, double *out)\n{\n";
+    r += body_ + out + "}\n";
+    return r;
+}
+
+std::string ccode(const Basic &b)
+{
+    CCodePrinter p;
+    return p.apply(b);
+}
+
+std::string ccode_function(const std::string &name, const vec_basic &exprs,
+        const vec_basic &symbols, const std::string &qualifiers)
+{
+    CCodePrinter p;
+    return p.function(name, exprs, symbols, qualifiers);
+}
+
+std::string ccode_function(const std::string &name, const DenseMatrix &m,
+        const vec_basic &symbols, const std::string &qualifiers)
+{
+    vec_basic exprs;
+    for (unsigned i = 0; i < m.nrows(); i++)
+        for (unsigned j = 0; j < m.ncols(); j++)
+            exprs.push_back(m.get(i, j));
+    return ccode_function(name, exprs, symbols, qualifiers);
+}
+
+} // CSymPy
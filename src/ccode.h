@@ -0,0 +1,41 @@
+/**
+ *  \file ccode.h
+ *  Printing of expressions as C code
+ *
+ **/
+#ifndef CSYMPY_CCODE_H
+#define CSYMPY_CCODE_H
+
+#include "basic.h"
+#include "matrix.h"
+
+namespace CSymPy {
+
+/*  C (or CUDA) code computing expressions in double precision with the
+    functions of `<math.h>`, for embedding them in other programs.
+
+    Numbers are printed as double literals, integer powers up to the 8th as
+    products (`x*x*x`), powers of one half as `sqrt` and `E**x` as
+    `exp(x)`. Symbols are printed by name, so their names must be valid C
+    identifiers.
+*/
+
+//! \return `b` as a C expression
+std::string ccode(const Basic &b);
+/*! \return the C function
+        `qualifiers void name(const double *in, double *out)`
+    computing `exprs` into `out`, where `in[i]` is the value of
+    `symbols[i]`. Each subexpression that occurs more than once (and each
+    base of a power printed as a product) is computed once into a local
+    variable. Use `qualifiers` for e.g. `static inline` or (CUDA)
+    `__device__`.
+*/
+std::string ccode_function(const std::string &name, const vec_basic &exprs,
+        const vec_basic &symbols, const std::string &qualifiers = "");
+//! \return a C function computing the entries of `m` in row-major order
+std::string ccode_function(const std::string &name, const DenseMatrix &m,
+        const vec_basic &symbols, const std::string &qualifiers = "");
+
+} // CSymPy
+
+#endif
@@ -48,6 +48,7 @@ public:
     virtual RCP<const Basic> diff(const RCP<const Symbol> &x) const;
 
     virtual vec_basic get_args() const { return {}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return true; }
 
     virtual void accept(Visitor &v) const;
 };
@@ -59,6 +59,22 @@ Ptr<T> outArg( T& arg )
 
 enum ENull { null };
 
+// Drops one reference counted by `count` (the `refcount_` of `p`), returns
+// true if it was the last one. Overloaded for counters that need to know
+// the object (see biased_refcount.h).
+template<class C, class T>
+inline bool rcp_release(C &count, T *p)
+{
+    return --count == 0;
+}
+
+// Deletes `p` after its last reference was dropped. Specialized for Basic
+// when deletions are deferred (see deferred_release.h).
+template<class T, class Enable = void>
+struct RCPDeleter {
+    static void apply(T *p) { delete p; }
+};
+
 // RCP can be null. Functionally it should be equivalent to Teuchos::RCP.
 
 template<class T>
@@ -86,7 +102,8 @@ public:
         r_ptr._set_null();
     }
     ~RCP() {
-        if (ptr_ != nullptr && --(ptr_->refcount_) == 0) delete ptr_;
+        if (ptr_ != nullptr && rcp_release(ptr_->refcount_, ptr_))
+            RCPDeleter<T>::apply(ptr_);
     }
     T* operator->() const {
         CSYMPY_ASSERT(ptr_ != nullptr)
@@ -109,7 +126,8 @@ public:
     RCP<T>& operator=(const RCP<T> &r_ptr) {
         T *r_ptr_ptr_ = r_ptr.ptr_;
         if (!r_ptr.is_null()) (r_ptr_ptr_->refcount_)++;
-        if (!is_null() && --(ptr_->refcount_) == 0) delete ptr_;
+        if (!is_null() && rcp_release(ptr_->refcount_, ptr_))
+            RCPDeleter<T>::apply(ptr_);
         ptr_ = r_ptr_ptr_;
         return *this;
     }
@@ -119,7 +137,8 @@ public:
         return *this;
     }
     void reset() {
-        if (!is_null() && --(ptr_->refcount_) == 0) delete ptr_;
+        if (!is_null() && rcp_release(ptr_->refcount_, ptr_))
+            RCPDeleter<T>::apply(ptr_);
         ptr_ = nullptr;
     }
     // Don't use this function directly:
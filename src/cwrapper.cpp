@@ -116,6 +116,22 @@ void basic_mul(basic s, const basic a, const basic b)
     s->ptr = CSymPy::mul(a->ptr, b->ptr);
 }
 
+void basic_add_terms(basic s, const basic *terms, size_t n)
+{
+    CSymPy::vec_basic v;
+    v.reserve(n);
+    for (size_t i = 0; i < n; i++) v.push_back(terms[i]->ptr);
+    s->ptr = CSymPy::Add::from_terms(v);
+}
+
+void basic_mul_factors(basic s, const basic *factors, size_t n)
+{
+    CSymPy::vec_basic v;
+    v.reserve(n);
+    for (size_t i = 0; i < n; i++) v.push_back(factors[i]->ptr);
+    s->ptr = CSymPy::Mul::from_factors(v);
+}
+
 void basic_pow(basic s, const basic a, const basic b)
 {
     s->ptr = CSymPy::pow(a->ptr, b->ptr);
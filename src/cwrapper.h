@@ -1,6 +1,7 @@
 #ifndef CWRAPPER_H
 #define CWRAPPER_H
 
+#include <stddef.h>
 #include <gmp.h>
 
 #ifdef __cplusplus
@@ -55,6 +56,10 @@ void basic_add(basic s, const basic a, const basic b);
 void basic_sub(basic s, const basic a, const basic b);
 //! Assigns s = a * b.
 void basic_mul(basic s, const basic a, const basic b);
+//! Assigns s = terms[0] + ... + terms[n-1].
+void basic_add_terms(basic s, const basic *terms, size_t n);
+//! Assigns s = factors[0] * ... * factors[n-1].
+void basic_mul_factors(basic s, const basic *factors, size_t n);
 //! Assigns s = a / b.
 void basic_div(basic s, const basic a, const basic b);
 //! Assigns s = a ^ b.
@@ -0,0 +1,111 @@
+#include <vector>
+
+#include "deferred_release.h"
+
+namespace CSymPy {
+
+#if defined(WITH_CSYMPY_DEFERRED_RELEASE)
+
+namespace {
+
+// The per-thread state is made of plain (trivially destructible) thread
+// locals, so that nodes released after `ReleaseFlusher` below has run (by
+// thread locals destroyed later, or during static destruction) can still be
+// handled: they are then deleted recursively.
+thread_local std::vector<const Basic *> *queue = nullptr;
+thread_local bool deferred = false;
+thread_local bool draining = false;
+thread_local bool exited = false;
+
+// Deletes queued nodes from the back (so that the children of a node are
+// deleted right after it), at most `max` of them
+void drain(std::size_t max)
+{
+    bool outer = !draining;
+    draining = true;
+    for (; max > 0 && queue != nullptr && !queue->empty(); max--) {
+        const Basic *b = queue->back();
+        queue->pop_back();
+        delete b;
+    }
+    if (outer) draining = false;
+}
+
+// Deletes what is left in the queue when the thread exits
+struct ReleaseFlusher {
+    bool active = true;
+    ~ReleaseFlusher() {
+        deferred = false;
+        drain(std::numeric_limits<std::size_t>::max());
+        delete queue;
+        queue = nullptr;
+        exited = true;
+    }
+};
+
+thread_local ReleaseFlusher flusher;
+
+void push(const Basic *b)
+{
+    if (queue == nullptr) {
+        // Make sure the flusher of this thread is constructed
+        (void)flusher.active;
+        queue = new std::vector<const Basic *>();
+    }
+    queue->push_back(b);
+}
+
+} // anonymous namespace
+
+void release_basic(const Basic *b)
+{
+    if (exited) {
+        delete b;
+    } else if (draining || deferred) {
+        push(b);
+    } else {
+        // The children of `b` are queued while it is deleted
+        draining = true;
+        delete b;
+        drain(std::numeric_limits<std::size_t>::max());
+        draining = false;
+    }
+}
+
+void set_deferred_release(bool enable)
+{
+    if (exited) return;
+    deferred = enable;
+    if (!enable) drain(std::numeric_limits<std::size_t>::max());
+}
+
+std::size_t release_pending(std::size_t max)
+{
+    drain(max);
+    return pending_release_count();
+}
+
+std::size_t pending_release_count()
+{
+    return queue == nullptr ? 0 : queue->size();
+}
+
+#else
+
+void set_deferred_release(bool enable)
+{
+}
+
+std::size_t release_pending(std::size_t max)
+{
+    return 0;
+}
+
+std::size_t pending_release_count()
+{
+    return 0;
+}
+
+#endif
+
+} // CSymPy
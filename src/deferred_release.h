@@ -0,0 +1,54 @@
+/**
+ *  \file deferred_release.h
+ *  Iterative and deferred deletion of expression trees
+ *
+ **/
+#ifndef CSYMPY_DEFERRED_RELEASE_H
+#define CSYMPY_DEFERRED_RELEASE_H
+
+#include <cstddef>
+#include <limits>
+
+#include "basic.h"
+
+namespace CSymPy {
+
+/*  By default, dropping the last RCP to an expression deletes it, which
+    drops the references to its children, which deletes them, and so on: a
+    recursion as deep as the tree, that runs to completion before the RCP
+    destructor returns.
+
+    When CSymPy is configured with WITH_CSYMPY_DEFERRED_RELEASE, nodes whose
+    last reference is dropped are deleted through `release_basic()`, which
+    puts them on a queue of the calling thread instead of recursing. The
+    queue is drained in a loop, so deleting a tree of any depth only needs a
+    constant amount of stack.
+
+    With `set_deferred_release(true)` the queue of the calling thread is not
+    drained automatically any more: dropping a huge expression only queues
+    its root, and the thread deletes the queued nodes in slices of its
+    choice by calling `release_pending(max)` (e.g. between requests), which
+    keeps the pauses short. Whatever is still queued is deleted when the
+    thread exits.
+
+    Queued nodes are dead: they are not returned by hash-consing any more.
+    Without WITH_CSYMPY_DEFERRED_RELEASE the functions below do nothing.
+*/
+
+//! Enables (`true`) or disables (`false`) deferring the deletions of the
+//! calling thread until `release_pending()` is called. Disabled by default.
+//! Disabling it deletes all queued nodes.
+void set_deferred_release(bool enable);
+
+//! Deletes at most `max` of the nodes queued by the calling thread (the
+//! children of the deleted nodes are queued in turn).
+//! \return the number of nodes still queued
+std::size_t release_pending(std::size_t max =
+        std::numeric_limits<std::size_t>::max());
+
+//! \return the number of nodes queued by the calling thread
+std::size_t pending_release_count();
+
+} // CSymPy
+
+#endif
@@ -1,8 +1,18 @@
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
 #include "matrix.h"
 #include "add.h"
 #include "mul.h"
 #include "integer.h"
 #include "pow.h"
+#include "rational.h"
+#include "complex.h"
+#include "symbol.h"
+#include "ntheory.h"
+#include "polynomial.h"
 
 namespace CSymPy {
 
@@ -22,6 +32,12 @@ DenseMatrix::DenseMatrix(unsigned row, unsigned col, const vec_basic &l)
     CSYMPY_ASSERT(m_.size() == row*col)
 }
 
+DenseMatrix::DenseMatrix(unsigned row, unsigned col, vec_basic &&l)
+        : MatrixBase(row, col), m_{std::move(l)}
+{
+    CSYMPY_ASSERT(m_.size() == row*col)
+}
+
 // Get and set elements
 RCP<const Basic> DenseMatrix::get(unsigned i, unsigned j) const
 {
@@ -170,9 +186,7 @@ void transpose_dense(const DenseMatrix &A, DenseMatrix &B)
 {
     CSYMPY_ASSERT(B.row_ == A.col_ && B.col_ == A.row_);
 
-    for (unsigned i = 0; i < A.row_; i++)
-        for (unsigned j = 0; j < A.col_; j++)
-            B.m_[j*B.col_ + i] = A.m_[i*A.col_ + j];
+    copy_dense(A.view().transpose(), B.view());
 }
 
 // ------------------------------- Submatrix ---------------------------------//
@@ -185,12 +199,17 @@ void submatrix_dense(const DenseMatrix &A, unsigned row_start, unsigned row_end,
     CSYMPY_ASSERT(B.row_ == row_end - row_start + 1 &&
             B.col_ == col_end - col_start + 1);
 
-    unsigned row = B.row_, col = B.col_;
+    copy_dense(A.view().submatrix(row_start, row_end, col_start, col_end),
+        B.view());
+}
+
+void copy_dense(const ConstDenseMatrixView &A, const DenseMatrixView &B)
+{
+    CSYMPY_ASSERT(A.nrows() == B.nrows() && A.ncols() == B.ncols());
 
-    for (unsigned i = 0; i < row; i++)
-        for (unsigned j = 0; j < col; j++)
-            B.m_[i*col + j] =
-                A.m_[(row_start + i)*A.col_ + col_start + j];
+    for (unsigned i = 0; i < A.nrows(); i++)
+        for (unsigned j = 0; j < A.ncols(); j++)
+            B(i, j) = A(i, j);
 }
 
 // ------------------------------- Matrix Addition ---------------------------//
@@ -208,6 +227,25 @@ void add_dense_dense(const DenseMatrix &A, const DenseMatrix &B, DenseMatrix &C)
     }
 }
 
+void add_dense_dense(const ConstDenseMatrixView &A,
+    const ConstDenseMatrixView &B, const DenseMatrixView &C)
+{
+    CSYMPY_ASSERT(A.nrows() == B.nrows() && A.ncols() == B.ncols() &&
+        A.nrows() == C.nrows() && A.ncols() == C.ncols());
+
+    for (unsigned i = 0; i < A.nrows(); i++)
+        for (unsigned j = 0; j < A.ncols(); j++)
+            C(i, j) = add(A(i, j), B(i, j));
+}
+
+void iadd_dense_dense(DenseMatrix &A, const DenseMatrix &B)
+{
+    CSYMPY_ASSERT(A.row_ == B.row_ && A.col_ == B.col_);
+
+    for (unsigned i = 0; i < A.m_.size(); i++)
+        A.m_[i] = add(A.m_[i], B.m_[i]);
+}
+
 void add_dense_scalar(const DenseMatrix &A, const RCP<const Basic> &k, DenseMatrix &B)
 {
     CSYMPY_ASSERT(A.row_ == B.row_ && A.col_ == B.col_);
@@ -222,21 +260,128 @@ void add_dense_scalar(const DenseMatrix &A, const RCP<const Basic> &k, DenseMatr
 }
 
 // ------------------------------- Matrix Multiplication ---------------------//
+namespace {
+
+// The output of mul_dense_dense() is computed in tiles of `mul_tile` x
+// `mul_tile` entries, so that the columns of B used by a tile stay in the
+// cache while it is computed
+const unsigned mul_tile = 16;
+
+// Computes the tile `t` (the tiles are numbered row by row) of `c = a*b`.
+// Each entry is built as one sum of all its terms (in `terms`), instead of by
+// `add()` term by term, which would create `inner - 1` intermediate Adds.
+void mul_dense_tile(const ConstDenseMatrixView &a,
+        const ConstDenseMatrixView &b, const DenseMatrixView &c, unsigned t,
+        vec_basic &terms)
+{
+    unsigned row = c.nrows(), col = c.ncols(), inner = a.ncols();
+    unsigned tiles_per_row = (col + mul_tile - 1) / mul_tile;
+    unsigned r0 = (t / tiles_per_row) * mul_tile;
+    unsigned c0 = (t % tiles_per_row) * mul_tile;
+    unsigned r1 = std::min(r0 + mul_tile, row);
+    unsigned c1 = std::min(c0 + mul_tile, col);
+    for (unsigned r = r0; r < r1; r++) {
+        for (unsigned j = c0; j < c1; j++) {
+            // Numeric terms (e.g. of integer matrices) are summed directly
+            RCP<const Number> coef = zero;
+            terms.clear();
+            for (unsigned k = 0; k < inner; k++) {
+                RCP<const Basic> t = mul(a(r, k), b(k, j));
+                if (is_a_Number(*t))
+                    iaddnum(outArg(coef), rcp_static_cast<const Number>(t));
+                else
+                    terms.push_back(t);
+            }
+            if (terms.empty()) {
+                c(r, j) = coef;
+            } else {
+                terms.push_back(coef);
+                c(r, j) = Add::from_terms(terms);
+            }
+        }
+    }
+}
+
+unsigned mul_dense_tiles(unsigned row, unsigned col)
+{
+    return ((row + mul_tile - 1) / mul_tile) * ((col + mul_tile - 1) / mul_tile);
+}
+
+// Calls `f(i)` for `i` from `begin` to `end` on `threads` threads (0 means
+// the number of hardware threads), each taking the next `i` in turn
+template <typename F>
+void for_each_task(unsigned begin, unsigned end, unsigned threads,
+    const F &f)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads > end - begin) threads = end - begin;
+    std::atomic<unsigned> next(begin);
+    auto work = [&]() {
+        for (;;) {
+            unsigned i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= end) break;
+            f(i);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.push_back(std::thread(work));
+    work();
+    for (auto &t: workers) t.join();
+}
+
+} // anonymous namespace
+
 void mul_dense_dense(const DenseMatrix &A, const DenseMatrix &B,
         DenseMatrix &C)
 {
     CSYMPY_ASSERT(A.col_ == B.row_ && C.row_ == A.row_ && C.col_ == B.col_);
 
-    unsigned row = A.row_, col = B.col_;
+    mul_dense_dense(A.view(), B.view(), C.view());
+}
 
-    for (unsigned r = 0; r<row; r++) {
-        for (unsigned c = 0; c<col; c++) {
-            C.m_[r*col + c] = zero; // Integer Zero
-            for (unsigned k = 0; k<A.col_; k++)
-                C.m_[r*col + c] = add(C.m_[r*col + c],
-                    mul(A.m_[r*A.col_ + k], B.m_[k*col + c]));
-        }
+void mul_dense_dense(const ConstDenseMatrixView &A,
+    const ConstDenseMatrixView &B, const DenseMatrixView &C)
+{
+    CSYMPY_ASSERT(A.ncols() == B.nrows() && C.nrows() == A.nrows() &&
+        C.ncols() == B.ncols());
+
+    unsigned tiles = mul_dense_tiles(C.nrows(), C.ncols());
+    vec_basic terms;
+    for (unsigned t = 0; t < tiles; t++)
+        mul_dense_tile(A, B, C, t, terms);
+}
+
+void mul_dense_dense_parallel(const DenseMatrix &A, const DenseMatrix &B,
+        DenseMatrix &C, unsigned threads)
+{
+    CSYMPY_ASSERT(A.col_ == B.row_ && C.row_ == A.row_ && C.col_ == B.col_);
+
+#if defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+    unsigned tiles = mul_dense_tiles(A.row_, B.col_);
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads > tiles) threads = tiles;
+    if (threads > 1) {
+        // Each thread takes the next tile until there are none left. The
+        // tiles write to different entries of C.
+        std::atomic<unsigned> next(0);
+        auto work = [&]() {
+            vec_basic terms;
+            for (;;) {
+                unsigned t = next.fetch_add(1, std::memory_order_relaxed);
+                if (t >= tiles) break;
+                mul_dense_tile(A.view(), B.view(), C.view(), t, terms);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; t++)
+            workers.push_back(std::thread(work));
+        work();
+        for (auto &t: workers) t.join();
+        return;
     }
+#endif
+    mul_dense_dense(A, B, C);
 }
 
 void mul_dense_scalar(const DenseMatrix &A, const RCP<const Basic> &k, DenseMatrix& B)
@@ -252,36 +397,53 @@ void mul_dense_scalar(const DenseMatrix &A, const RCP<const Basic> &k, DenseMatr
     }
 }
 
+void imul_dense_scalar(DenseMatrix &A, const RCP<const Basic> &k)
+{
+    for (auto &e: A.m_)
+        e = mul(e, k);
+}
+
 // -------------------------------- Row Operations ---------------------------//
 void row_exchange_dense(DenseMatrix &A , unsigned i, unsigned j)
 {
-    CSYMPY_ASSERT(i != j && i < A.row_ && j < A.row_);
-
-    unsigned col = A.col_;
-
-    for (unsigned k = 0; k < A.col_; k++)
-        std::swap(A.m_[i*col + k], A.m_[j*col + k]);
+    row_exchange_dense(A.view(), i, j);
 }
 
 void row_mul_scalar_dense(DenseMatrix &A, unsigned i, RCP<const Basic> &c)
 {
-    CSYMPY_ASSERT(i < A.row_);
-
-    unsigned col = A.col_;
-
-    for (unsigned j = 0; j < A.col_; j++)
-        A.m_[i*col + j] = mul(c, A.m_[i*col + j]);
+    row_mul_scalar_dense(A.view(), i, c);
 }
 
 void row_add_row_dense(DenseMatrix &A, unsigned i, unsigned j,
     RCP<const Basic> &c)
 {
-    CSYMPY_ASSERT(i != j && i < A.row_ && j < A.row_);
+    row_add_row_dense(A.view(), i, j, c);
+}
 
-    unsigned col = A.col_;
+void row_exchange_dense(const DenseMatrixView &A, unsigned i, unsigned j)
+{
+    CSYMPY_ASSERT(i != j && i < A.nrows() && j < A.nrows());
 
-    for (unsigned k = 0; k < A.col_; k++)
-        A.m_[i*col + k] = add(A.m_[i*col + k], mul(c, A.m_[j*col + k]));
+    for (unsigned k = 0; k < A.ncols(); k++)
+        std::swap(A(i, k), A(j, k));
+}
+
+void row_mul_scalar_dense(const DenseMatrixView &A, unsigned i,
+    const RCP<const Basic> &c)
+{
+    CSYMPY_ASSERT(i < A.nrows());
+
+    for (unsigned j = 0; j < A.ncols(); j++)
+        A(i, j) = mul(c, A(i, j));
+}
+
+void row_add_row_dense(const DenseMatrixView &A, unsigned i, unsigned j,
+    const RCP<const Basic> &c)
+{
+    CSYMPY_ASSERT(i != j && i < A.nrows() && j < A.nrows());
+
+    for (unsigned k = 0; k < A.ncols(); k++)
+        A(i, k) = add(A(i, k), mul(c, A(j, k)));
 }
 
 // ------------------------------ Gaussian Elimination -----------------------//
@@ -329,11 +491,21 @@ void pivoted_gaussian_elimination(const DenseMatrix &A, DenseMatrix &B,
 // Algorithm 1, page 12, Nakos, G. C., Turner, P. R., Williams, R. M. (1997).
 // Fraction-free algorithms for linear and polynomial equations.
 // ACM SIGSAM Bulletin, 31(3), 11–19. doi:10.1145/271130.271133.
+namespace {
+
+// Defined with the numeric kernels below
+bool fraction_free_gaussian_elimination_polynomial(const vec_basic &a,
+    unsigned row, unsigned col, vec_basic &b);
+
+} // anonymous namespace
+
 void fraction_free_gaussian_elimination(const DenseMatrix &A, DenseMatrix &B)
 {
     CSYMPY_ASSERT(A.row_ == B.row_ && A.col_ == B.col_);
 
     unsigned col = A.col_;
+    if (fraction_free_gaussian_elimination_polynomial(A.m_, A.row_, col, B.m_))
+        return;
     B.m_ = A.m_;
 
     for (unsigned i = 0; i < col - 1; i++)
@@ -699,6 +871,309 @@ void LDL_solve(const DenseMatrix &A, const DenseMatrix &b, DenseMatrix &x)
     back_substitution(D, x_, x);
 }
 
+// ------------------------------ Numeric kernels ----------------------------//
+// When all entries of a matrix are Integers (or Rationals), the fraction-free
+// algorithms below copy them into a contiguous vector of machine words, `mpz`
+// or `mpq` numbers and run on it, instead of dispatching on
+// `RCP<const Basic>` for every operation. Machine words are tried first, the
+// `mpz` kernel is run if they overflow. Matrices of polynomials are run as
+// vectors of Polynomials: each step is expanded and its division cancels, so
+// the entries stay the (expanded) minors of the matrix, instead of trees of
+// unexpanded quotients that grow exponentially with the size.
+namespace {
+
+enum class NumericKind { none, integer, rational };
+
+NumericKind numeric_kind(const vec_basic &m)
+{
+    NumericKind kind = NumericKind::integer;
+    for (const auto &e: m) {
+        if (is_a<Integer>(*e)) continue;
+        if (!is_a<Rational>(*e)) return NumericKind::none;
+        kind = NumericKind::rational;
+    }
+    return kind;
+}
+
+inline bool get_numeric(const Basic &b, long &r)
+{
+    return mpz_get_long(static_cast<const Integer &>(b).i, r);
+}
+
+inline bool get_numeric(const Basic &b, mpz_class &r)
+{
+    r = static_cast<const Integer &>(b).i;
+    return true;
+}
+
+inline bool get_numeric(const Basic &b, mpq_class &r)
+{
+    if (is_a<Integer>(b))
+        r = static_cast<const Integer &>(b).i;
+    else
+        r = static_cast<const Rational &>(b).i;
+    return true;
+}
+
+template <typename T>
+bool get_numeric(const vec_basic &a, std::vector<T> &m)
+{
+    m.resize(a.size());
+    for (size_t i = 0; i < a.size(); i++)
+        if (!get_numeric(*a[i], m[i])) return false;
+    return true;
+}
+
+// Symbolic entries that are all polynomials with integer coefficients are
+// converted into Polynomials in common generators
+bool get_numeric(const vec_basic &a, std::vector<RCP<const Polynomial>> &m)
+{
+    for (const auto &e: a)
+        if (!is_polynomial(*e)) return false;
+    polynomials(a, m);
+    return true;
+}
+
+inline RCP<const Basic> to_basic(long r)
+{
+    return integer_from_long(r);
+}
+
+inline RCP<const Basic> to_basic(const mpz_class &r)
+{
+    return integer_from_mpz(mpz_class(r));
+}
+
+inline RCP<const Basic> to_basic(const mpq_class &r)
+{
+    return Rational::from_mpq(r);
+}
+
+inline RCP<const Basic> to_basic(const RCP<const Polynomial> &r)
+{
+    return r->as_basic();
+}
+
+template <typename T>
+void convert(const std::vector<T> &m, vec_basic &r)
+{
+    r.resize(m.size());
+    for (size_t i = 0; i < m.size(); i++)
+        r[i] = to_basic(m[i]);
+}
+
+template <typename T>
+void convert(const std::vector<T> &m, std::vector<mpq_class> &r)
+{
+    r.assign(m.begin(), m.end());
+}
+
+// r = (a*b - c*d) / e, the division being exact (none if `e` is null).
+// `r` may be `b`, `t` is a temporary. Returns false on overflow.
+inline bool fraction_free_step(long &r, long a, long b, long c, long d,
+    const long *e, long &)
+{
+    __int128 t = (__int128)a*b - (__int128)c*d;
+    if (e != nullptr) t /= *e;
+    if (t > LONG_MAX || t < LONG_MIN) return false;
+    r = (long)t;
+    return true;
+}
+
+inline bool fraction_free_step(mpz_class &r, const mpz_class &a,
+    const mpz_class &b, const mpz_class &c, const mpz_class &d,
+    const mpz_class *e, mpz_class &t)
+{
+    mpz_mul(t.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t());
+    mpz_submul(t.get_mpz_t(), c.get_mpz_t(), d.get_mpz_t());
+    if (e != nullptr)
+        mpz_divexact(r.get_mpz_t(), t.get_mpz_t(), e->get_mpz_t());
+    else
+        mpz_swap(r.get_mpz_t(), t.get_mpz_t());
+    return true;
+}
+
+inline bool fraction_free_step(mpq_class &r, const mpq_class &a,
+    const mpq_class &b, const mpq_class &c, const mpq_class &d,
+    const mpq_class *e, mpq_class &t)
+{
+    t = a*b;
+    t -= c*d;
+    if (e != nullptr)
+        mpq_div(r.get_mpq_t(), t.get_mpq_t(), e->get_mpq_t());
+    else
+        mpq_swap(r.get_mpq_t(), t.get_mpq_t());
+    return true;
+}
+
+// Polynomial entries are expanded at each step and the division cancels
+// exactly, so they only grow as much as the minors they are
+inline bool fraction_free_step(RCP<const Polynomial> &r,
+    const RCP<const Polynomial> &a, const RCP<const Polynomial> &b,
+    const RCP<const Polynomial> &c, const RCP<const Polynomial> &d,
+    const RCP<const Polynomial> *e, RCP<const Polynomial> &t)
+{
+    t = polynomial_sub(*polynomial_mul(*a, *b), *polynomial_mul(*c, *d));
+    r = (e != nullptr) ? polynomial_divexact(*t, **e) : t;
+    return true;
+}
+
+template <typename T>
+inline bool is_zero_entry(const T &x)
+{
+    return x == 0;
+}
+
+inline bool is_zero_entry(const RCP<const Polynomial> &x)
+{
+    return x->is_zero();
+}
+
+// The fraction-free elimination of det_bareis() (with `pivot`, `sign` is set
+// to the sign of the row permutation, or to 0 if the matrix is singular) and
+// fraction_free_LU() (without), in place on the `n x n` matrix `m`.
+// Returns false on overflow or if a divisor is zero, so that the caller can
+// fall back to a wider type or to the symbolic algorithm.
+template <typename T>
+bool fraction_free_elimination(std::vector<T> &m, unsigned n, bool pivot,
+    int &sign)
+{
+    T t;
+    sign = 1;
+    for (unsigned k = 0; k + 1 < n; k++) {
+        if (pivot && is_zero_entry(m[k*n + k])) {
+            unsigned i = k + 1;
+            while (i < n && is_zero_entry(m[i*n + k])) i++;
+            if (i == n) {
+                sign = 0;
+                return true;
+            }
+            std::swap_ranges(m.begin() + k*n, m.begin() + k*n + n,
+                m.begin() + i*n);
+            sign = -sign;
+        }
+        const T *e = nullptr;
+        if (k > 0) {
+            e = &m[(k - 1)*n + k - 1];
+            if (is_zero_entry(*e)) return false;
+        }
+        for (unsigned i = k + 1; i < n; i++)
+            for (unsigned j = k + 1; j < n; j++)
+                if (!fraction_free_step(m[i*n + j], m[k*n + k], m[i*n + j],
+                        m[i*n + k], m[k*n + j], e, t))
+                    return false;
+    }
+    return true;
+}
+
+template <typename T>
+bool det_bareis_numeric(const vec_basic &a, unsigned n, RCP<const Basic> &d)
+{
+    std::vector<T> m;
+    int sign;
+    if (!get_numeric(a, m) || !fraction_free_elimination(m, n, true, sign))
+        return false;
+    if (sign == 0) {
+        d = zero;
+    } else {
+        d = to_basic(m.back());
+        if (sign < 0) d = mul(minus_one, d);
+    }
+    return true;
+}
+
+// From this size on, det_bareis() of a numeric matrix calls
+// det_multimodular() when machine words overflow
+const unsigned det_multimodular_min = 32;
+
+template <typename T, typename R>
+bool fraction_free_LU_numeric(const vec_basic &a, unsigned n, R &lu)
+{
+    std::vector<T> m;
+    int sign;
+    if (!get_numeric(a, m) || !fraction_free_elimination(m, n, false, sign))
+        return false;
+    convert(m, lu);
+    return true;
+}
+
+// Sets `lu` (a `vec_basic` or a vector of `mpq_class`) to the fraction-free
+// LU of the `n x n` matrix `a` if it is numeric
+template <typename R>
+bool fraction_free_LU_numeric(const vec_basic &a, unsigned n, R &lu)
+{
+    switch (numeric_kind(a)) {
+        case NumericKind::integer:
+            return fraction_free_LU_numeric<long>(a, n, lu) ||
+                fraction_free_LU_numeric<mpz_class>(a, n, lu);
+        case NumericKind::rational:
+            return fraction_free_LU_numeric<mpq_class>(a, n, lu);
+        default:
+            return false;
+    }
+}
+
+// fraction_free_gaussian_elimination() of the `row x col` matrix `a` into
+// `b` if its entries are polynomials. Returns false otherwise or if a divisor
+// is zero.
+bool fraction_free_gaussian_elimination_polynomial(const vec_basic &a,
+    unsigned row, unsigned col, vec_basic &b)
+{
+    std::vector<RCP<const Polynomial>> m;
+    if (numeric_kind(a) != NumericKind::none || !get_numeric(a, m))
+        return false;
+    RCP<const Polynomial> t;
+    for (unsigned i = 0; i + 1 < col && i + 1 < row; i++) {
+        const RCP<const Polynomial> *e = nullptr;
+        if (i > 0) {
+            e = &m[(i - 1)*col + i - 1];
+            if (is_zero_entry(*e)) return false;
+        }
+        for (unsigned j = i + 1; j < row; j++)
+            for (unsigned k = i + 1; k < col; k++)
+                fraction_free_step(m[j*col + k], m[i*col + i], m[j*col + k],
+                    m[j*col + i], m[i*col + k], e, t);
+    }
+    convert(m, b);
+    for (unsigned i = 0; i + 1 < col; i++)
+        for (unsigned j = i + 1; j < row; j++)
+            b[j*col + i] = zero;
+    return true;
+}
+
+// The forward and back substitutions of inverse_fraction_free_LU() on the
+// numeric fraction-free LU `lu`, with the columns of the inverse stored into
+// `b`. Returns false if a divisor is zero.
+bool inverse_fraction_free_LU_numeric(const std::vector<mpq_class> &lu,
+    unsigned n, vec_basic &b)
+{
+    std::vector<mpq_class> x(n);
+    mpq_class t;
+
+    for (unsigned c = 0; c < n; c++) {
+        for (unsigned i = 0; i < n; i++)
+            x[i] = (i == c) ? 1 : 0;
+        for (unsigned i = 0; i + 1 < n; i++) {
+            if (i > 0 && lu[(i - 1)*n + i - 1] == 0) return false;
+            for (unsigned j = i + 1; j < n; j++) {
+                fraction_free_step(x[j], lu[i*n + i], x[j], lu[j*n + i], x[i],
+                    i > 0 ? &lu[(i - 1)*n + i - 1] : nullptr, t);
+            }
+        }
+        for (unsigned i = n; i-- > 0;) {
+            for (unsigned j = i + 1; j < n; j++)
+                x[i] -= lu[i*n + j]*x[j];
+            if (lu[i*n + i] == 0) return false;
+            x[i] /= lu[i*n + i];
+        }
+        for (unsigned i = 0; i < n; i++)
+            b[i*n + c] = to_basic(x[i]);
+    }
+    return true;
+}
+
+} // anonymous namespace
+
 // --------------------------- Matrix Decomposition --------------------------//
 
 // Algorithm 3, page 14, Nakos, G. C., Turner, P. R., Williams, R. M. (1997).
@@ -714,6 +1189,11 @@ void fraction_free_LU(const DenseMatrix &A, DenseMatrix &LU)
     unsigned n = A.row_;
     unsigned i, j, k;
 
+    if (fraction_free_LU_numeric(A.m_, n, LU.m_) ||
+            (numeric_kind(A.m_) == NumericKind::none &&
+            fraction_free_LU_numeric<RCP<const Polynomial>>(A.m_, n, LU.m_)))
+        return;
+
     LU.m_ = A.m_;
 
     for (i = 0; i < n - 1; i++)
@@ -734,37 +1214,46 @@ void LU(const DenseMatrix &A, DenseMatrix &L, DenseMatrix &U)
     CSYMPY_ASSERT(A.row_ == L.row_ && A.row_ == U.row_);
 
     unsigned n = A.row_;
-    unsigned i, j, k;
-    RCP<const Basic> scale;
+    unsigned i, j;
 
     U.m_ = A.m_;
+    LU_inplace(U);
+
+    for(i = 0; i < n; i++) {
+        for(j = 0; j < i; j++) {
+            L.m_[i*n + j] = U.m_[i*n + j];
+            U.m_[i*n + j] = zero; // Integer zero
+        }
+        L.m_[i*n + i] = one; // Integer one
+        for (j = i + 1; j < n; j++)
+            L.m_[i*n + j] = zero; // Integer zero
+    }
+}
+
+void LU_inplace(DenseMatrix &A)
+{
+    CSYMPY_ASSERT(A.row_ == A.col_);
+
+    unsigned n = A.row_;
+    unsigned i, j, k;
+    RCP<const Basic> scale;
 
     for (j = 0; j < n; j++) {
         for (i = 0; i < j; i++)
             for (k = 0; k < i; k++)
-                U.m_[i*n + j] = sub(U.m_[i*n + j],
-                    mul(U.m_[i*n + k], U.m_[k*n + j]));
+                A.m_[i*n + j] = sub(A.m_[i*n + j],
+                    mul(A.m_[i*n + k], A.m_[k*n + j]));
 
         for (i = j; i < n; i++) {
             for (k = 0; k < j; k++)
-                U.m_[i*n + j] = sub(U.m_[i*n + j],
-                    mul(U.m_[i*n + k], U.m_[k*n + j]));
+                A.m_[i*n + j] = sub(A.m_[i*n + j],
+                    mul(A.m_[i*n + k], A.m_[k*n + j]));
         }
 
-        scale = div(one, U.m_[j*n + j]);
+        scale = div(one, A.m_[j*n + j]);
 
         for (i = j + 1; i < n; i++)
-            U.m_[i*n + j] = mul(U.m_[i*n + j], scale);
-    }
-
-    for(i = 0; i < n; i++) {
-        for(j = 0; j < i; j++) {
-            L.m_[i*n + j] = U.m_[i*n + j];
-            U.m_[i*n + j] = zero; // Integer zero
-        }
-        L.m_[i*n + i] = one; // Integer one
-        for (j = i + 1; j < n; j++)
-            L.m_[i*n + j] = zero; // Integer zero
+            A.m_[i*n + j] = mul(A.m_[i*n + j], scale);
     }
 }
 
@@ -991,9 +1480,23 @@ RCP<const Basic> det_bareis(const DenseMatrix &A)
                     )
                 );
     } else {
+        RCP<const Basic> d;
+        NumericKind kind = numeric_kind(A.m_);
+        if (kind == NumericKind::integer &&
+                det_bareis_numeric<long>(A.m_, n, d))
+            return d;
+        if (kind != NumericKind::none && n >= det_multimodular_min)
+            return det_multimodular(A, 1);
+        if ((kind == NumericKind::integer &&
+                    det_bareis_numeric<mpz_class>(A.m_, n, d)) ||
+                (kind == NumericKind::rational &&
+                    det_bareis_numeric<mpq_class>(A.m_, n, d)) ||
+                (kind == NumericKind::none &&
+                    det_bareis_numeric<RCP<const Polynomial>>(A.m_, n, d)))
+            return d;
+
         DenseMatrix B = DenseMatrix(n, n, A.m_);
         unsigned i, sign = 1;
-        RCP<const Basic> d;
 
         for (unsigned k = 0; k < n - 1; k++) {
             if (eq(B.m_[k*n + k], zero)) {
@@ -1048,7 +1551,7 @@ void berkowitz(const DenseMatrix &A, std::vector<DenseMatrix> &polys)
             T.m_[i] = zero;
         for (i = 0; i < k; i++)
             C.m_[i] = A.m_[i*col + k];
-        items.push_back(C);
+        items.push_back(std::move(C));
 
         for (i = 0; i < n - 2; i++) {
             DenseMatrix B = DenseMatrix(k, 1);
@@ -1057,7 +1560,7 @@ void berkowitz(const DenseMatrix &A, std::vector<DenseMatrix> &polys)
                 for (m = 0; m < k; m++)
                     B.m_[l] = add(B.m_[l], mul(A.m_[l*col + m], items[i].m_[m]));
             }
-            items.push_back(B);
+            items.push_back(std::move(B));
         }
 
         items_.clear();
@@ -1075,7 +1578,7 @@ void berkowitz(const DenseMatrix &A, std::vector<DenseMatrix> &polys)
                 T.m_[(i + l)*n + i] = items_[l];
         }
 
-        transforms.push_back(T);
+        transforms.push_back(std::move(T));
     }
 
     polys.push_back(DenseMatrix(2, 1, {one, mul(A.m_[0], minus_one)}));
@@ -1093,32 +1596,126 @@ void berkowitz(const DenseMatrix &A, std::vector<DenseMatrix> &polys)
                 B.m_[l] = expand(B.m_[l]);
             }
         }
-        polys.push_back(B);
+        polys.push_back(std::move(B));
     }
 }
 
-RCP<const Basic> det_berkowitz(const DenseMatrix &A)
+namespace {
+
+// Products with fewer entries than this are computed by the calling thread
+// alone in berkowitz_poly()
+const unsigned berkowitz_parallel_min = 8;
+
+// \return the expanded sum of `a[i*a_step] * b[i]` for `i < n`, built as
+// in mul_dense_tile()
+RCP<const Basic> expand_dot(const RCP<const Basic> *a, int a_step,
+    const RCP<const Basic> *b, unsigned n)
+{
+    RCP<const Number> coef = zero;
+    vec_basic terms;
+    for (unsigned i = 0; i < n; i++) {
+        RCP<const Basic> t = mul(a[(int)i*a_step], b[i]);
+        if (is_a_Number(*t))
+            iaddnum(outArg(coef), rcp_static_cast<const Number>(t));
+        else
+            terms.push_back(t);
+    }
+    if (terms.empty())
+        return coef;
+    terms.push_back(coef);
+    return expand(Add::from_terms(terms));
+}
+
+// Computes the coefficients of the characteristic polynomial of the `col x
+// col` matrix `a` in `poly` by Berkowitz' algorithm, like berkowitz(), but
+// applies the Toeplitz matrix of each stage as soon as it is known and keeps
+// only the vectors of the current stage. The entries of the products of a
+// stage are computed by `threads` threads, each taking the next entry in turn.
+void berkowitz_poly(const vec_basic &a, unsigned col, vec_basic &poly,
+    unsigned threads)
 {
-    std::vector<DenseMatrix> polys;
+    auto for_each_entry = [&](unsigned n, const std::function<void(unsigned)>
+            &f) {
+        if (threads == 1 || n < berkowitz_parallel_min) {
+            for (unsigned l = 0; l < n; l++) f(l);
+        } else {
+            for_each_task(0, n, threads, f);
+        }
+    };
+
+    // `v` is `A_k^i C` and `t` the first column of the Toeplitz matrix of the
+    // stage, `w` and `q` receive the next `v` and `poly`
+    vec_basic v(col), w(col), t(col + 1), q(col + 1);
+    poly.assign(col + 1, zero);
+    poly[0] = one;
+    poly[1] = mul(minus_one, a[0]);
+
+    for (unsigned n = 2; n <= col; n++) {
+        // A_k is the leading `k x k` submatrix, C the column above and R the
+        // row left of `a[k*col + k]`
+        unsigned k = n - 1;
+        for (unsigned l = 0; l < k; l++)
+            v[l] = a[l*col + k];
+        t[0] = one;
+        t[1] = mul(minus_one, a[k*col + k]);
+        for (unsigned i = 0; i + 1 < n; i++) {
+            if (i > 0) {
+                for_each_entry(k, [&](unsigned l) {
+                    w[l] = expand_dot(&a[l*col], 1, &v[0], k);
+                });
+                std::swap(v, w);
+            }
+            t[i + 2] = mul(minus_one, expand_dot(&a[k*col], 1, &v[0], k));
+        }
+        // `q = T poly`, where T is the `(n + 1) x n` lower triangular Toeplitz
+        // matrix with the first column `t`
+        for_each_entry(n + 1, [&](unsigned l) {
+            q[l] = expand_dot(&t[l], -1, &poly[0], std::min(l + 1, n));
+        });
+        std::swap(poly, q);
+    }
+}
+
+} // anonymous namespace
 
-    berkowitz(A, polys);
-    DenseMatrix poly = polys[polys.size() - 1];
+RCP<const Basic> det_berkowitz(const DenseMatrix &A)
+{
+    return det_berkowitz_parallel(A, 1);
+}
 
-    if (polys.size() % 2 == 1)
-        return mul(minus_one, poly.get(poly.nrows() - 1, 0));
+RCP<const Basic> det_berkowitz_parallel(const DenseMatrix &A, unsigned threads)
+{
+    CSYMPY_ASSERT(A.nrows() == A.ncols());
 
-    return poly.get(poly.nrows() - 1, 0);
+    unsigned n = A.nrows();
+    if (n == 0)
+        return one;
+    DenseMatrix B = DenseMatrix(n + 1, 1);
+    char_poly_parallel(A, B, threads);
+    // The constant term of `det(xI - A)` is `(-1)^n det(A)`
+    if (n % 2 == 1)
+        return mul(minus_one, B.get(n, 0));
+    return B.get(n, 0);
 }
 
 void char_poly(const DenseMatrix &A, DenseMatrix &B)
+{
+    char_poly_parallel(A, B, 1);
+}
+
+void char_poly_parallel(const DenseMatrix &A, DenseMatrix &B, unsigned threads)
 {
     CSYMPY_ASSERT(B.ncols() == 1 && B.nrows() == A.nrows() + 1);
     CSYMPY_ASSERT(A.nrows() == A.ncols());
 
-    std::vector<DenseMatrix> polys;
-
-    berkowitz(A, polys);
-    B = polys[polys.size() - 1];
+#if !defined(WITH_CSYMPY_THREAD_SAFE) || !defined(WITH_CSYMPY_RCP)
+    threads = 1;
+#endif
+    if (A.row_ == 0) {
+        B.m_[0] = one;
+        return;
+    }
+    berkowitz_poly(A.m_, A.row_, B.m_, threads);
 }
 
 void inverse_fraction_free_LU(const DenseMatrix &A, DenseMatrix &B)
@@ -1131,6 +1728,11 @@ void inverse_fraction_free_LU(const DenseMatrix &A, DenseMatrix &B)
     DenseMatrix x = DenseMatrix(n, 1);
     DenseMatrix x_ = DenseMatrix(n, 1);
 
+    std::vector<mpq_class> lu;
+    if (fraction_free_LU_numeric(A.m_, n, lu) &&
+            inverse_fraction_free_LU_numeric(lu, n, B.m_))
+        return;
+
     // Initialize matrices
     for (i = 0; i < n*n; i++) {
         LU.m_[i] = zero;
@@ -1223,6 +1825,304 @@ void inverse_gauss_jordan(const DenseMatrix &A, DenseMatrix &B)
     fraction_free_gauss_jordan_solve(A, e, B);
 }
 
+// ------------------------- Multimodular algorithms -------------------------//
+// The determinant, or the solution of Ax = b, is computed modulo enough word
+// sized primes to determine it (from Hadamard's bound), one prime per task,
+// and reconstructed from the residues by the Chinese remainder theorem (and
+// rational reconstruction for solutions). The work per prime is a plain
+// elimination on machine words, so there is no coefficient growth.
+namespace {
+
+// The primes are below 2^31, so that products of residues fit in 64 bits
+// and each prime is larger than 2^30.
+const unsigned modular_prime_bits = 30;
+
+// Appends to `primes` the next `count` primes below the last one in it
+// (below 2^31 if it is empty), in decreasing order. Windows below the last
+// prime are sieved by the primes of the `Sieve` up to sqrt(2^31).
+void next_modular_primes(std::vector<unsigned> &primes, unsigned count)
+{
+    // About one number in 21 is prime near 2^31
+    const unsigned window = std::min(1u << 16, std::max(1u << 10, 32*count));
+    std::vector<unsigned> small;
+    std::vector<bool> composite;
+    unsigned hi = primes.empty() ? 1u << 31 : primes.back();
+
+    Sieve::generate_primes(small, 46341);
+    while (count > 0) {
+        unsigned lo = hi - window;
+        CSYMPY_ASSERT(lo > small.back());
+        composite.assign(window, false);
+        for (unsigned q: small)
+            for (unsigned k = (lo + q - 1) / q * q; k < hi; k += q)
+                composite[k - lo] = true;
+        for (unsigned k = hi; k-- > lo && count > 0;)
+            if (!composite[k - lo]) {
+                primes.push_back(k);
+                count--;
+            }
+        hi = lo;
+    }
+}
+
+// Reduction modulo `p` (below 2^31) of numbers below 2^63 by a
+// multiplication with a precomputed inverse (Barrett's reduction), which is
+// much faster than a division
+struct Modulus {
+    unsigned p;
+    uint64_t inv;
+
+    Modulus(unsigned p) : p(p), inv(~(uint64_t)0 / p) {}
+
+    unsigned reduce(uint64_t x) const {
+        uint64_t q = ((unsigned __int128)x * inv) >> 64;
+        uint64_t r = x - q * p;
+        return r >= p ? r - p : r;
+    }
+    unsigned mul(unsigned a, unsigned b) const {
+        return reduce((uint64_t)a * b);
+    }
+};
+
+unsigned invmod(unsigned a, unsigned p)
+{
+    long t = 0, t1 = 1, r = p, r1 = a, q;
+    while (r1 != 0) {
+        q = r / r1;
+        t -= q * t1;
+        std::swap(t, t1);
+        r -= q * r1;
+        std::swap(r, r1);
+    }
+    return t < 0 ? t + p : t;
+}
+
+// Gaussian elimination modulo `p` of the `n` rows of width `w` of `m` (an
+// `n x n` matrix followed by `w - n` right hand sides).
+// \return the determinant of the `n x n` matrix modulo `p`. If it is not
+// zero and `w > n`, the last `w - n` columns of `m` are then the solutions.
+unsigned gauss_jordan_mod(std::vector<unsigned> &m, unsigned n, unsigned w,
+    const Modulus &mod)
+{
+    unsigned p = mod.p, det = 1;
+    for (unsigned k = 0; k < n; k++) {
+        unsigned i = k;
+        while (i < n && m[i*w + k] == 0) i++;
+        if (i == n) return 0;
+        if (i != k) {
+            std::swap_ranges(m.begin() + i*w, m.begin() + i*w + w,
+                m.begin() + k*w);
+            det = p - det;
+        }
+        det = mod.mul(det, m[k*w + k]);
+        unsigned inv = invmod(m[k*w + k], p);
+        for (unsigned j = k; j < w; j++)
+            m[k*w + j] = mod.mul(m[k*w + j], inv);
+        // Without right hand sides, only the rows below are needed
+        for (i = (w > n) ? 0 : k + 1; i < n; i++) {
+            if (i == k || m[i*w + k] == 0) continue;
+            uint64_t f = p - m[i*w + k];
+            for (unsigned j = k; j < w; j++)
+                m[i*w + j] = mod.reduce(m[i*w + j] + f * m[k*w + j]);
+        }
+    }
+    return det;
+}
+
+// Sets `m` to the `rows x cols` matrix `a` with each row multiplied by the
+// lcm of the denominators of its entries, and `den` to the product of these
+// multipliers. Throws unless the entries are Integers or Rationals.
+void integer_rows(const vec_basic &a, unsigned rows, unsigned cols,
+    std::vector<mpz_class> &m, mpz_class &den)
+{
+    m.resize(a.size());
+    den = 1;
+    for (unsigned i = 0; i < rows; i++) {
+        mpz_class l = 1;
+        for (unsigned j = 0; j < cols; j++) {
+            const Basic &e = *a[i*cols + j];
+            if (is_a<Rational>(e))
+                mpz_lcm(l.get_mpz_t(), l.get_mpz_t(),
+                    static_cast<const Rational &>(e).i.get_den_mpz_t());
+            else if (!is_a<Integer>(e))
+                throw std::runtime_error(
+                    "Entries must be Integers or Rationals");
+        }
+        for (unsigned j = 0; j < cols; j++) {
+            const Basic &e = *a[i*cols + j];
+            if (is_a<Integer>(e)) {
+                m[i*cols + j] = static_cast<const Integer &>(e).i * l;
+            } else {
+                const mpq_class &q = static_cast<const Rational &>(e).i;
+                m[i*cols + j] = q.get_num() * (l / q.get_den());
+            }
+        }
+        den *= l;
+    }
+}
+
+// \return `b` such that the absolute values of all minors of the first
+// `cols` columns of the `rows x w` matrix `m` are below 2^b (Hadamard's
+// bound)
+unsigned long hadamard_bits(const std::vector<mpz_class> &m, unsigned rows,
+    unsigned cols, unsigned w)
+{
+    unsigned long bits = 0;
+    mpz_class s;
+    for (unsigned i = 0; i < rows; i++) {
+        s = 0;
+        for (unsigned j = 0; j < cols; j++)
+            mpz_addmul(s.get_mpz_t(), m[i*w + j].get_mpz_t(),
+                m[i*w + j].get_mpz_t());
+        bits += (mpz_sizeinbase(s.get_mpz_t(), 2) + 1) / 2;
+    }
+    return bits;
+}
+
+// \return the integer modulo the product of `primes` with the given
+// residues, in the symmetric range
+mpz_class modular_crt(const std::vector<unsigned> &residues,
+    const std::vector<unsigned> &primes)
+{
+    std::vector<RCP<const Integer>> rem, mod;
+    rem.reserve(primes.size());
+    mod.reserve(primes.size());
+    for (unsigned i = 0; i < primes.size(); i++) {
+        rem.push_back(integer(mpz_class(residues[i])));
+        mod.push_back(integer(mpz_class(primes[i])));
+    }
+    RCP<const Integer> r;
+    crt(outArg(r), rem, mod);
+    mpz_class m = 1;
+    for (unsigned p: primes) m *= p;
+    mpz_class x = r->as_mpz();
+    if (2 * x > m) x -= m;
+    return x;
+}
+
+// \return the fraction `n/d` with `|n|, d <= 2^bits` congruent to `r` modulo
+// `m`, which must be above 2^(2 bits + 1)
+mpq_class rational_reconstruction(const mpz_class &r, const mpz_class &m,
+    unsigned long bits)
+{
+    mpz_class bound, r0 = m, r1 = r, t0 = 0, t1 = 1, q;
+    mpz_ui_pow_ui(bound.get_mpz_t(), 2, bits);
+    if (r1 < 0) r1 += m;
+    while (r1 > bound) {
+        q = r0 / r1;
+        r0 -= q * r1;
+        swap(r0, r1);
+        t0 -= q * t1;
+        swap(t0, t1);
+    }
+    if (abs(t1) > bound)
+        throw std::runtime_error("Rational reconstruction failed");
+    mpq_class x(r1, t1);
+    x.canonicalize();
+    return x;
+}
+
+} // anonymous namespace
+
+RCP<const Basic> det_multimodular(const DenseMatrix &A, unsigned threads)
+{
+    CSYMPY_ASSERT(A.row_ == A.col_);
+
+    unsigned n = A.row_;
+    std::vector<mpz_class> a;
+    mpz_class den;
+
+    integer_rows(A.m_, n, n, a, den);
+    if (n == 0) return one;
+
+    unsigned long bits = hadamard_bits(a, n, n, n);
+    // The product of the primes must be above 2|det(A)| for the sign
+    std::vector<unsigned> primes;
+    next_modular_primes(primes, (bits + 1) / modular_prime_bits + 1);
+    std::vector<unsigned> residues(primes.size());
+
+    for_each_task(0, primes.size(), threads, [&](unsigned i) {
+        unsigned p = primes[i];
+        std::vector<unsigned> m(n*n);
+        for (unsigned j = 0; j < n*n; j++)
+            m[j] = mpz_fdiv_ui(a[j].get_mpz_t(), p);
+        residues[i] = gauss_jordan_mod(m, n, n, Modulus(p));
+    });
+
+    mpq_class d(modular_crt(residues, primes), den);
+    d.canonicalize();
+    return Rational::from_mpq(d);
+}
+
+void multimodular_solve(const DenseMatrix &A, const DenseMatrix &b,
+    DenseMatrix &x, unsigned threads)
+{
+    CSYMPY_ASSERT(A.row_ == A.col_);
+    CSYMPY_ASSERT(b.row_ == A.row_ && x.row_ == A.row_);
+    CSYMPY_ASSERT(x.col_ == b.col_);
+
+    unsigned n = A.row_, w = A.col_ + b.col_;
+    vec_basic ab(n*w);
+    std::vector<mpz_class> a;
+    mpz_class den;
+
+    // Scaling the rows of [A | b] does not change the solutions
+    for (unsigned i = 0; i < n; i++) {
+        std::copy(A.m_.begin() + i*n, A.m_.begin() + i*n + n,
+            ab.begin() + i*w);
+        std::copy(b.m_.begin() + i*b.col_, b.m_.begin() + i*b.col_ + b.col_,
+            ab.begin() + i*w + n);
+    }
+    integer_rows(ab, n, w, a, den);
+
+    // By Cramer's rule, the numerators and denominators of the solutions
+    // are minors of [A | b]. A prime is unlucky if A is singular modulo it,
+    // i.e. if it divides det(A): if more than `det_bits` bits of primes are
+    // unlucky, det(A) = 0.
+    unsigned long bits = hadamard_bits(a, n, w, w);
+    unsigned long det_bits = hadamard_bits(a, n, n, w);
+    unsigned needed = (2 * bits + 1) / modular_prime_bits + 1;
+    std::vector<unsigned> primes, good;
+    std::vector<std::vector<unsigned>> solutions;
+    unsigned unlucky = 0;
+
+    while (good.size() < needed) {
+        unsigned begin = primes.size();
+        next_modular_primes(primes, needed - good.size());
+        std::vector<std::vector<unsigned>> m(primes.size() - begin);
+        std::vector<unsigned> dets(m.size());
+        for_each_task(begin, primes.size(), threads, [&](unsigned i) {
+            unsigned p = primes[i];
+            std::vector<unsigned> &r = m[i - begin];
+            r.resize(n*w);
+            for (unsigned j = 0; j < n*w; j++)
+                r[j] = mpz_fdiv_ui(a[j].get_mpz_t(), p);
+            dets[i - begin] = gauss_jordan_mod(r, n, w, Modulus(p));
+        });
+        for (unsigned i = 0; i < m.size(); i++) {
+            if (dets[i] == 0) {
+                unlucky++;
+                continue;
+            }
+            good.push_back(primes[begin + i]);
+            solutions.push_back(std::move(m[i]));
+        }
+        if ((unsigned long)unlucky * modular_prime_bits > det_bits)
+            throw std::runtime_error("Matrix is singular");
+    }
+
+    mpz_class M = 1;
+    for (unsigned p: good) M *= p;
+    std::vector<unsigned> residues(good.size());
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned j = 0; j < b.col_; j++) {
+            for (unsigned k = 0; k < good.size(); k++)
+                residues[k] = solutions[k][i*w + n + j];
+            x.m_[i*b.col_ + j] = Rational::from_mpq(rational_reconstruction(
+                modular_crt(residues, good), M, bits));
+        }
+}
+
 // ------------------------- NumPy-like functions ----------------------------//
 
 // Mimic `eye` function in NumPy
@@ -1300,4 +2200,21 @@ void zeros(DenseMatrix &A, unsigned rows, unsigned cols)
     }
 }
 
+void jacobian(const vec_basic &f, const vec_basic &x, DenseMatrix &J)
+{
+    std::vector<RCP<const Symbol>> symbols;
+    for (auto &s: x) {
+        if (!is_a<Symbol>(*s))
+            throw std::runtime_error("jacobian: x must contain Symbols only");
+        symbols.push_back(rcp_static_cast<const Symbol>(s));
+    }
+    J = DenseMatrix(f.size(), x.size());
+    Differentiator d;
+    for (unsigned i = 0; i < f.size(); i++) {
+        for (unsigned j = 0; j < x.size(); j++) {
+            J.set(i, j, d.diff(f[i], symbols[j]));
+        }
+    }
+}
+
 } // CSymPy
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <cmath>
+
+#include "dense_matrix_double.h"
+#include "eval_double.h"
+
+#ifdef HAVE_CSYMPY_LAPACK
+extern "C" {
+void dgetrf_(const int *m, const int *n, double *a, const int *lda,
+        int *ipiv, int *info);
+void dgetrs_(const char *trans, const int *n, const int *nrhs,
+        const double *a, const int *lda, const int *ipiv, double *b,
+        const int *ldb, int *info);
+void dgetri_(const int *n, double *a, const int *lda, const int *ipiv,
+        double *work, const int *lwork, int *info);
+}
+#endif
+
+namespace CSymPy {
+
+void eval_double(const DenseMatrix &A, std::vector<double> &a)
+{
+    unsigned row = A.nrows(), col = A.ncols();
+    a.resize(row*col);
+    for (unsigned i = 0; i < row; i++)
+        for (unsigned j = 0; j < col; j++)
+            a[i*col + j] = eval_double(*A.get(i, j));
+}
+
+namespace {
+
+void check_square(const DenseMatrix &A)
+{
+    if (A.nrows() != A.ncols())
+        throw std::runtime_error("Matrix must be square");
+}
+
+#ifdef HAVE_CSYMPY_LAPACK
+
+/*  LAPACK is column-major, so it sees the row-major `a` as its transpose:
+    `lu` holds the factorization of `a^T`. Solving `a x = b` is then
+    solving `(a^T)^T x = b` (`trans = 'T'`), and the inverse of `a^T` read
+    row-major is the inverse of `a`.
+*/
+
+//! \return false if `a` is singular
+bool LU_factor(unsigned n, std::vector<double> &lu, std::vector<int> &pivots)
+{
+    int n_ = n, info;
+    pivots.resize(n);
+    dgetrf_(&n_, &n_, lu.data(), &n_, pivots.data(), &info);
+    if (info < 0)
+        throw std::runtime_error("dgetrf: illegal argument");
+    return info == 0;
+}
+
+double LU_det(unsigned n, const std::vector<double> &lu,
+        const std::vector<int> &pivots)
+{
+    double d = 1;
+    for (unsigned i = 0; i < n; i++) {
+        d *= lu[i*n + i];
+        if (pivots[i] != int(i) + 1) d = -d;
+    }
+    return d;
+}
+
+void LU_substitute(unsigned n, const std::vector<double> &lu,
+        const std::vector<int> &pivots, unsigned nrhs, std::vector<double> &x)
+{
+    // `x` is row-major `n x nrhs`, LAPACK wants it column-major
+    std::vector<double> t(n*nrhs);
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned j = 0; j < nrhs; j++)
+            t[j*n + i] = x[i*nrhs + j];
+    int n_ = n, nrhs_ = nrhs, info;
+    char trans = 'T';
+    dgetrs_(&trans, &n_, &nrhs_, lu.data(), &n_, pivots.data(), t.data(),
+            &n_, &info);
+    if (info < 0)
+        throw std::runtime_error("dgetrs: illegal argument");
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned j = 0; j < nrhs; j++)
+            x[i*nrhs + j] = t[j*n + i];
+}
+
+void LU_invert(unsigned n, std::vector<double> &lu,
+        const std::vector<int> &pivots)
+{
+    int n_ = n, lwork = -1, info;
+    double size;
+    dgetri_(&n_, lu.data(), &n_, pivots.data(), &size, &lwork, &info);
+    lwork = std::max(int(size), 1);
+    std::vector<double> work(lwork);
+    dgetri_(&n_, lu.data(), &n_, pivots.data(), work.data(), &lwork, &info);
+    if (info < 0)
+        throw std::runtime_error("dgetri: illegal argument");
+}
+
+#else
+
+//! Columns per panel of the blocked LU factorization
+const unsigned LU_block_size = 64;
+
+/*  Right-looking blocked LU factorization with partial pivoting of the
+    row-major `lu` in place: `L` (with a unit diagonal) below the diagonal,
+    `U` on and above it, `pivots[k]` is the row exchanged with row `k` at
+    step `k`. Each panel of LU_block_size columns is factored alone, then
+    the rows of `U` to its right are computed and the trailing submatrix is
+    updated in one rank-LU_block_size pass, row by row, which keeps the
+    panel rows in cache.
+*/
+//! \return false if `a` is singular
+bool LU_factor(unsigned n, std::vector<double> &lu, std::vector<int> &pivots)
+{
+    bool regular = true;
+    double *a = lu.data();
+    pivots.resize(n);
+    for (unsigned k0 = 0; k0 < n; k0 += LU_block_size) {
+        unsigned k1 = std::min(k0 + LU_block_size, n);
+        // Panel: columns k0..k1-1 of rows k0..n-1
+        for (unsigned k = k0; k < k1; k++) {
+            unsigned p = k;
+            for (unsigned i = k + 1; i < n; i++)
+                if (std::abs(a[i*n + k]) > std::abs(a[p*n + k])) p = i;
+            pivots[k] = p;
+            if (p != k)
+                std::swap_ranges(a + k*n, a + (k + 1)*n, a + p*n);
+            double d = a[k*n + k];
+            if (d == 0) {
+                regular = false;
+                continue;
+            }
+            for (unsigned i = k + 1; i < n; i++) {
+                double l = a[i*n + k] /= d;
+                if (l == 0) continue;
+                for (unsigned j = k + 1; j < k1; j++)
+                    a[i*n + j] -= l*a[k*n + j];
+            }
+        }
+        if (k1 == n) break;
+        // U12 = L11^-1 A12
+        for (unsigned k = k0; k < k1; k++)
+            for (unsigned i = k + 1; i < k1; i++) {
+                double l = a[i*n + k];
+                if (l == 0) continue;
+                for (unsigned j = k1; j < n; j++)
+                    a[i*n + j] -= l*a[k*n + j];
+            }
+        // A22 -= L21 U12
+        for (unsigned i = k1; i < n; i++)
+            for (unsigned k = k0; k < k1; k++) {
+                double l = a[i*n + k];
+                if (l == 0) continue;
+                for (unsigned j = k1; j < n; j++)
+                    a[i*n + j] -= l*a[k*n + j];
+            }
+    }
+    return regular;
+}
+
+double LU_det(unsigned n, const std::vector<double> &lu,
+        const std::vector<int> &pivots)
+{
+    double d = 1;
+    for (unsigned i = 0; i < n; i++) {
+        d *= lu[i*n + i];
+        if (pivots[i] != int(i)) d = -d;
+    }
+    return d;
+}
+
+void LU_substitute(unsigned n, const std::vector<double> &lu,
+        const std::vector<int> &pivots, unsigned nrhs, std::vector<double> &x)
+{
+    double *b = x.data();
+    for (unsigned k = 0; k < n; k++)
+        if (pivots[k] != int(k))
+            std::swap_ranges(b + k*nrhs, b + (k + 1)*nrhs,
+                b + pivots[k]*nrhs);
+    // L y = P b
+    for (unsigned i = 1; i < n; i++)
+        for (unsigned k = 0; k < i; k++) {
+            double l = lu[i*n + k];
+            if (l == 0) continue;
+            for (unsigned j = 0; j < nrhs; j++)
+                b[i*nrhs + j] -= l*b[k*nrhs + j];
+        }
+    // U x = y
+    for (unsigned i = n; i-- > 0;) {
+        for (unsigned k = i + 1; k < n; k++) {
+            double u = lu[i*n + k];
+            if (u == 0) continue;
+            for (unsigned j = 0; j < nrhs; j++)
+                b[i*nrhs + j] -= u*b[k*nrhs + j];
+        }
+        double d = lu[i*n + i];
+        for (unsigned j = 0; j < nrhs; j++)
+            b[i*nrhs + j] /= d;
+    }
+}
+
+void LU_invert(unsigned n, std::vector<double> &lu,
+        const std::vector<int> &pivots)
+{
+    std::vector<double> x(n*n, 0.0);
+    for (unsigned i = 0; i < n; i++)
+        x[i*n + i] = 1;
+    LU_substitute(n, lu, pivots, n, x);
+    lu.swap(x);
+}
+
+#endif // HAVE_CSYMPY_LAPACK
+
+} // anonymous namespace
+
+double det_double(unsigned n, const std::vector<double> &a)
+{
+    CSYMPY_ASSERT(a.size() == n*n);
+    if (n == 0) return 1;
+    std::vector<double> lu(a);
+    std::vector<int> pivots;
+    if (!LU_factor(n, lu, pivots)) return 0;
+    return LU_det(n, lu, pivots);
+}
+
+double det_double(const DenseMatrix &A)
+{
+    check_square(A);
+    std::vector<double> a;
+    eval_double(A, a);
+    return det_double(A.nrows(), a);
+}
+
+void LU_solve_double(unsigned n, const std::vector<double> &a,
+        unsigned nrhs, const std::vector<double> &b, std::vector<double> &x)
+{
+    CSYMPY_ASSERT(a.size() == n*n && b.size() == n*nrhs);
+    x = b;
+    if (n == 0) return;
+    std::vector<double> lu(a);
+    std::vector<int> pivots;
+    if (!LU_factor(n, lu, pivots))
+        throw std::runtime_error("Matrix is singular");
+    LU_substitute(n, lu, pivots, nrhs, x);
+}
+
+void LU_solve_double(const DenseMatrix &A, const DenseMatrix &b,
+        std::vector<double> &x)
+{
+    check_square(A);
+    if (b.nrows() != A.nrows())
+        throw std::runtime_error("Dimensions of A and b do not match");
+    std::vector<double> a, c;
+    eval_double(A, a);
+    eval_double(b, c);
+    LU_solve_double(A.nrows(), a, b.ncols(), c, x);
+}
+
+void inverse_double(unsigned n, const std::vector<double> &a,
+        std::vector<double> &ainv)
+{
+    CSYMPY_ASSERT(a.size() == n*n);
+    ainv = a;
+    if (n == 0) return;
+    std::vector<int> pivots;
+    if (!LU_factor(n, ainv, pivots))
+        throw std::runtime_error("Matrix is singular");
+    LU_invert(n, ainv, pivots);
+}
+
+void inverse_double(const DenseMatrix &A, std::vector<double> &ainv)
+{
+    check_square(A);
+    std::vector<double> a;
+    eval_double(A, a);
+    inverse_double(A.nrows(), a, ainv);
+}
+
+} // CSymPy
@@ -0,0 +1,50 @@
+/**
+ *  \file dense_matrix_double.h
+ *  Numeric (double precision) solve, inverse and determinant of dense
+ *  matrices
+ *
+ **/
+#ifndef CSYMPY_DENSE_MATRIX_DOUBLE_H
+#define CSYMPY_DENSE_MATRIX_DOUBLE_H
+
+#include <vector>
+
+#include "matrix.h"
+
+namespace CSymPy {
+
+/*  Once numbers are substituted into a matrix, solving with it as a
+    DenseMatrix still goes through `RCP<const Basic>` arithmetic for every
+    entry. The functions below evaluate the entries once into a row-major
+    array of doubles and do the linear algebra there: with LU factorization
+    with partial pivoting, by LAPACK (`dgetrf`, `dgetrs`, `dgetri`) when
+    CSymPy is configured with WITH_LAPACK, and otherwise by a built-in
+    blocked kernel.
+
+    All arrays are row-major: entry `(i, j)` of an `n x m` matrix is
+    `a[i*m + j]`. The solve and inverse functions throw std::runtime_error
+    if the matrix is singular (has an exactly zero pivot).
+*/
+
+//! Evaluates the entries of `A`, which must not contain symbols, into `a`
+void eval_double(const DenseMatrix &A, std::vector<double> &a);
+
+//! \return the determinant of the `n x n` matrix `a`
+double det_double(unsigned n, const std::vector<double> &a);
+double det_double(const DenseMatrix &A);
+
+//! Solves `a x = b` for the `n x nrhs` matrix `x`, where `a` is `n x n` and
+//! `b` is `n x nrhs`
+void LU_solve_double(unsigned n, const std::vector<double> &a,
+        unsigned nrhs, const std::vector<double> &b, std::vector<double> &x);
+void LU_solve_double(const DenseMatrix &A, const DenseMatrix &b,
+        std::vector<double> &x);
+
+//! Computes the inverse `ainv` of the `n x n` matrix `a`
+void inverse_double(unsigned n, const std::vector<double> &a,
+        std::vector<double> &ainv);
+void inverse_double(const DenseMatrix &A, std::vector<double> &ainv);
+
+} // CSymPy
+
+#endif
@@ -10,6 +10,10 @@
 
 #include <gmpxx.h>
 
+#include "pool_allocator.h"
+#include "flat_hash_map.h"
+#include "flat_map.h"
+
 namespace CSymPy {
 
 class Basic;
@@ -20,20 +24,52 @@ struct RCPBasicKeyEq;
 struct RCPBasicKeyLess;
 struct RCPIntegerKeyLess;
 
+#if defined(WITH_CSYMPY_FLAT_HASH_MAP)
+typedef FlatHashMap<RCP<const Basic>, RCP<const Number>,
+        RCPBasicHash, RCPBasicKeyEq> umap_basic_num;
+typedef FlatHashMap<RCP<const Basic>, RCP<const Basic>,
+        RCPBasicHash, RCPBasicKeyEq> umap_basic_basic;
+#elif defined(WITH_CSYMPY_POOL_ALLOCATOR)
+typedef std::unordered_map<RCP<const Basic>, RCP<const Number>,
+        RCPBasicHash, RCPBasicKeyEq,
+        PoolAllocator<std::pair<const RCP<const Basic>, RCP<const Number>>>>
+        umap_basic_num;
+typedef std::unordered_map<RCP<const Basic>, RCP<const Basic>,
+        RCPBasicHash, RCPBasicKeyEq,
+        PoolAllocator<std::pair<const RCP<const Basic>, RCP<const Basic>>>>
+        umap_basic_basic;
+#else
 typedef std::unordered_map<RCP<const Basic>, RCP<const Number>,
         RCPBasicHash, RCPBasicKeyEq> umap_basic_num;
 typedef std::unordered_map<RCP<const Basic>, RCP<const Basic>,
         RCPBasicHash, RCPBasicKeyEq> umap_basic_basic;
+#endif
 
 typedef std::vector<int> vec_int;
 typedef std::vector<RCP<const Basic>> vec_basic;
+typedef std::vector<std::pair<RCP<const Basic>, RCP<const Basic>>> vec_pair;
 typedef std::vector<RCP<const Integer>> vec_integer;
 typedef std::map<vec_int, long long int> map_vec_int;
 typedef std::map<vec_int, mpz_class> map_vec_mpz;
+#if defined(WITH_CSYMPY_POOL_ALLOCATOR)
+typedef std::map<RCP<const Basic>, RCP<const Number>, RCPBasicKeyLess,
+        PoolAllocator<std::pair<const RCP<const Basic>, RCP<const Number>>>>
+        map_basic_num;
+#else
 typedef std::map<RCP<const Basic>, RCP<const Number>,
         RCPBasicKeyLess> map_basic_num;
+#endif
+#if defined(WITH_CSYMPY_FLAT_MAP)
+typedef FlatMap<RCP<const Basic>, RCP<const Basic>,
+        RCPBasicKeyLess> map_basic_basic;
+#elif defined(WITH_CSYMPY_POOL_ALLOCATOR)
+typedef std::map<RCP<const Basic>, RCP<const Basic>, RCPBasicKeyLess,
+        PoolAllocator<std::pair<const RCP<const Basic>, RCP<const Basic>>>>
+        map_basic_basic;
+#else
 typedef std::map<RCP<const Basic>, RCP<const Basic>,
         RCPBasicKeyLess> map_basic_basic;
+#endif
 typedef std::map<RCP<const Integer>, unsigned,
         RCPIntegerKeyLess> map_integer_uint;
 
@@ -87,8 +123,18 @@ typedef struct
     }
 } vec_int_eq;
 
+#if defined(WITH_CSYMPY_FLAT_HASH_MAP)
+typedef FlatHashMap<vec_int, mpz_class,
+        vec_int_hash, vec_int_eq> umap_vec_mpz;
+#else
 typedef std::unordered_map<vec_int, mpz_class,
         vec_int_hash, vec_int_eq> umap_vec_mpz;
+#endif
+
+//! Sparse polynomial with exponents packed into one word (see MonomialPacking)
+typedef std::unordered_map<unsigned long long, mpz_class> umap_ull_mpz;
+//! Sparse polynomial with packed exponents, sorted by decreasing monomials
+typedef std::vector<std::pair<unsigned long long, mpz_class>> vec_ull_mpz;
 
 } // CSymPy
 
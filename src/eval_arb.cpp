@@ -8,6 +8,7 @@
 #include "pow.h"
 #include "functions.h"
 #include "constants.h"
+#include "polynomial.h"
 #include "visitor.h"
 #include "eval_arb.h"
 
@@ -45,21 +46,22 @@ public:
         fmpq_clear(q_);
     }
 
+    // Add and Mul are evaluated from their dictionaries directly, without
+    // building the `coef*term` and `base**exp` nodes of get_args()
     virtual void visit(const Add &x) {
-        arb_t t;
+        arb_t t, c;
         arb_init(t);
-
-        auto d = x.get_args();
-        for (auto p = d.begin(); p != d.end();  p++) {
-
-            if (p == d.begin()) {
-                apply(result_, *(*p));
-            } else {
-                apply(t, *(*p));
-                arb_add(result_, result_, t, prec_);
-            }
+        arb_init(c);
+
+        apply(result_, *(x.coef_));
+        for (auto &p: x.dict_) {
+            apply(t, *(p.first));
+            apply(c, *(p.second));
+            arb_mul(t, t, c, prec_);
+            arb_add(result_, result_, t, prec_);
         }
 
+        arb_clear(c);
         arb_clear(t);
     }
 
@@ -67,36 +69,39 @@ public:
         arb_t t;
         arb_init(t);
 
-        auto d = x.get_args();
-        for (auto p = d.begin(); p != d.end(); p++) {
-
-            if (p == d.begin()) {
-                apply(result_, *(*p));
-            } else {
-                apply(t, *(*p));
-                arb_mul(result_, result_, t, prec_);
-            }
+        apply(result_, *(x.coef_));
+        for (auto &p: x.dict_) {
+            if (p.second->__eq__(*one))
+                apply(t, *(p.first));
+            else
+                apply_pow(t, *(p.first), *(p.second));
+            arb_mul(result_, result_, t, prec_);
         }
 
         arb_clear(t);
     }
 
-    virtual void visit(const Pow &x) {
-        if (eq(x.get_base(), E)) {
-            apply(result_, *(x.exp_));
-            arb_exp(result_, result_, prec_);
+    // Evaluates `base**exp` into `result`
+    void apply_pow(arb_ptr result, const Basic &base, const Basic &exp) {
+        if (base.__eq__(*E)) {
+            apply(result, exp);
+            arb_exp(result, result, prec_);
         } else {
             arb_t b;
             arb_init(b);
 
-            apply(b, *(x.base_));
-            apply(result_, *(x.exp_));
-            arb_pow(result_, b, result_, prec_);
+            apply(b, base);
+            apply(result, exp);
+            arb_pow(result, b, result, prec_);
 
             arb_clear(b);
         }
     }
 
+    virtual void visit(const Pow &x) {
+        apply_pow(result_, *(x.base_), *(x.exp_));
+    }
+
     virtual void visit(const Sin &x) {
         apply(result_, *(x.get_arg()));
         arb_sin(result_, result_, prec_);
@@ -269,6 +274,10 @@ public:
     virtual void visit(const Subs &) {
         throw std::runtime_error("Not implemented.");
     };
+
+    virtual void visit(const Polynomial &x) {
+        apply(result_, *x.as_basic());
+    };
 };
 
 void eval_arb(arb_t result, const Basic &b, long precision)
@@ -277,6 +286,16 @@ void eval_arb(arb_t result, const Basic &b, long precision)
     v.apply(result, b);
 }
 
+void eval_arb(arb_mat_t result, const DenseMatrix &A, long precision)
+{
+    CSYMPY_ASSERT(arb_mat_nrows(result) == long(A.nrows()) &&
+        arb_mat_ncols(result) == long(A.ncols()));
+    EvalArbVisitor v(precision);
+    for (unsigned i = 0; i < A.nrows(); i++)
+        for (unsigned j = 0; j < A.ncols(); j++)
+            v.apply(arb_mat_entry(result, i, j), *A.get(i, j));
+}
+
 } // CSymPy
 
 #endif // HAVE_CSYMPY_ARB
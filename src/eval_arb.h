@@ -11,7 +11,9 @@
 #ifdef HAVE_CSYMPY_ARB
 
 #include "basic.h"
+#include "matrix.h"
 #include "arb.h"
+#include "arb_mat.h"
 
 namespace CSymPy {
 
@@ -19,6 +21,10 @@ namespace CSymPy {
 // This design will not change in `arb` and hence will not change in `CSymPy`
 // also.
 void eval_arb(arb_t result, const Basic &b, long precision = 53);
+//! Evaluates the entries of `A` into `result`, which must be initialized
+//! with the dimensions of `A`. Solve, inverse and determinant are then
+//! `arb_mat_solve()`, `arb_mat_inv()` and `arb_mat_det()`.
+void eval_arb(arb_mat_t result, const DenseMatrix &A, long precision = 53);
 
 } // CSymPy
 
@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <complex>
+#include <thread>
+#include <unordered_map>
 
 #include "basic.h"
 #include "symbol.h"
@@ -10,11 +15,48 @@
 #include "pow.h"
 #include "functions.h"
 #include "constants.h"
+#include "polynomial.h"
 #include "visitor.h"
 #include "eval_double.h"
 
 namespace CSymPy {
 
+namespace {
+
+template <class T>
+inline T powi(T x, int n)
+{
+    if (n < 0) return T(1) / powi(x, -n);
+    T r = 1;
+    while (n != 0) {
+        if (n & 1) r *= x;
+        x *= x;
+        n >>= 1;
+    }
+    return r;
+}
+
+template <class T>
+T complex_value(const Complex &x);
+
+template <>
+double complex_value<double>(const Complex &)
+{
+    throw std::runtime_error("Complex cannot be evaluated as a double.");
+}
+
+template <>
+std::complex<double> complex_value<std::complex<double>>(const Complex &x)
+{
+    return std::complex<double>(x.real_.get_d(), x.imaginary_.get_d());
+}
+
+} // anonymous namespace
+
+// Evaluates an expression as a `T` (double or std::complex<double>). The
+// values of the symbols are looked up in `values`, in the order of
+// `symbols`, so that no substituted tree has to be built.
+template <class T>
 class EvalDoubleVisitor : public Visitor {
 private:
     /*
@@ -24,63 +66,604 @@ private:
        returned. Thus no corruption can happen and apply() can be safely called
        recursively.
     */
-    double result_;
+    T result_;
+    const vec_basic *symbols_;
+    const T *values_;
+
+    // Integer powers by repeated multiplication (as compile_double()), which
+    // is exact for complex numbers, other powers by the principal branch
+    T power(const Basic &base, const Basic &exp) {
+        T a = apply(base);
+        if (is_a<Integer>(exp)) {
+            const mpz_class &n = static_cast<const Integer &>(exp).i;
+            if (n.fits_sint_p()) return powi(a, n.get_si());
+        }
+        return std::pow(a, apply(exp));
+    }
+
 public:
-    double apply(const Basic &b) {
+    EvalDoubleVisitor(const vec_basic *symbols = nullptr,
+            const T *values = nullptr) : symbols_(symbols), values_(values) {}
+
+    T apply(const Basic &b) {
         b.accept(*this);
         return result_;
     }
 
     void visit(const Integer &x) {
-        double tmp = x.i.get_d();
+        T tmp = x.i.get_d();
         result_ = tmp;
     }
 
     void visit(const Rational &x) {
-        double tmp = x.i.get_d();
+        T tmp = x.i.get_d();
         result_ = tmp;
     }
 
+    void visit(const Complex &x) {
+        result_ = complex_value<T>(x);
+    }
+
+    void visit(const Constant &x) {
+        if (x.__eq__(*pi))
+            result_ = ::acos(-1.0);
+        else if (x.__eq__(*E))
+            result_ = ::exp(1.0);
+        else
+            throw std::runtime_error("Not implemented.");
+    }
+
+    void visit(const Symbol &x) {
+        if (symbols_ != nullptr) {
+            for (std::size_t i = 0; i < symbols_->size(); i++) {
+                const Basic *s = (*symbols_)[i].get();
+                if (s == &x || s->__eq__(x)) {
+                    result_ = values_[i];
+                    return;
+                }
+            }
+        }
+        throw std::runtime_error("Symbol cannot be evaluated as a double.");
+    }
+
+    // Add and Mul are evaluated from their dictionaries directly, without
+    // building the `coef*term` and `base**exp` nodes of get_args()
     void visit(const Add &x) {
-        double tmp = 0;
-        for (auto &p: x.get_args()) tmp = tmp + apply(*p);
+        T tmp = apply(*(x.coef_));
+        for (auto &p: x.dict_) tmp = tmp + apply(*p.second) * apply(*p.first);
         result_ = tmp;
     }
 
     void visit(const Mul &x) {
-        double tmp = 1;
-        for (auto &p: x.get_args()) tmp = tmp * apply(*p);
+        T tmp = apply(*(x.coef_));
+        for (auto &p: x.dict_) tmp = tmp * power(*p.first, *p.second);
         result_ = tmp;
     }
 
     void visit(const Pow &x) {
-        double a = apply(*(x.base_));
-        double b = apply(*(x.exp_));
-        result_ = ::pow(a, b);
+        result_ = power(*(x.base_), *(x.exp_));
     }
 
     void visit(const Sin &x) {
-        double tmp = apply(*(x.get_arg()));
-        result_ = ::sin(tmp);
+        T tmp = apply(*(x.get_arg()));
+        result_ = std::sin(tmp);
     }
 
     void visit(const Cos &x) {
-        double tmp = apply(*(x.get_arg()));
-        result_ = ::cos(tmp);
+        T tmp = apply(*(x.get_arg()));
+        result_ = std::cos(tmp);
     }
 
     void visit(const Tan &x) {
-        double tmp = apply(*(x.get_arg()));
-        result_ = ::tan(tmp);
+        T tmp = apply(*(x.get_arg()));
+        result_ = std::tan(tmp);
     }
 
-    virtual void visit(const Symbol &) {
-        throw std::runtime_error("Symbol cannot be evaluated as a double.");
+    void visit(const Log &x) {
+        T tmp = apply(*(x.get_arg()));
+        result_ = std::log(tmp);
+    }
+
+    void visit(const Abs &x) {
+        T tmp = apply(*(x.get_arg()));
+        result_ = std::abs(tmp);
+    }
+
+    virtual void visit(const Derivative &) {
+        throw std::runtime_error("Not implemented.");
     };
-    virtual void visit(const Complex &) {
+    virtual void visit(const Cot &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Csc &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Sec &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ASin &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACos &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ASec &) {
         throw std::runtime_error("Not implemented.");
     };
-    virtual void visit(const Log &) {
+    virtual void visit(const ACsc &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ATan &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACot &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ATan2 &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const LambertW &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const FunctionSymbol &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Sinh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Cosh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Tanh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Coth &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ASinh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACosh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ATanh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACoth &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const KroneckerDelta &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const LeviCivita &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Zeta &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Dirichlet_eta &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Gamma &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const LowerGamma &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const UpperGamma &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Subs &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Polynomial &x) {
+        apply(*x.as_basic());
+    };
+};
+
+double eval_double(const Basic &b)
+{
+    EvalDoubleVisitor<double> v;
+    return v.apply(b);
+}
+
+namespace {
+
+// Evaluates the values of `values` into `v`, \return their symbols
+template <class T>
+vec_basic eval_values(const map_basic_basic &values, std::vector<T> &v)
+{
+    vec_basic symbols;
+    EvalDoubleVisitor<T> e;
+    for (auto &p: values) {
+        if (!is_a<Symbol>(*p.first))
+            throw std::runtime_error("Only symbols can be substituted.");
+        symbols.push_back(p.first);
+        v.push_back(e.apply(*p.second));
+    }
+    return symbols;
+}
+
+} // anonymous namespace
+
+double eval_double(const Basic &b, const map_basic_basic &values)
+{
+    std::vector<double> v;
+    vec_basic symbols = eval_values(values, v);
+    return eval_double(b, symbols, v);
+}
+
+double eval_double(const Basic &b, const vec_basic &symbols,
+        const std::vector<double> &values)
+{
+    if (symbols.size() != values.size())
+        throw std::runtime_error("Need one value for each symbol.");
+    EvalDoubleVisitor<double> v(&symbols, values.data());
+    return v.apply(b);
+}
+
+std::complex<double> eval_complex_double(const Basic &b)
+{
+    EvalDoubleVisitor<std::complex<double>> v;
+    return v.apply(b);
+}
+
+std::complex<double> eval_complex_double(const Basic &b,
+        const map_basic_basic &values)
+{
+    std::vector<std::complex<double>> v;
+    vec_basic symbols = eval_values(values, v);
+    return eval_complex_double(b, symbols, v);
+}
+
+std::complex<double> eval_complex_double(const Basic &b,
+        const vec_basic &symbols,
+        const std::vector<std::complex<double>> &values)
+{
+    if (symbols.size() != values.size())
+        throw std::runtime_error("Need one value for each symbol.");
+    EvalDoubleVisitor<std::complex<double>> v(&symbols, values.data());
+    return v.apply(b);
+}
+
+namespace {
+
+// Reverse mode differentiation of an expression in doubles: the distinct
+// subexpressions in postorder (the tape), evaluated from the symbols up to
+// the root, then their adjoints (the derivatives of the root by them) from
+// the root down to the symbols
+class GradientTape {
+private:
+    struct Node {
+        const Basic *node;
+        double value;
+        double adjoint;
+    };
+    std::vector<Node> nodes_;
+    std::unordered_map<RCP<const Basic>, std::size_t, RCPBasicHash,
+        RCPBasicKeyEq> index_, symbol_index_;
+    const vec_basic &symbols_;
+    const std::vector<double> &values_;
+
+    static bool is_leaf(const Basic &b) {
+        return is_a_Number(b) || is_a<Constant>(b);
+    }
+
+    // Adds the nodes of `b` (the terms of Add, the bases and exponents of
+    // Mul and Pow, the arguments of functions) in postorder, each distinct
+    // node once
+    void walk(const Basic &b) {
+        if (is_leaf(b)) return;
+        RCP<const Basic> r = rcp(&b);
+        if (index_.find(r) != index_.end()) return;
+        if (is_a<Add>(b)) {
+            for (auto &p: static_cast<const Add &>(b).dict_) walk(*p.first);
+        } else if (is_a<Mul>(b)) {
+            for (auto &p: static_cast<const Mul &>(b).dict_) {
+                walk(*p.first);
+                walk(*p.second);
+            }
+        } else if (is_a<Pow>(b)) {
+            walk(*static_cast<const Pow &>(b).get_base());
+            walk(*static_cast<const Pow &>(b).get_exp());
+        } else if (is_a<Sin>(b) || is_a<Cos>(b) || is_a<Tan>(b)) {
+            walk(*static_cast<const TrigFunction &>(b).get_arg());
+        } else if (is_a<Log>(b)) {
+            walk(*static_cast<const Log &>(b).get_arg());
+        } else if (is_a<Abs>(b)) {
+            walk(*static_cast<const Abs &>(b).get_arg());
+        } else if (!is_a<Symbol>(b)) {
+            throw std::runtime_error("Not implemented.");
+        }
+        index_[r] = nodes_.size();
+        nodes_.push_back({&b, 0, 0});
+    }
+
+    Node &node(const Basic &b) {
+        return nodes_[index_.find(rcp(&b))->second];
+    }
+
+    double value(const Basic &b) {
+        return is_leaf(b) ? eval_double(b) : node(b).value;
+    }
+
+    // `base**exp`, integer powers by repeated multiplication
+    double power(double base, const Basic &exp) {
+        if (is_a<Integer>(exp)) {
+            const mpz_class &n = static_cast<const Integer &>(exp).i;
+            if (n.fits_sint_p()) return powi(base, n.get_si());
+        }
+        return std::pow(base, value(exp));
+    }
+
+    // The derivative of `base**exp` by `base`
+    double power_diff(double base, const Basic &exp) {
+        if (is_a<Integer>(exp)) {
+            const mpz_class &n = static_cast<const Integer &>(exp).i;
+            if (n.fits_sint_p()) return n.get_si() * powi(base, n.get_si() - 1);
+        }
+        double e = value(exp);
+        return e * std::pow(base, e - 1);
+    }
+
+    double evaluate(const Basic &b) {
+        if (is_a<Symbol>(b)) {
+            auto it = symbol_index_.find(rcp(&b));
+            if (it == symbol_index_.end())
+                throw std::runtime_error(
+                    "Symbol cannot be evaluated as a double.");
+            return values_[it->second];
+        } else if (is_a<Add>(b)) {
+            const Add &x = static_cast<const Add &>(b);
+            double r = eval_double(*x.coef_);
+            for (auto &p: x.dict_)
+                r += eval_double(*p.second) * value(*p.first);
+            return r;
+        } else if (is_a<Mul>(b)) {
+            const Mul &x = static_cast<const Mul &>(b);
+            double r = eval_double(*x.coef_);
+            for (auto &p: x.dict_) r *= power(value(*p.first), *p.second);
+            return r;
+        } else if (is_a<Pow>(b)) {
+            const Pow &x = static_cast<const Pow &>(b);
+            return power(value(*x.get_base()), *x.get_exp());
+        } else if (is_a<Sin>(b)) {
+            return std::sin(value(*static_cast<const Sin &>(b).get_arg()));
+        } else if (is_a<Cos>(b)) {
+            return std::cos(value(*static_cast<const Cos &>(b).get_arg()));
+        } else if (is_a<Tan>(b)) {
+            return std::tan(value(*static_cast<const Tan &>(b).get_arg()));
+        } else if (is_a<Log>(b)) {
+            return std::log(value(*static_cast<const Log &>(b).get_arg()));
+        } else {
+            return std::abs(value(*static_cast<const Abs &>(b).get_arg()));
+        }
+    }
+
+    void contribute(const Basic &b, double d) {
+        if (!is_leaf(b)) node(b).adjoint += d;
+    }
+
+    // Adds the adjoint `a` of `n` times the partial derivatives of `n` by
+    // its arguments to the adjoints of the arguments
+    void propagate(const Node &n, double a) {
+        const Basic &b = *n.node;
+        if (is_a<Add>(b)) {
+            for (auto &p: static_cast<const Add &>(b).dict_)
+                contribute(*p.first, a * eval_double(*p.second));
+        } else if (is_a<Mul>(b)) {
+            // The product of the other factors of each factor, without
+            // dividing (the factors may be zero)
+            const Mul &x = static_cast<const Mul &>(b);
+            std::vector<double> f;
+            for (auto &p: x.dict_)
+                f.push_back(power(value(*p.first), *p.second));
+            std::vector<double> after(f.size() + 1, 1);
+            for (std::size_t i = f.size(); i-- > 0; )
+                after[i] = after[i + 1] * f[i];
+            double before = eval_double(*x.coef_);
+            std::size_t i = 0;
+            for (auto &p: x.dict_) {
+                double others = before * after[i + 1];
+                double base = value(*p.first);
+                contribute(*p.first, a * others * power_diff(base, *p.second));
+                if (!is_a_Number(*p.second))
+                    contribute(*p.second, a * others * f[i] * std::log(base));
+                before *= f[i++];
+            }
+        } else if (is_a<Pow>(b)) {
+            const Pow &x = static_cast<const Pow &>(b);
+            double base = value(*x.get_base());
+            contribute(*x.get_base(), a * power_diff(base, *x.get_exp()));
+            if (!is_a_Number(*x.get_exp()))
+                contribute(*x.get_exp(), a * n.value * std::log(base));
+        } else if (is_a<Sin>(b)) {
+            const Basic &arg = *static_cast<const Sin &>(b).get_arg();
+            contribute(arg, a * std::cos(value(arg)));
+        } else if (is_a<Cos>(b)) {
+            const Basic &arg = *static_cast<const Cos &>(b).get_arg();
+            contribute(arg, -a * std::sin(value(arg)));
+        } else if (is_a<Tan>(b)) {
+            const Basic &arg = *static_cast<const Tan &>(b).get_arg();
+            contribute(arg, a * (1 + n.value * n.value));
+        } else if (is_a<Log>(b)) {
+            const Basic &arg = *static_cast<const Log &>(b).get_arg();
+            contribute(arg, a / value(arg));
+        } else if (is_a<Abs>(b)) {
+            const Basic &arg = *static_cast<const Abs &>(b).get_arg();
+            double v = value(arg);
+            contribute(arg, v > 0 ? a : (v < 0 ? -a : 0));
+        }
+    }
+
+public:
+    GradientTape(const Basic &b, const vec_basic &symbols,
+            const std::vector<double> &values)
+        : symbols_(symbols), values_(values) {
+        for (std::size_t i = 0; i < symbols.size(); i++)
+            symbol_index_[symbols[i]] = i;
+        walk(b);
+    }
+
+    double apply(const Basic &b, std::vector<double> &grad) {
+        grad.assign(symbols_.size(), 0);
+        if (is_leaf(b)) return eval_double(b);
+        for (auto &n: nodes_) n.value = evaluate(*n.node);
+        nodes_.back().adjoint = 1;
+        for (std::size_t i = nodes_.size(); i-- > 0; ) {
+            if (nodes_[i].adjoint != 0)
+                propagate(nodes_[i], nodes_[i].adjoint);
+        }
+        for (std::size_t i = 0; i < symbols_.size(); i++) {
+            auto it = index_.find(symbols_[i]);
+            if (it != index_.end()) grad[i] = nodes_[it->second].adjoint;
+        }
+        return nodes_.back().value;
+    }
+};
+
+} // anonymous namespace
+
+double eval_double_gradient(const Basic &b, const vec_basic &symbols,
+        const std::vector<double> &values, std::vector<double> &grad)
+{
+    if (symbols.size() != values.size())
+        throw std::runtime_error("Need one value for each symbol.");
+    GradientTape t(b, symbols, values);
+    return t.apply(b, grad);
+}
+
+// Lowers an expression into a CompiledDouble. Each distinct subexpression
+// gets a register (found by `hash()` and `__eq__`), numbers and constants
+// are loaded into their registers once, here.
+class DoubleCompiler : public Visitor {
+private:
+    struct PtrHash {
+        std::size_t operator()(const Basic *b) const { return b->hash(); }
+    };
+    struct PtrEq {
+        bool operator()(const Basic *a, const Basic *b) const {
+            return a == b || a->__eq__(*b);
+        }
+    };
+    // The expression outlives the compiler, so its nodes can be the keys
+    std::unordered_map<const Basic *, int, PtrHash, PtrEq> slots_;
+    // Nodes built while compiling, kept alive for the same reason
+    vec_basic temporaries_;
+    CompiledDouble &f_;
+    int result_;
+
+    int constant(double value) {
+        f_.regs_.push_back(value);
+        return f_.regs_.size() - 1;
+    }
+    int emit(CompiledDouble::Opcode op, int a, int b = 0) {
+        int dst = f_.regs_.size();
+        f_.regs_.push_back(0);
+        f_.code_.push_back({op, dst, a, b});
+        return dst;
+    }
+    int power(const Basic &base, const Basic &exp) {
+        if (is_a<Integer>(exp)) {
+            const mpz_class &n = static_cast<const Integer &>(exp).i;
+            if (n == 1) return apply(base);
+            if (n.fits_sint_p())
+                return emit(CompiledDouble::POWI, apply(base), n.get_si());
+        }
+        return emit(CompiledDouble::POW, apply(base), apply(exp));
+    }
+
+public:
+    DoubleCompiler(CompiledDouble &f, const vec_basic &symbols) : f_(f) {
+        f_.nsymbols_ = symbols.size();
+        for (auto &s: symbols) {
+            if (!is_a<Symbol>(*s))
+                throw std::runtime_error("Only symbols can be arguments.");
+            slots_.insert(std::make_pair(s.get(), constant(0)));
+        }
+    }
+
+    void compile(const Basic &b) {
+        f_.result_ = apply(b);
+    }
+
+    //! \return the register holding the value of `b`
+    int apply(const Basic &b) {
+        auto it = slots_.find(&b);
+        if (it != slots_.end()) return it->second;
+        b.accept(*this);
+        slots_.insert(std::make_pair(&b, result_));
+        return result_;
+    }
+
+    void visit(const Integer &x) {
+        result_ = constant(x.i.get_d());
+    }
+
+    void visit(const Rational &x) {
+        result_ = constant(x.i.get_d());
+    }
+
+    void visit(const Constant &x) {
+        if (x.__eq__(*pi))
+            result_ = constant(::acos(-1.0));
+        else if (x.__eq__(*E))
+            result_ = constant(::exp(1.0));
+        else
+            throw std::runtime_error("Not implemented.");
+    }
+
+    void visit(const Add &x) {
+        int r = -1;
+        if (!x.coef_->is_zero()) r = apply(*(x.coef_));
+        for (auto &p: x.dict_) {
+            int t = apply(*(p.first));
+            if (!p.second->is_one())
+                t = emit(CompiledDouble::MUL, apply(*(p.second)), t);
+            r = (r < 0) ? t : emit(CompiledDouble::ADD, r, t);
+        }
+        result_ = r;
+    }
+
+    void visit(const Mul &x) {
+        int r = -1;
+        if (!x.coef_->is_one()) r = apply(*(x.coef_));
+        for (auto &p: x.dict_) {
+            int t = power(*(p.first), *(p.second));
+            r = (r < 0) ? t : emit(CompiledDouble::MUL, r, t);
+        }
+        result_ = r;
+    }
+
+    void visit(const Pow &x) {
+        result_ = power(*(x.base_), *(x.exp_));
+    }
+
+    void visit(const Sin &x) {
+        result_ = emit(CompiledDouble::SIN, apply(*(x.get_arg())));
+    }
+
+    void visit(const Cos &x) {
+        result_ = emit(CompiledDouble::COS, apply(*(x.get_arg())));
+    }
+
+    void visit(const Tan &x) {
+        result_ = emit(CompiledDouble::TAN, apply(*(x.get_arg())));
+    }
+
+    void visit(const Log &x) {
+        result_ = emit(CompiledDouble::LOG, apply(*(x.get_arg())));
+    }
+
+    void visit(const Polynomial &x) {
+        temporaries_.push_back(x.as_basic());
+        result_ = apply(*temporaries_.back());
+    }
+
+    virtual void visit(const Symbol &) {
+        throw std::runtime_error("Symbol not in the list of symbols.");
+    };
+    virtual void visit(const Complex &) {
         throw std::runtime_error("Not implemented.");
     };
     virtual void visit(const Derivative &) {
@@ -167,9 +750,6 @@ public:
     virtual void visit(const UpperGamma &) {
         throw std::runtime_error("Not implemented.");
     };
-    virtual void visit(const Constant &) {
-        throw std::runtime_error("Not implemented.");
-    };
     virtual void visit(const Abs &) {
         throw std::runtime_error("Not implemented.");
     };
@@ -178,10 +758,158 @@ public:
     };
 };
 
-double eval_double(const Basic &b)
+namespace {
+
+// `d = a**n` for `CompiledDouble::batch_lanes` lanes, by repeated squaring
+// (the same multiplications for all lanes)
+void powi_lanes(double *d, const double *a, int n)
 {
-    EvalDoubleVisitor v;
-    return v.apply(b);
+    const std::size_t L = CompiledDouble::batch_lanes;
+    bool invert = n < 0;
+    if (invert) n = -n;
+    double p[L];
+    for (std::size_t l = 0; l < L; l++) {
+        d[l] = 1;
+        p[l] = a[l];
+    }
+    while (n != 0) {
+        if (n & 1)
+            for (std::size_t l = 0; l < L; l++) d[l] *= p[l];
+        for (std::size_t l = 0; l < L; l++) p[l] *= p[l];
+        n >>= 1;
+    }
+    if (invert)
+        for (std::size_t l = 0; l < L; l++) d[l] = 1 / d[l];
+}
+
+} // anonymous namespace
+
+double CompiledDouble::operator()(const double *x) const
+{
+    double *r = regs_.data();
+    for (std::size_t i = 0; i < nsymbols_; i++) r[i] = x[i];
+    for (const Instruction &c: code_) {
+        switch (c.op) {
+            case ADD: r[c.dst] = r[c.a] + r[c.b]; break;
+            case MUL: r[c.dst] = r[c.a] * r[c.b]; break;
+            case POW: r[c.dst] = ::pow(r[c.a], r[c.b]); break;
+            case POWI: r[c.dst] = powi(r[c.a], c.b); break;
+            case SIN: r[c.dst] = ::sin(r[c.a]); break;
+            case COS: r[c.dst] = ::cos(r[c.a]); break;
+            case TAN: r[c.dst] = ::tan(r[c.a]); break;
+            case LOG: r[c.dst] = ::log(r[c.a]); break;
+        }
+    }
+    return r[result_];
+}
+
+void CompiledDouble::init_batch_regs(std::vector<double> &r) const
+{
+    const std::size_t L = batch_lanes;
+    r.resize(regs_.size() * L);
+    for (std::size_t i = 0; i < regs_.size(); i++)
+        for (std::size_t l = 0; l < L; l++)
+            r[i * L + l] = regs_[i];
+}
+
+void CompiledDouble::eval_batch(const double *x, std::size_t n,
+        double *out) const
+{
+    if (batch_regs_.empty()) init_batch_regs(batch_regs_);
+    eval_batch(batch_regs_.data(), x, n, out);
+}
+
+void CompiledDouble::eval_batch(double *r, const double *x, std::size_t n,
+        double *out) const
+{
+    const std::size_t L = batch_lanes;
+    for (std::size_t start = 0; start < n; start += L) {
+        // The lanes past the last point keep their previous values
+        std::size_t m = std::min(L, n - start);
+        for (std::size_t i = 0; i < nsymbols_; i++)
+            for (std::size_t l = 0; l < m; l++)
+                r[i * L + l] = x[(start + l) * nsymbols_ + i];
+        for (const Instruction &c: code_) {
+            double *d = r + c.dst * L;
+            const double *a = r + c.a * L;
+            const double *b = r + c.b * L;
+            switch (c.op) {
+                case ADD:
+                    for (std::size_t l = 0; l < L; l++) d[l] = a[l] + b[l];
+                    break;
+                case MUL:
+                    for (std::size_t l = 0; l < L; l++) d[l] = a[l] * b[l];
+                    break;
+                case POW:
+                    for (std::size_t l = 0; l < L; l++)
+                        d[l] = ::pow(a[l], b[l]);
+                    break;
+                case POWI:
+                    powi_lanes(d, a, c.b);
+                    break;
+                case SIN:
+                    for (std::size_t l = 0; l < L; l++) d[l] = ::sin(a[l]);
+                    break;
+                case COS:
+                    for (std::size_t l = 0; l < L; l++) d[l] = ::cos(a[l]);
+                    break;
+                case TAN:
+                    for (std::size_t l = 0; l < L; l++) d[l] = ::tan(a[l]);
+                    break;
+                case LOG:
+                    for (std::size_t l = 0; l < L; l++) d[l] = ::log(a[l]);
+                    break;
+            }
+        }
+        for (std::size_t l = 0; l < m; l++) out[start + l] = r[result_ * L + l];
+    }
+}
+
+void CompiledDouble::eval_batch_parallel(const double *x, std::size_t n,
+        double *out, unsigned threads) const
+{
+    const std::size_t C = parallel_chunk;
+    const std::size_t chunks = (n + C - 1) / C;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads > chunks) threads = chunks;
+    if (threads <= 1) {
+        eval_batch(x, n, out);
+        return;
+    }
+    // Each thread takes the next chunk until there are none left, so faster
+    // threads take more chunks. Chunks are multiples of `batch_lanes`: every
+    // point is computed in the same lane as by eval_batch().
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        std::vector<double> r;
+        init_batch_regs(r);
+        for (;;) {
+            std::size_t c = next.fetch_add(1, std::memory_order_relaxed);
+            if (c >= chunks) break;
+            std::size_t start = c * C;
+            eval_batch(r.data(), x + start * nsymbols_,
+                std::min(C, n - start), out + start);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.push_back(std::thread(work));
+    work();
+    for (auto &t: workers) t.join();
+}
+
+CompiledDouble compile_double(const Basic &b, const vec_basic &symbols)
+{
+    CompiledDouble f;
+    DoubleCompiler c(f, symbols);
+    c.compile(b);
+    return f;
+}
+
+void eval_double_batch(const Basic &b, const vec_basic &symbols,
+        const double *inputs, std::size_t n, double *out, unsigned threads)
+{
+    compile_double(b, symbols).eval_batch_parallel(inputs, n, out, threads);
 }
 
 } // CSymPy
@@ -5,11 +5,132 @@
 #ifndef CSYMPY_EVAL_DOUBLE_H
 #define CSYMPY_EVAL_DOUBLE_H
 
+#include <complex>
+
 #include "basic.h"
 
 namespace CSymPy {
 
+//! Evaluates `b`, which must not contain symbols, as a double
 double eval_double(const Basic &b);
+//! Evaluates `b` with the symbols that are keys of `values` replaced by
+//! the values (which must not contain symbols). Same as
+//! `eval_double(*b.subs(values))` for substituted symbols, without
+//! building the substituted expression.
+double eval_double(const Basic &b, const map_basic_basic &values);
+//! Evaluates `b` with `symbols[i]` replaced by `values[i]`
+double eval_double(const Basic &b, const vec_basic &symbols,
+        const std::vector<double> &values);
+
+//! Evaluates `b` as a complex number, on the principal branches of powers
+//! and of `log` (whose branch cut is the negative real axis). Integer
+//! powers are exact products.
+std::complex<double> eval_complex_double(const Basic &b);
+//! See eval_double(const Basic &, const map_basic_basic &)
+std::complex<double> eval_complex_double(const Basic &b,
+        const map_basic_basic &values);
+std::complex<double> eval_complex_double(const Basic &b,
+        const vec_basic &symbols,
+        const std::vector<std::complex<double>> &values);
+
+/*! Evaluates `b` and its gradient by `symbols` at `values` (the value of
+    `symbols[i]` is `values[i]`) by reverse mode differentiation: one pass
+    over the distinct subexpressions of `b` computes their values, one pass
+    back computes the derivatives of `b` by all of them, whatever the number
+    of symbols. Supports the classes supported by compile_double() and Abs.
+
+    \return the value of `b`, `grad[i]` receives the partial derivative of
+    `b` by `symbols[i]`
+*/
+double eval_double_gradient(const Basic &b, const vec_basic &symbols,
+        const std::vector<double> &values, std::vector<double> &grad);
+
+/*! An expression lowered by compile_double() into a flat register program,
+    for evaluating it at many points.
+
+    The registers hold the values of the symbols, then the constants, then
+    one value for each distinct subexpression (equal subexpressions are
+    computed only once). Evaluating is a single loop over a contiguous array
+    of instructions: no tree walk, no virtual call and no allocation.
+
+    eval_batch() evaluates `batch_lanes` points at a time: each instruction
+    is a loop over the lanes, which the compiler turns into SIMD
+    instructions for the target (e.g. AVX2 with `-march=native`). With
+    `-ffast-math` and glibc, GCC also vectorizes the sin, cos, tan, pow and
+    log calls (libmvec). `batch_lanes` is large enough (32) that GCC
+    vectorizes these loops instead of unrolling them completely.
+
+    eval_batch_parallel() splits the points into chunks of `parallel_chunk`
+    points, which the threads take one after the other. Each thread has its
+    own registers, so the results are the same as eval_batch()'s, bit for
+    bit, whatever the number of threads.
+
+    Other evaluations write to the registers of the instance, so an
+    instance must not be evaluated by several threads at once (copy it
+    instead).
+*/
+class CompiledDouble {
+public:
+    enum Opcode {
+        ADD, MUL, POW, POWI, SIN, COS, TAN, LOG
+    };
+    //! `r[dst] = op(r[a], r[b])`, for POWI `b` is the integer exponent
+    struct Instruction {
+        Opcode op;
+        int dst, a, b;
+    };
+
+    //! \return the value at `x`, where `x[i]` is the value of `symbols[i]`
+    //! of compile_double()
+    double operator()(const double *x) const;
+    double operator()(const std::vector<double> &x) const {
+        return (*this)(x.data());
+    }
+    //! Evaluates at `n` points: `out[i]` is the value at `x + i*nsymbols`
+    //! (the points are stored one after the other)
+    void eval_batch(const double *x, std::size_t n, double *out) const;
+    //! Same as eval_batch(), using `threads` threads (0 means the number of
+    //! hardware threads)
+    void eval_batch_parallel(const double *x, std::size_t n, double *out,
+            unsigned threads = 0) const;
+    //! \return the number of instructions
+    std::size_t size() const { return code_.size(); }
+
+    //! Number of points that eval_batch() evaluates at once
+    static const std::size_t batch_lanes = 32;
+    //! Number of points per chunk of eval_batch_parallel(), a multiple of
+    //! `batch_lanes` (the input of a chunk fits in the L1 cache with up to
+    //! 8 symbols)
+    static const std::size_t parallel_chunk = 16 * batch_lanes;
+
+private:
+    std::vector<Instruction> code_;
+    mutable std::vector<double> regs_;
+    // eval_batch() registers: `batch_lanes` values per register, allocated
+    // by the first call
+    mutable std::vector<double> batch_regs_;
+    std::size_t nsymbols_;
+    int result_;
+
+    void init_batch_regs(std::vector<double> &r) const;
+    // eval_batch() with the registers `r`
+    void eval_batch(double *r, const double *x, std::size_t n,
+            double *out) const;
+
+    friend class DoubleCompiler;
+};
+
+//! Compiles `b` as a function of `symbols` (its only free symbols) for
+//! repeated evaluation. Supports the classes supported by eval_double(),
+//! Log and the constants `pi` and `E`.
+CompiledDouble compile_double(const Basic &b, const vec_basic &symbols);
+
+//! Evaluates `b` as a function of `symbols` at `n` points, see
+//! CompiledDouble::eval_batch_parallel(). To evaluate the same expression
+//! repeatedly, compile it once with compile_double() instead.
+void eval_double_batch(const Basic &b, const vec_basic &symbols,
+        const double *inputs, std::size_t n, double *out,
+        unsigned threads = 1);
 
 } // CSymPy
 
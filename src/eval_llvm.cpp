@@ -0,0 +1,400 @@
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+
+#include "basic.h"
+#include "symbol.h"
+#include "add.h"
+#include "integer.h"
+#include "rational.h"
+#include "complex.h"
+#include "mul.h"
+#include "pow.h"
+#include "functions.h"
+#include "constants.h"
+#include "polynomial.h"
+#include "visitor.h"
+#include "eval_llvm.h"
+
+#ifdef HAVE_CSYMPY_LLVM
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/TargetSelect.h>
+
+namespace CSymPy {
+
+namespace {
+
+void check(llvm::Error e)
+{
+    if (e) throw std::runtime_error(llvm::toString(std::move(e)));
+}
+
+template <class T>
+T check(llvm::Expected<T> e)
+{
+    if (!e) throw std::runtime_error(llvm::toString(e.takeError()));
+    return std::move(*e);
+}
+
+// Functions are compiled into one JIT for the whole program (for the host
+// CPU), which resolves the calls to libm in the running process. Never
+// destroyed, as the compiled functions are never freed.
+llvm::orc::LLJIT &jit()
+{
+    static llvm::orc::LLJIT *j = []() {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        std::unique_ptr<llvm::orc::LLJIT> j =
+            check(llvm::orc::LLJITBuilder().create());
+        j->getMainJITDylib().addGenerator(check(
+            llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                j->getDataLayout().getGlobalPrefix())));
+        return j.release();
+    }();
+    return *j;
+}
+
+} // anonymous namespace
+
+// Emits the LLVM IR of expressions. Each distinct subexpression is computed
+// once (found by `hash()` and `__eq__`).
+class LLVMDoubleVisitor : public Visitor {
+private:
+    struct PtrHash {
+        std::size_t operator()(const Basic *b) const { return b->hash(); }
+    };
+    struct PtrEq {
+        bool operator()(const Basic *a, const Basic *b) const {
+            return a == b || a->__eq__(*b);
+        }
+    };
+    // The expressions outlive the visitor, so their nodes can be the keys
+    std::unordered_map<const Basic *, llvm::Value *, PtrHash, PtrEq> values_;
+    // Nodes built while compiling, kept alive for the same reason
+    vec_basic temporaries_;
+    llvm::Module &module_;
+    llvm::IRBuilder<> builder_;
+    llvm::Type *double_;
+    llvm::Value *result_;
+
+    llvm::Value *constant(double value) {
+        return llvm::ConstantFP::get(double_, value);
+    }
+    llvm::Value *intrinsic(llvm::Intrinsic::ID id, llvm::Value *a) {
+        llvm::Function *f =
+            llvm::Intrinsic::getDeclaration(&module_, id, {double_});
+        return builder_.CreateCall(f, {a});
+    }
+    llvm::Value *libm(const char *name, llvm::Value *a) {
+        llvm::FunctionCallee f = module_.getOrInsertFunction(name,
+            llvm::FunctionType::get(double_, {double_}, false));
+        return builder_.CreateCall(f, {a});
+    }
+    // Integer powers by repeated squaring, as compile_double()
+    llvm::Value *power(const Basic &base, const Basic &exp) {
+        if (is_a<Integer>(exp)) {
+            const mpz_class &e = static_cast<const Integer &>(exp).i;
+            if (e.fits_sint_p()) {
+                long n = e.get_si();
+                if (n == 0) return constant(1);
+                llvm::Value *p = apply(base), *r = nullptr;
+                for (long m = (n < 0) ? -n : n; m != 0; m >>= 1) {
+                    if (m & 1) r = (r == nullptr) ? p : builder_.CreateFMul(r, p);
+                    if (m > 1) p = builder_.CreateFMul(p, p);
+                }
+                return (n < 0) ? builder_.CreateFDiv(constant(1), r) : r;
+            }
+        }
+        llvm::Function *f = llvm::Intrinsic::getDeclaration(&module_,
+            llvm::Intrinsic::pow, {double_});
+        return builder_.CreateCall(f, {apply(base), apply(exp)});
+    }
+
+public:
+    LLVMDoubleVisitor(llvm::Module &module, llvm::BasicBlock *block,
+            const vec_basic &symbols, llvm::Value *in)
+        : module_(module), builder_(block),
+          double_(builder_.getDoubleTy()) {
+        for (std::size_t i = 0; i < symbols.size(); i++) {
+            if (!is_a<Symbol>(*symbols[i]))
+                throw std::runtime_error("Only symbols can be arguments.");
+            llvm::Value *p = builder_.CreateConstGEP1_64(double_, in, i);
+            values_[symbols[i].get()] = builder_.CreateLoad(double_, p);
+        }
+    }
+
+    llvm::IRBuilder<> &builder() { return builder_; }
+
+    //! \return the value of `b`
+    llvm::Value *apply(const Basic &b) {
+        auto it = values_.find(&b);
+        if (it != values_.end()) return it->second;
+        b.accept(*this);
+        values_.insert(std::make_pair(&b, result_));
+        return result_;
+    }
+
+    void visit(const Integer &x) {
+        result_ = constant(x.i.get_d());
+    }
+
+    void visit(const Rational &x) {
+        result_ = constant(x.i.get_d());
+    }
+
+    void visit(const Constant &x) {
+        if (x.__eq__(*pi))
+            result_ = constant(::acos(-1.0));
+        else if (x.__eq__(*E))
+            result_ = constant(::exp(1.0));
+        else
+            throw std::runtime_error("Not implemented.");
+    }
+
+    void visit(const Add &x) {
+        llvm::Value *r = nullptr;
+        if (!x.coef_->is_zero()) r = apply(*(x.coef_));
+        for (auto &p: x.dict_) {
+            llvm::Value *t = apply(*(p.first));
+            if (!p.second->is_one())
+                t = builder_.CreateFMul(apply(*(p.second)), t);
+            r = (r == nullptr) ? t : builder_.CreateFAdd(r, t);
+        }
+        result_ = r;
+    }
+
+    void visit(const Mul &x) {
+        llvm::Value *r = nullptr;
+        if (!x.coef_->is_one()) r = apply(*(x.coef_));
+        for (auto &p: x.dict_) {
+            llvm::Value *t = power(*(p.first), *(p.second));
+            r = (r == nullptr) ? t : builder_.CreateFMul(r, t);
+        }
+        result_ = r;
+    }
+
+    void visit(const Pow &x) {
+        result_ = power(*(x.base_), *(x.exp_));
+    }
+
+    void visit(const Sin &x) {
+        result_ = intrinsic(llvm::Intrinsic::sin, apply(*(x.get_arg())));
+    }
+
+    void visit(const Cos &x) {
+        result_ = intrinsic(llvm::Intrinsic::cos, apply(*(x.get_arg())));
+    }
+
+    void visit(const Tan &x) {
+        result_ = libm("tan", apply(*(x.get_arg())));
+    }
+
+    void visit(const Log &x) {
+        result_ = intrinsic(llvm::Intrinsic::log, apply(*(x.get_arg())));
+    }
+
+    void visit(const Abs &x) {
+        result_ = intrinsic(llvm::Intrinsic::fabs, apply(*(x.get_arg())));
+    }
+
+    void visit(const Polynomial &x) {
+        temporaries_.push_back(x.as_basic());
+        result_ = apply(*temporaries_.back());
+    }
+
+    virtual void visit(const Symbol &) {
+        throw std::runtime_error("Symbol not in the list of symbols.");
+    };
+    virtual void visit(const Complex &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Derivative &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Cot &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Csc &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Sec &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ASin &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACos &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ASec &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACsc &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ATan &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACot &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ATan2 &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const LambertW &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const FunctionSymbol &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Sinh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Cosh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Tanh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Coth &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ASinh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACosh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ATanh &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const ACoth &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const KroneckerDelta &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const LeviCivita &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Zeta &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Dirichlet_eta &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Gamma &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const LowerGamma &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const UpperGamma &) {
+        throw std::runtime_error("Not implemented.");
+    };
+    virtual void visit(const Subs &) {
+        throw std::runtime_error("Not implemented.");
+    };
+};
+
+namespace {
+
+// Emits `void name(const double *in, double *out)` computing `exprs` into
+// a new module and adds it to the JIT
+LLVMDouble::Function jit_compile(const vec_basic &exprs,
+        const vec_basic &symbols, const std::string &name)
+{
+    std::unique_ptr<llvm::LLVMContext> context(new llvm::LLVMContext());
+    std::unique_ptr<llvm::Module> module(new llvm::Module(name, *context));
+    module->setDataLayout(jit().getDataLayout());
+
+    llvm::Type *ptr = llvm::Type::getDoublePtrTy(*context);
+    llvm::FunctionType *type = llvm::FunctionType::get(
+        llvm::Type::getVoidTy(*context), {ptr, ptr}, false);
+    llvm::Function *f = llvm::Function::Create(type,
+        llvm::Function::ExternalLinkage, name, module.get());
+    llvm::BasicBlock *block = llvm::BasicBlock::Create(*context, "entry", f);
+    llvm::Value *in = f->getArg(0), *out = f->getArg(1);
+
+    LLVMDoubleVisitor v(*module, block, symbols, in);
+    llvm::IRBuilder<> &b = v.builder();
+    for (std::size_t i = 0; i < exprs.size(); i++) {
+        llvm::Value *value = v.apply(*exprs[i]);
+        b.CreateStore(value, b.CreateConstGEP1_64(b.getDoubleTy(), out, i));
+    }
+    b.CreateRetVoid();
+    CSYMPY_ASSERT(!llvm::verifyFunction(*f))
+
+    check(jit().addIRModule(llvm::orc::ThreadSafeModule(std::move(module),
+        std::move(context))));
+    return reinterpret_cast<LLVMDouble::Function>(
+        check(jit().lookup(name)).getAddress());
+}
+
+struct CompiledEntry {
+    vec_basic exprs;
+    vec_basic symbols;
+    LLVMDouble::Function f;
+};
+
+// Compiled functions by the hash of their expressions and symbols
+struct CompiledCache {
+    std::mutex mutex;
+    std::unordered_multimap<std::size_t, CompiledEntry> entries;
+    // Number of functions compiled, for their names
+    std::size_t count = 0;
+};
+
+CompiledCache &cache()
+{
+    static CompiledCache *c = new CompiledCache();
+    return *c;
+}
+
+} // anonymous namespace
+
+LLVMDouble compile_llvm_double(const vec_basic &exprs,
+        const vec_basic &symbols)
+{
+    std::size_t h = exprs.size();
+    for (auto &e: exprs) hash_combine<Basic>(h, *e);
+    for (auto &s: symbols) hash_combine<Basic>(h, *s);
+
+    CompiledCache &c = cache();
+    std::lock_guard<std::mutex> lock(c.mutex);
+    auto range = c.entries.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (vec_basic_eq(it->second.exprs, exprs) &&
+                vec_basic_eq(it->second.symbols, symbols))
+            return LLVMDouble(it->second.f);
+    }
+    std::string name = "csympy_" + std::to_string(c.count++);
+    LLVMDouble::Function f = jit_compile(exprs, symbols, name);
+    c.entries.insert(std::make_pair(h, CompiledEntry{exprs, symbols, f}));
+    return LLVMDouble(f);
+}
+
+LLVMDouble compile_llvm_double(const Basic &b, const vec_basic &symbols)
+{
+    return compile_llvm_double(vec_basic{rcp(&b)}, symbols);
+}
+
+LLVMDouble compile_llvm_double(const DenseMatrix &m, const vec_basic &symbols)
+{
+    vec_basic exprs;
+    for (unsigned i = 0; i < m.nrows(); i++)
+        for (unsigned j = 0; j < m.ncols(); j++)
+            exprs.push_back(m.get(i, j));
+    return compile_llvm_double(exprs, symbols);
+}
+
+} // CSymPy
+
+#endif // HAVE_CSYMPY_LLVM
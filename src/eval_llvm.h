@@ -0,0 +1,66 @@
+/**
+ *  \file eval_llvm.h
+ *  Evaluation of expressions compiled to native code by LLVM
+ *
+ **/
+
+#ifndef CSYMPY_EVAL_LLVM_H
+#define CSYMPY_EVAL_LLVM_H
+
+#include "basic.h"
+
+#ifdef HAVE_CSYMPY_LLVM
+
+#include "matrix.h"
+
+namespace CSymPy {
+
+/*! An expression, or the entries of a matrix of expressions, compiled by
+    LLVM into a native function `f(in, out)`: `in[i]` is the value of
+    `symbols[i]` of compile_llvm_double(), `out` receives the values of the
+    expressions (the entries of a matrix in row-major order).
+
+    Equal subexpressions are computed once, integer powers by
+    multiplications. The function has no state: an instance can be called
+    by several threads at once, and copying it is cheap.
+*/
+class LLVMDouble {
+public:
+    typedef void (*Function)(const double *in, double *out);
+
+    void operator()(const double *in, double *out) const { f_(in, out); }
+    //! \return the value of the first (or only) expression at `x`
+    double operator()(const std::vector<double> &x) const {
+        double r;
+        f_(x.data(), &r);
+        return r;
+    }
+    //! \return the native function, valid until the program exits
+    Function get_function() const { return f_; }
+
+private:
+    Function f_;
+
+    LLVMDouble(Function f) : f_(f) {}
+
+    friend LLVMDouble compile_llvm_double(const vec_basic &exprs,
+            const vec_basic &symbols);
+};
+
+//! Compiles `exprs` (functions of `symbols`, which must be all of their
+//! free symbols) into one native function computing all of them. Supports
+//! the classes supported by compile_double() and Abs.
+//!
+//! Compiled functions are cached (by the hashes of `exprs` and `symbols`)
+//! and never freed: compiling equal expressions again returns the same
+//! function.
+LLVMDouble compile_llvm_double(const vec_basic &exprs,
+        const vec_basic &symbols);
+LLVMDouble compile_llvm_double(const Basic &b, const vec_basic &symbols);
+LLVMDouble compile_llvm_double(const DenseMatrix &m, const vec_basic &symbols);
+
+} // CSymPy
+
+#endif // HAVE_CSYMPY_LLVM
+
+#endif
@@ -0,0 +1,376 @@
+/**
+ *  \file flat_hash_map.h
+ *  Open addressing hash map
+ *
+ **/
+#ifndef CSYMPY_FLAT_HASH_MAP_H
+#define CSYMPY_FLAT_HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace CSymPy {
+
+/*! Hash map with open addressing (Robin Hood hashing, linear probing and
+    backward shift deletion), a drop-in replacement for the subset of
+    `std::unordered_map` used by CSymPy.
+
+    All entries live in one array of slots. Each slot stores the full hash of
+    its key next to the entry, so probing compares hashes without touching the
+    key (for `RCP<const Basic>` keys that saves following the pointer to the
+    node), and growing the table never calls the hash function again. Inserting
+    allocates only when the table grows, and the whole table is freed at once.
+
+    Unlike `std::unordered_map`, inserting or erasing may move other entries,
+    so it invalidates all iterators, pointers and references into the map.
+    (`erase(iterator)` returns a valid iterator to continue the iteration.)
+
+    When CSymPy is configured with WITH_CSYMPY_FLAT_HASH_MAP, `umap_basic_num`,
+    `umap_basic_basic` and `umap_vec_mpz` are FlatHashMaps.
+*/
+template <class Key, class T, class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<const Key, T> value_type;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Hash hasher;
+    typedef KeyEqual key_equal;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+
+private:
+    struct Slot {
+        //! Hash of the key, 0 for an empty slot
+        std::size_t hash;
+        typename std::aligned_storage<sizeof(value_type),
+                 alignof(value_type)>::type storage;
+        value_type &value() {
+            return *reinterpret_cast<value_type *>(&storage);
+        }
+        const value_type &value() const {
+            return *reinterpret_cast<const value_type *>(&storage);
+        }
+    };
+
+    template <class S, class V>
+    class Iterator {
+        friend class FlatHashMap;
+        S *p_, *end_;
+        Iterator(S *p, S *end) : p_{p}, end_{end} { skip(); }
+        void skip() { while (p_ != end_ && p_->hash == 0) ++p_; }
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename FlatHashMap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef V* pointer;
+        typedef V& reference;
+
+        Iterator() : p_{nullptr}, end_{nullptr} {}
+        //! Conversion from iterator to const_iterator
+        template <class S2, class V2>
+        Iterator(const Iterator<S2, V2> &o) : p_{o.p_}, end_{o.end_} {}
+        V &operator*() const { return p_->value(); }
+        V *operator->() const { return &p_->value(); }
+        Iterator &operator++() { ++p_; skip(); return *this; }
+        Iterator operator++(int) { Iterator t = *this; ++*this; return t; }
+        template <class S2, class V2>
+        bool operator==(const Iterator<S2, V2> &o) const { return p_ == o.p_; }
+        template <class S2, class V2>
+        bool operator!=(const Iterator<S2, V2> &o) const { return p_ != o.p_; }
+        template <class S2, class V2> friend class Iterator;
+    };
+
+public:
+    typedef Iterator<Slot, value_type> iterator;
+    typedef Iterator<const Slot, const value_type> const_iterator;
+
+private:
+    Slot *slots_;
+    //! Number of slots, 0 or a power of two
+    size_type capacity_;
+    size_type size_;
+    //! 64 - log2(capacity_)
+    unsigned shift_;
+    Hash hash_function_;
+    KeyEqual key_eq_;
+
+    // At most 7/8 of the slots are used
+    static size_type max_size_for(size_type capacity) {
+        return capacity - capacity / 8;
+    }
+
+    std::size_t hash_of(const Key &k) const {
+        std::size_t h = hash_function_(k);
+        // 0 marks empty slots
+        return h == 0 ? 1 : h;
+    }
+    // The preferred slot of a hash. The hashes of CSymPy keys are often
+    // regular (e.g. `vec_int_hash`), so they are mixed first.
+    size_type home(std::size_t h) const {
+        return (size_type)(((std::uint64_t)h * 0x9E3779B97F4A7C15ULL)
+            >> shift_);
+    }
+    size_type distance(size_type pos, std::size_t h) const {
+        return (pos - home(h)) & (capacity_ - 1);
+    }
+    size_type next(size_type pos) const {
+        return (pos + 1) & (capacity_ - 1);
+    }
+
+    // Returns the position of `k`, or capacity_ if it is not in the map
+    size_type find_pos(const Key &k) const {
+        if (size_ == 0) return capacity_;
+        std::size_t h = hash_of(k);
+        size_type pos = home(h);
+        for (size_type d = 0; ; d++) {
+            const Slot &s = slots_[pos];
+            // Robin Hood invariant: `k` would have displaced a richer entry
+            if (s.hash == 0 || distance(pos, s.hash) < d) return capacity_;
+            if (s.hash == h && key_eq_(s.value().first, k)) return pos;
+            pos = next(pos);
+        }
+    }
+
+    // Moves the (not yet present) entry `v` with hash `h` into the table,
+    // which must have room for it. Returns its position.
+    size_type insert_new(std::size_t h, value_type &&v) {
+        size_type pos = home(h), result = capacity_;
+        size_type d = 0;
+        // The entry being placed, initially `v`, then the displaced ones
+        Slot carry;
+        carry.hash = h;
+        ::new(&carry.storage) value_type(std::move(v));
+        for (;;) {
+            Slot &s = slots_[pos];
+            if (s.hash == 0) {
+                s.hash = carry.hash;
+                ::new(&s.storage) value_type(std::move(carry.value()));
+                carry.value().~value_type();
+                size_++;
+                return result == capacity_ ? pos : result;
+            }
+            size_type ds = distance(pos, s.hash);
+            if (ds < d) {
+                // Swap the richer entry out, continue placing it instead
+                value_type t(std::move(s.value()));
+                s.value().~value_type();
+                ::new(&s.storage) value_type(std::move(carry.value()));
+                carry.value().~value_type();
+                ::new(&carry.storage) value_type(std::move(t));
+                std::swap(s.hash, carry.hash);
+                if (result == capacity_) result = pos;
+                d = ds;
+            }
+            pos = next(pos);
+            d++;
+        }
+    }
+
+    void rehash_to(size_type capacity) {
+        Slot *old = slots_;
+        size_type old_capacity = capacity_;
+        slots_ = static_cast<Slot *>(::operator new(capacity * sizeof(Slot)));
+        for (size_type i = 0; i < capacity; i++) slots_[i].hash = 0;
+        capacity_ = capacity;
+        shift_ = 64;
+        for (size_type c = capacity; c > 1; c >>= 1) shift_--;
+        size_ = 0;
+        for (size_type i = 0; i < old_capacity; i++) {
+            if (old[i].hash != 0) {
+                insert_new(old[i].hash, std::move(old[i].value()));
+                old[i].value().~value_type();
+            }
+        }
+        ::operator delete(old);
+    }
+
+    void grow_for(size_type n) {
+        if (n <= max_size_for(capacity_)) return;
+        size_type capacity = capacity_ == 0 ? 8 : capacity_;
+        while (n > max_size_for(capacity)) capacity *= 2;
+        rehash_to(capacity);
+    }
+
+    void destroy() {
+        for (size_type i = 0; i < capacity_; i++)
+            if (slots_[i].hash != 0) slots_[i].value().~value_type();
+        ::operator delete(slots_);
+        slots_ = nullptr;
+        capacity_ = size_ = 0;
+        shift_ = 64;
+    }
+
+    void erase_pos(size_type pos) {
+        slots_[pos].value().~value_type();
+        slots_[pos].hash = 0;
+        size_--;
+        // Backward shift: move the following displaced entries one back
+        size_type n = next(pos);
+        while (slots_[n].hash != 0 && distance(n, slots_[n].hash) > 0) {
+            slots_[pos].hash = slots_[n].hash;
+            ::new(&slots_[pos].storage) value_type(std::move(slots_[n].value()));
+            slots_[n].value().~value_type();
+            slots_[n].hash = 0;
+            pos = n;
+            n = next(n);
+        }
+    }
+
+public:
+    FlatHashMap() : slots_{nullptr}, capacity_{0}, size_{0}, shift_{64} {}
+    FlatHashMap(std::initializer_list<value_type> l) : FlatHashMap() {
+        reserve(l.size());
+        for (auto &v: l) insert(v);
+    }
+    FlatHashMap(const FlatHashMap &o) : FlatHashMap() {
+        *this = o;
+    }
+    FlatHashMap(FlatHashMap &&o) noexcept : FlatHashMap() {
+        swap(o);
+    }
+    ~FlatHashMap() { destroy(); }
+
+    FlatHashMap &operator=(const FlatHashMap &o) {
+        if (this == &o) return *this;
+        destroy();
+        if (o.size_ == 0) return *this;
+        // Same capacity and hash function: every entry goes to its old slot
+        slots_ = static_cast<Slot *>(::operator new(o.capacity_ * sizeof(Slot)));
+        capacity_ = o.capacity_;
+        shift_ = o.shift_;
+        for (size_type i = 0; i < capacity_; i++) {
+            slots_[i].hash = 0;
+            if (o.slots_[i].hash != 0) {
+                ::new(&slots_[i].storage) value_type(o.slots_[i].value());
+                slots_[i].hash = o.slots_[i].hash;
+                size_++;
+            }
+        }
+        return *this;
+    }
+    FlatHashMap &operator=(FlatHashMap &&o) noexcept {
+        swap(o);
+        return *this;
+    }
+    void swap(FlatHashMap &o) noexcept {
+        std::swap(slots_, o.slots_);
+        std::swap(capacity_, o.capacity_);
+        std::swap(size_, o.size_);
+        std::swap(shift_, o.shift_);
+        std::swap(hash_function_, o.hash_function_);
+        std::swap(key_eq_, o.key_eq_);
+    }
+
+    iterator begin() { return iterator(slots_, slots_ + capacity_); }
+    iterator end() {
+        return iterator(slots_ + capacity_, slots_ + capacity_);
+    }
+    const_iterator begin() const {
+        return const_iterator(slots_, slots_ + capacity_);
+    }
+    const_iterator end() const {
+        return const_iterator(slots_ + capacity_, slots_ + capacity_);
+    }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    size_type size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_type bucket_count() const { return capacity_; }
+    float load_factor() const {
+        return capacity_ == 0 ? 0 : (float)size_ / capacity_;
+    }
+    //! Makes room for `n` entries without any further allocation
+    void reserve(size_type n) { grow_for(n); }
+    void clear() {
+        for (size_type i = 0; i < capacity_; i++) {
+            if (slots_[i].hash != 0) {
+                slots_[i].value().~value_type();
+                slots_[i].hash = 0;
+            }
+        }
+        size_ = 0;
+    }
+
+    iterator find(const Key &k) {
+        return iterator(slots_ + find_pos(k), slots_ + capacity_);
+    }
+    const_iterator find(const Key &k) const {
+        return const_iterator(slots_ + find_pos(k), slots_ + capacity_);
+    }
+    size_type count(const Key &k) const {
+        return find_pos(k) == capacity_ ? 0 : 1;
+    }
+    T &at(const Key &k) {
+        size_type pos = find_pos(k);
+        if (pos == capacity_) throw std::out_of_range("FlatHashMap::at");
+        return slots_[pos].value().second;
+    }
+    const T &at(const Key &k) const {
+        size_type pos = find_pos(k);
+        if (pos == capacity_) throw std::out_of_range("FlatHashMap::at");
+        return slots_[pos].value().second;
+    }
+
+    std::pair<iterator, bool> insert(value_type &&v) {
+        size_type pos = find_pos(v.first);
+        if (pos != capacity_)
+            return std::make_pair(iterator(slots_ + pos, slots_ + capacity_),
+                false);
+        std::size_t h = hash_of(v.first);
+        grow_for(size_ + 1);
+        pos = insert_new(h, std::move(v));
+        return std::make_pair(iterator(slots_ + pos, slots_ + capacity_), true);
+    }
+    std::pair<iterator, bool> insert(const value_type &v) {
+        size_type pos = find_pos(v.first);
+        if (pos != capacity_)
+            return std::make_pair(iterator(slots_ + pos, slots_ + capacity_),
+                false);
+        std::size_t h = hash_of(v.first);
+        grow_for(size_ + 1);
+        pos = insert_new(h, value_type(v));
+        return std::make_pair(iterator(slots_ + pos, slots_ + capacity_), true);
+    }
+    template <class P>
+    std::pair<iterator, bool> insert(P &&v) {
+        return insert(value_type(std::forward<P>(v)));
+    }
+    T &operator[](const Key &k) {
+        size_type pos = find_pos(k);
+        if (pos != capacity_) return slots_[pos].value().second;
+        std::size_t h = hash_of(k);
+        grow_for(size_ + 1);
+        pos = insert_new(h, value_type(k, T()));
+        return slots_[pos].value().second;
+    }
+
+    size_type erase(const Key &k) {
+        size_type pos = find_pos(k);
+        if (pos == capacity_) return 0;
+        erase_pos(pos);
+        return 1;
+    }
+    //! Erases the entry at `it`, returns the iterator to continue from
+    iterator erase(const_iterator it) {
+        size_type pos = it.p_ - slots_;
+        erase_pos(pos);
+        // Either an entry was shifted into `pos`, or we skip to the next one
+        return iterator(slots_ + pos, slots_ + capacity_);
+    }
+};
+
+} // CSymPy
+
+#endif
@@ -0,0 +1,282 @@
+/**
+ *  \file flat_map.h
+ *  Sorted vector map with inline storage
+ *
+ **/
+#ifndef CSYMPY_FLAT_MAP_H
+#define CSYMPY_FLAT_MAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace CSymPy {
+
+/*! Ordered map stored as a sorted array, a drop-in replacement for the
+    subset of `std::map` used by CSymPy.
+
+    Up to `N` entries are stored inline (in the map object itself), larger
+    maps use one heap allocated array. Iteration is in the order given by
+    `Compare`, like for `std::map`, but copying a map is a single pass over a
+    contiguous array (for `RCP` entries one reference count increment per
+    key and value) instead of allocating a tree node per entry, and lookups
+    are binary searches in one cache friendly array. Inserting and erasing
+    shift the following entries, which is cheap for the small dictionaries of
+    a Mul.
+
+    Like for `boost::container::flat_map` the `value_type` is
+    `std::pair<Key, T>` (the key is not `const`, so that entries can be
+    moved), the keys must not be modified through iterators. Inserting or
+    erasing invalidates all iterators, pointers and references into the map.
+
+    When CSymPy is configured with WITH_CSYMPY_FLAT_MAP, `map_basic_basic`
+    (e.g. the dictionary of Mul) is a FlatMap.
+*/
+template <class Key, class T, class Compare = std::less<Key>,
+         std::size_t N = 4>
+class FlatMap {
+public:
+    typedef Key key_type;
+    typedef T mapped_type;
+    typedef std::pair<Key, T> value_type;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Compare key_compare;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef value_type* iterator;
+    typedef const value_type* const_iterator;
+
+private:
+    value_type *data_;
+    size_type size_;
+    size_type capacity_;
+    typename std::aligned_storage<sizeof(value_type) * N,
+             alignof(value_type)>::type inline_;
+    Compare comp_;
+
+    value_type *inline_data() {
+        return reinterpret_cast<value_type *>(&inline_);
+    }
+    bool is_inline() const {
+        return data_ == reinterpret_cast<const value_type *>(&inline_);
+    }
+
+    // Makes room for `n` entries
+    void grow_for(size_type n) {
+        if (n <= capacity_) return;
+        size_type capacity = std::max(n, 2 * capacity_);
+        value_type *data = static_cast<value_type *>(
+            ::operator new(capacity * sizeof(value_type)));
+        for (size_type i = 0; i < size_; i++) {
+            ::new(data + i) value_type(std::move(data_[i]));
+            data_[i].~value_type();
+        }
+        if (!is_inline()) ::operator delete(data_);
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    void destroy() {
+        for (size_type i = 0; i < size_; i++) data_[i].~value_type();
+        if (!is_inline()) ::operator delete(data_);
+        data_ = inline_data();
+        size_ = 0;
+        capacity_ = N;
+    }
+
+    // Inserts `v` before position `pos` (which must be the sorted position)
+    template <class V>
+    iterator insert_at(size_type pos, V &&v) {
+        if (size_ == capacity_) {
+            // Build the new array around the new entry
+            size_type capacity = 2 * capacity_;
+            value_type *data = static_cast<value_type *>(
+                ::operator new(capacity * sizeof(value_type)));
+            ::new(data + pos) value_type(std::forward<V>(v));
+            for (size_type i = 0; i < size_; i++) {
+                ::new(data + (i < pos ? i : i + 1))
+                    value_type(std::move(data_[i]));
+                data_[i].~value_type();
+            }
+            if (!is_inline()) ::operator delete(data_);
+            data_ = data;
+            capacity_ = capacity;
+        } else if (pos == size_) {
+            ::new(data_ + size_) value_type(std::forward<V>(v));
+        } else {
+            value_type t(std::forward<V>(v));
+            ::new(data_ + size_) value_type(std::move(data_[size_ - 1]));
+            for (size_type i = size_ - 1; i > pos; i--)
+                data_[i] = std::move(data_[i - 1]);
+            data_[pos] = std::move(t);
+        }
+        size_++;
+        return data_ + pos;
+    }
+
+    size_type lower_bound_pos(const Key &k) const {
+        size_type lo = 0, hi = size_;
+        while (lo < hi) {
+            size_type mid = (lo + hi) / 2;
+            if (comp_(data_[mid].first, k))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+    // Returns the position of `k`, or size_ if it is not in the map
+    size_type find_pos(const Key &k) const {
+        size_type pos = lower_bound_pos(k);
+        if (pos == size_ || comp_(k, data_[pos].first)) return size_;
+        return pos;
+    }
+
+public:
+    FlatMap() : data_{inline_data()}, size_{0}, capacity_{N} {}
+    FlatMap(std::initializer_list<value_type> l) : FlatMap() {
+        for (auto &v: l) insert(v);
+    }
+    template <class InputIt>
+    FlatMap(InputIt first, InputIt last) : FlatMap() {
+        insert(first, last);
+    }
+    FlatMap(const FlatMap &o) : FlatMap() {
+        grow_for(o.size_);
+        for (size_type i = 0; i < o.size_; i++)
+            ::new(data_ + i) value_type(o.data_[i]);
+        size_ = o.size_;
+    }
+    FlatMap(FlatMap &&o) noexcept : FlatMap() {
+        *this = std::move(o);
+    }
+    ~FlatMap() { destroy(); }
+
+    FlatMap &operator=(const FlatMap &o) {
+        if (this == &o) return *this;
+        FlatMap t(o);
+        *this = std::move(t);
+        return *this;
+    }
+    FlatMap &operator=(FlatMap &&o) noexcept {
+        if (this == &o) return *this;
+        destroy();
+        if (o.is_inline()) {
+            for (size_type i = 0; i < o.size_; i++) {
+                ::new(data_ + i) value_type(std::move(o.data_[i]));
+                o.data_[i].~value_type();
+            }
+            size_ = o.size_;
+        } else {
+            data_ = o.data_;
+            size_ = o.size_;
+            capacity_ = o.capacity_;
+            o.data_ = o.inline_data();
+            o.capacity_ = N;
+        }
+        o.size_ = 0;
+        return *this;
+    }
+    void swap(FlatMap &o) {
+        FlatMap t(std::move(o));
+        o = std::move(*this);
+        *this = std::move(t);
+    }
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+    const_iterator cbegin() const { return data_; }
+    const_iterator cend() const { return data_ + size_; }
+
+    size_type size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void reserve(size_type n) { grow_for(n); }
+    void clear() {
+        for (size_type i = 0; i < size_; i++) data_[i].~value_type();
+        size_ = 0;
+    }
+
+    iterator find(const Key &k) { return data_ + find_pos(k); }
+    const_iterator find(const Key &k) const { return data_ + find_pos(k); }
+    size_type count(const Key &k) const {
+        return find_pos(k) == size_ ? 0 : 1;
+    }
+    iterator lower_bound(const Key &k) { return data_ + lower_bound_pos(k); }
+    const_iterator lower_bound(const Key &k) const {
+        return data_ + lower_bound_pos(k);
+    }
+    T &at(const Key &k) {
+        size_type pos = find_pos(k);
+        if (pos == size_) throw std::out_of_range("FlatMap::at");
+        return data_[pos].second;
+    }
+    const T &at(const Key &k) const {
+        size_type pos = find_pos(k);
+        if (pos == size_) throw std::out_of_range("FlatMap::at");
+        return data_[pos].second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type &v) {
+        size_type pos = lower_bound_pos(v.first);
+        if (pos != size_ && !comp_(v.first, data_[pos].first))
+            return std::make_pair(data_ + pos, false);
+        return std::make_pair(insert_at(pos, v), true);
+    }
+    std::pair<iterator, bool> insert(value_type &&v) {
+        size_type pos = lower_bound_pos(v.first);
+        if (pos != size_ && !comp_(v.first, data_[pos].first))
+            return std::make_pair(data_ + pos, false);
+        return std::make_pair(insert_at(pos, std::move(v)), true);
+    }
+    template <class P>
+    std::pair<iterator, bool> insert(P &&v) {
+        return insert(value_type(std::forward<P>(v)));
+    }
+    //! Inserts `v` before `hint` if that is its sorted position (e.g.
+    //! `end()` when the entries come in order), otherwise like insert(v)
+    iterator insert(const_iterator hint, const value_type &v) {
+        size_type pos = hint - data_;
+        if ((pos == 0 || comp_(data_[pos - 1].first, v.first)) &&
+                (pos == size_ || comp_(v.first, data_[pos].first)))
+            return insert_at(pos, v);
+        return insert(v).first;
+    }
+    template <class InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) insert(end(), *first);
+    }
+    T &operator[](const Key &k) {
+        size_type pos = lower_bound_pos(k);
+        if (pos != size_ && !comp_(k, data_[pos].first))
+            return data_[pos].second;
+        return insert_at(pos, value_type(k, T()))->second;
+    }
+
+    //! Erases the entry at `it`, returns the iterator to the next entry
+    iterator erase(const_iterator it) {
+        size_type pos = it - data_;
+        for (size_type i = pos; i + 1 < size_; i++)
+            data_[i] = std::move(data_[i + 1]);
+        data_[size_ - 1].~value_type();
+        size_--;
+        return data_ + pos;
+    }
+    size_type erase(const Key &k) {
+        size_type pos = find_pos(k);
+        if (pos == size_) return 0;
+        erase(data_ + pos);
+        return 1;
+    }
+};
+
+} // CSymPy
+
+#endif
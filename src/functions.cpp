@@ -277,7 +277,8 @@ RCP<const Basic> TrigFunction::subs(const map_basic_basic &subs_dict) const
     auto it = subs_dict.find(rcp(this));
     if (it != subs_dict.end())
         return it->second;
-    RCP<const Basic> arg = arg_->subs(subs_dict);
+    SubsMemo memo(subs_dict);
+    RCP<const Basic> arg = memo.subs(arg_);
     if (arg == arg_)
         return rcp(this);
     else
@@ -1217,70 +1218,70 @@ RCP<const Basic> atan2(const RCP<const Basic> &num, const RCP<const Basic> &den)
 
 RCP<const Basic> Sin::diff(const RCP<const Symbol> &x) const
 {
-    return mul(cos(get_arg()), get_arg()->diff(x));
+    return mul(cos(get_arg()), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> Cos::diff(const RCP<const Symbol> &x) const
 {
-    return mul(mul(minus_one, sin(get_arg())), get_arg()->diff(x));
+    return mul(mul(minus_one, sin(get_arg())), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> Tan::diff(const RCP<const Symbol> &x) const
 {
     RCP<const Integer> two = rcp(new Integer(2));
-    return mul(add(one, pow(tan(get_arg()), two)), get_arg()->diff(x));
+    return mul(add(one, pow(tan(get_arg()), two)), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> Cot::diff(const RCP<const Symbol> &x) const
 {
     RCP<const Integer> two = rcp(new Integer(2));
-    return mul(mul(add(one, pow(cot(get_arg()), two)), minus_one), get_arg()->diff(x));
+    return mul(mul(add(one, pow(cot(get_arg()), two)), minus_one), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> Csc::diff(const RCP<const Symbol> &x) const
 {
-    return mul(mul(mul(cot(get_arg()), csc(get_arg())), minus_one), get_arg()->diff(x));
+    return mul(mul(mul(cot(get_arg()), csc(get_arg())), minus_one), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> Sec::diff(const RCP<const Symbol> &x) const
 {
-    return mul(mul(tan(get_arg()), sec(get_arg())), get_arg()->diff(x));
+    return mul(mul(tan(get_arg()), sec(get_arg())), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> ASin::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(one, sqrt(sub(one, pow(get_arg(), i2)))), get_arg()->diff(x));
+    return mul(div(one, sqrt(sub(one, pow(get_arg(), i2)))), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> ACos::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(minus_one, sqrt(sub(one, pow(get_arg(), i2)))), get_arg()->diff(x));
+    return mul(div(minus_one, sqrt(sub(one, pow(get_arg(), i2)))), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> ASec::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(one, mul(pow(get_arg(), i2), sqrt(sub(one, div(one, pow(get_arg(), i2)))))), get_arg()->diff(x));
+    return mul(div(one, mul(pow(get_arg(), i2), sqrt(sub(one, div(one, pow(get_arg(), i2)))))), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> ACsc::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(minus_one, mul(pow(get_arg(), i2), sqrt(sub(one, div(one, pow(get_arg(), i2)))))), get_arg()->diff(x));
+    return mul(div(minus_one, mul(pow(get_arg(), i2), sqrt(sub(one, div(one, pow(get_arg(), i2)))))), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> ATan::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(one, add(one, pow(get_arg(), i2))), get_arg()->diff(x));
+    return mul(div(one, add(one, pow(get_arg(), i2))), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> ACot::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(minus_one, add(one, pow(get_arg(), i2))), get_arg()->diff(x));
+    return mul(div(minus_one, add(one, pow(get_arg(), i2))), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> ATan2::diff(const RCP<const Symbol> &x) const
 {
     return mul(div(pow(den_, i2), add(pow(den_, i2), pow(num_, i2))),
-                div(num_, den_)->diff(x));
+                diff_arg(div(num_, den_), x));
 }
 
 RCP<const Basic> Sin::create(const RCP<const Basic> &arg) const
@@ -1393,7 +1394,7 @@ RCP<const Basic> LambertW::diff(const RCP<const Symbol> &x) const
     // check http://en.wikipedia.org/wiki/Lambert_W_function#Derivative
     // for the equation
     RCP<const Basic> lambertw_val = lambertw(arg_);
-    return mul(div(lambertw_val, mul(arg_, add(lambertw_val, one))), arg_->diff(x));
+    return mul(div(lambertw_val, mul(arg_, add(lambertw_val, one))), diff_arg(arg_, x));
 }
 
 RCP<const Basic> lambertw(const RCP<const Basic> &arg)
@@ -1468,11 +1469,12 @@ RCP<const Basic> FunctionSymbol::diff(const RCP<const Symbol> &x) const
     std::string name;
     unsigned count  = 0;
     bool found_x = false;
+    DiffMemo memo;
     for (auto &a : arg_) {
         if (eq(a, x)) {
             found_x = true;
             count++;
-        } else if (count < 2 && neq(a->diff(x), zero)) {
+        } else if (count < 2 && neq(memo.diff(a, x), zero)) {
             count++;
         }
     }
@@ -1480,7 +1482,7 @@ RCP<const Basic> FunctionSymbol::diff(const RCP<const Symbol> &x) const
         return rcp(new Derivative(self, {x}));
     }
     for (unsigned i = 0; i < arg_.size(); i++) {
-        t = arg_[i]->diff(x);
+        t = memo.diff(arg_[i], x);
         if (neq(t, zero)) {
             name = "x";
             do {
@@ -1502,10 +1504,14 @@ RCP<const Basic> FunctionSymbol::subs(const map_basic_basic &subs_dict) const
     auto it = subs_dict.find(rcp(this));
     if (it != subs_dict.end())
         return it->second;
+    SubsMemo memo(subs_dict);
     vec_basic v = arg_;
+    bool changed = false;
     for (unsigned i = 0; i < v.size(); i++) {
-        v[i] = v[i]->subs(subs_dict);
+        v[i] = memo.subs(v[i]);
+        if (v[i] != arg_[i]) changed = true;
     }
+    if (!changed) return rcp(this);
     return rcp(new FunctionSymbol(name_, v));
 }
 
@@ -1850,7 +1856,8 @@ RCP<const Basic> HyperbolicFunction::subs(const map_basic_basic &subs_dict) cons
     auto it = subs_dict.find(rcp(this));
     if (it != subs_dict.end())
         return it->second;
-    RCP<const Basic> arg = arg_->subs(subs_dict);
+    SubsMemo memo(subs_dict);
+    RCP<const Basic> arg = memo.subs(arg_);
     if (arg == arg_)
         return rcp(this);
     else
@@ -1921,7 +1928,7 @@ RCP<const Basic>  Sinh::expand_as_exp() const
 
 RCP<const Basic> Sinh::diff(const RCP<const Symbol> &x) const
 {
-    return mul(cosh(get_arg()), get_arg()->diff(x));
+    return mul(cosh(get_arg()), diff_arg(get_arg(), x));
 }
 
 Cosh::Cosh(const RCP<const Basic> &arg)
@@ -1987,7 +1994,7 @@ RCP<const Basic>  Cosh::expand_as_exp() const
 
 RCP<const Basic> Cosh::diff(const RCP<const Symbol> &x) const
 {
-    return mul(sinh(get_arg()), get_arg()->diff(x));
+    return mul(sinh(get_arg()), diff_arg(get_arg(), x));
 }
 
 Tanh::Tanh(const RCP<const Basic> &arg)
@@ -2056,7 +2063,7 @@ RCP<const Basic>  Tanh::expand_as_exp() const
 
 RCP<const Basic> Tanh::diff(const RCP<const Symbol> &x) const
 {
-    return mul(sub(one, pow(tanh(get_arg()), i2)), get_arg()->diff(x));
+    return mul(sub(one, pow(tanh(get_arg()), i2)), diff_arg(get_arg(), x));
 }
 
 Coth::Coth(const RCP<const Basic> &arg)
@@ -2128,7 +2135,7 @@ RCP<const Basic>  Coth::expand_as_exp() const
 
 RCP<const Basic> Coth::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(minus_one, pow(sinh(get_arg()), i2)), get_arg()->diff(x));
+    return mul(div(minus_one, pow(sinh(get_arg()), i2)), diff_arg(get_arg(), x));
 }
 
 ASinh::ASinh(const RCP<const Basic> &arg)
@@ -2192,7 +2199,7 @@ RCP<const Basic> asinh(const RCP<const Basic> &arg)
 
 RCP<const Basic> ASinh::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(one, sqrt(add(pow(x, i2), one))), get_arg()->diff(x));
+    return mul(div(one, sqrt(add(pow(x, i2), one))), diff_arg(get_arg(), x));
 }
 
 ACosh::ACosh(const RCP<const Basic> &arg)
@@ -2243,7 +2250,7 @@ RCP<const Basic> acosh(const RCP<const Basic> &arg)
 
 RCP<const Basic> ACosh::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(one, sqrt(sub(pow(x, i2), one))), get_arg()->diff(x));
+    return mul(div(one, sqrt(sub(pow(x, i2), one))), diff_arg(get_arg(), x));
 }
 
 ATanh::ATanh(const RCP<const Basic> &arg)
@@ -2305,7 +2312,7 @@ RCP<const Basic> atanh(const RCP<const Basic> &arg)
 
 RCP<const Basic> ATanh::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(one, sub(one, pow(x, i2))), get_arg()->diff(x));
+    return mul(div(one, sub(one, pow(x, i2))), diff_arg(get_arg(), x));
 }
 
 ACoth::ACoth(const RCP<const Basic> &arg)
@@ -2364,7 +2371,7 @@ RCP<const Basic> acoth(const RCP<const Basic> &arg)
 
 RCP<const Basic> ACoth::diff(const RCP<const Symbol> &x) const
 {
-    return mul(div(one, sub(one, pow(x, i2))), get_arg()->diff(x));
+    return mul(div(one, sub(one, pow(x, i2))), diff_arg(get_arg(), x));
 }
 
 RCP<const Basic> Sinh::create(const RCP<const Basic> &arg) const
@@ -2642,7 +2649,7 @@ std::string Zeta::__str__() const
 RCP<const Basic> Zeta::diff(const RCP<const Symbol> &x) const
 {
     // TODO: check if it is differentiated wrt s
-    return mul(mul(mul(minus_one, s_), zeta(add(s_, one), a_)), a_->diff(x));
+    return mul(mul(mul(minus_one, s_), zeta(add(s_, one), a_)), diff_arg(a_, x));
 }
 
 RCP<const Basic> zeta(const RCP<const Basic> &s, const RCP<const Basic> &a)
@@ -3024,12 +3031,25 @@ std::string Abs::__str__() const
 
 RCP<const Basic> Abs::diff(const RCP<const Symbol> &x) const
 {
-    if (eq(arg_->diff(x), zero))
+    if (eq(diff_arg(arg_, x), zero))
         return zero;
     else
         return rcp(new Derivative(rcp(this), {x}));
 }
 
+RCP<const Basic> Abs::subs(const map_basic_basic &subs_dict) const
+{
+    auto it = subs_dict.find(rcp(this));
+    if (it != subs_dict.end())
+        return it->second;
+    SubsMemo memo(subs_dict);
+    RCP<const Basic> arg = memo.subs(arg_);
+    if (arg == arg_)
+        return rcp(this);
+    else
+        return abs(arg);
+}
+
 RCP<const Basic> abs(const RCP<const Basic> &arg)
 {
     if (is_a<Integer>(*arg)) {
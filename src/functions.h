@@ -28,6 +28,7 @@ public:
     //! \return `arg_`
     inline RCP<const Basic> get_arg() const { return arg_; }
     virtual vec_basic get_args() const { return {arg_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return f(*arg_); }
     //! Method to construct classes with canonicalization
     virtual RCP<const Basic> create(const RCP<const Basic> &arg) const;
     //! Substitute with `subs_dict`
@@ -418,6 +419,9 @@ public:
     virtual RCP<const Basic> diff(const RCP<const Symbol> &x) const;
 
     virtual vec_basic get_args() const { return {num_, den_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const {
+        return f(*num_) && f(*den_);
+    }
 
     virtual void accept(Visitor &v) const;
 };
@@ -452,6 +456,7 @@ public:
     //! \return `arg_`
     inline RCP<const Basic> get_arg() const { return arg_; }
     virtual vec_basic get_args() const { return {arg_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return f(*arg_); }
     //! \return `true` if canonical
     bool is_canonical(const RCP<const Basic> &arg);
     //! Differentiate w.r.t Symbol `x`
@@ -500,6 +505,9 @@ public:
     //! \return `a_`
     inline RCP<const Basic> get_a() const { return a_; }
     virtual vec_basic get_args() const { return {s_, a_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const {
+        return f(*s_) && f(*a_);
+    }
     //! \return `true` if canonical
     bool is_canonical(const RCP<const Basic> &s, const RCP<const Basic> &a);
     //! Differentiate w.r.t Symbol `x`
@@ -535,6 +543,7 @@ public:
     //! \return `s_`
     inline RCP<const Basic> get_s() const { return s_; }
     virtual vec_basic get_args() const { return {s_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return f(*s_); }
     //! \return `true` if canonical
     bool is_canonical(const RCP<const Basic> &s);
     //! Rewrites in the form of zeta
@@ -570,6 +579,11 @@ public:
     inline std::string get_name() const { return name_; }
     //! \return `arg_`
     virtual vec_basic get_args() const { return arg_; }
+    virtual bool for_each_arg(const ArgCallback &f) const {
+        for (auto &p: arg_)
+            if (!f(*p)) return false;
+        return true;
+    }
     //! \return `true` if canonical
     bool is_canonical(const vec_basic &arg);
     //! Differentiate w.r.t Symbol `x`
@@ -705,6 +719,7 @@ public:
     //! \return `arg_`
     inline RCP<const Basic> get_arg() const { return arg_; }
     virtual vec_basic get_args() const { return {arg_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return f(*arg_); }
     //! Method to construct classes with canonicalization
     virtual RCP<const Basic> create(const RCP<const Basic> &arg) const;
     //! Substitute with `subs_dict`
@@ -961,6 +976,9 @@ public:
     //! \return `true` if canonical
     bool is_canonical(const RCP<const Basic> &i, const RCP<const Basic> &j);
     virtual vec_basic get_args() const { return {i_, j_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const {
+        return f(*i_) && f(*j_);
+    }
 
     virtual void accept(Visitor &v) const;
 };
@@ -995,6 +1013,11 @@ public:
     //! \return `true` if canonical
     bool is_canonical(const vec_basic &arg);
     virtual vec_basic get_args() const { return arg_; }
+    virtual bool for_each_arg(const ArgCallback &f) const {
+        for (auto &p: arg_)
+            if (!f(*p)) return false;
+        return true;
+    }
 
     virtual void accept(Visitor &v) const;
 };
@@ -1032,6 +1055,7 @@ public:
     //! \return `true` if canonical
     bool is_canonical(const RCP<const Basic> &arg);
     virtual vec_basic get_args() const { return {arg_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return f(*arg_); }
 
     virtual void accept(Visitor &v) const;
 };
@@ -1061,6 +1085,9 @@ public:
     //! \return `true` if canonical
     bool is_canonical(const RCP<const Basic> &s, const RCP<const Basic> &x);
     virtual vec_basic get_args() const { return {s_, x_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const {
+        return f(*s_) && f(*x_);
+    }
 
     virtual void accept(Visitor &v) const;
 };
@@ -1091,6 +1118,9 @@ public:
     //! \return `true` if canonical
     bool is_canonical(const RCP<const Basic> &s, const RCP<const Basic> &x);
     virtual vec_basic get_args() const { return {s_, x_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const {
+        return f(*s_) && f(*x_);
+    }
 
     virtual void accept(Visitor &v) const;
 };
@@ -1122,7 +1152,10 @@ public:
     bool is_canonical(const RCP<const Basic> &arg);
     inline RCP<const Basic> get_arg() const { return arg_; }
     virtual vec_basic get_args() const { return {arg_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return f(*arg_); }
     RCP<const Basic> diff(const RCP<const Symbol> &x) const;
+    //! Substitutes `subs_dict` into `self`
+    virtual RCP<const Basic> subs(const map_basic_basic &subs_dict) const;
 
     virtual void accept(Visitor &v) const;
 };
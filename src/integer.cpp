@@ -8,9 +8,19 @@ Integer::Integer(int i)
     this->i = i;
 }
 
-Integer::Integer(mpz_class i)
+Integer::Integer(mpz_class i) : i{std::move(i)}
 {
-    this->i = i;
+}
+
+const RCP<const Integer> *make_integer_cache()
+{
+    // Never destroyed, so that the cached Integers outlive all other
+    // (static) objects that might refer to them.
+    RCP<const Integer> *cache =
+        new RCP<const Integer>[integer_cache_max - integer_cache_min + 1];
+    for (long i = integer_cache_min; i <= integer_cache_max; i++)
+        cache[i - integer_cache_min] = rcp(new Integer(mpz_class(i)));
+    return cache;
 }
 
 std::size_t Integer::__hash__() const
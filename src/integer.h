@@ -7,11 +7,61 @@
 #ifndef CSYMPY_INTEGER_H
 #define CSYMPY_INTEGER_H
 
+#include <climits>
+
 #include "basic.h"
 #include "number.h"
+#include "unique_table.h"
 
 namespace CSymPy {
 
+class Integer;
+
+/*  Small Integers (from `integer_cache_min` to `integer_cache_max`) are
+    preallocated once and shared. `integer()` and the fast arithmetic methods
+    of Integer (`addint()`, `mulint()`, ...) return these instead of creating
+    a new node, so the small coefficients and exponents that dominate
+    expansion cost neither a node nor a GMP limb allocation.
+*/
+const long integer_cache_min = -256;
+const long integer_cache_max = 1024;
+
+//! \return the table of cached Integers, indexed by `i - integer_cache_min`
+const RCP<const Integer> *make_integer_cache();
+
+//! \return the cached Integer with value `i`
+inline const RCP<const Integer> &cached_integer(long i)
+{
+    static const RCP<const Integer> *cache = make_integer_cache();
+    return cache[i - integer_cache_min];
+}
+
+//! \return `true` if the Integer `i` is in the cache
+inline bool is_cached_integer(long i)
+{
+    return i >= integer_cache_min && i <= integer_cache_max;
+}
+
+//! \return `true` and sets `r` if `z` fits into a `long`
+inline bool mpz_get_long(const mpz_class &z, long &r)
+{
+    const __mpz_struct *p = z.get_mpz_t();
+    if (p->_mp_size == 0) {
+        r = 0;
+        return true;
+    }
+    if (p->_mp_size != 1 && p->_mp_size != -1) return false;
+    mp_limb_t l = p->_mp_d[0];
+    if (l > (mp_limb_t)LONG_MAX) return false;
+    r = p->_mp_size > 0 ? (long)l : -(long)l;
+    return true;
+}
+
+//! \return Integer from `long`, uses the cache if possible. Not interned.
+inline RCP<const Integer> integer_from_long(long i);
+//! \return Integer from `mpz_class`, uses the cache if possible. Not interned.
+inline RCP<const Integer> integer_from_mpz(mpz_class &&i);
+
 //! Integer Class
 class Integer : public Number {
 public:
@@ -53,17 +103,11 @@ public:
 
     /* These are very fast methods for add/sub/mul/div/pow on Integers only */
     //! Fast Integer Addition
-    inline RCP<const Integer> addint(const Integer &other) const {
-        return rcp(new Integer(this->i + other.i));
-    }
+    inline RCP<const Integer> addint(const Integer &other) const;
     //! Fast Integer Subtraction
-    inline RCP<const Integer> subint(const Integer &other) const {
-        return rcp(new Integer(this->i - other.i));
-    }
+    inline RCP<const Integer> subint(const Integer &other) const;
     //! Fast Integer Multiplication
-    inline RCP<const Integer> mulint(const Integer &other) const {
-        return rcp(new Integer(this->i * other.i));
-    }
+    inline RCP<const Integer> mulint(const Integer &other) const;
     //!  Integer Division
     RCP<const Number> divint(const Integer &other) const;
     //! Fast Negative Power Evaluation
@@ -78,12 +122,10 @@ public:
         }
         mpz_class tmp;
         mpz_pow_ui(tmp.get_mpz_t(), this->i.get_mpz_t(), other.i.get_ui());
-        return rcp(new Integer(tmp));
+        return integer_from_mpz(std::move(tmp));
     }
     //! \return negative of self.
-    inline RCP<const Integer> neg() const {
-        return rcp(new Integer(-i));
-    }
+    inline RCP<const Integer> neg() const;
 
     /* These are general methods, overriden from the Number class, that need to
      * check types to decide what operation to do, and so are a bit slower. */
@@ -151,16 +193,69 @@ struct RCPIntegerKeyLess
         return false;
     }
 };
+inline RCP<const Integer> integer_from_long(long i)
+{
+    if (is_cached_integer(i)) return cached_integer(i);
+    return rcp(new Integer(mpz_class(i)));
+}
+
+inline RCP<const Integer> integer_from_mpz(mpz_class &&i)
+{
+    long l;
+    if (mpz_get_long(i, l) && is_cached_integer(l)) return cached_integer(l);
+    return rcp(new Integer(std::move(i)));
+}
+
+inline RCP<const Integer> Integer::addint(const Integer &other) const
+{
+    long a, b, r;
+    if (mpz_get_long(this->i, a) && mpz_get_long(other.i, b)
+            && !__builtin_saddl_overflow(a, b, &r))
+        return integer_from_long(r);
+    return integer_from_mpz(this->i + other.i);
+}
+
+inline RCP<const Integer> Integer::subint(const Integer &other) const
+{
+    long a, b, r;
+    if (mpz_get_long(this->i, a) && mpz_get_long(other.i, b)
+            && !__builtin_ssubl_overflow(a, b, &r))
+        return integer_from_long(r);
+    return integer_from_mpz(this->i - other.i);
+}
+
+inline RCP<const Integer> Integer::mulint(const Integer &other) const
+{
+    long a, b, r;
+    if (mpz_get_long(this->i, a) && mpz_get_long(other.i, b)
+            && !__builtin_smull_overflow(a, b, &r))
+        return integer_from_long(r);
+    return integer_from_mpz(this->i * other.i);
+}
+
+inline RCP<const Integer> Integer::neg() const
+{
+    long a;
+    if (mpz_get_long(this->i, a) && is_cached_integer(-a))
+        return cached_integer(-a);
+    return integer_from_mpz(-i);
+}
+
 //! \return RCP<const Integer> from `int`
 inline RCP<const Integer> integer(int i)
 {
-    return rcp(new Integer(i));
+    // The cached Integers are unique already, they are not put into the
+    // unique table
+    if (is_cached_integer(i)) return cached_integer(i);
+    return intern(rcp(new Integer(i)));
 }
 
 //! \return RCP<const Integer> from `mpz_class`
 inline RCP<const Integer> integer(mpz_class i)
 {
-    return rcp(new Integer(i));
+    long l;
+    if (mpz_get_long(i, l) && is_cached_integer(l)) return cached_integer(l);
+    return intern(rcp(new Integer(std::move(i))));
 }
 //! Integer Square root
 RCP<const Integer> isqrt(const Integer &n);
@@ -76,6 +76,72 @@ protected:
     unsigned col_;
 };
 
+// ------------------------------ Dense Views --------------------------------//
+// A view of entries of a DenseMatrix (or of another view), e.g. a block or the
+// transpose, without copying them: the entry `(i, j)` is
+// `data[i*row_stride + j*col_stride]`. A view does not own its entries and
+// must not outlive the matrix. `T` is `const RCP<const Basic>` for read-only
+// views (ConstDenseMatrixView) and `RCP<const Basic>` otherwise
+// (DenseMatrixView).
+template <class T>
+class DenseView {
+public:
+    DenseView(T *data, unsigned row, unsigned col, unsigned row_stride,
+        unsigned col_stride)
+        : data_{data}, row_{row}, col_{col}, row_stride_{row_stride},
+          col_stride_{col_stride} {}
+    // A DenseMatrixView converts to a ConstDenseMatrixView
+    template <class U>
+    DenseView(const DenseView<U> &v)
+        : data_{v.data_}, row_{v.row_}, col_{v.col_},
+          row_stride_{v.row_stride_}, col_stride_{v.col_stride_} {}
+
+    unsigned nrows() const { return row_; }
+    unsigned ncols() const { return col_; }
+
+    // The entry itself, no reference is acquired
+    T &operator()(unsigned i, unsigned j) const {
+        CSYMPY_ASSERT(i < row_ && j < col_);
+        return data_[i*row_stride_ + j*col_stride_];
+    }
+    RCP<const Basic> get(unsigned i, unsigned j) const {
+        return (*this)(i, j);
+    }
+    void set(unsigned i, unsigned j, const RCP<const Basic> &e) const {
+        (*this)(i, j) = e;
+    }
+
+    // Rows `row_start` to `row_end` and columns `col_start` to `col_end`
+    // (both inclusive, as in submatrix_dense())
+    DenseView submatrix(unsigned row_start, unsigned row_end,
+        unsigned col_start, unsigned col_end) const {
+        CSYMPY_ASSERT(row_start <= row_end && row_end < row_ &&
+            col_start <= col_end && col_end < col_);
+        return DenseView(&(*this)(row_start, col_start),
+            row_end - row_start + 1, col_end - col_start + 1, row_stride_,
+            col_stride_);
+    }
+    DenseView row(unsigned i) const {
+        return submatrix(i, i, 0, col_ - 1);
+    }
+    DenseView column(unsigned j) const {
+        return submatrix(0, row_ - 1, j, j);
+    }
+    DenseView transpose() const {
+        return DenseView(data_, col_, row_, col_stride_, row_stride_);
+    }
+
+private:
+    T *data_;
+    unsigned row_, col_;
+    unsigned row_stride_, col_stride_;
+
+    template <class U> friend class DenseView;
+};
+
+typedef DenseView<RCP<const Basic>> DenseMatrixView;
+typedef DenseView<const RCP<const Basic>> ConstDenseMatrixView;
+
 // ----------------------------- Dense Matrix --------------------------------//
 class DenseMatrix: public MatrixBase {
 public:
@@ -83,6 +149,8 @@ public:
     DenseMatrix();
     DenseMatrix(unsigned row, unsigned col);
     DenseMatrix(unsigned row, unsigned col, const vec_basic &l);
+    // Takes the entries of `l` (in row-major order) without copying them
+    DenseMatrix(unsigned row, unsigned col, vec_basic &&l);
 
     // Should implement all the virtual methods from MatrixBase
     // and throw an exception if a method is not applicable.
@@ -91,6 +159,14 @@ public:
     virtual RCP<const Basic> get(unsigned i, unsigned j) const;
     virtual void set(unsigned i, unsigned j, const RCP<const Basic> &e);
 
+    // Views of all entries, see DenseView
+    DenseMatrixView view() {
+        return DenseMatrixView(m_.data(), row_, col_, col_, 1);
+    }
+    ConstDenseMatrixView view() const {
+        return ConstDenseMatrixView(m_.data(), row_, col_, col_, 1);
+    }
+
     virtual unsigned rank() const;
     virtual RCP<const Basic> det() const;
     virtual void inv(MatrixBase &result) const;
@@ -139,8 +215,12 @@ public:
         DenseMatrix &B );
     friend void mul_dense_dense(const DenseMatrix &A, const DenseMatrix &B,
         DenseMatrix &C);
+    friend void mul_dense_dense_parallel(const DenseMatrix &A,
+        const DenseMatrix &B, DenseMatrix &C, unsigned threads);
     friend void mul_dense_scalar(const DenseMatrix &A, const RCP<const Basic> &k,
         DenseMatrix &C);
+    friend void iadd_dense_dense(DenseMatrix &A, const DenseMatrix &B);
+    friend void imul_dense_scalar(DenseMatrix &A, const RCP<const Basic> &k);
     friend void transpose_dense(const DenseMatrix &A, DenseMatrix &B);
     friend void submatrix_dense(const DenseMatrix &A, unsigned row_start,
         unsigned row_end, unsigned col_start, unsigned col_end, DenseMatrix &B);
@@ -181,6 +261,7 @@ public:
     // Matrix Decomposition
     friend void fraction_free_LU(const DenseMatrix &A, DenseMatrix &LU);
     friend void LU(const DenseMatrix &A, DenseMatrix &L, DenseMatrix &U);
+    friend void LU_inplace(DenseMatrix &A);
     friend void fraction_free_LDU(const DenseMatrix &A, DenseMatrix &L,
         DenseMatrix &D, DenseMatrix &U);
     friend void QR(const DenseMatrix &A, DenseMatrix &Q, DenseMatrix &R);
@@ -192,7 +273,13 @@ public:
 
     // Determinant
     friend RCP<const Basic> det_bareis(const DenseMatrix &A);
+    friend RCP<const Basic> det_multimodular(const DenseMatrix &A,
+        unsigned threads);
+    friend void multimodular_solve(const DenseMatrix &A, const DenseMatrix &b,
+        DenseMatrix &x, unsigned threads);
     friend void berkowitz(const DenseMatrix &A, std::vector<DenseMatrix> &polys);
+    friend void char_poly_parallel(const DenseMatrix &A, DenseMatrix &B,
+        unsigned threads);
 
     // Inverse
     friend void inverse_fraction_free_LU(const DenseMatrix &A, DenseMatrix &B);
@@ -304,6 +391,27 @@ public:
     friend void csr_binop_csr_canonical(const CSRMatrix& A, const CSRMatrix& B,
         CSRMatrix& C,
         RCP<const Basic> (&bin_op)(const RCP<const Basic>&, const RCP<const Basic>&));
+    friend void csr_add_csr(const CSRMatrix &A, const CSRMatrix &B,
+        CSRMatrix &C);
+    friend void csr_mul_csr(const CSRMatrix &A, const CSRMatrix &B,
+        CSRMatrix &C);
+    friend void csr_mul_csr_parallel(const CSRMatrix &A, const CSRMatrix &B,
+        CSRMatrix &C, unsigned threads);
+    friend void csr_mul_dense(const CSRMatrix &A, const DenseMatrix &B,
+        DenseMatrix &C);
+    friend void csr_mul_scalar(const CSRMatrix &A, const RCP<const Basic> &k,
+        CSRMatrix &B);
+    friend void csr_transpose(const CSRMatrix &A, CSRMatrix &B);
+    friend void csr_permute(const CSRMatrix &A,
+        const std::vector<unsigned> &rows, const std::vector<unsigned> &cols,
+        CSRMatrix &B);
+    friend void csr_minimum_degree_ordering(const CSRMatrix &A,
+        std::vector<unsigned> &perm);
+    friend void csr_fraction_free_LU(const CSRMatrix &A, CSRMatrix &LU,
+        std::vector<unsigned> &rows);
+    friend RCP<const Basic> csr_det(const CSRMatrix &A);
+    friend void csr_fraction_free_LU_solve(const CSRMatrix &A,
+        const DenseMatrix &b, DenseMatrix &x);
 
 protected:
     std::vector<unsigned> p_;
@@ -311,8 +419,15 @@ protected:
     vec_basic x_;
 };
 
+// In-place `A = A + B` and `A = A*k`, reusing the storage of A
+void iadd_dense_dense(DenseMatrix &A, const DenseMatrix &B);
+void imul_dense_scalar(DenseMatrix &A, const RCP<const Basic> &k);
+
 // Matrix Factorization
 void LU(const DenseMatrix &A, DenseMatrix &L, DenseMatrix &U);
+// LU() in place: `A` is overwritten by U on and above the diagonal and by L
+// (without its unit diagonal) below it
+void LU_inplace(DenseMatrix &A);
 
 void LDL(const DenseMatrix &A, DenseMatrix &L, DenseMatrix &D);
 
@@ -335,11 +450,30 @@ void LDL_solve(const DenseMatrix &A, const DenseMatrix &b, DenseMatrix &x);
 // Determinant
 RCP<const Basic> det_berkowitz(const DenseMatrix &A);
 
+// Multimodular algorithms for matrices of Integers and Rationals (they throw
+// otherwise): the result is computed modulo word sized primes by `threads`
+// threads (0 means the number of hardware threads) and reconstructed by the
+// Chinese remainder theorem, so the entries do not grow as in det_bareis()
+// or fraction_free_gaussian_elimination_solve().
+RCP<const Basic> det_multimodular(const DenseMatrix &A, unsigned threads = 0);
+// Solutions are found by rational reconstruction. Throws if A is singular.
+void multimodular_solve(const DenseMatrix &A, const DenseMatrix &b,
+    DenseMatrix &x, unsigned threads = 0);
+
 // Characteristic polynomial: Only the coefficients of monomials in decreasing
 // order of monomial powers is returned, i.e. if `B = transpose([1, -2, 3])`
 // then the corresponding polynomial is `x^2 - 2x + 3`.
 void char_poly(const DenseMatrix &A, DenseMatrix &B);
 
+// char_poly() and det_berkowitz() with the products of each stage of
+// Berkowitz' algorithm computed by `threads` threads (0 means the number of
+// hardware threads). Only with WITH_CSYMPY_THREAD_SAFE (otherwise
+// sequential).
+void char_poly_parallel(const DenseMatrix &A, DenseMatrix &B,
+    unsigned threads = 0);
+RCP<const Basic> det_berkowitz_parallel(const DenseMatrix &A,
+    unsigned threads = 0);
+
 // Mimic `eye` function in NumPy
 void eye(DenseMatrix &A, unsigned N, unsigned M = 0, int k = 0);
 
@@ -352,6 +486,63 @@ void ones(DenseMatrix &A, unsigned rows, unsigned cols);
 // Create a matrix filled with zeros
 void zeros(DenseMatrix &A, unsigned rows, unsigned cols);
 
+// `C = A*B` computed by `threads` threads (0 means the number of hardware
+// threads), each taking tiles of C in turn. Only with WITH_CSYMPY_THREAD_SAFE
+// (otherwise the same as `mul_dense_dense()`).
+void mul_dense_dense_parallel(const DenseMatrix &A, const DenseMatrix &B,
+        DenseMatrix &C, unsigned threads = 0);
+
+// Operations on views (e.g. blocks or transposes), in place of copies made
+// by submatrix_dense() or transpose_dense(). The view of the result must not
+// overlap the others.
+void copy_dense(const ConstDenseMatrixView &A, const DenseMatrixView &B);
+void add_dense_dense(const ConstDenseMatrixView &A,
+    const ConstDenseMatrixView &B, const DenseMatrixView &C);
+void mul_dense_dense(const ConstDenseMatrixView &A,
+    const ConstDenseMatrixView &B, const DenseMatrixView &C);
+void row_exchange_dense(const DenseMatrixView &A, unsigned i, unsigned j);
+void row_mul_scalar_dense(const DenseMatrixView &A, unsigned i,
+    const RCP<const Basic> &c);
+void row_add_row_dense(const DenseMatrixView &A, unsigned i, unsigned j,
+    const RCP<const Basic> &c);
+
+// Sparse matrices: the results are CSR matrices in canonical format
+void csr_add_csr(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C);
+void csr_mul_csr(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C);
+// `C = A*B` computed by `threads` threads (0 means the number of hardware
+// threads), each taking chunks of rows of C in turn. Only with
+// WITH_CSYMPY_THREAD_SAFE (otherwise the same as `csr_mul_csr()`).
+void csr_mul_csr_parallel(const CSRMatrix &A, const CSRMatrix &B,
+    CSRMatrix &C, unsigned threads = 0);
+// `C = A*B` for a dense `B`, e.g. a matrix-vector product
+void csr_mul_dense(const CSRMatrix &A, const DenseMatrix &B, DenseMatrix &C);
+void csr_mul_scalar(const CSRMatrix &A, const RCP<const Basic> &k,
+    CSRMatrix &B);
+void csr_transpose(const CSRMatrix &A, CSRMatrix &B);
+// `B(i, j) = A(rows[i], cols[j])`
+void csr_permute(const CSRMatrix &A, const std::vector<unsigned> &rows,
+    const std::vector<unsigned> &cols, CSRMatrix &B);
+// Fill-reducing (minimum degree) ordering of a square matrix: eliminating
+// the rows and columns in the order `perm`, i.e. factoring `P A P^T`
+// (`csr_permute(A, perm, perm, B)`), creates few new entries.
+void csr_minimum_degree_ordering(const CSRMatrix &A,
+    std::vector<unsigned> &perm);
+// Fraction-free LU of the rows of A in the order `rows` (exchanged only when
+// a pivot is zero), in the format of fraction_free_LU(). Throws if A is
+// singular before the last column.
+void csr_fraction_free_LU(const CSRMatrix &A, CSRMatrix &LU,
+    std::vector<unsigned> &rows);
+// Determinant and solution of Ax = b by fraction-free elimination in the
+// minimum degree ordering. The solve throws if A is singular.
+RCP<const Basic> csr_det(const CSRMatrix &A);
+void csr_fraction_free_LU_solve(const CSRMatrix &A, const DenseMatrix &b,
+    DenseMatrix &x);
+
+// Jacobian `J(i, j) = f[i]->diff(x[j])`, the entries of `x` must be Symbols.
+// One Differentiator computes all the entries, so the derivatives of the
+// subexpressions shared by them are computed once.
+void jacobian(const vec_basic &f, const vec_basic &x, DenseMatrix &J);
+
 // Returns true if `b` is exactly the type T.
 // Here T can be a DenseMatrix, CSRMatrix, etc.
 template <class T>
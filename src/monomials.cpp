@@ -13,6 +13,58 @@ void monomial_mul(const vec_int &A, const vec_int &B, vec_int &C)
     }
 }
 
+namespace {
+
+// Bits per variable for exponents up to `max_degree` (with the guard bit)
+unsigned packing_bits(unsigned max_degree)
+{
+    unsigned b = 0;
+    while (b < 32 && (max_degree >> b) != 0) b++;
+    // One more bit for the guard
+    return b + 1;
+}
+
+} // anonymous namespace
+
+bool MonomialPacking::fits(unsigned n, unsigned max_degree)
+{
+    return n * packing_bits(max_degree) <= 64;
+}
+
+MonomialPacking::MonomialPacking(unsigned n, unsigned max_degree)
+    : n_{n}
+{
+    bits_ = packing_bits(max_degree);
+    if (n * bits_ > 64)
+        throw std::runtime_error("MonomialPacking: exponents do not fit into 64 bits");
+    guard_ = 0;
+    for (unsigned i = 0; i < n; i++)
+        guard_ |= 1ULL << (i * bits_ + bits_ - 1);
+}
+
+unsigned long long MonomialPacking::pack(const vec_int &exp) const
+{
+    unsigned long long field = (1ULL << (bits_ - 1)) - 1;
+    unsigned long long m = 0;
+    for (unsigned i = 0; i < n_; i++) {
+        if (exp[i] < 0)
+            throw std::runtime_error("MonomialPacking: negative exponents are not supported");
+        if ((unsigned long long)exp[i] > field)
+            throw std::runtime_error("MonomialPacking: exponent exceeds the degree bound");
+        m = (m << bits_) | (unsigned long long)exp[i];
+    }
+    return m;
+}
+
+void MonomialPacking::unpack(unsigned long long m, vec_int &exp) const
+{
+    unsigned long long field = (1ULL << (bits_ - 1)) - 1;
+    for (unsigned i = n_; i > 0; i--) {
+        exp[i-1] = m & field;
+        m >>= bits_;
+    }
+}
+
 /*
 // Other implementation of monomial_mul() are below. Those are slightly slower,
 // so they are commented out.
@@ -13,6 +13,50 @@ namespace CSymPy {
 //! Monomial multiplication
 void monomial_mul(const vec_int &A, const vec_int &B, vec_int &C);
 
+/*! Layout of exponent vectors packed into a single 64-bit word.
+
+    Each of the `n` exponents gets a field of `bits` bits, wide enough for
+    the degree bound, plus one guard bit on top. The first variable goes
+    into the most significant field, so comparing packed monomials as
+    integers is the lexicographic order of the exponent vectors.
+
+    Multiplication of two packed monomials is a single integer addition; as
+    long as the exponents of the product stay within the degree bound, no
+    carry crosses into the neighbouring field, which can be checked by
+    testing the guard bits (`overflows()`).
+*/
+class MonomialPacking {
+public:
+    //! Number of variables
+    unsigned n_;
+    //! Bits per variable, including the guard bit
+    unsigned bits_;
+    //! Mask of all guard bits
+    unsigned long long guard_;
+
+public:
+    //! Packing for `n` variables with exponents up to `max_degree`
+    MonomialPacking(unsigned n, unsigned max_degree);
+    //! \return `true` if such a packing fits into 64 bits
+    static bool fits(unsigned n, unsigned max_degree);
+
+    //! \return the packed form of `exp`
+    unsigned long long pack(const vec_int &exp) const;
+    //! Unpacks `m` into `exp`, which must have size `n_`
+    void unpack(unsigned long long m, vec_int &exp) const;
+    //! \return `true` if some exponent of `m` exceeds the degree bound
+    inline bool overflows(unsigned long long m) const {
+        return (m & guard_) != 0;
+    }
+};
+
+//! Packed monomial multiplication
+inline unsigned long long monomial_mul(unsigned long long A,
+        unsigned long long B)
+{
+    return A + B;
+}
+
 } // CSymPy
 
 #endif
@@ -1,4 +1,5 @@
 #include <stdexcept>
+#include <algorithm>
 
 #include "add.h"
 #include "mul.h"
@@ -7,6 +8,7 @@
 #include "complex.h"
 #include "functions.h"
 #include "constants.h"
+#include "unique_table.h"
 
 namespace CSymPy {
 
@@ -338,6 +340,98 @@ void Mul::as_base_exp(const RCP<const Basic> &self, const Ptr<RCP<const Basic>>
     }
 }
 
+namespace {
+
+// Multiplies the sorted ranges of factors (base, exp) [i, i_end) and
+// [j, j_end) into the empty dict `d`. Both ranges are merged in one pass,
+// each factor is appended at the end of `d`. Only the common bases need
+// dict_add_term_new().
+template <class It1, class It2>
+void mul_merge_dicts(const Ptr<RCP<const Number>> &coef, map_basic_basic &d,
+        It1 i, It1 i_end, It2 j, It2 j_end)
+{
+    RCPBasicKeyLess less;
+    while (i != i_end && j != j_end) {
+        if (less(i->first, j->first)) {
+            d.insert(d.end(), *i);
+            ++i;
+        } else if (less(j->first, i->first)) {
+            d.insert(d.end(), *j);
+            ++j;
+        } else {
+            d.insert(d.end(), *i);
+            Mul::dict_add_term_new(coef, d, j->second, j->first);
+            ++i;
+            ++j;
+        }
+    }
+    d.insert(i, i_end);
+    d.insert(j, j_end);
+}
+
+typedef std::pair<RCP<const Basic>, RCP<const Basic>> base_exp;
+
+// The only factor of the monomial `a`, which is not a Mul
+inline base_exp monomial_factor(const RCP<const Basic> &a)
+{
+    if (is_a<Pow>(*a))
+        return base_exp(rcp_static_cast<const Pow>(a)->base_,
+            rcp_static_cast<const Pow>(a)->exp_);
+    return base_exp(a, one);
+}
+
+// Multiplies the product `coef` * `d` by `b`
+void mul_to_dict(const Ptr<RCP<const Number>> &coef, map_basic_basic &d,
+        const RCP<const Basic> &b)
+{
+    if (is_a<Mul>(*b)) {
+        if (!(rcp_static_cast<const Mul>(b)->coef_->is_one()))
+            imulnum(coef, rcp_static_cast<const Mul>(b)->coef_);
+        for (auto &p: rcp_static_cast<const Mul>(b)->dict_)
+            Mul::dict_add_term_new(coef, d, p.second, p.first);
+    } else if (is_a_Number(*b)) {
+        imulnum(coef, rcp_static_cast<const Number>(b));
+    } else {
+        RCP<const Basic> exp;
+        RCP<const Basic> t;
+        Mul::as_base_exp(b, outArg(exp), outArg(t));
+        Mul::dict_add_term_new(coef, d, exp, t);
+    }
+}
+
+} // anonymous namespace
+
+RCP<const Basic> mul_monomials(const RCP<const Basic> &a,
+        const RCP<const Basic> &b)
+{
+    CSYMPY_ASSERT(!is_a_Number(*a) && !is_a<Add>(*a))
+    CSYMPY_ASSERT(!is_a_Number(*b) && !is_a<Add>(*b))
+    CSYMPY_ASSERT(!is_a<Mul>(*a) ||
+        rcp_static_cast<const Mul>(a)->coef_->is_one())
+    CSYMPY_ASSERT(!is_a<Mul>(*b) ||
+        rcp_static_cast<const Mul>(b)->coef_->is_one())
+    map_basic_basic d;
+    RCP<const Number> coef = one;
+    if (is_a<Mul>(*a) && is_a<Mul>(*b)) {
+        const map_basic_basic &A = rcp_static_cast<const Mul>(a)->dict_;
+        const map_basic_basic &B = rcp_static_cast<const Mul>(b)->dict_;
+        mul_merge_dicts(outArg(coef), d, A.begin(), A.end(),
+            B.begin(), B.end());
+    } else if (is_a<Mul>(*a)) {
+        const map_basic_basic &A = rcp_static_cast<const Mul>(a)->dict_;
+        base_exp f = monomial_factor(b);
+        mul_merge_dicts(outArg(coef), d, A.begin(), A.end(), &f, &f + 1);
+    } else if (is_a<Mul>(*b)) {
+        const map_basic_basic &B = rcp_static_cast<const Mul>(b)->dict_;
+        base_exp f = monomial_factor(a);
+        mul_merge_dicts(outArg(coef), d, &f, &f + 1, B.begin(), B.end());
+    } else {
+        base_exp f = monomial_factor(a), g = monomial_factor(b);
+        mul_merge_dicts(outArg(coef), d, &f, &f + 1, &g, &g + 1);
+    }
+    return intern(Mul::from_dict(coef, std::move(d)));
+}
+
 RCP<const Basic> mul(const RCP<const Basic> &a, const RCP<const Basic> &b)
 {
     CSymPy::map_basic_basic d;
@@ -351,31 +445,16 @@ RCP<const Basic> mul(const RCP<const Basic> &a, const RCP<const Basic> &b)
         // following two lines.
         if (!(A->coef_->is_one()) || !(B->coef_->is_one()))
             coef = mulnum(A->coef_, B->coef_);
-        d = A->dict_;
-        for (auto &p: B->dict_)
-            Mul::dict_add_term_new(outArg(coef), d, p.second, p.first);
+        mul_merge_dicts(outArg(coef), d, A->dict_.begin(), A->dict_.end(),
+            B->dict_.begin(), B->dict_.end());
     } else if (CSymPy::is_a<Mul>(*a)) {
-        RCP<const Basic> exp;
-        RCP<const Basic> t;
         coef = (rcp_static_cast<const Mul>(a))->coef_;
         d = (rcp_static_cast<const Mul>(a))->dict_;
-        if (is_a_Number(*b)) {
-            imulnum(outArg(coef), rcp_static_cast<const Number>(b));
-        } else {
-            Mul::as_base_exp(b, outArg(exp), outArg(t));
-            Mul::dict_add_term_new(outArg(coef), d, exp, t);
-        }
+        mul_to_dict(outArg(coef), d, b);
     } else if (CSymPy::is_a<Mul>(*b)) {
-        RCP<const Basic> exp;
-        RCP<const Basic> t;
         coef = (rcp_static_cast<const Mul>(b))->coef_;
         d = (rcp_static_cast<const Mul>(b))->dict_;
-        if (is_a_Number(*a)) {
-            imulnum(outArg(coef), rcp_static_cast<const Number>(a));
-        } else {
-            Mul::as_base_exp(a, outArg(exp), outArg(t));
-            Mul::dict_add_term_new(outArg(coef), d, exp, t);
-        }
+        mul_to_dict(outArg(coef), d, a);
     } else {
         RCP<const Basic> exp;
         RCP<const Basic> t;
@@ -384,7 +463,34 @@ RCP<const Basic> mul(const RCP<const Basic> &a, const RCP<const Basic> &b)
         Mul::as_base_exp(b, outArg(exp), outArg(t));
         Mul::dict_add_term_new(outArg(coef), d, exp, t);
     }
-    return Mul::from_dict(coef, std::move(d));
+    return intern(Mul::from_dict(coef, std::move(d)));
+}
+
+RCP<const Basic> Mul::from_factors(const vec_basic &factors)
+{
+    map_basic_basic d;
+    RCP<const Number> coef = one;
+    for (auto &f: factors)
+        mul_to_dict(outArg(coef), d, f);
+    return intern(Mul::from_dict(coef, std::move(d)));
+}
+
+void imul(const Ptr<RCP<const Basic>> &self, const RCP<const Basic> &b)
+{
+#if !defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+    if (is_a<Mul>(**self) && (*self)->refcount_ == 1 &&
+            !(*self)->is_interned()) {
+        // We hold the only reference, so we take over the dictionary instead
+        // of copying it (see iadd()).
+        Mul &a = const_cast<Mul &>(static_cast<const Mul &>(**self));
+        RCP<const Number> coef = a.coef_;
+        map_basic_basic d = std::move(a.dict_);
+        mul_to_dict(outArg(coef), d, b);
+        *self = intern(Mul::from_dict(coef, std::move(d)));
+        return;
+    }
+#endif
+    *self = mul(*self, b);
 }
 
 RCP<const Basic> div(const RCP<const Basic> &a, const RCP<const Basic> &b)
@@ -404,16 +510,34 @@ RCP<const Basic> mul_expand_two(const RCP<const Basic> &a, const RCP<const Basic
         RCP<const Number> coef = mulnum(rcp_static_cast<const Add>(a)->coef_,
             rcp_static_cast<const Add>(b)->coef_);
         umap_basic_num d;
+#if defined(WITH_CSYMPY_FLAT_HASH_MAP)
+        // The number of products is usually a large overestimate of the
+        // number of terms. Reserving the slots (whole entries, unlike the
+        // buckets of std::unordered_map) for all of them makes the inserts
+        // miss the cache, while growing the table is cheap (no rehashing).
+        d.reserve((rcp_static_cast<const Add>(a))->dict_.size() +
+            (rcp_static_cast<const Add>(b))->dict_.size());
+#else
+        // The reserve() below allocates one bucket for each product
+        expand_check_size(0, sizeof(void *) *
+            (double)(rcp_static_cast<const Add>(a))->dict_.size()*
+            (rcp_static_cast<const Add>(b))->dict_.size());
         // Improves (x+1)^3(x+2)^3...(x+350)^3 expansion from 0.97s to 0.93s:
         d.reserve((rcp_static_cast<const Add>(a))->dict_.size()*
             (rcp_static_cast<const Add>(b))->dict_.size());
+#endif
+        // (Upper estimate of) the memory taken by a product of two terms
+        std::size_t term_bytes =
+            add_term_bytes(*(rcp_static_cast<const Add>(a))->dict_.begin()->first) +
+            add_term_bytes(*(rcp_static_cast<const Add>(b))->dict_.begin()->first);
         // Expand dicts first:
         for (auto &p: (rcp_static_cast<const Add>(a))->dict_) {
             for (auto &q: (rcp_static_cast<const Add>(b))->dict_) {
-                // The main bottleneck here is the mul(p.first, q.first) command
-                RCP<const Basic> term = mul(p.first, q.first);
+                // The main bottleneck here is the product of the two terms
+                RCP<const Basic> term = mul_monomials(p.first, q.first);
                 if (is_a_Number(*term)) {
-                    iaddnum(outArg(coef), rcp_static_cast<const Number>(term));
+                    iaddnum(outArg(coef), mulnum(mulnum(p.second, q.second),
+                        rcp_static_cast<const Number>(term)));
                 } else {
                     Add::dict_add_term(d, mulnum(p.second, q.second), term);
                 }
@@ -421,6 +545,7 @@ RCP<const Basic> mul_expand_two(const RCP<const Basic> &a, const RCP<const Basic
             Add::dict_add_term(d,
                     mulnum(rcp_static_cast<const Add>(b)->coef_, p.second),
                     p.first);
+            expand_check_size(d.size(), d.size() * term_bytes);
         }
         // Handle the coefficient of "a":
         for (auto &q: (rcp_static_cast<const Add>(b))->dict_) {
@@ -440,9 +565,11 @@ RCP<const Basic> mul_expand_two(const RCP<const Basic> &a, const RCP<const Basic
         umap_basic_num d;
         d.reserve((rcp_static_cast<const Add>(b))->dict_.size());
         for (auto &q: (rcp_static_cast<const Add>(b))->dict_) {
-            RCP<const Basic> term = mul(a_term, q.first);
+            RCP<const Basic> term = is_a_Number(*a_term) ? q.first :
+                mul_monomials(a_term, q.first);
             if (is_a_Number(*term)) {
-                iaddnum(outArg(coef), rcp_static_cast<const Number>(term));
+                iaddnum(outArg(coef), mulnum(mulnum(a_coef, q.second),
+                    rcp_static_cast<const Number>(term)));
             } else {
                 Add::dict_add_term(d, mulnum(a_coef, q.second), term);
             }
@@ -462,11 +589,31 @@ RCP<const Basic> mul_expand_two(const RCP<const Basic> &a, const RCP<const Basic
 
 RCP<const Basic> mul_expand(const RCP<const Mul> &self)
 {
-    RCP<const Basic> a, b;
-    self->as_two_terms(outArg(a), outArg(b));
-    a = expand(a);
-    b = expand(b);
-    return mul_expand_two(a, b);
+    // The factors that expand into an Add are multiplied in the order of
+    // increasing number of terms, so that the largest factor comes last and
+    // the intermediate results stay as small as possible. The remaining
+    // factors are multiplied together and distributed over the result at
+    // the end.
+    typedef std::pair<std::size_t, RCP<const Basic>> sized_factor;
+    std::vector<sized_factor> factors;
+    RCP<const Basic> rest = self->coef_;
+    for (auto &p: self->dict_) {
+        RCP<const Basic> f = expand(pow(p.first, p.second));
+        if (is_a<Add>(*f))
+            factors.push_back(std::make_pair(
+                rcp_static_cast<const Add>(f)->dict_.size(), f));
+        else
+            rest = mul(rest, f);
+    }
+    if (factors.empty()) return rest;
+    std::stable_sort(factors.begin(), factors.end(),
+        [](const sized_factor &a, const sized_factor &b) {
+            return a.first < b.first;
+        });
+    RCP<const Basic> r = factors[0].second;
+    for (std::size_t i = 1; i < factors.size(); i++)
+        r = mul_expand_two(r, factors[i].second);
+    return mul_expand_two(rest, r);
 }
 
 RCP<const Basic> Mul::power_all_terms(const RCP<const Basic> &exp) const
@@ -501,10 +648,11 @@ RCP<const Basic> Mul::power_all_terms(const RCP<const Basic> &exp) const
 
 RCP<const Basic> Mul::diff(const RCP<const Symbol> &x) const
 {
+    DiffMemo memo;
     RCP<const Basic> r=zero;
     for (auto &p: dict_) {
         RCP<const Number> coef = coef_;
-        RCP<const Basic> factor = pow(p.first, p.second)->diff(x);
+        RCP<const Basic> factor = memo.diff(pow(p.first, p.second), x);
         if (is_a<Integer>(*factor) &&
                 rcp_static_cast<const Integer>(factor)->is_zero()) continue;
         map_basic_basic d = dict_;
@@ -535,14 +683,27 @@ RCP<const Basic> Mul::subs(const map_basic_basic &subs_dict) const
     if (it != subs_dict.end())
         return it->second;
 
+    SubsMemo memo(subs_dict);
     RCP<const Number> coef = coef_;
     map_basic_basic d;
+    bool changed = false;
     for (auto &p: dict_) {
         RCP<const Basic> factor_old = pow(p.first, p.second);
-        RCP<const Basic> factor = factor_old->subs(subs_dict);
+        RCP<const Basic> factor = memo.subs(factor_old);
         if (factor == factor_old) {
-            Mul::dict_add_term_new(outArg(coef), d, p.second, p.first);
-        } else if (is_a<Integer>(*factor) &&
+            if (changed)
+                Mul::dict_add_term_new(outArg(coef), d, p.second, p.first);
+            continue;
+        }
+        if (!changed) {
+            // The first substituted factor, copy the factors before it
+            for (auto &q: dict_) {
+                if (&q == &p) break;
+                Mul::dict_add_term_new(outArg(coef), d, q.second, q.first);
+            }
+            changed = true;
+        }
+        if (is_a<Integer>(*factor) &&
                 rcp_static_cast<const Integer>(factor)->is_zero()) {
             return zero;
         } else if (is_a_Number(*factor)) {
@@ -559,6 +720,8 @@ RCP<const Basic> Mul::subs(const map_basic_basic &subs_dict) const
             Mul::dict_add_term_new(outArg(coef), d, exp, t);
         }
     }
+    // Nothing was substituted, no need for a new Mul
+    if (!changed) return self;
     return Mul::from_dict(coef, std::move(d));
 }
 
@@ -571,4 +734,11 @@ vec_basic Mul::get_args() const {
     return args;
 }
 
+bool Mul::for_each_arg(const ArgCallback &f) const {
+    if (!coef_->is_one() && !f(*coef_)) return false;
+    for (auto &p: dict_)
+        if (!f(*p.first) || !f(*p.second)) return false;
+    return true;
+}
+
 } // CSymPy
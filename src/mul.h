@@ -36,6 +36,9 @@ public:
     //! Create a Mul from a dict
     static RCP<const Basic> from_dict(const RCP<const Number> &coef,
             map_basic_basic &&d);
+    //! \return the product of `factors`, built in one dictionary and
+    //! canonicalized once, instead of folding with `mul()`
+    static RCP<const Basic> from_factors(const vec_basic &factors);
     //! Add terms to dict
     static void dict_add_term(map_basic_basic &d,
         const RCP<const Basic> &exp, const RCP<const Basic> &t);
@@ -62,12 +65,23 @@ public:
     virtual RCP<const Basic> subs(const map_basic_basic &subs_dict) const;
 
     virtual vec_basic get_args() const;
+    virtual bool for_each_arg(const ArgCallback &f) const;
 
     virtual void accept(Visitor &v) const;
 };
 //! Multiplication
 RCP<const Basic> mul(const RCP<const Basic> &a,
         const RCP<const Basic> &b);
+/*! Replaces `*self` by `*self * b`. If `*self` is a Mul that nobody else
+ * references, its dictionary is reused instead of copied (see iadd()).
+ * */
+void imul(const Ptr<RCP<const Basic>> &self, const RCP<const Basic> &b);
+/*! Multiplication of two monomials, i.e. terms of an Add: no Number, Add
+ * or Mul with a coefficient other than one. The factors of `a` and `b` are
+ * merged in one pass, skipping the type dispatch of mul().
+ * */
+RCP<const Basic> mul_monomials(const RCP<const Basic> &a,
+        const RCP<const Basic> &b);
 //! Division
 RCP<const Basic> div(const RCP<const Basic> &a,
         const RCP<const Basic> &b);
@@ -76,6 +90,9 @@ RCP<const Basic> neg(const RCP<const Basic> &a);
 
 //! Expand `self`
 RCP<const Basic> mul_expand(const RCP<const Mul> &self);
+//! Expands `a * b`, where `a` and `b` are already expanded
+RCP<const Basic> mul_expand_two(const RCP<const Basic> &a,
+        const RCP<const Basic> &b);
 
 } // CSymPy
 
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <cmath>
-#include <valarray>
+#include <limits>
+#include <thread>
 
 #include "ntheory.h"
 #include "rational.h"
@@ -499,9 +501,13 @@ void prime_factor_multiplicities(map_integer_uint &primes_mul, const Integer &n)
         insert(primes_mul, integer(_n), 1);
 }
 
-std::vector<unsigned> Sieve::_primes = {2,3,5,7,11,13,17,19,23,29};
-bool Sieve::_clear = true;
-unsigned Sieve::_sieve_size = 32 * 1024 * 8; //32K in bits
+Sieve::Primes Sieve::_primes = std::make_shared<const std::vector<unsigned>>(
+    std::vector<unsigned>{2,3,5,7,11,13,17,19,23,29});
+std::mutex Sieve::_mutex;
+std::atomic<bool> Sieve::_clear(true);
+std::atomic<unsigned> Sieve::_sieve_size(32 * 1024 * 8); //32K in bits
+std::atomic<unsigned> Sieve::_threads(0);
+std::atomic<unsigned> Sieve::_cache_limit(1 << 24);
 
 void Sieve::set_clear(bool clear)
 {
@@ -510,7 +516,10 @@ void Sieve::set_clear(bool clear)
 
 void Sieve::clear()
 {
-    _primes.erase(_primes.begin() + 10, _primes.end());
+    std::lock_guard<std::mutex> lock(_mutex);
+    Primes primes = std::atomic_load(&_primes);
+    std::atomic_store(&_primes, std::make_shared<const std::vector<unsigned>>(
+        primes->begin(), primes->begin() + 10));
 }
 
 void Sieve::set_sieve_size(unsigned size) {
@@ -521,89 +530,246 @@ void Sieve::set_sieve_size(unsigned size) {
 #endif
 }
 
-void Sieve::_extend(unsigned limit)
+void Sieve::set_num_threads(unsigned threads) {
+    _threads = threads;
+}
+
+void Sieve::set_cache_limit(unsigned limit) {
+    limit = std::max(limit, 1u << 16);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _cache_limit = limit;
+    Primes primes = std::atomic_load(&_primes);
+    auto it = std::upper_bound(primes->begin(), primes->end(), limit);
+    if (it != primes->end())
+        std::atomic_store(&_primes,
+            std::make_shared<const std::vector<unsigned>>(primes->begin(), it));
+}
+
+#ifndef HAVE_CSYMPY_PRIMESIEVE
+namespace {
+
+// Mod 30 wheel: byte `b` of a segment holds the numbers `30*b + r` for the
+// 8 residues `r` coprime to 30, one bit each.
+const unsigned wheel_residues[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+// Bit of each residue (0 for residues that are not coprime to 30)
+const unsigned char wheel_bit[30] = {
+    0, 1 << 0, 0, 0, 0, 0, 0, 1 << 1, 0, 0, 0, 1 << 2, 0, 1 << 3, 0, 0, 0,
+    1 << 4, 0, 1 << 5, 0, 0, 0, 1 << 6, 0, 0, 0, 0, 0, 1 << 7};
+
+// A sieving prime `p`: for `m = 30*q + wheel_residues[w]`, the multiple
+// `p*m` is bit `mask[w]` of byte `p*q + offset[w]`.
+struct WheelPrime {
+    unsigned p;
+    unsigned offset[8];
+    unsigned char mask[8];
+};
+
+// Crosses off the multiples `p*m`, `m >= p` coprime to 30, of the sieving
+// primes in the bytes `[lo, hi)` (counted from 0) and appends the primes
+// in `[first, last]` left in them to `out`.
+void sieve_bytes(const std::vector<WheelPrime> &wheel_primes,
+        unsigned long long lo, unsigned long long hi,
+        unsigned long long first, unsigned long long last,
+        std::vector<unsigned char> &bits, std::vector<unsigned> &out)
 {
-#ifdef HAVE_CSYMPY_PRIMESIEVE
-    if (_primes.back() < limit)
-        primesieve::generate_primes(_primes.back() + 1, limit, &_primes);
-#else
-    const unsigned sqrt_limit = static_cast<unsigned>(std::sqrt(limit));
-    unsigned start = _primes.back() + 1;
-    if (limit <= start)
-        return;
-    if (sqrt_limit >= start) {
-        _extend(sqrt_limit);
-        start = _primes.back() + 1;
+    unsigned long long size = hi - lo;
+    bits.assign(size, 0xff);
+    unsigned char *seg = bits.data();
+    for (const WheelPrime &wp : wheel_primes) {
+        unsigned long long p = wp.p;
+        if (p * p >= 30 * hi) break;
+        // first m = 30*q + r with p*m in the segment and m >= p
+        unsigned long long m = std::max(p, 30 * lo / p);
+        unsigned long long q = m / 30;
+        // bytes of the multiples of q, relative to the segment
+        long long base = (long long)(p * q) - (long long)lo;
+        for (unsigned w = 0; w < 8; w++) {
+            long long i = base + wp.offset[w];
+            if (30 * q + wheel_residues[w] >= m && i >= 0 &&
+                    i < (long long)size)
+                seg[i] &= ~wp.mask[w];
+        }
+        base += p;
+        for (; base + wp.offset[7] < (long long)size; base += p) {
+            unsigned char *b = seg + base;
+            b[wp.offset[0]] &= ~wp.mask[0];
+            b[wp.offset[1]] &= ~wp.mask[1];
+            b[wp.offset[2]] &= ~wp.mask[2];
+            b[wp.offset[3]] &= ~wp.mask[3];
+            b[wp.offset[4]] &= ~wp.mask[4];
+            b[wp.offset[5]] &= ~wp.mask[5];
+            b[wp.offset[6]] &= ~wp.mask[6];
+            b[wp.offset[7]] &= ~wp.mask[7];
+        }
+        for (unsigned w = 0; w < 8; w++)
+            if (base + wp.offset[w] < (long long)size)
+                seg[base + wp.offset[w]] &= ~wp.mask[w];
     }
-    
-    unsigned segment = _sieve_size;
-    std::valarray<bool> is_prime(segment);
-    for (; start <= limit; start += 2 * segment) {
-        unsigned finish = std::min(start + segment * 2 + 1, limit);
-        is_prime[std::slice(0, segment, 1)] = true;
-        //considering only odd integers. An odd number n corresponds to n-start/2 in the array.
-        for (unsigned index = 1; index < _primes.size() &&
-            _primes[index] * _primes[index] <= finish; ++index) {
-            unsigned n = _primes[index];
-            unsigned multiple = (start / n + 1) * n;
-            if (multiple % 2 == 0)
-                multiple += n;
-            if (multiple > finish)
-                continue;
-            std::slice sl = std::slice((multiple-start)/ 2, 1 + (finish - multiple) / (2 * n), n);
-            //starting from n*n, all the odd multiples of n are marked not prime. 
-            is_prime[sl] = false;
+    for (unsigned long long i = 0; i < size; i++) {
+        unsigned byte = seg[i];
+        while (byte != 0) {
+            unsigned long long n = 30 * (lo + i) +
+                wheel_residues[__builtin_ctz(byte)];
+            byte &= byte - 1;
+            if (n >= first && n <= last)
+                out.push_back(n);
         }
-        for (unsigned n = start + 1; n <= finish; n += 2) {
-            if (is_prime[(n - start) / 2])
-                _primes.push_back(n);
+    }
+}
+
+// Appends the primes in `[first, last]` (`first >= 7`) to `out`, given
+// all the primes up to `sqrt(last)` in `small`. The range is sieved in
+// segments of `segment` bytes, split between `threads` threads.
+void sieve_range(const std::vector<unsigned> &small, unsigned first,
+        unsigned last, unsigned segment, unsigned threads,
+        std::vector<unsigned> &out)
+{
+    std::vector<WheelPrime> wheel_primes;
+    for (unsigned p : small) {
+        if (p < 7) continue;
+        if ((unsigned long long)p * p > last) break;
+        WheelPrime wp;
+        wp.p = p;
+        for (unsigned w = 0; w < 8; w++) {
+            unsigned long long r = (unsigned long long)p * wheel_residues[w];
+            wp.offset[w] = r / 30;
+            wp.mask[w] = wheel_bit[r % 30];
         }
+        wheel_primes.push_back(wp);
     }
+    unsigned long long lo = first / 30, hi = last / 30 + 1;
+    unsigned long long segments = (hi - lo + segment - 1) / segment;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::max(1ULL, std::min<unsigned long long>(threads,
+        segments / 4));
+    // thread `t` sieves the segments `[t*segments/threads,
+    // (t+1)*segments/threads)` into its own vector
+    std::vector<std::vector<unsigned>> found(threads);
+    auto work = [&](unsigned t) {
+        std::vector<unsigned char> bits;
+        std::vector<unsigned> &v = (t == 0) ? out : found[t];
+        for (unsigned long long s = t * segments / threads;
+                s < (t + 1) * segments / threads; s++)
+            sieve_bytes(wheel_primes, lo + s * segment,
+                std::min(lo + (s + 1) * segment, hi), first, last, bits, v);
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(work, t);
+    work(0);
+    for (std::thread &w : workers)
+        w.join();
+    for (unsigned t = 1; t < threads; t++)
+        out.insert(out.end(), found[t].begin(), found[t].end());
+}
+
+} // anonymous namespace
+#endif
+
+namespace {
+
+// Appends the primes in `[first, last]` (`first >= 7`) to `out`, given all
+// the primes up to `sqrt(last)` in `small`
+void append_primes(const std::vector<unsigned> &small, unsigned first,
+        unsigned last, unsigned segment, unsigned threads,
+        std::vector<unsigned> &out)
+{
+    if (first > last) return;
+#ifdef HAVE_CSYMPY_PRIMESIEVE
+    primesieve::generate_primes(first, last, &out);
+#else
+    sieve_range(small, first, last, segment, threads, out);
 #endif
 }
 
-void Sieve::generate_primes(std::vector<unsigned> &primes, unsigned limit)
+// Extends `primes` (all primes up to its last one) past `limit`: sieving
+// a bit further than `limit` (prime gaps below 2^32 are less than 512)
+// ends the vector with a prime larger than `limit`, so that it is known to
+// hold all primes up to `limit` without storing how far it was sieved.
+void extend_primes(std::vector<unsigned> &primes, unsigned limit,
+        unsigned segment, unsigned threads)
 {
-    _extend(limit);
-    std::vector<unsigned>::iterator it = std::upper_bound (_primes.begin(), _primes.end(), limit);
-    //find the first position greater than limit and reserve space for the primes
-    primes.reserve(it - _primes.begin());
-    std::copy(_primes.begin(), it, std::back_inserter(primes));
-    if (_clear)
-        clear();
+    if (primes.back() >= limit) return;
+    unsigned last = std::min<unsigned long long>(limit + 512ULL,
+        std::numeric_limits<unsigned>::max());
+    const unsigned sqrt_last = static_cast<unsigned>(std::sqrt(last));
+    extend_primes(primes, sqrt_last, segment, threads);
+    std::vector<unsigned> small(primes.begin(), std::upper_bound(
+        primes.begin(), primes.end(), sqrt_last));
+    append_primes(small, primes.back() + 1, last, segment, threads, primes);
 }
 
-Sieve::iterator::iterator(unsigned max)
+} // anonymous namespace
+
+Sieve::Primes Sieve::_extend(unsigned limit)
 {
-    _limit = max;
-    _index = 0;
+    limit = std::min(limit, _cache_limit.load());
+    Primes primes = std::atomic_load(&_primes);
+    if (primes->back() >= limit)
+        return primes;
+    std::lock_guard<std::mutex> lock(_mutex);
+    primes = std::atomic_load(&_primes);
+    if (primes->back() >= limit)
+        return primes;
+    auto extended = std::make_shared<std::vector<unsigned>>(*primes);
+    extend_primes(*extended, limit, _sieve_size / 8, _threads);
+    primes = extended;
+    std::atomic_store(&_primes, primes);
+    return primes;
 }
 
-Sieve::iterator::iterator()
+void Sieve::generate_primes(std::vector<unsigned> &primes, unsigned limit)
 {
-    _limit = 0;
-    _index = 0;
+    // With `_clear`, only the primes needed to sieve up to `limit` are stored
+    Primes cache = _extend(_clear ?
+        static_cast<unsigned>(std::sqrt(limit)) : limit);
+    if (cache->back() >= limit) {
+        std::vector<unsigned>::const_iterator it =
+            std::upper_bound(cache->begin(), cache->end(), limit);
+        primes.insert(primes.end(), cache->begin(), it);
+        return;
+    }
+    primes.reserve(limit / (std::log(limit) - 1.1) + 10);
+    primes.insert(primes.end(), cache->begin(), cache->end());
+    append_primes(*cache, cache->back() + 1, limit, _sieve_size / 8,
+        _threads, primes);
 }
 
-Sieve::iterator::~iterator()
+Sieve::iterator::iterator(unsigned max)
+    : _index(0), _limit(max), _in_cache(true)
+{
+    unsigned top = (max == 0) ? std::numeric_limits<unsigned>::max() : max;
+    _cache = _extend(static_cast<unsigned>(std::sqrt(top)));
+    _next = _cache->back() + 1;
+}
+
+Sieve::iterator::iterator()
+    : iterator(0)
 {
-    if (_clear)
-        Sieve::clear();
 }
 
 unsigned Sieve::iterator::next_prime()
 {
-    if (_index >= _primes.size()) {
-        unsigned extend_to = _primes[_index - 1] * 2;
-        if (_limit > 0 && _limit < extend_to) {
-            extend_to = _limit;
+    unsigned top = (_limit == 0) ? std::numeric_limits<unsigned>::max()
+        : _limit;
+    if (_in_cache) {
+        if (_index < _cache->size()) {
+            unsigned p = (*_cache)[_index++];
+            return (p <= top) ? p : _limit + 1;
         }
-        _extend(extend_to);
-        if (_index >= _primes.size()) {     //the next prime is greater than _limit
+        _in_cache = false;
+    }
+    while (_index >= _segment.size()) {
+        if (_next == 0 || _next > top)     //the next prime is greater than _limit
             return _limit + 1;
-        }
+        unsigned last = std::min<unsigned long long>(
+            _next + 30ULL * (_sieve_size / 8) - 1, top);
+        _segment.clear();
+        _index = 0;
+        append_primes(*_cache, _next, last, _sieve_size / 8, 1, _segment);
+        _next = (last == top) ? 0 : last + 1;
     }
-    return CSymPy::Sieve::_primes[_index++];
+    return _segment[_index++];
 }
 
 RCP<const Number> bernoulli(unsigned long n)
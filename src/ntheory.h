@@ -7,6 +7,10 @@
 #ifndef CSYMPY_NTHEORY_H
 #define CSYMPY_NTHEORY_H
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 #include "integer.h"
 
 namespace CSymPy {
@@ -88,16 +92,29 @@ void prime_factors(std::vector<RCP<const Integer>> &primes, const Integer &n);
 void prime_factor_multiplicities(map_integer_uint &primes, const Integer &n);
 // Sieve class stores all the primes upto a limit. When a prime or a list of prime
 // is requested, if the prime is not there in the sieve, it is extended to hold that
-// prime. The implementation is a very basic Eratosthenes sieve, but the code should
-// be quite optimized. For limit=1e8, it is about 20x slower than the
-// `primesieve` library (1206ms vs 55.63ms).
+// prime. The implementation is a segmented Eratosthenes sieve on a mod 30 wheel:
+// each byte of a segment holds the 8 numbers coprime to 30 of an interval of 30,
+// the segments (of `set_sieve_size()` kilobytes) are split between threads.
+// `generate_primes()` sieves directly into its result when the sieve is cleared
+// afterwards. For limit=1e8, it takes about 60ms on one thread.
+//
+// The stored primes are an immutable vector shared by all readers: extending it
+// builds a new vector under a lock and publishes it, readers keep the vector they
+// started with. All functions can be called concurrently. The stored primes never
+// go past `set_cache_limit()`, primes beyond it are sieved for each request.
 class Sieve {
 
 private:
-    static std::vector<unsigned> _primes;
-    static void _extend(unsigned limit);
-    static unsigned _sieve_size;
-    static bool _clear;
+    typedef std::shared_ptr<const std::vector<unsigned>> Primes;
+    static Primes _primes;
+    static std::mutex _mutex;
+    //! \return the stored primes, extended to hold all primes up to
+    //! `limit` (or the cache limit, if lower)
+    static Primes _extend(unsigned limit);
+    static std::atomic<unsigned> _sieve_size;
+    static std::atomic<unsigned> _threads;
+    static std::atomic<unsigned> _cache_limit;
+    static std::atomic<bool> _clear;
 
 public:
     // Returns all primes up to the `limit` (including). The vector `primes` should
@@ -109,23 +126,35 @@ public:
     //Set the sieve size in kilobytes. Set it to L1d cache size for best performance.
     //Default value is 32.
     static void set_sieve_size(unsigned size);
+    //Set the number of threads sieving large ranges (0, the default, for the
+    //number of hardware threads). Ignored with primesieve.
+    static void set_num_threads(unsigned threads);
     //Set whether the sieve is cleared after the sieve is extended in internal functions
     static void set_clear(bool clear);
+    //Set the largest number up to which primes are stored (at least 2^16).
+    //Default value is 2^24 (about a million primes).
+    static void set_cache_limit(unsigned limit);
 
+    // Iterators generate the primes beyond the stored ones segment by segment,
+    // with memory for the primes up to sqrt(limit) and one segment. An iterator
+    // must only be used by one thread.
     class iterator {
 
     private:
+        Primes _cache;
+        std::vector<unsigned> _segment;
         unsigned _index;
         unsigned _limit;
+        // first number of the next segment (0 after the last one)
+        unsigned _next;
+        bool _in_cache;
 
     public:
         //Iterator that generates primes upto limit
         iterator(unsigned limit);
         //Iterator that generates primes with no limit.
         iterator();
-        //Destructor
-        ~iterator();
-        //Next prime
+        //Next prime, `limit + 1` after the last one
         unsigned next_prime();
     };
 };
@@ -39,6 +39,7 @@ public:
     virtual RCP<const Basic> diff(const RCP<const Symbol> &x) const;
 
     virtual vec_basic get_args() const { return {}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return true; }
 };
 //! Add `self` and `other`
 inline RCP<const Number> addnum(const RCP<const Number> &self,
@@ -0,0 +1,866 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
+#include "polynomial.h"
+#include "symbol.h"
+#include "add.h"
+#include "mul.h"
+#include "pow.h"
+#include "integer.h"
+#include "constants.h"
+#include "rings.h"
+#include "monomials.h"
+
+namespace CSymPy {
+
+namespace {
+
+// Lexicographic comparison of the monomials `a` and `b` with `n` variables
+inline int monomial_cmp(const int *a, const int *b, unsigned n)
+{
+    for (unsigned j = 0; j < n; j++) {
+        if (a[j] != b[j]) return a[j] < b[j] ? -1 : 1;
+    }
+    return 0;
+}
+
+// Sorts the terms by decreasing monomials
+void sort_terms(unsigned n, vec_int &exps, std::vector<mpz_class> &coefs)
+{
+    std::size_t len = coefs.size();
+    std::vector<std::size_t> perm(len);
+    for (std::size_t i = 0; i < len; i++) perm[i] = i;
+    std::sort(perm.begin(), perm.end(),
+        [&](std::size_t x, std::size_t y) {
+            return monomial_cmp(&exps[x*n], &exps[y*n], n) > 0;
+        });
+    vec_int e(exps.size());
+    std::vector<mpz_class> c(len);
+    for (std::size_t i = 0; i < len; i++) {
+        std::copy(exps.begin() + perm[i]*n, exps.begin() + (perm[i]+1)*n,
+                e.begin() + i*n);
+        c[i].swap(coefs[perm[i]]);
+    }
+    exps.swap(e);
+    coefs.swap(c);
+}
+
+// Creates the Polynomial from a dictionary of terms, dropping zero terms
+RCP<const Polynomial> from_umap(const vec_basic &vars, umap_vec_mpz &P)
+{
+    unsigned n = vars.size();
+    vec_int exps;
+    std::vector<mpz_class> coefs;
+    exps.reserve(n*P.size());
+    coefs.reserve(P.size());
+    for (auto &p: P) {
+        if (p.second == 0) continue;
+        exps.insert(exps.end(), p.first.begin(), p.first.end());
+        coefs.push_back(std::move(p.second));
+    }
+    sort_terms(n, exps, coefs);
+    return rcp(new Polynomial(vars, std::move(exps), std::move(coefs)));
+}
+
+// Adds two sorted lists of terms
+void add_terms(unsigned n, const vec_int &ea, const std::vector<mpz_class> &ca,
+        const vec_int &eb, const std::vector<mpz_class> &cb,
+        vec_int &ec, std::vector<mpz_class> &cc)
+{
+    std::size_t i = 0, k = 0;
+    ec.reserve(ea.size() + eb.size());
+    cc.reserve(ca.size() + cb.size());
+    while (i < ca.size() || k < cb.size()) {
+        int c;
+        if (i == ca.size()) c = -1;
+        else if (k == cb.size()) c = 1;
+        else c = monomial_cmp(&ea[i*n], &eb[k*n], n);
+        if (c > 0) {
+            ec.insert(ec.end(), ea.begin() + i*n, ea.begin() + (i+1)*n);
+            cc.push_back(ca[i]);
+            i++;
+        } else if (c < 0) {
+            ec.insert(ec.end(), eb.begin() + k*n, eb.begin() + (k+1)*n);
+            cc.push_back(cb[k]);
+            k++;
+        } else {
+            mpz_class s = ca[i] + cb[k];
+            if (s != 0) {
+                ec.insert(ec.end(), ea.begin() + i*n, ea.begin() + (i+1)*n);
+                cc.push_back(std::move(s));
+            }
+            i++;
+            k++;
+        }
+    }
+}
+
+// Rough estimate of the memory taken by one term with `n` variables: the
+// exponents and the coefficient, in the result and in the packed working copy
+std::size_t term_bytes(unsigned n)
+{
+    return n * sizeof(int) + 2 * (sizeof(mpz_class) + 16) +
+        sizeof(vec_ull_mpz::value_type);
+}
+
+// Multiplies two sorted lists of terms. The exponents are packed into a
+// single word if the degrees allow it, otherwise the (slower) vec_int
+// polynomials are used.
+void mul_terms(unsigned n, const vec_int &ea, const std::vector<mpz_class> &ca,
+        const vec_int &eb, const std::vector<mpz_class> &cb,
+        vec_int &ec, std::vector<mpz_class> &cc)
+{
+    if (ca.size() == 0 || cb.size() == 0) return;
+    vec_int deg_a(n, 0), deg_b(n, 0);
+    int total_a = 0, total_b = 0;
+    for (std::size_t i = 0; i < ca.size(); i++) {
+        int total = 0;
+        for (unsigned j = 0; j < n; j++) {
+            deg_a[j] = std::max(deg_a[j], ea[i*n + j]);
+            total += ea[i*n + j];
+        }
+        total_a = std::max(total_a, total);
+    }
+    for (std::size_t i = 0; i < cb.size(); i++) {
+        int total = 0;
+        for (unsigned j = 0; j < n; j++) {
+            deg_b[j] = std::max(deg_b[j], eb[i*n + j]);
+            total += eb[i*n + j];
+        }
+        total_b = std::max(total_b, total);
+    }
+    unsigned max_degree = 0;
+    for (unsigned j = 0; j < n; j++)
+        max_degree = std::max(max_degree, (unsigned)(deg_a[j] + deg_b[j]));
+    // Upper bound on the number of terms of the product: the products of
+    // pairs of terms that fit into the box of the partial degrees and into
+    // the simplex of the total degree
+    double box = 1, simplex = 1;
+    for (unsigned j = 0; j < n; j++) {
+        box *= deg_a[j] + deg_b[j] + 1;
+        simplex *= (double)(total_a + total_b + j + 1) / (j + 1);
+    }
+    double terms = std::min((double)ca.size() * cb.size(),
+        std::min(box, simplex));
+    expand_check_size(terms, terms * term_bytes(n));
+
+    if (MonomialPacking::fits(n, max_degree)) {
+        MonomialPacking packing(n, max_degree);
+        vec_int exp(n);
+        // The terms are sorted lexicographically with the first variable
+        // most significant, which is the order of the packed monomials
+        auto pack = [&](const vec_int &e, const std::vector<mpz_class> &c,
+                vec_ull_mpz &P) {
+            P.reserve(c.size());
+            for (std::size_t i = 0; i < c.size(); i++) {
+                std::copy(e.begin() + i*n, e.begin() + (i+1)*n, exp.begin());
+                P.push_back(std::make_pair(packing.pack(exp), c[i]));
+            }
+        };
+        vec_ull_mpz A, B, C;
+        pack(ea, ca, A);
+        pack(eb, cb, B);
+        poly_mul(A, B, C, packing);
+        ec.reserve(n*C.size());
+        cc.reserve(C.size());
+        for (auto &p: C) {
+            packing.unpack(p.first, exp);
+            ec.insert(ec.end(), exp.begin(), exp.end());
+            cc.push_back(std::move(p.second));
+        }
+    } else {
+        auto to_umap = [&](const vec_int &e, const std::vector<mpz_class> &c,
+                umap_vec_mpz &P) {
+            for (std::size_t i = 0; i < c.size(); i++)
+                P[vec_int(e.begin() + i*n, e.begin() + (i+1)*n)] = c[i];
+        };
+        umap_vec_mpz A, B, C;
+        to_umap(ea, ca, A);
+        to_umap(eb, cb, B);
+        poly_mul(A, B, C);
+        for (auto &p: C) {
+            if (p.second == 0) continue;
+            ec.insert(ec.end(), p.first.begin(), p.first.end());
+            cc.push_back(std::move(p.second));
+        }
+        sort_terms(n, ec, cc);
+    }
+}
+
+// Divides the sorted list of terms `a` by `b` (not zero) into the sorted
+// quotient `q`, leading term by leading term. The remainder is kept in a map
+// sorted by decreasing monomials of type `Key`: `ops.key(e)` makes one from
+// exponents, `ops.unpack()` is its inverse and `ops.add()` multiplies two
+// monomials. Returns false if `b` does not divide `a`.
+template <class Key, class Ops>
+bool divexact_terms(unsigned n, const vec_int &ea,
+        const std::vector<mpz_class> &ca, const vec_int &eb,
+        const std::vector<mpz_class> &cb, const vec_int &deg_q,
+        vec_int &eq, std::vector<mpz_class> &cq, const Ops &ops)
+{
+    std::map<Key, mpz_class, std::greater<Key>> r;
+    for (std::size_t i = 0; i < ca.size(); i++)
+        r[ops.key(ea.data() + i*n)] = ca[i];
+    std::vector<Key> kb;
+    for (std::size_t k = 0; k < cb.size(); k++)
+        kb.push_back(ops.key(eb.data() + k*n));
+    vec_int e(n);
+    mpz_class c;
+    while (!r.empty()) {
+        // The leading term of the remainder divided by that of `b` is the
+        // next term of `q`, its exponents are at most those of `deg_q`
+        auto it = r.begin();
+        ops.unpack(it->first, e);
+        for (unsigned j = 0; j < n; j++) {
+            e[j] -= eb[j];
+            if (e[j] < 0 || e[j] > deg_q[j]) return false;
+        }
+        if (!mpz_divisible_p(it->second.get_mpz_t(), cb[0].get_mpz_t()))
+            return false;
+        mpz_divexact(c.get_mpz_t(), it->second.get_mpz_t(),
+            cb[0].get_mpz_t());
+        r.erase(it);
+        Key kq = ops.key(e.data());
+        for (std::size_t k = 1; k < cb.size(); k++) {
+            auto t = r.insert(std::make_pair(ops.add(kq, kb[k]),
+                mpz_class(0))).first;
+            mpz_submul(t->second.get_mpz_t(), c.get_mpz_t(),
+                cb[k].get_mpz_t());
+            if (t->second == 0) r.erase(t);
+        }
+        eq.insert(eq.end(), e.begin(), e.end());
+        cq.push_back(c);
+    }
+    return true;
+}
+
+// Keys of divexact_terms(): monomials packed into words
+struct PackedKeys {
+    const MonomialPacking &packing;
+    mutable vec_int exp;
+
+    unsigned long long key(const int *e) const {
+        std::copy(e, e + packing.n_, exp.begin());
+        return packing.pack(exp);
+    }
+    void unpack(unsigned long long m, vec_int &e) const {
+        packing.unpack(m, e);
+    }
+    unsigned long long add(unsigned long long a, unsigned long long b) const {
+        return a + b;
+    }
+};
+
+// Keys of divexact_terms(): the exponents, when they do not fit into a word
+struct VectorKeys {
+    unsigned n;
+
+    vec_int key(const int *e) const {
+        return vec_int(e, e + n);
+    }
+    void unpack(const vec_int &m, vec_int &e) const {
+        e = m;
+    }
+    vec_int add(const vec_int &a, const vec_int &b) const {
+        vec_int c(n);
+        for (unsigned j = 0; j < n; j++) c[j] = a[j] + b[j];
+        return c;
+    }
+};
+
+// Divides two sorted lists of terms, see divexact_terms()
+bool divexact_terms(unsigned n, const vec_int &ea,
+        const std::vector<mpz_class> &ca, const vec_int &eb,
+        const std::vector<mpz_class> &cb, vec_int &eq,
+        std::vector<mpz_class> &cq)
+{
+    if (ca.size() == 0) return true;
+    // The degrees of `q` are those of `a` minus those of `b`, and all
+    // monomials of the remainder are at most those of `a`
+    vec_int deg_a(n, 0), deg_q(n, 0);
+    for (std::size_t i = 0; i < ca.size(); i++)
+        for (unsigned j = 0; j < n; j++)
+            deg_a[j] = std::max(deg_a[j], ea[i*n + j]);
+    unsigned max_degree = 0;
+    for (unsigned j = 0; j < n; j++) {
+        int deg_b = 0;
+        for (std::size_t k = 0; k < cb.size(); k++)
+            deg_b = std::max(deg_b, eb[k*n + j]);
+        if (deg_b > deg_a[j]) return false;
+        deg_q[j] = deg_a[j] - deg_b;
+        max_degree = std::max(max_degree, (unsigned)deg_a[j]);
+    }
+    if (MonomialPacking::fits(n, max_degree)) {
+        MonomialPacking packing(n, max_degree);
+        return divexact_terms<unsigned long long>(n, ea, ca, eb, cb, deg_q,
+            eq, cq, PackedKeys{packing, vec_int(n)});
+    }
+    return divexact_terms<vec_int>(n, ea, ca, eb, cb, deg_q, eq, cq,
+        VectorKeys{n});
+}
+
+// Exponents of `a` rewritten for the generators `vars`, which must contain
+// all generators of `a`. The terms are sorted again.
+void remap_terms(const Polynomial &a, const vec_basic &vars,
+        vec_int &exps, std::vector<mpz_class> &coefs)
+{
+    unsigned na = a.get_vars().size();
+    unsigned n = vars.size();
+    std::vector<unsigned> pos(na);
+    for (unsigned j = 0; j < na; j++) {
+        for (unsigned k = 0; k < n; k++) {
+            if (eq(a.get_vars()[j], vars[k])) {
+                pos[j] = k;
+                break;
+            }
+        }
+    }
+    exps.assign(n*a.size(), 0);
+    const vec_int &ea = a.get_exps();
+    for (std::size_t i = 0; i < a.size(); i++)
+        for (unsigned j = 0; j < na; j++)
+            exps[i*n + pos[j]] = ea[i*na + j];
+    coefs = a.get_coefs();
+    sort_terms(n, exps, coefs);
+}
+
+// Calls `f(vars, ea, ca, eb, cb)` with the terms of `a` and `b` written in
+// common generators: those of `a`, followed by the new ones from `b`.
+template<class F>
+RCP<const Polynomial> with_common_vars(const Polynomial &a,
+        const Polynomial &b, F f)
+{
+    if (vec_basic_eq(a.get_vars(), b.get_vars()))
+        return f(a.get_vars(), a.get_exps(), a.get_coefs(),
+                b.get_exps(), b.get_coefs());
+    vec_basic vars = a.get_vars();
+    for (auto &x: b.get_vars()) {
+        bool found = false;
+        for (auto &y: a.get_vars()) {
+            if (eq(x, y)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) vars.push_back(x);
+    }
+    vec_int ea, eb;
+    std::vector<mpz_class> ca, cb;
+    // New variables are appended (least significant), so the terms of `a`
+    // stay sorted; `remap_terms()` sorts them anyway.
+    remap_terms(a, vars, ea, ca);
+    remap_terms(b, vars, eb, cb);
+    return f(vars, ea, ca, eb, cb);
+}
+
+// Converts expressions into Polynomials with the given generators
+class PolynomialConverter {
+private:
+    const vec_basic &vars_;
+    std::unordered_map<RCP<const Basic>, unsigned, RCPBasicHash,
+        RCPBasicKeyEq> index_;
+
+    unsigned index(const RCP<const Basic> &x) const {
+        auto it = index_.find(x);
+        if (it == index_.end())
+            throw std::runtime_error("polynomial: symbol " + x->__str__() +
+                    " is not one of the generators");
+        return it->second;
+    }
+
+    RCP<const Polynomial> constant(const mpz_class &c) const {
+        vec_int exps;
+        std::vector<mpz_class> coefs;
+        if (c != 0) {
+            exps.assign(vars_.size(), 0);
+            coefs.push_back(c);
+        }
+        return rcp(new Polynomial(vars_, std::move(exps), std::move(coefs)));
+    }
+
+    static int as_exponent(const RCP<const Basic> &e) {
+        if (!is_a<Integer>(*e) ||
+                rcp_static_cast<const Integer>(e)->is_negative())
+            throw std::runtime_error("polynomial: exponents must be non-negative integers");
+        return rcp_static_cast<const Integer>(e)->as_int();
+    }
+
+public:
+    PolynomialConverter(const vec_basic &vars) : vars_(vars) {
+        for (unsigned j = 0; j < vars.size(); j++) {
+            if (!is_a<Symbol>(*vars[j]))
+                throw std::runtime_error("polynomial: generators must be symbols");
+            index_[vars[j]] = j;
+        }
+    }
+
+    // Adds the exponents of `p` to `exp` if `p` is a monomial (a Symbol,
+    // a power of a Symbol or their product), otherwise returns false
+    bool monomial(const RCP<const Basic> &p, vec_int &exp) const {
+        if (is_a<Symbol>(*p)) {
+            exp[index(p)] += 1;
+            return true;
+        } else if (is_a<Pow>(*p)) {
+            const Pow &q = static_cast<const Pow &>(*p);
+            if (!is_a<Symbol>(*q.base_)) return false;
+            exp[index(q.base_)] += as_exponent(q.exp_);
+            return true;
+        } else if (is_a<Mul>(*p)) {
+            const Mul &q = static_cast<const Mul &>(*p);
+            if (!q.coef_->is_one()) return false;
+            for (auto &r: q.dict_)
+                if (!is_a<Symbol>(*r.first)) return false;
+            for (auto &r: q.dict_)
+                exp[index(r.first)] += as_exponent(r.second);
+            return true;
+        }
+        return false;
+    }
+
+    RCP<const Polynomial> convert(const RCP<const Basic> &p) const {
+        unsigned n = vars_.size();
+        if (is_a<Integer>(*p))
+            return constant(rcp_static_cast<const Integer>(p)->as_mpz());
+        vec_int exp(n, 0);
+        if (monomial(p, exp)) {
+            std::vector<mpz_class> coefs = {1};
+            return rcp(new Polynomial(vars_, std::move(exp), std::move(coefs)));
+        }
+        if (is_a<Pow>(*p)) {
+            const Pow &q = static_cast<const Pow &>(*p);
+            return polynomial_pow(*convert(q.base_), as_exponent(q.exp_));
+        } else if (is_a<Mul>(*p)) {
+            const Mul &q = static_cast<const Mul &>(*p);
+            if (!is_a<Integer>(*q.coef_))
+                throw std::runtime_error("polynomial: coefficients must be integers");
+            // The Symbol factors form one monomial, the rest is multiplied
+            for (auto &r: q.dict_)
+                if (is_a<Symbol>(*r.first))
+                    exp[index(r.first)] += as_exponent(r.second);
+            std::vector<mpz_class> coefs = {
+                rcp_static_cast<const Integer>(q.coef_)->as_mpz()};
+            // The factors are multiplied in the order of increasing number
+            // of terms, see mul_expand()
+            std::vector<RCP<const Polynomial>> factors;
+            factors.push_back(rcp(new Polynomial(vars_, std::move(exp),
+                std::move(coefs))));
+            for (auto &r: q.dict_)
+                if (!is_a<Symbol>(*r.first))
+                    factors.push_back(polynomial_pow(*convert(r.first),
+                        as_exponent(r.second)));
+            std::stable_sort(factors.begin(), factors.end(),
+                [](const RCP<const Polynomial> &a,
+                        const RCP<const Polynomial> &b) {
+                    return a->size() < b->size();
+                });
+            RCP<const Polynomial> result = factors[0];
+            for (std::size_t i = 1; i < factors.size(); i++)
+                result = polynomial_mul(*result, *factors[i]);
+            return result;
+        } else if (is_a<Add>(*p)) {
+            const Add &q = static_cast<const Add &>(*p);
+            if (!is_a<Integer>(*q.coef_))
+                throw std::runtime_error("polynomial: coefficients must be integers");
+            umap_vec_mpz P;
+            if (!q.coef_->is_zero())
+                P[vec_int(n, 0)] = rcp_static_cast<const Integer>(q.coef_)->as_mpz();
+            for (auto &r: q.dict_) {
+                if (!is_a<Integer>(*r.second))
+                    throw std::runtime_error("polynomial: coefficients must be integers");
+                const mpz_class &c =
+                    rcp_static_cast<const Integer>(r.second)->i;
+                std::fill(exp.begin(), exp.end(), 0);
+                if (monomial(r.first, exp)) {
+                    P[exp] += c;
+                } else {
+                    RCP<const Polynomial> t = convert(r.first);
+                    for (std::size_t i = 0; i < t->size(); i++) {
+                        auto e = t->get_exps().begin() + i*n;
+                        mpz_addmul(P[vec_int(e, e + n)].get_mpz_t(),
+                            c.get_mpz_t(), t->get_coefs()[i].get_mpz_t());
+                    }
+                }
+            }
+            return from_umap(vars_, P);
+        }
+        throw std::runtime_error("polynomial: " + p->__str__() +
+                " is not a polynomial");
+    }
+};
+
+void collect_symbols(const Basic &p,
+        std::set<RCP<const Basic>, RCPBasicKeyLess> &s)
+{
+    if (is_a<Symbol>(p)) {
+        s.insert(rcp(&p));
+    } else if (is_a<Add>(p)) {
+        for (auto &q: static_cast<const Add &>(p).dict_)
+            collect_symbols(*q.first, s);
+    } else if (is_a<Mul>(p)) {
+        for (auto &q: static_cast<const Mul &>(p).dict_)
+            collect_symbols(*q.first, s);
+    } else if (is_a<Pow>(p)) {
+        collect_symbols(*static_cast<const Pow &>(p).base_, s);
+    }
+}
+
+} // anonymous namespace
+
+Polynomial::Polynomial(const vec_basic &vars, vec_int &&exps,
+        std::vector<mpz_class> &&coefs)
+    : vars_{vars}, exps_{std::move(exps)}, coefs_{std::move(coefs)}
+{
+    CSYMPY_ASSERT(is_canonical(vars_, exps_, coefs_))
+}
+
+bool Polynomial::is_canonical(const vec_basic &vars, const vec_int &exps,
+        const std::vector<mpz_class> &coefs) const
+{
+    unsigned n = vars.size();
+    for (unsigned j = 0; j < n; j++) {
+        if (!is_a<Symbol>(*vars[j])) return false;
+        for (unsigned k = 0; k < j; k++)
+            if (eq(vars[j], vars[k])) return false;
+    }
+    if (exps.size() != n*coefs.size()) return false;
+    for (auto &e: exps)
+        if (e < 0) return false;
+    for (std::size_t i = 0; i < coefs.size(); i++) {
+        if (coefs[i] == 0) return false;
+        // Strictly decreasing monomials
+        if (i > 0 && monomial_cmp(&exps[(i-1)*n], &exps[i*n], n) <= 0)
+            return false;
+    }
+    return true;
+}
+
+std::size_t Polynomial::__hash__() const
+{
+    std::size_t seed = POLYNOMIAL;
+    for (auto &x: vars_)
+        hash_combine<Basic>(seed, *x);
+    for (auto &e: exps_)
+        hash_combine<int>(seed, e);
+    for (auto &c: coefs_)
+        hash_combine<long long int>(seed, c.get_si());
+    return seed;
+}
+
+bool Polynomial::__eq__(const Basic &o) const
+{
+    if (is_a<Polynomial>(o)) {
+        const Polynomial &s = static_cast<const Polynomial &>(o);
+        return vec_basic_eq(vars_, s.vars_) && exps_ == s.exps_ &&
+            coefs_ == s.coefs_;
+    }
+    return false;
+}
+
+int Polynomial::compare(const Basic &o) const
+{
+    CSYMPY_ASSERT(is_a<Polynomial>(o))
+    const Polynomial &s = static_cast<const Polynomial &>(o);
+    int cmp = vec_basic_compare(vars_, s.vars_);
+    if (cmp != 0) return cmp;
+    if (coefs_.size() != s.coefs_.size())
+        return coefs_.size() < s.coefs_.size() ? -1 : 1;
+    if (exps_ != s.exps_)
+        return exps_ < s.exps_ ? -1 : 1;
+    for (std::size_t i = 0; i < coefs_.size(); i++) {
+        cmp = mpz_cmp(coefs_[i].get_mpz_t(), s.coefs_[i].get_mpz_t());
+        if (cmp != 0) return cmp < 0 ? -1 : 1;
+    }
+    return 0;
+}
+
+std::string Polynomial::__str__() const
+{
+    return as_basic()->__str__();
+}
+
+RCP<const Basic> Polynomial::as_basic() const
+{
+    unsigned n = vars_.size();
+    RCP<const Number> coef = zero;
+    umap_basic_num d;
+    d.reserve(coefs_.size());
+    for (std::size_t i = 0; i < coefs_.size(); i++) {
+        map_basic_basic m;
+        for (unsigned j = 0; j < n; j++) {
+            if (exps_[i*n + j] > 0)
+                insert(m, vars_[j], integer(exps_[i*n + j]));
+        }
+        if (m.size() == 0) {
+            coef = integer(coefs_[i]);
+        } else {
+            insert(d, Mul::from_dict(one, std::move(m)), integer(coefs_[i]));
+        }
+    }
+    return Add::from_dict(coef, std::move(d));
+}
+
+mpz_class Polynomial::eval(const std::vector<mpz_class> &values) const
+{
+    unsigned n = vars_.size();
+    if (values.size() != n)
+        throw std::runtime_error("eval: one value per generator is needed");
+    mpz_class r = 0, t, p;
+    for (std::size_t i = 0; i < coefs_.size(); i++) {
+        t = coefs_[i];
+        for (unsigned j = 0; j < n; j++) {
+            if (exps_[i*n + j] == 0) continue;
+            mpz_pow_ui(p.get_mpz_t(), values[j].get_mpz_t(), exps_[i*n + j]);
+            t *= p;
+        }
+        r += t;
+    }
+    return r;
+}
+
+double Polynomial::eval_double(const std::vector<double> &values) const
+{
+    unsigned n = vars_.size();
+    if (values.size() != n)
+        throw std::runtime_error("eval_double: one value per generator is needed");
+    double r = 0;
+    for (std::size_t i = 0; i < coefs_.size(); i++) {
+        double t = coefs_[i].get_d();
+        for (unsigned j = 0; j < n; j++)
+            t *= std::pow(values[j], exps_[i*n + j]);
+        r += t;
+    }
+    return r;
+}
+
+RCP<const Basic> Polynomial::diff(const RCP<const Symbol> &x) const
+{
+    unsigned n = vars_.size();
+    vec_int exps;
+    std::vector<mpz_class> coefs;
+    unsigned j = 0;
+    while (j < n && !eq(vars_[j], x)) j++;
+    if (j < n) {
+        // Decrementing the exponent of one variable keeps the terms (that
+        // don't vanish) sorted
+        for (std::size_t i = 0; i < coefs_.size(); i++) {
+            int e = exps_[i*n + j];
+            if (e == 0) continue;
+            exps.insert(exps.end(), exps_.begin() + i*n,
+                exps_.begin() + (i+1)*n);
+            exps[exps.size() - n + j] = e - 1;
+            coefs.push_back(coefs_[i] * e);
+        }
+    }
+    return rcp(new Polynomial(vars_, std::move(exps), std::move(coefs)));
+}
+
+RCP<const Basic> Polynomial::subs(const map_basic_basic &subs_dict) const
+{
+    RCP<const Polynomial> self = rcp_const_cast<Polynomial>(rcp(this));
+    auto it = subs_dict.find(self);
+    if (it != subs_dict.end())
+        return it->second;
+    return as_basic()->subs(subs_dict);
+}
+
+vec_basic Polynomial::get_args() const
+{
+    return {as_basic()};
+}
+
+bool is_polynomial(const Basic &p)
+{
+    if (is_a<Symbol>(p) || is_a<Integer>(p)) return true;
+    if (is_a<Add>(p)) {
+        const Add &q = static_cast<const Add &>(p);
+        if (!is_a<Integer>(*q.coef_)) return false;
+        for (auto &r: q.dict_)
+            if (!is_a<Integer>(*r.second) || !is_polynomial(*r.first))
+                return false;
+        return true;
+    }
+    if (is_a<Mul>(p)) {
+        const Mul &q = static_cast<const Mul &>(p);
+        if (!is_a<Integer>(*q.coef_)) return false;
+        for (auto &r: q.dict_)
+            if (!is_a<Integer>(*r.second) ||
+                    rcp_static_cast<const Integer>(r.second)->is_negative() ||
+                    !is_polynomial(*r.first))
+                return false;
+        return true;
+    }
+    if (is_a<Pow>(p)) {
+        const Pow &q = static_cast<const Pow &>(p);
+        return is_a<Integer>(*q.exp_) &&
+            !rcp_static_cast<const Integer>(q.exp_)->is_negative() &&
+            is_polynomial(*q.base_);
+    }
+    return false;
+}
+
+RCP<const Polynomial> polynomial(const RCP<const Basic> &p,
+        const vec_basic &vars)
+{
+    if (vars.size() == 0) {
+        std::set<RCP<const Basic>, RCPBasicKeyLess> s;
+        collect_symbols(*p, s);
+        vec_basic v(s.begin(), s.end());
+        return PolynomialConverter(v).convert(p);
+    }
+    return PolynomialConverter(vars).convert(p);
+}
+
+void polynomials(const vec_basic &p, std::vector<RCP<const Polynomial>> &r)
+{
+    std::set<RCP<const Basic>, RCPBasicKeyLess> s;
+    for (auto &q: p)
+        collect_symbols(*q, s);
+    vec_basic v(s.begin(), s.end());
+    PolynomialConverter c(v);
+    r.clear();
+    r.reserve(p.size());
+    for (auto &q: p)
+        r.push_back(c.convert(q));
+}
+
+RCP<const Polynomial> polynomial_add(const Polynomial &a, const Polynomial &b)
+{
+    return with_common_vars(a, b, [](const vec_basic &vars,
+            const vec_int &ea, const std::vector<mpz_class> &ca,
+            const vec_int &eb, const std::vector<mpz_class> &cb) {
+        vec_int ec;
+        std::vector<mpz_class> cc;
+        add_terms(vars.size(), ea, ca, eb, cb, ec, cc);
+        return rcp(new Polynomial(vars, std::move(ec), std::move(cc)));
+    });
+}
+
+RCP<const Polynomial> polynomial_sub(const Polynomial &a, const Polynomial &b)
+{
+    return with_common_vars(a, b, [](const vec_basic &vars,
+            const vec_int &ea, const std::vector<mpz_class> &ca,
+            const vec_int &eb, const std::vector<mpz_class> &cb) {
+        vec_int ec;
+        std::vector<mpz_class> cc, neg_b(cb.size());
+        for (std::size_t k = 0; k < cb.size(); k++)
+            mpz_neg(neg_b[k].get_mpz_t(), cb[k].get_mpz_t());
+        add_terms(vars.size(), ea, ca, eb, neg_b, ec, cc);
+        return rcp(new Polynomial(vars, std::move(ec), std::move(cc)));
+    });
+}
+
+RCP<const Polynomial> polynomial_mul(const Polynomial &a, const Polynomial &b)
+{
+    return with_common_vars(a, b, [](const vec_basic &vars,
+            const vec_int &ea, const std::vector<mpz_class> &ca,
+            const vec_int &eb, const std::vector<mpz_class> &cb) {
+        vec_int ec;
+        std::vector<mpz_class> cc;
+        mul_terms(vars.size(), ea, ca, eb, cb, ec, cc);
+        return rcp(new Polynomial(vars, std::move(ec), std::move(cc)));
+    });
+}
+
+RCP<const Polynomial> polynomial_pow(const Polynomial &a, unsigned n)
+{
+    unsigned nv = a.get_vars().size();
+    std::size_t m = a.size();
+    const vec_int &ea = a.get_exps();
+    const std::vector<mpz_class> &ca = a.get_coefs();
+    if (n == 0 || m <= 1) {
+        // 1, 0 or a single term
+        vec_int exps(nv*std::min(m, (std::size_t)1), 0);
+        std::vector<mpz_class> coefs;
+        if (n == 0) {
+            exps.assign(nv, 0);
+            coefs.push_back(1);
+        } else if (m == 1) {
+            for (unsigned j = 0; j < nv; j++) exps[j] = ea[j] * n;
+            coefs.push_back(0);
+            mpz_pow_ui(coefs[0].get_mpz_t(), ca[0].get_mpz_t(), n);
+        }
+        return rcp(new Polynomial(a.get_vars(), std::move(exps),
+            std::move(coefs)));
+    }
+
+    // Multinomial expansion: (a_1 + ... + a_m)^n is the sum of
+    // multinomial(k) * a_1^k_1 * ... * a_m^k_m over k_1 + ... + k_m = n.
+    double terms = multinomial_coefficients_count(m, n);
+    expand_check_size(terms, terms * term_bytes(nv));
+    // cpow[i][k] = (coefficient of a_i)^k
+    std::vector<std::vector<mpz_class>> cpow(m,
+        std::vector<mpz_class>(n + 1));
+    for (std::size_t i = 0; i < m; i++) {
+        cpow[i][0] = 1;
+        for (unsigned k = 1; k <= n; k++) cpow[i][k] = cpow[i][k-1] * ca[i];
+    }
+    int max_degree = 0;
+    for (auto &e: ea) max_degree = std::max(max_degree, e);
+    vec_int exp(nv);
+    mpz_class c;
+    // Exponents and coefficient of the term given by `k`
+    // The multinomial coefficients are generated one by one
+    MultinomialGenerator g(m, n);
+    auto term = [&]() {
+        const vec_int &k = g.get_exponents();
+        std::fill(exp.begin(), exp.end(), 0);
+        if (g.is_small())
+            c = g.get_coefficient_ui();
+        else
+            c = g.get_coefficient();
+        for (std::size_t i = 0; i < m; i++) {
+            if (k[i] == 0) continue;
+            for (unsigned j = 0; j < nv; j++) exp[j] += k[i] * ea[i*nv + j];
+            c *= cpow[i][k[i]];
+        }
+    };
+    if (MonomialPacking::fits(nv, max_degree * n)) {
+        MonomialPacking packing(nv, max_degree * n);
+        umap_ull_mpz P;
+        P.reserve((std::size_t)terms);
+        do {
+            term();
+            P[packing.pack(exp)] += c;
+        } while (g.next());
+        vec_ull_mpz S;
+        poly_sort(P, S);
+        vec_int exps;
+        std::vector<mpz_class> coefs;
+        exps.reserve(nv*S.size());
+        coefs.reserve(S.size());
+        for (auto &p: S) {
+            if (p.second == 0) continue;
+            packing.unpack(p.first, exp);
+            exps.insert(exps.end(), exp.begin(), exp.end());
+            coefs.push_back(std::move(p.second));
+        }
+        return rcp(new Polynomial(a.get_vars(), std::move(exps),
+            std::move(coefs)));
+    }
+    umap_vec_mpz P;
+    do {
+        term();
+        P[exp] += c;
+    } while (g.next());
+    return from_umap(a.get_vars(), P);
+}
+
+RCP<const Polynomial> polynomial_divexact(const Polynomial &a,
+        const Polynomial &b)
+{
+    if (b.is_zero())
+        throw std::runtime_error("polynomial_divexact: division by zero");
+    return with_common_vars(a, b, [](const vec_basic &vars,
+            const vec_int &ea, const std::vector<mpz_class> &ca,
+            const vec_int &eb, const std::vector<mpz_class> &cb) {
+        vec_int eq;
+        std::vector<mpz_class> cq;
+        if (!divexact_terms(vars.size(), ea, ca, eb, cb, eq, cq))
+            throw std::runtime_error("polynomial_divexact: not divisible");
+        return rcp(new Polynomial(vars, std::move(eq), std::move(cq)));
+    });
+}
+
+} // CSymPy
@@ -0,0 +1,109 @@
+/**
+ *  \file polynomial.h
+ *  Class Polynomial
+ *
+ **/
+#ifndef CSYMPY_POLYNOMIAL_H
+#define CSYMPY_POLYNOMIAL_H
+
+#include "basic.h"
+#include "dict.h"
+
+namespace CSymPy {
+
+/*! Sparse multivariate polynomial with integer coefficients.
+
+    The terms are stored in two flat arrays: the exponents (`vars_.size()`
+    per term, term after term) and the coefficients. Terms are sorted by
+    decreasing monomials in lexicographic order, `vars_[0]` being the most
+    significant variable, and no coefficient is zero.
+
+    The arithmetic (`polynomial_add()`, `polynomial_mul()`,
+    `polynomial_pow()`, `diff()`) works on these arrays directly and never
+    builds the Add/Mul representation, use `as_basic()` to convert back.
+    Multiplication packs the exponents and uses the kernels from rings.h.
+*/
+class Polynomial : public Basic {
+private:
+    //! The generators (Symbols), in the order of the exponents
+    vec_basic vars_;
+    //! Exponents, `vars_.size()` per term
+    vec_int exps_;
+    //! Coefficients, one per term
+    std::vector<mpz_class> coefs_;
+
+public:
+    IMPLEMENT_TYPEID(POLYNOMIAL)
+    //! Polynomial Constructor, the terms must be in canonical form
+    Polynomial(const vec_basic &vars, vec_int &&exps,
+            std::vector<mpz_class> &&coefs);
+    //! \return `true` if canonical
+    bool is_canonical(const vec_basic &vars, const vec_int &exps,
+            const std::vector<mpz_class> &coefs) const;
+    //! \return Size of the hash
+    virtual std::size_t __hash__() const;
+    /*! Equality comparator
+     * \param o - Object to be compared with
+     * \return whether the 2 objects are equal
+     * */
+    virtual bool __eq__(const Basic &o) const;
+    virtual int compare(const Basic &o) const;
+    //! \return stringify version
+    virtual std::string __str__() const;
+    //! Differentiate w.r.t Symbol `x`, the result is a Polynomial
+    virtual RCP<const Basic> diff(const RCP<const Symbol> &x) const;
+    virtual RCP<const Basic> subs(const map_basic_basic &subs_dict) const;
+
+    virtual vec_basic get_args() const;
+
+    virtual void accept(Visitor &v) const;
+
+    //! \return the generators
+    inline const vec_basic &get_vars() const { return vars_; }
+    //! \return the exponents, `get_vars().size()` per term
+    inline const vec_int &get_exps() const { return exps_; }
+    //! \return the coefficients
+    inline const std::vector<mpz_class> &get_coefs() const { return coefs_; }
+    //! \return number of terms
+    inline std::size_t size() const { return coefs_.size(); }
+    //! \return `true` if `0`
+    inline bool is_zero() const { return coefs_.size() == 0; }
+
+    //! Converts to the Add/Mul/Pow representation
+    RCP<const Basic> as_basic() const;
+    //! Evaluates the polynomial at `vars_[j] = values[j]`
+    mpz_class eval(const std::vector<mpz_class> &values) const;
+    //! Evaluates the polynomial at `vars_[j] = values[j]`
+    double eval_double(const std::vector<double> &values) const;
+};
+
+//! \return `true` if `p` is a polynomial with integer coefficients in its
+//! symbols, i.e. if it can be converted by `polynomial()`
+bool is_polynomial(const Basic &p);
+
+//! Converts `p` into a Polynomial in the generators `vars`. If `vars` is
+//! empty, the symbols of `p` (in the order given by `RCPBasicKeyLess`) are
+//! used.
+RCP<const Polynomial> polynomial(const RCP<const Basic> &p,
+        const vec_basic &vars = {});
+
+//! Converts all of `p` into Polynomials in the same generators (the symbols
+//! of all of them, in the order given by `RCPBasicKeyLess`), so that the
+//! arithmetic on them does not have to rewrite their exponents
+void polynomials(const vec_basic &p, std::vector<RCP<const Polynomial>> &r);
+
+//! \return `a + b`
+RCP<const Polynomial> polynomial_add(const Polynomial &a, const Polynomial &b);
+//! \return `a - b`
+RCP<const Polynomial> polynomial_sub(const Polynomial &a, const Polynomial &b);
+//! \return `a * b`
+RCP<const Polynomial> polynomial_mul(const Polynomial &a, const Polynomial &b);
+//! \return `a ^ n`
+RCP<const Polynomial> polynomial_pow(const Polynomial &a, unsigned n);
+//! \return `a / b`. Throws if `b` does not divide `a`.
+RCP<const Polynomial> polynomial_divexact(const Polynomial &a,
+        const Polynomial &b);
+
+} // CSymPy
+
+#endif
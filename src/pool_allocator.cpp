@@ -0,0 +1,116 @@
+#include <mutex>
+
+#include "pool_allocator.h"
+
+namespace CSymPy {
+
+namespace {
+
+const std::size_t pool_classes = pool_max_size / pool_granularity;
+// Each refill from the system carves one chunk of this size into blocks
+const std::size_t pool_chunk_size = 64 * 1024;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+// The per-thread free lists are plain (trivially destructible) thread locals,
+// so that blocks freed during static destruction, after `PoolFlusher` below
+// has run, still have a valid place to go.
+thread_local FreeBlock *local_free[pool_classes];
+
+// Free lists of exited threads. Never destroyed, see `PoolFlusher`.
+struct GlobalPool {
+    std::mutex mutex;
+    FreeBlock *free[pool_classes];
+    GlobalPool() {
+        for (std::size_t c = 0; c < pool_classes; c++) free[c] = nullptr;
+    }
+};
+
+GlobalPool &global_pool()
+{
+    static GlobalPool *pool = new GlobalPool();
+    return *pool;
+}
+
+// Hands the free lists of an exiting thread over to the global pool.
+struct PoolFlusher {
+    bool active;
+    PoolFlusher() : active{true} {}
+    ~PoolFlusher() {
+        GlobalPool &g = global_pool();
+        std::lock_guard<std::mutex> lock(g.mutex);
+        for (std::size_t c = 0; c < pool_classes; c++) {
+            FreeBlock *b = local_free[c];
+            if (b == nullptr) continue;
+            FreeBlock *last = b;
+            while (last->next != nullptr) last = last->next;
+            last->next = g.free[c];
+            g.free[c] = b;
+            local_free[c] = nullptr;
+        }
+    }
+};
+
+thread_local PoolFlusher flusher;
+
+inline std::size_t size_class(std::size_t size)
+{
+    return (size - 1) / pool_granularity;
+}
+
+// Refills the (empty) free list of size class `c` of the calling thread
+void refill(std::size_t c)
+{
+    // Make sure the flusher of this thread is constructed
+    (void)flusher.active;
+    GlobalPool &g = global_pool();
+    {
+        std::lock_guard<std::mutex> lock(g.mutex);
+        if (g.free[c] != nullptr) {
+            local_free[c] = g.free[c];
+            g.free[c] = nullptr;
+            return;
+        }
+    }
+    std::size_t block = (c + 1) * pool_granularity;
+    std::size_t n = pool_chunk_size / block;
+    char *chunk = static_cast<char *>(::operator new(n * block));
+    FreeBlock *head = nullptr;
+    for (std::size_t i = n; i > 0; i--) {
+        FreeBlock *b = reinterpret_cast<FreeBlock *>(chunk + (i-1) * block);
+        b->next = head;
+        head = b;
+    }
+    local_free[c] = head;
+}
+
+} // anonymous namespace
+
+void *pool_allocate(std::size_t size)
+{
+    if (size == 0) size = 1;
+    if (size > pool_max_size) return ::operator new(size);
+    std::size_t c = size_class(size);
+    if (local_free[c] == nullptr) refill(c);
+    FreeBlock *b = local_free[c];
+    local_free[c] = b->next;
+    return b;
+}
+
+void pool_deallocate(void *p, std::size_t size)
+{
+    if (p == nullptr) return;
+    if (size == 0) size = 1;
+    if (size > pool_max_size) {
+        ::operator delete(p);
+        return;
+    }
+    std::size_t c = size_class(size);
+    FreeBlock *b = static_cast<FreeBlock *>(p);
+    b->next = local_free[c];
+    local_free[c] = b;
+}
+
+} // CSymPy
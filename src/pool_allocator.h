@@ -0,0 +1,91 @@
+/**
+ *  \file pool_allocator.h
+ *  Size-class pool allocator for expression nodes and dictionaries
+ *
+ **/
+#ifndef CSYMPY_POOL_ALLOCATOR_H
+#define CSYMPY_POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "csympy_config.h"
+
+namespace CSymPy {
+
+/*  Small blocks (up to `pool_max_size` bytes) are served from per-thread free
+    lists, one for each size class of `pool_granularity` bytes. Free lists are
+    refilled in large chunks, so building an expression with millions of
+    nodes only hits the system allocator a handful of times. Larger requests
+    go straight to `::operator new`.
+
+    Memory freed by a thread goes to that thread's free lists, regardless of
+    which thread allocated it. When a thread exits, its free blocks are handed
+    over to a global list from which other threads refill. Chunks are never
+    returned to the system.
+
+    When CSymPy is configured with WITH_CSYMPY_POOL_ALLOCATOR, all Basic
+    subclasses (through `Basic::operator new`) and the nodes of
+    `umap_basic_num`, `umap_basic_basic`, `map_basic_num` and
+    `map_basic_basic` are allocated from the pool.
+*/
+
+const std::size_t pool_granularity = 16;
+const std::size_t pool_max_size = 256;
+
+//! Allocates `size` bytes from the pool of the calling thread
+void *pool_allocate(std::size_t size);
+//! Returns a block of `size` bytes obtained from `pool_allocate()`
+void pool_deallocate(void *p, std::size_t size);
+
+//! STL allocator that allocates from the pool
+template <class T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    template <class U> struct rebind { typedef PoolAllocator<U> other; };
+
+    PoolAllocator() {}
+    template <class U> PoolAllocator(const PoolAllocator<U> &) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(pool_allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n) {
+        pool_deallocate(p, n * sizeof(T));
+    }
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        ::new((void *)p) U(std::forward<Args>(args)...);
+    }
+    template <class U>
+    void destroy(U* p) {
+        p->~U();
+    }
+    std::size_t max_size() const {
+        return std::size_t(-1) / sizeof(T);
+    }
+};
+
+template <class T, class U>
+inline bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &)
+{
+    return true;
+}
+
+template <class T, class U>
+inline bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &)
+{
+    return false;
+}
+
+} // CSymPy
+
+#endif
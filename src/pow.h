@@ -45,6 +45,7 @@ public:
     virtual RCP<const Basic> subs(const map_basic_basic &subs_dict) const;
 
     virtual vec_basic get_args() const;
+    virtual bool for_each_arg(const ArgCallback &f) const;
 
     virtual void accept(Visitor &v) const;
 };
@@ -57,6 +58,55 @@ RCP<const Basic> pow(const RCP<const Basic> &a,
 RCP<const Basic> exp(const RCP<const Basic> &x);
 
 void multinomial_coefficients(int m, int n, map_vec_int &r);
+void multinomial_coefficients_mpz(int m, int n, map_vec_mpz &r);
+/*! Generates the multinomial coefficients `(m, n)` one at a time, in the
+    same form as `multinomial_coefficients_mpz()`, but without storing them:
+
+        MultinomialGenerator g(m, n);
+        do {
+            // use g.get_exponents() and g.get_coefficient()
+        } while (g.next());
+
+    Going to the next term changes the exponents at no more than three
+    positions, and the coefficient is updated by one multiplication and one
+    exact division. If all the coefficients (and the products in their
+    updates) fit into a word, the arithmetic is done in `unsigned long` and the
+    coefficients can be read directly with `get_coefficient_ui()`.
+*/
+class MultinomialGenerator {
+private:
+    int m_, n_;
+    //! The current exponents
+    vec_int k_;
+    //! rem_[i] = n - k_[0] - ... - k_[i-1], kept up to date for i <= hi_ + 1
+    vec_int rem_;
+    //! The last position before `m-1` with a non-zero exponent, or -1
+    int hi_;
+    bool small_;
+    //! c_ui_[i] (or c_[i]) = multinomial(n; k_[0], ..., k_[i], rem_[i+1]),
+    //! kept up to date for i <= hi_. The coefficient is c_ui_[hi_].
+    std::vector<unsigned long> c_ui_;
+    std::vector<mpz_class> c_;
+public:
+    MultinomialGenerator(int m, int n);
+    //! \return the exponents `k_1, ..., k_m` of the current term
+    inline const vec_int &get_exponents() const { return k_; }
+    //! \return `true` if the coefficients fit into an `unsigned long` (then
+    //! `get_coefficient_ui()` can be used)
+    inline bool is_small() const { return small_; }
+    //! \return the coefficient of the current term, if `is_small()`
+    inline unsigned long get_coefficient_ui() const {
+        return hi_ < 0 ? 1 : c_ui_[hi_];
+    }
+    //! \return the coefficient of the current term
+    mpz_class get_coefficient() const;
+    //! Advances to the next term, returns `false` if there is none
+    bool next();
+};
+
+//! \return the number of multinomial coefficients `(m, n)`, i.e. the number of
+//! terms of `(a_1 + ... + a_m)^n` (as a double, it can be huge)
+double multinomial_coefficients_count(int m, int n);
 //! Expand the power expression
 RCP<const Basic> pow_expand(const RCP<const Pow> &self);
 //! \return square root of `x`
@@ -90,8 +140,11 @@ public:
     //! \return `arg` of `log(arg)`
     inline RCP<const Basic> get_arg() const { return arg_; }
     virtual vec_basic get_args() const { return {arg_}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return f(*arg_); }
     //! Differentiate w.r.t Symbol `x`
     virtual RCP<const Basic> diff(const RCP<const Symbol> &x) const;
+    //! Substitutes `subs_dict` into `self`
+    virtual RCP<const Basic> subs(const map_basic_basic &subs_dict) const;
 
     virtual void accept(Visitor &v) const;
 };
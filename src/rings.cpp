@@ -1,4 +1,7 @@
 #include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <exception>
 
 #include "add.h"
 #include "mul.h"
@@ -9,6 +12,48 @@
 
 namespace CSymPy {
 
+namespace {
+
+// Fills `exp` (already of size `syms.size()` and zeroed) with the exponents
+// of the monomial `term`
+void monomial2exp(const RCP<const Basic> &term, umap_basic_num &syms,
+        vec_int &exp)
+{
+    if (is_a<Mul>(*term)) {
+        const map_basic_basic &d = rcp_static_cast<const Mul>(term)->dict_;
+        for (auto &q: d) {
+            RCP<const Basic> sym = q.first;
+            if (!is_a<Integer>(*syms.at(sym)))
+                    throw std::runtime_error("Not implemented.");
+            int i = rcp_static_cast<const Integer>(syms.at(sym))->as_int();
+            if (is_a<Integer>(*q.second)) {
+                exp[i] = rcp_static_cast<const Integer>(q.second)->as_int();
+            } else {
+                throw std::runtime_error("Cannot convert symbolic exponents to sparse polynomials with integer exponents.");
+            }
+        }
+    } else if (is_a<Pow>(*term)) {
+        RCP<const Basic> sym = rcp_static_cast<const Pow>(term)->base_;
+        RCP<const Basic> exp_ = rcp_static_cast<const Pow>(term)->exp_;
+        if (!is_a<Integer>(*syms.at(sym)))
+                throw std::runtime_error("Not implemented.");
+        int i = rcp_static_cast<const Integer>(syms.at(sym))->as_int();
+        if (!is_a<Integer>(*exp_))
+            throw std::runtime_error("Not implemented.");
+        exp[i] = rcp_static_cast<const Integer>(exp_)->as_int();
+    } else if (is_a<Symbol>(*term)) {
+        RCP<const Basic> sym = term;
+        if (!is_a<Integer>(*syms.at(sym)))
+                throw std::runtime_error("Not implemented.");
+        int i = rcp_static_cast<const Integer>(syms.at(sym))->as_int();
+        exp[i] = 1;
+    } else {
+        throw std::runtime_error("Not implemented.");
+    }
+}
+
+} // anonymous namespace
+
 void expr2poly(const RCP<const Basic> &p, umap_basic_num &syms, umap_vec_mpz &P)
 {
     if (is_a<Add>(*p)) {
@@ -21,38 +66,7 @@ void expr2poly(const RCP<const Basic> &p, umap_basic_num &syms, umap_vec_mpz &P)
                     throw std::runtime_error("Not implemented.");
             coef = rcp_static_cast<const Integer>(p.second)->as_mpz();
             exp.assign(n, 0); // Initialize to [0]*n
-            if (is_a<Mul>(*p.first)) {
-                const map_basic_basic &term = rcp_static_cast<const Mul>(p.first)->dict_;
-                for (auto &q: term) {
-                    RCP<const Basic> sym = q.first;
-                    if (!is_a<Integer>(*syms.at(sym)))
-                            throw std::runtime_error("Not implemented.");
-                    int i = rcp_static_cast<const Integer>(syms.at(sym))->as_int();
-                    if (is_a<Integer>(*q.second)) {
-                        exp[i] = rcp_static_cast<const Integer>(q.second)->as_int();
-                    } else {
-                        throw std::runtime_error("Cannot convert symbolic exponents to sparse polynomials with integer exponents.");
-                    }
-                }
-            } else if (is_a<Pow>(*p.first)) {
-                RCP<const Basic> sym = rcp_static_cast<const Pow>(p.first)->base_;
-                RCP<const Basic> exp_ = rcp_static_cast<const Pow>(p.first)->exp_;
-                if (!is_a<Integer>(*syms.at(sym)))
-                        throw std::runtime_error("Not implemented.");
-                int i = rcp_static_cast<const Integer>(syms.at(sym))->as_int();
-                if (!is_a<Integer>(*exp_))
-                    throw std::runtime_error("Not implemented.");
-                exp[i] = rcp_static_cast<const Integer>(exp_)->as_int();
-            } else if (is_a<Symbol>(*p.first)) {
-                RCP<const Basic> sym = p.first;
-                if (!is_a<Integer>(*syms.at(sym)))
-                        throw std::runtime_error("Not implemented.");
-                int i = rcp_static_cast<const Integer>(syms.at(sym))->as_int();
-                exp[i] = 1;
-            } else {
-                throw std::runtime_error("Not implemented.");
-            }
-
+            monomial2exp(p.first, syms, exp);
             P[exp] = coef;
         }
     } else {
@@ -60,6 +74,31 @@ void expr2poly(const RCP<const Basic> &p, umap_basic_num &syms, umap_vec_mpz &P)
     }
 }
 
+void expr2poly(const RCP<const Basic> &p, umap_basic_num &syms,
+        const MonomialPacking &packing, umap_ull_mpz &P)
+{
+    if (is_a<Add>(*p)) {
+        int n = syms.size();
+        if (n != (int)packing.n_)
+            throw std::runtime_error("expr2poly: packing does not match the number of symbols");
+        const umap_basic_num &d = rcp_static_cast<const Add>(p)->dict_;
+        // The exponent vector is reused, so the conversion does no
+        // allocations per term (besides the coefficients).
+        vec_int exp(n);
+        P.reserve(d.size());
+        for (auto &p: d) {
+            if (!is_a<Integer>(*p.second))
+                    throw std::runtime_error("Not implemented.");
+            std::fill(exp.begin(), exp.end(), 0);
+            monomial2exp(p.first, syms, exp);
+            P[packing.pack(exp)] =
+                rcp_static_cast<const Integer>(p.second)->as_mpz();
+        }
+    } else {
+        throw std::runtime_error("Not implemented.");
+    }
+}
+
 void poly_mul(const umap_vec_mpz &A, const umap_vec_mpz &B, umap_vec_mpz &C)
 {
     vec_int exp;
@@ -91,4 +130,249 @@ void poly_mul(const umap_vec_mpz &A, const umap_vec_mpz &B, umap_vec_mpz &C)
     */
 }
 
+void poly_mul(const umap_ull_mpz &A, const umap_ull_mpz &B, umap_ull_mpz &C,
+        const MonomialPacking &packing)
+{
+    unsigned long long exp;
+    for (auto &a: A) {
+        for (auto &b: B) {
+            exp = monomial_mul(a.first, b.first);
+            if (packing.overflows(exp))
+                throw std::runtime_error("poly_mul: exponent exceeds the degree bound of the packing");
+            mpz_addmul(C[exp].get_mpz_t(), a.second.get_mpz_t(),
+                b.second.get_mpz_t());
+        }
+    }
+}
+
+namespace {
+
+// Runs `f(t)` for t = 0, ..., threads-1, each in its own thread, and
+// rethrows the first exception thrown by any of them
+template<class F>
+void run_in_threads(unsigned threads, F f)
+{
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(threads);
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&, t]() {
+            try {
+                f(t);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        }));
+    }
+    for (auto &w: workers) w.join();
+    for (auto &e: errors)
+        if (e) std::rethrow_exception(e);
+}
+
+} // anonymous namespace
+
+void poly_mul_parallel(const umap_ull_mpz &A, const umap_ull_mpz &B,
+        umap_ull_mpz &C, const MonomialPacking &packing, unsigned threads)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads <= 1 || A.size() < 2) {
+        poly_mul(A, B, C, packing);
+        return;
+    }
+    if (threads > A.size()) threads = A.size();
+
+    std::vector<const umap_ull_mpz::value_type *> rows;
+    rows.reserve(A.size());
+    for (auto &a: A) rows.push_back(&a);
+
+    // partial[t][p]: the products computed by thread `t` whose monomial is in
+    // part `p` of the result
+    std::vector<std::vector<umap_ull_mpz>> partial(threads,
+        std::vector<umap_ull_mpz>(threads));
+    auto part = [threads](unsigned long long m) -> unsigned {
+        // Spread the (very regular) packed monomials over the parts
+        return (unsigned)(((m * 0x9E3779B97F4A7C15ULL) >> 32) % threads);
+    };
+
+    run_in_threads(threads, [&](unsigned t) {
+        std::vector<umap_ull_mpz> &acc = partial[t];
+        unsigned long long exp;
+        // Interleaved rows: every row has the same number of products
+        for (std::size_t i = t; i < rows.size(); i += threads) {
+            const umap_ull_mpz::value_type &a = *rows[i];
+            for (auto &b: B) {
+                exp = monomial_mul(a.first, b.first);
+                if (packing.overflows(exp))
+                    throw std::runtime_error("poly_mul: exponent exceeds the degree bound of the packing");
+                mpz_addmul(acc[part(exp)][exp].get_mpz_t(),
+                    a.second.get_mpz_t(), b.second.get_mpz_t());
+            }
+        }
+    });
+
+    // Part `p` of the result is merged by thread `p` into partial[0][p]
+    run_in_threads(threads, [&](unsigned p) {
+        umap_ull_mpz &r = partial[0][p];
+        for (unsigned t = 1; t < threads; t++) {
+            for (auto &q: partial[t][p]) {
+                auto it = r.find(q.first);
+                if (it == r.end())
+                    r.insert(std::make_pair(q.first, std::move(q.second)));
+                else
+                    it->second += q.second;
+            }
+            umap_ull_mpz().swap(partial[t][p]);
+        }
+    });
+
+    std::size_t n = C.size();
+    for (unsigned p = 0; p < threads; p++) n += partial[0][p].size();
+    C.reserve(n);
+    for (unsigned p = 0; p < threads; p++) {
+        for (auto &q: partial[0][p]) {
+            auto it = C.find(q.first);
+            if (it == C.end())
+                C.insert(std::make_pair(q.first, std::move(q.second)));
+            else
+                it->second += q.second;
+        }
+    }
+}
+
+void poly_sort(const umap_ull_mpz &A, vec_ull_mpz &B)
+{
+    B.clear();
+    B.reserve(A.size());
+    for (auto &a: A) B.push_back(a);
+    std::sort(B.begin(), B.end(),
+        [](const std::pair<unsigned long long, mpz_class> &x,
+           const std::pair<unsigned long long, mpz_class> &y)
+        { return x.first > y.first; });
+}
+
+namespace {
+
+// Heap entry of poly_mul_heap(): the product of the terms A[i] and B[j]
+struct HeapTerm {
+    unsigned long long exp;
+    unsigned i, j;
+};
+
+inline bool operator<(const HeapTerm &x, const HeapTerm &y)
+{
+    return x.exp < y.exp;
+}
+
+} // anonymous namespace
+
+void poly_mul_heap(const vec_ull_mpz &A, const vec_ull_mpz &B, vec_ull_mpz &C,
+        const MonomialPacking &packing)
+{
+    C.clear();
+    if (A.size() == 0 || B.size() == 0) return;
+    // The heap holds at most one entry per term of the first factor, so
+    // make that the shorter one
+    if (A.size() > B.size()) {
+        poly_mul_heap(B, A, C, packing);
+        return;
+    }
+    // Row i (the products A[i]*B[j] for all j) enters the heap only once
+    // A[i-1]*B[0] was taken out, and each row has a single entry in the
+    // heap, which is replaced by its successor A[i]*B[j+1] when it is taken
+    // out. As A and B are sorted, the entries come out in decreasing order.
+    std::vector<HeapTerm> heap;
+    heap.reserve(A.size());
+    mpz_class coef;
+    auto push = [&](unsigned i, unsigned j) {
+        unsigned long long exp = monomial_mul(A[i].first, B[j].first);
+        if (packing.overflows(exp))
+            throw std::runtime_error("poly_mul: exponent exceeds the degree bound of the packing");
+        heap.push_back({exp, i, j});
+        std::push_heap(heap.begin(), heap.end());
+    };
+    push(0, 0);
+    while (heap.size() > 0) {
+        unsigned long long exp = heap.front().exp;
+        coef = 0;
+        while (heap.size() > 0 && heap.front().exp == exp) {
+            HeapTerm t = heap.front();
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
+            mpz_addmul(coef.get_mpz_t(), A[t.i].second.get_mpz_t(),
+                B[t.j].second.get_mpz_t());
+            if (t.j == 0 && t.i + 1 < A.size()) push(t.i + 1, 0);
+            if (t.j + 1 < B.size()) push(t.i, t.j + 1);
+        }
+        if (coef != 0) C.push_back(std::make_pair(exp, coef));
+    }
+}
+
+namespace {
+
+// Upper bound on the number of terms of A*B: the number of monomials that fit
+// both into the box of the partial degrees and the simplex of the total
+// degree of the product.
+double poly_mul_size_bound(const vec_ull_mpz &A, const vec_ull_mpz &B,
+        const MonomialPacking &packing)
+{
+    unsigned n = packing.n_;
+    vec_int exp(n), deg_a(n, 0), deg_b(n, 0);
+    int total_a = 0, total_b = 0;
+    auto degrees = [&](const vec_ull_mpz &P, vec_int &deg, int &total) {
+        for (auto &p: P) {
+            packing.unpack(p.first, exp);
+            int t = 0;
+            for (unsigned i = 0; i < n; i++) {
+                if (exp[i] > deg[i]) deg[i] = exp[i];
+                t += exp[i];
+            }
+            if (t > total) total = t;
+        }
+    };
+    degrees(A, deg_a, total_a);
+    degrees(B, deg_b, total_b);
+    double box = 1, simplex = 1;
+    int total = total_a + total_b;
+    for (unsigned i = 0; i < n; i++) {
+        box *= deg_a[i] + deg_b[i] + 1;
+        // binomial(total + n, n)
+        simplex *= (double)(total + i + 1) / (i + 1);
+    }
+    return std::min(box, simplex);
+}
+
+} // anonymous namespace
+
+void poly_mul(const vec_ull_mpz &A, const vec_ull_mpz &B, vec_ull_mpz &C,
+        const MonomialPacking &packing)
+{
+    C.clear();
+    if (A.size() == 0 || B.size() == 0) return;
+    // Dense products (many products per term of the result) are faster to
+    // accumulate in a hash table, which stays small. Sparse ones are faster
+    // with the heap, whose memory use is independent of the number of
+    // products. The threshold was measured on the expand2b benchmark and on
+    // random sparse polynomials.
+    double products = (double)A.size() * B.size();
+    if (products <= 2 * poly_mul_size_bound(A, B, packing)) {
+        poly_mul_heap(A, B, C, packing);
+        return;
+    }
+    umap_ull_mpz D;
+    unsigned long long exp;
+    for (auto &a: A) {
+        for (auto &b: B) {
+            exp = monomial_mul(a.first, b.first);
+            if (packing.overflows(exp))
+                throw std::runtime_error("poly_mul: exponent exceeds the degree bound of the packing");
+            mpz_addmul(D[exp].get_mpz_t(), a.second.get_mpz_t(),
+                b.second.get_mpz_t());
+        }
+    }
+    poly_sort(D, C);
+    // Remove cancelled terms
+    C.erase(std::remove_if(C.begin(), C.end(),
+        [](const std::pair<unsigned long long, mpz_class> &t)
+        { return t.second == 0; }), C.end());
+}
+
 } // CSymPy
@@ -8,6 +8,7 @@
 
 #include "basic.h"
 #include "dict.h"
+#include "monomials.h"
 
 namespace CSymPy {
 
@@ -18,6 +19,38 @@ void expr2poly(const RCP<const Basic> &p, umap_basic_num &syms,
 //! Multiply two polynomials: `C = A*B`
 void poly_mul(const umap_vec_mpz &A, const umap_vec_mpz &B, umap_vec_mpz &C);
 
+//! Converts expression `p` into a polynomial `P` with packed exponents.
+//! `packing` must have room for the exponents of all the products that `P`
+//! will later be used in.
+void expr2poly(const RCP<const Basic> &p, umap_basic_num &syms,
+        const MonomialPacking &packing, umap_ull_mpz &P);
+
+//! Multiply two polynomials with packed exponents: `C = A*B`.
+//! Throws if an exponent of the product exceeds the degree bound of `packing`.
+void poly_mul(const umap_ull_mpz &A, const umap_ull_mpz &B, umap_ull_mpz &C,
+        const MonomialPacking &packing);
+
+//! Multiply two polynomials with packed exponents: `C = A*B`, using
+//! `threads` threads (0 means one per hardware thread). Each thread
+//! multiplies a part of the terms of `A` and accumulates into its own tables,
+//! split by monomial; the tables are then merged in parallel, one part of
+//! the monomials per thread, so no locking of `C` is needed.
+void poly_mul_parallel(const umap_ull_mpz &A, const umap_ull_mpz &B,
+        umap_ull_mpz &C, const MonomialPacking &packing, unsigned threads = 0);
+
+//! Sorts the terms of `A` by decreasing monomials into `B`
+void poly_sort(const umap_ull_mpz &A, vec_ull_mpz &B);
+
+//! Multiply two sorted polynomials with packed exponents: `C = A*B`, using
+//! a heap to merge the products (Monagan and Pearce). `C` comes out sorted.
+void poly_mul_heap(const vec_ull_mpz &A, const vec_ull_mpz &B, vec_ull_mpz &C,
+        const MonomialPacking &packing);
+
+//! Multiply two sorted polynomials with packed exponents: `C = A*B`.
+//! Uses `poly_mul_heap()` for sparse products and hashing for dense ones.
+void poly_mul(const vec_ull_mpz &A, const vec_ull_mpz &B, vec_ull_mpz &C,
+        const MonomialPacking &packing);
+
 } // CSymPy
 
 #endif
@@ -1,10 +1,15 @@
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <set>
+#include <thread>
 
 #include "matrix.h"
 #include "add.h"
 #include "mul.h"
 #include "integer.h"
 #include "constants.h"
+#include "complex.h"
 
 namespace CSymPy {
 // ----------------------------- CSRMatrix ------------------------------------
@@ -117,7 +122,7 @@ unsigned CSRMatrix::rank() const
 
 RCP<const Basic> CSRMatrix::det() const
 {
-    throw std::runtime_error("Not implemented.");
+    return csr_det(*this);
 }
 
 void CSRMatrix::inv(MatrixBase &result) const
@@ -127,12 +132,28 @@ void CSRMatrix::inv(MatrixBase &result) const
 
 void CSRMatrix::add_matrix(const MatrixBase &other, MatrixBase &result) const
 {
-    throw std::runtime_error("Not implemented.");
+    CSYMPY_ASSERT(row_ == result.nrows() && col_ == result.ncols());
+
+    if (is_a<CSRMatrix>(other) && is_a<CSRMatrix>(result)) {
+        const CSRMatrix &o = static_cast<const CSRMatrix &>(other);
+        CSRMatrix &r = static_cast<CSRMatrix &>(result);
+        csr_add_csr(*this, o, r);
+    }
 }
 
 void CSRMatrix::mul_matrix(const MatrixBase &other, MatrixBase &result) const
 {
-    throw std::runtime_error("Not implemented.");
+    CSYMPY_ASSERT(row_ == result.nrows() && other.ncols() == result.ncols());
+
+    if (is_a<CSRMatrix>(other) && is_a<CSRMatrix>(result)) {
+        const CSRMatrix &o = static_cast<const CSRMatrix &>(other);
+        CSRMatrix &r = static_cast<CSRMatrix &>(result);
+        csr_mul_csr(*this, o, r);
+    } else if (is_a<DenseMatrix>(other) && is_a<DenseMatrix>(result)) {
+        const DenseMatrix &o = static_cast<const DenseMatrix &>(other);
+        DenseMatrix &r = static_cast<DenseMatrix &>(result);
+        csr_mul_dense(*this, o, r);
+    }
 }
 
 // Add a scalar
@@ -144,13 +165,19 @@ void CSRMatrix::add_scalar(const RCP<const Basic> &k, MatrixBase &result) const
 // Multiply by a scalar
 void CSRMatrix::mul_scalar(const RCP<const Basic> &k, MatrixBase &result) const
 {
-    throw std::runtime_error("Not implemented.");
+    if (is_a<CSRMatrix>(result)) {
+        CSRMatrix &r = static_cast<CSRMatrix &>(result);
+        csr_mul_scalar(*this, k, r);
+    }
 }
 
 // Matrix transpose
 void CSRMatrix::transpose(MatrixBase &result) const
 {
-    throw std::runtime_error("Not implemented.");
+    if (is_a<CSRMatrix>(result)) {
+        CSRMatrix &r = static_cast<CSRMatrix &>(result);
+        csr_transpose(*this, r);
+    }
 }
 
 // Extract out a submatrix
@@ -178,13 +205,24 @@ void CSRMatrix::LDL(MatrixBase &L, MatrixBase &D) const
 // Solve Ax = b using LU factorization
 void CSRMatrix::LU_solve(const MatrixBase &b, MatrixBase &x) const
 {
-    throw std::runtime_error("Not implemented.");
+    if (is_a<DenseMatrix>(b) && is_a<DenseMatrix>(x)) {
+        const DenseMatrix &b_ = static_cast<const DenseMatrix &>(b);
+        DenseMatrix &x_ = static_cast<DenseMatrix &>(x);
+        csr_fraction_free_LU_solve(*this, b_, x_);
+    }
 }
 
 // Fraction free LU factorization
 void CSRMatrix::FFLU(MatrixBase &LU) const
 {
-    throw std::runtime_error("Not implemented.");
+    if (is_a<CSRMatrix>(LU)) {
+        CSRMatrix &LU_ = static_cast<CSRMatrix &>(LU);
+        std::vector<unsigned> rows;
+        csr_fraction_free_LU(*this, LU_, rows);
+        for (unsigned i = 0; i < row_; i++)
+            if (rows[i] != i)
+                throw std::runtime_error("Matrix needs row exchanges");
+    }
 }
 
 // Fraction free LDU factorization
@@ -349,7 +387,7 @@ CSRMatrix CSRMatrix::from_coo(unsigned row, unsigned col,
 void csr_matmat_pass1(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C)
 {
     // method that uses O(n) temp storage
-    std::vector<unsigned> mask(A.col_, -1);
+    std::vector<unsigned> mask(B.col_, -1);
     C.p_[0] = 0;
 
     unsigned nnz = 0;
@@ -385,8 +423,8 @@ void csr_matmat_pass1(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C)
 // row pointer Cp[] computed in Pass 1.
 void csr_matmat_pass2(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C)
 {
-    std::vector<int> next(A.col_, -1);
-    vec_basic sums(A.col_, zero);
+    std::vector<int> next(B.col_, -1);
+    vec_basic sums(B.col_, zero);
 
     unsigned nnz = 0;
 
@@ -577,4 +615,504 @@ void csr_binop_csr_canonical(const CSRMatrix& A, const CSRMatrix& B, CSRMatrix&
         CSRMatrix::csr_sum_duplicates(C.p_, C.j_, C.x_, A.row_);
 }
 
+void csr_add_csr(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C)
+{
+    CSYMPY_ASSERT(A.row_ == B.row_ && A.col_ == B.col_);
+
+    CSRMatrix R = CSRMatrix(A.row_, A.col_);
+    csr_binop_csr_canonical(A, B, R, add);
+    C = std::move(R);
+}
+
+void csr_mul_csr(const CSRMatrix &A, const CSRMatrix &B, CSRMatrix &C)
+{
+    CSYMPY_ASSERT(A.col_ == B.row_);
+
+    CSRMatrix R = CSRMatrix(A.row_, B.col_);
+    csr_matmat_pass1(A, B, R);
+    R.j_.resize(R.p_[A.row_]);
+    R.x_.resize(R.p_[A.row_]);
+    csr_matmat_pass2(A, B, R);
+    // Pass 2 drops the entries that cancel and leaves the indices of each row
+    // unsorted
+    R.j_.resize(R.p_[A.row_]);
+    R.x_.resize(R.p_[A.row_]);
+    CSRMatrix::csr_sort_indices(R.p_, R.j_, R.x_, A.row_);
+    C = std::move(R);
+}
+
+void csr_mul_csr_parallel(const CSRMatrix &A, const CSRMatrix &B,
+    CSRMatrix &C, unsigned threads)
+{
+    CSYMPY_ASSERT(A.col_ == B.row_);
+
+#if defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+    const unsigned chunk = 64;
+    unsigned row = A.row_, chunks = (row + chunk - 1) / chunk;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads > chunks) threads = chunks;
+    if (threads > 1) {
+        // Runs `f(begin, end)` on the chunks of rows, each thread taking the
+        // next chunk in turn
+        auto run = [&](const std::function<void(unsigned, unsigned)> &f) {
+            std::atomic<unsigned> next(0);
+            auto work = [&]() {
+                for (;;) {
+                    unsigned c = next.fetch_add(1, std::memory_order_relaxed);
+                    if (c >= chunks) break;
+                    f(c * chunk, std::min(row, (c + 1) * chunk));
+                }
+            };
+            std::vector<std::thread> workers;
+            for (unsigned t = 1; t < threads; t++)
+                workers.push_back(std::thread(work));
+            work();
+            for (auto &t: workers) t.join();
+        };
+        std::vector<unsigned> p(row + 1, 0), nnz(row);
+
+        // Pass 1: the number of entries of each row, an upper bound as
+        // entries may cancel
+        run([&](unsigned begin, unsigned end) {
+            std::vector<unsigned> mask(B.col_, -1);
+            for (unsigned i = begin; i < end; i++) {
+                unsigned row_nnz = 0;
+                for (unsigned jj = A.p_[i]; jj < A.p_[i + 1]; jj++) {
+                    unsigned j = A.j_[jj];
+                    for (unsigned kk = B.p_[j]; kk < B.p_[j + 1]; kk++)
+                        if (mask[B.j_[kk]] != i) {
+                            mask[B.j_[kk]] = i;
+                            row_nnz++;
+                        }
+                }
+                p[i + 1] = row_nnz;
+            }
+        });
+        for (unsigned i = 0; i < row; i++) {
+            if (p[i + 1] + p[i] < p[i])
+                throw std::overflow_error("nnz of the result is too large");
+            p[i + 1] += p[i];
+        }
+
+        // Pass 2: each row is computed into its slots, with sorted indices
+        std::vector<unsigned> j(p[row]);
+        vec_basic x(p[row]);
+        run([&](unsigned begin, unsigned end) {
+            std::vector<unsigned> cols, mask(B.col_, -1);
+            vec_basic sums(B.col_, zero);
+            for (unsigned i = begin; i < end; i++) {
+                cols.clear();
+                for (unsigned jj = A.p_[i]; jj < A.p_[i + 1]; jj++) {
+                    unsigned c = A.j_[jj];
+                    for (unsigned kk = B.p_[c]; kk < B.p_[c + 1]; kk++) {
+                        unsigned k = B.j_[kk];
+                        if (mask[k] != i) {
+                            mask[k] = i;
+                            cols.push_back(k);
+                        }
+                        sums[k] = add(sums[k], mul(A.x_[jj], B.x_[kk]));
+                    }
+                }
+                std::sort(cols.begin(), cols.end());
+                unsigned pos = p[i];
+                for (unsigned k: cols) {
+                    if (neq(sums[k], zero)) {
+                        j[pos] = k;
+                        x[pos++] = sums[k];
+                    }
+                    sums[k] = zero;
+                }
+                nnz[i] = pos - p[i];
+            }
+        });
+
+        // Drop the slots of the entries that cancelled
+        unsigned pos = 0;
+        for (unsigned i = 0; i < row; i++) {
+            unsigned start = p[i];
+            p[i] = pos;
+            for (unsigned k = start; k < start + nnz[i]; k++, pos++) {
+                j[pos] = j[k];
+                x[pos] = std::move(x[k]);
+            }
+        }
+        p[row] = pos;
+        j.resize(pos);
+        x.resize(pos);
+        C = CSRMatrix(row, B.col_, std::move(p), std::move(j), std::move(x));
+        return;
+    }
+#endif
+    csr_mul_csr(A, B, C);
+}
+
+// C = A*B, e.g. a matrix-vector product if B is a column
+void csr_mul_dense(const CSRMatrix &A, const DenseMatrix &B, DenseMatrix &C)
+{
+    CSYMPY_ASSERT(A.col_ == B.nrows() && C.nrows() == A.row_ &&
+        C.ncols() == B.ncols());
+
+    unsigned col = B.ncols();
+    vec_basic terms;
+
+    for (unsigned i = 0; i < A.row_; i++)
+        for (unsigned k = 0; k < col; k++) {
+            // Numeric terms are summed directly
+            RCP<const Number> coef = zero;
+            terms.clear();
+            for (unsigned jj = A.p_[i]; jj < A.p_[i + 1]; jj++) {
+                RCP<const Basic> t = mul(A.x_[jj], B.get(A.j_[jj], k));
+                if (is_a_Number(*t))
+                    iaddnum(outArg(coef), rcp_static_cast<const Number>(t));
+                else
+                    terms.push_back(t);
+            }
+            if (terms.empty()) {
+                C.set(i, k, coef);
+            } else {
+                terms.push_back(coef);
+                C.set(i, k, Add::from_terms(terms));
+            }
+        }
+}
+
+void csr_mul_scalar(const CSRMatrix &A, const RCP<const Basic> &k,
+    CSRMatrix &B)
+{
+    std::vector<unsigned> p(A.row_ + 1, 0), j;
+    vec_basic x;
+
+    for (unsigned i = 0; i < A.row_; i++) {
+        for (unsigned jj = A.p_[i]; jj < A.p_[i + 1]; jj++) {
+            RCP<const Basic> e = mul(A.x_[jj], k);
+            if (neq(e, zero)) {
+                j.push_back(A.j_[jj]);
+                x.push_back(e);
+            }
+        }
+        p[i + 1] = j.size();
+    }
+    B = CSRMatrix(A.row_, A.col_, std::move(p), std::move(j), std::move(x));
+}
+
+void csr_transpose(const CSRMatrix &A, CSRMatrix &B)
+{
+    unsigned nnz = A.p_[A.row_];
+    std::vector<unsigned> p(A.col_ + 1, 0), j(nnz);
+    vec_basic x(nnz);
+
+    // Count the entries per column, then place them row by row, so that the
+    // indices of each row of B stay sorted
+    for (unsigned k = 0; k < nnz; k++)
+        p[A.j_[k] + 1]++;
+    for (unsigned c = 0; c < A.col_; c++)
+        p[c + 1] += p[c];
+    std::vector<unsigned> next(p.begin(), p.end() - 1);
+    for (unsigned i = 0; i < A.row_; i++)
+        for (unsigned jj = A.p_[i]; jj < A.p_[i + 1]; jj++) {
+            unsigned dest = next[A.j_[jj]]++;
+            j[dest] = i;
+            x[dest] = A.x_[jj];
+        }
+    B = CSRMatrix(A.col_, A.row_, std::move(p), std::move(j), std::move(x));
+}
+
+void csr_permute(const CSRMatrix &A, const std::vector<unsigned> &rows,
+    const std::vector<unsigned> &cols, CSRMatrix &B)
+{
+    CSYMPY_ASSERT(rows.size() == A.row_ && cols.size() == A.col_);
+
+    std::vector<unsigned> inv(A.col_), p(A.row_ + 1, 0), j;
+    vec_basic x;
+    std::vector<std::pair<unsigned, RCP<const Basic>>> row;
+
+    for (unsigned c = 0; c < A.col_; c++)
+        inv[cols[c]] = c;
+    for (unsigned i = 0; i < A.row_; i++) {
+        row.clear();
+        for (unsigned jj = A.p_[rows[i]]; jj < A.p_[rows[i] + 1]; jj++)
+            row.push_back(std::make_pair(inv[A.j_[jj]], A.x_[jj]));
+        std::sort(row.begin(), row.end(),
+            [](const std::pair<unsigned, RCP<const Basic>> &a,
+                const std::pair<unsigned, RCP<const Basic>> &b) {
+                return a.first < b.first;
+            });
+        for (auto &e: row) {
+            j.push_back(e.first);
+            x.push_back(e.second);
+        }
+        p[i + 1] = j.size();
+    }
+    B = CSRMatrix(A.row_, A.col_, std::move(p), std::move(j), std::move(x));
+}
+
+// Minimum degree ordering on the graph of the pattern of A + A^T: each step
+// eliminates the vertex of least degree (the lowest first among equal ones)
+// and connects its neighbours to each other, which is the fill it causes.
+// The elimination graph is kept explicitly (AMD approximates the degrees on
+// a quotient graph instead, which is faster on large matrices).
+void csr_minimum_degree_ordering(const CSRMatrix &A,
+    std::vector<unsigned> &perm)
+{
+    CSYMPY_ASSERT(A.row_ == A.col_);
+
+    unsigned n = A.row_;
+    std::vector<std::set<unsigned>> adj(n);
+    std::set<std::pair<unsigned, unsigned>> degrees;
+    std::vector<unsigned> nb;
+
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned jj = A.p_[i]; jj < A.p_[i + 1]; jj++)
+            if (A.j_[jj] != i) {
+                adj[i].insert(A.j_[jj]);
+                adj[A.j_[jj]].insert(i);
+            }
+    for (unsigned i = 0; i < n; i++)
+        degrees.insert(std::make_pair(adj[i].size(), i));
+
+    perm.clear();
+    while (!degrees.empty()) {
+        unsigned v = degrees.begin()->second;
+        degrees.erase(degrees.begin());
+        perm.push_back(v);
+
+        nb.assign(adj[v].begin(), adj[v].end());
+        for (unsigned u: nb) {
+            degrees.erase(std::make_pair(adj[u].size(), u));
+            adj[u].erase(v);
+        }
+        for (unsigned a: nb)
+            for (unsigned b: nb)
+                if (a != b) adj[a].insert(b);
+        for (unsigned u: nb)
+            degrees.insert(std::make_pair(adj[u].size(), u));
+        adj[v].clear();
+    }
+}
+
+namespace {
+
+// A row during the sparse fraction-free elimination: the entries of the
+// columns not eliminated yet, and those of L if they are kept
+struct EliminationRow {
+    std::vector<unsigned> j;
+    vec_basic x;
+    std::vector<unsigned> lj;
+    vec_basic lx;
+    // The entries are those after `stage` elimination steps
+    unsigned stage;
+};
+
+// The rows of the `n x n` CSR matrix with arrays `p`, `j` and `x`
+void csr_rows(unsigned n, const std::vector<unsigned> &p,
+    const std::vector<unsigned> &j, const vec_basic &x,
+    std::vector<EliminationRow> &rows)
+{
+    rows.resize(n);
+    for (unsigned i = 0; i < n; i++) {
+        rows[i].j.assign(j.begin() + p[i], j.begin() + p[i + 1]);
+        rows[i].x.assign(x.begin() + p[i], x.begin() + p[i + 1]);
+        rows[i].stage = 0;
+    }
+}
+
+// Fraction-free (Bareiss) elimination of the first `n` columns of the
+// sparse rows `r` (the columns from `n` on are right hand sides). Step `k`
+// exchanges row `k` with the sparsest later row with an entry in column `k`
+// if needed, then sets each later row with an entry `a` there to
+// `(p_k*row - a*row_k)/p_{k-1}`, `p_k` being the pivot. The later rows
+// without an entry would only be multiplied by `p_k/p_{k-1}`: as these
+// factors telescope, that is deferred until the row is used, so a step only
+// touches the rows it eliminates from. Afterwards row `k` is row `k` of U,
+// `rows[k]` the index of its original row.
+// \return the sign of the row permutation, or 0 if column `k` has no pivot
+// for a `k < n` (then `k` is returned in `k_failed`)
+int sparse_fraction_free_elimination(std::vector<EliminationRow> &r,
+    unsigned n, bool keep_l, std::vector<unsigned> &rows, unsigned &k_failed)
+{
+    vec_basic pivots;
+    std::vector<unsigned> j;
+    vec_basic x;
+    int sign = 1;
+
+    // Brings `row` to stage `k`
+    auto scale = [&](EliminationRow &row, unsigned k) {
+        if (row.stage == k) return;
+        for (auto &e: row.x) {
+            e = mul(e, pivots[k - 1]);
+            if (row.stage > 0) e = div(e, pivots[row.stage - 1]);
+        }
+        row.stage = k;
+    };
+
+    rows.resize(r.size());
+    for (unsigned i = 0; i < r.size(); i++)
+        rows[i] = i;
+
+    for (unsigned k = 0; k < n; k++) {
+        if (r[k].j.empty() || r[k].j[0] != k) {
+            unsigned best = k;
+            for (unsigned i = k + 1; i < n; i++)
+                if (!r[i].j.empty() && r[i].j[0] == k && (best == k ||
+                        r[i].j.size() < r[best].j.size()))
+                    best = i;
+            if (best == k) {
+                k_failed = k;
+                return 0;
+            }
+            std::swap(r[k], r[best]);
+            std::swap(rows[k], rows[best]);
+            sign = -sign;
+        }
+        scale(r[k], k);
+        pivots.push_back(r[k].x[0]);
+        const RCP<const Basic> &p = pivots[k];
+        const EliminationRow &pr = r[k];
+
+        for (unsigned i = k + 1; i < n; i++) {
+            EliminationRow &ri = r[i];
+            if (ri.j.empty() || ri.j[0] != k) continue;
+            scale(ri, k);
+            RCP<const Basic> a = ri.x[0];
+            if (keep_l) {
+                ri.lj.push_back(k);
+                ri.lx.push_back(a);
+            }
+            // Merge the columns after `k` of both rows
+            j.clear();
+            x.clear();
+            unsigned u = 1, v = 1;
+            while (u < ri.j.size() || v < pr.j.size()) {
+                unsigned c;
+                RCP<const Basic> e;
+                if (v == pr.j.size() || (u < ri.j.size() && ri.j[u] < pr.j[v])) {
+                    c = ri.j[u];
+                    e = mul(p, ri.x[u++]);
+                } else if (u == ri.j.size() || pr.j[v] < ri.j[u]) {
+                    c = pr.j[v];
+                    e = neg(mul(a, pr.x[v++]));
+                } else {
+                    c = ri.j[u];
+                    e = sub(mul(p, ri.x[u++]), mul(a, pr.x[v++]));
+                }
+                if (k > 0) e = div(e, pivots[k - 1]);
+                if (neq(e, zero)) {
+                    j.push_back(c);
+                    x.push_back(e);
+                }
+            }
+            ri.j.swap(j);
+            ri.x.swap(x);
+            ri.stage = k + 1;
+        }
+    }
+    return sign;
+}
+
+// Appends the columns of `b` to the rows of an `n x n` matrix
+void append_columns(const DenseMatrix &b, unsigned n,
+    std::vector<EliminationRow> &rows)
+{
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned c = 0; c < b.ncols(); c++)
+            if (neq(b.get(i, c), zero)) {
+                rows[i].j.push_back(n + c);
+                rows[i].x.push_back(b.get(i, c));
+            }
+}
+
+} // anonymous namespace
+
+void csr_fraction_free_LU(const CSRMatrix &A, CSRMatrix &LU,
+    std::vector<unsigned> &rows)
+{
+    CSYMPY_ASSERT(A.row_ == A.col_);
+
+    unsigned n = A.row_, k;
+    std::vector<EliminationRow> r;
+
+    csr_rows(n, A.p_, A.j_, A.x_, r);
+    // Without a pivot in the last column, there is nothing left to divide by
+    if (sparse_fraction_free_elimination(r, n, true, rows, k) == 0 &&
+            k + 1 < n)
+        throw std::runtime_error("Matrix is singular");
+
+    std::vector<unsigned> p(n + 1, 0), j;
+    vec_basic x;
+    for (unsigned i = 0; i < n; i++) {
+        j.insert(j.end(), r[i].lj.begin(), r[i].lj.end());
+        x.insert(x.end(), r[i].lx.begin(), r[i].lx.end());
+        j.insert(j.end(), r[i].j.begin(), r[i].j.end());
+        x.insert(x.end(), r[i].x.begin(), r[i].x.end());
+        p[i + 1] = j.size();
+    }
+    LU = CSRMatrix(n, n, std::move(p), std::move(j), std::move(x));
+}
+
+RCP<const Basic> csr_det(const CSRMatrix &A)
+{
+    CSYMPY_ASSERT(A.row_ == A.col_);
+
+    unsigned n = A.row_, k;
+    if (n == 0) return one;
+
+    // det(P A P^T) = det(A)
+    std::vector<unsigned> perm, rows;
+    std::vector<EliminationRow> r;
+    CSRMatrix B;
+    csr_minimum_degree_ordering(A, perm);
+    csr_permute(A, perm, perm, B);
+    csr_rows(n, B.p_, B.j_, B.x_, r);
+
+    int sign = sparse_fraction_free_elimination(r, n, false, rows, k);
+    if (sign == 0) return zero;
+    return (sign == 1) ? r[n - 1].x[0] : mul(minus_one, r[n - 1].x[0]);
+}
+
+void csr_fraction_free_LU_solve(const CSRMatrix &A, const DenseMatrix &b,
+    DenseMatrix &x)
+{
+    CSYMPY_ASSERT(A.row_ == A.col_);
+    CSYMPY_ASSERT(b.nrows() == A.row_ && x.nrows() == A.row_);
+    CSYMPY_ASSERT(x.ncols() == b.ncols());
+
+    unsigned n = A.row_, bcol = b.ncols(), k;
+    std::vector<unsigned> perm, rows;
+    std::vector<EliminationRow> r;
+    CSRMatrix B;
+
+    // Solve (P A P^T) (P x) = P b
+    csr_minimum_degree_ordering(A, perm);
+    csr_permute(A, perm, perm, B);
+    DenseMatrix b_ = DenseMatrix(n, bcol);
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned c = 0; c < bcol; c++)
+            b_.set(i, c, b.get(perm[i], c));
+    csr_rows(n, B.p_, B.j_, B.x_, r);
+    append_columns(b_, n, r);
+
+    // Row exchanges reorder the equations only
+    if (sparse_fraction_free_elimination(r, n, false, rows, k) == 0)
+        throw std::runtime_error("Matrix is singular");
+
+    // Back substitution on U, whose rows hold the right hand sides after
+    // column `n`
+    vec_basic y(n);
+    for (unsigned c = 0; c < bcol; c++) {
+        for (unsigned i = n; i-- > 0;) {
+            const EliminationRow &ri = r[i];
+            RCP<const Basic> s = zero;
+            for (unsigned u = 1; u < ri.j.size(); u++) {
+                if (ri.j[u] < n)
+                    s = sub(s, mul(ri.x[u], y[ri.j[u]]));
+                else if (ri.j[u] == n + c)
+                    s = add(s, ri.x[u]);
+            }
+            y[i] = div(s, ri.x[0]);
+        }
+        for (unsigned i = 0; i < n; i++)
+            x.set(perm[i], c, y[i]);
+    }
+}
+
 } // CSymPy
@@ -7,6 +7,7 @@
 #define CSYMPY_SYMBOL_H
 
 #include "basic.h"
+#include "unique_table.h"
 
 namespace CSymPy {
 
@@ -45,6 +46,7 @@ public:
     virtual RCP<const Basic> diff(const RCP<const Symbol> &x) const;
 
     virtual vec_basic get_args() const { return {}; }
+    virtual bool for_each_arg(const ArgCallback &f) const { return true; }
 
     virtual void accept(Visitor &v) const;
 };
@@ -52,7 +54,7 @@ public:
 //! inline version to return `Symbol`
 inline RCP<const Symbol> symbol(const std::string &name)
 {
-    return rcp(new Symbol(name));
+    return intern(rcp(new Symbol(name)));
 }
 
 } // CSymPy
@@ -23,6 +23,11 @@ using CSymPy::map_vec_int;
 using CSymPy::Integer;
 using CSymPy::integer;
 using CSymPy::multinomial_coefficients;
+using CSymPy::multinomial_coefficients_mpz;
+using CSymPy::multinomial_coefficients_count;
+using CSymPy::MultinomialGenerator;
+using CSymPy::map_vec_mpz;
+using CSymPy::vec_int;
 using CSymPy::one;
 using CSymPy::zero;
 using CSymPy::sin;
@@ -34,10 +39,15 @@ using CSymPy::add;
 using CSymPy::mul;
 using CSymPy::div;
 using CSymPy::sub;
+using CSymPy::iadd;
+using CSymPy::imul;
+using CSymPy::outArg;
 using CSymPy::exp;
 using CSymPy::E;
 using CSymPy::Rational;
 using CSymPy::Complex;
+using CSymPy::ExpandLimits;
+using CSymPy::ExpandLimitExceeded;
 using CSymPy::Number;
 using CSymPy::I;
 using CSymPy::rcp_dynamic_cast;
@@ -581,6 +591,36 @@ void test_multinomial()
         << "ms" << std::endl;
 }
 
+void test_multinomial_generator()
+{
+    // Small (word sized) and large coefficients
+    for (int m: {1, 2, 3, 4, 7}) {
+        for (int n: {0, 1, 2, 5, 20, 70}) {
+            if (multinomial_coefficients_count(m, n) > 100000) continue;
+            map_vec_mpz r;
+            if (m >= 2) {
+                multinomial_coefficients_mpz(m, n, r);
+            } else {
+                r[vec_int(1, n)] = 1;
+            }
+            MultinomialGenerator g(m, n);
+            assert(g.is_small() == (m == 1 || n <= 20));
+            double count = 0;
+            do {
+                auto it = r.find(g.get_exponents());
+                assert(it != r.end());
+                assert(it->second == g.get_coefficient());
+                if (g.is_small())
+                    assert(it->second == g.get_coefficient_ui());
+                r.erase(it);
+                count++;
+            } while (g.next());
+            assert(r.size() == 0);
+            assert(count == multinomial_coefficients_count(m, n));
+        }
+    }
+}
+
 void test_expand1()
 {
     RCP<const Basic> x = rcp(new Symbol("x"));
@@ -706,6 +746,18 @@ void test_expand2()
     r2 = mul(i4, pow(i5, div(im1, i2)));
     r2 = expand(pow(add(add(r1, r2), integer(1)), i2));
     assert(eq(r2, add(div(integer(54), i5), mul(integer(14), pow(i5, div(im1, i2))))));
+
+    // Products of terms that cancel to a number keep their coefficients
+    r1 = mul(add(mul(i2, pow(x, i2)), mul(i3, x)), pow(x, im1));
+    r1 = expand(r1);
+    r2 = add(mul(i2, x), i3);
+    assert(eq(r1, r2));
+
+    r1 = mul(add(mul(i2, x), y), add(mul(i3, pow(x, im1)), y));
+    r1 = expand(r1);
+    r2 = add(add(add(i6, mul(mul(i2, x), y)), mul(mul(i3, y), pow(x, im1))),
+        pow(y, i2));
+    assert(eq(r1, r2));
 }
 
 void test_expand3()
@@ -763,6 +815,189 @@ void test_expand3()
         << "ms" << std::endl;
 }
 
+void test_expand_factors()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> h = div(one, integer(2));
+    RCP<const Basic> r1, r2;
+
+    // Factors of different sizes, mixed with factors that are not Adds
+    r1 = mul(mul(mul(x, sin(y)), add(x, h)), add(add(x, y), h));
+    r1 = mul(r1, sub(x, h));
+    r2 = expand(r1);
+    // sin(y)*x*(x^2 - 1/4)*(x + y + 1/2)
+    r1 = mul(sin(y), add(pow(x, integer(3)), mul(div(integer(-1),
+        integer(4)), x)));
+    r1 = add(add(mul(r1, x), mul(r1, y)), mul(r1, h));
+    assert(eq(r2, expand(r1)));
+
+    r1 = mul(integer(3), mul(y, mul(add(x, y), add(x, integer(-1)))));
+    r2 = expand(r1);
+    assert(eq(r2, add(add(mul(integer(3), mul(pow(x, integer(2)), y)),
+        mul(integer(3), mul(x, pow(y, integer(2))))),
+        add(mul(integer(-3), mul(x, y)), mul(integer(-3), pow(y, integer(2)))))));
+}
+
+void test_expand_limits()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> z = rcp(new Symbol("z"));
+    RCP<const Basic> w = rcp(new Symbol("w"));
+    RCP<const Basic> e, r;
+    bool thrown;
+
+    // 39711 terms
+    e = pow(add(add(add(x, y), z), w), integer(60));
+    thrown = false;
+    try {
+        expand(e, ExpandLimits(1000));
+    } catch (ExpandLimitExceeded &) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        expand(e, ExpandLimits(0, 100000));
+    } catch (ExpandLimitExceeded &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Polynomial products
+    e = pow(add(add(add(x, y), z), w), integer(10));
+    e = mul(e, add(e, w));
+    thrown = false;
+    try {
+        expand(e, ExpandLimits(1000));
+    } catch (ExpandLimitExceeded &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // Products that are not polynomials with integer coefficients
+    e = pow(add(add(add(x, y), z), sin(w)), integer(10));
+    e = mul(e, add(e, w));
+    thrown = false;
+    try {
+        expand(e, ExpandLimits(1000));
+    } catch (ExpandLimitExceeded &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // The limits only apply to the call that was given them
+    r = expand(e);
+    assert(eq(expand(e, ExpandLimits(100000, 100000000)), r));
+    assert(eq(expand(e, ExpandLimits()), r));
+}
+
+void test_expand_parallel()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> z = rcp(new Symbol("z"));
+    RCP<const Basic> i2 = integer(2);
+    RCP<const Basic> i3 = integer(3);
+    RCP<const Basic> r, e, e1, e2;
+
+    // Not polynomials with integer coefficients, so that the Add/Mul code
+    // paths are used
+    e1 = pow(add(add(x, sin(y)), div(z, i3)), integer(6));
+    e2 = pow(add(add(sin(x), y), mul(i3, z)), integer(5));
+    e = add(mul(e1, e2), add(pow(add(x, sin(z)), i3), mul(e1, sin(x))));
+    r = expand(e);
+    for (unsigned threads: {0, 1, 2, 3, 8}) {
+        assert(eq(expand_parallel(e, threads), r));
+    }
+
+    e = mul(add(x, y), add(mul(i2, x), z));
+    assert(eq(expand_parallel(e, 4), expand(e)));
+    assert(eq(expand_parallel(x, 4), x));
+    assert(eq(expand_parallel(i3, 4), i3));
+    e = add(pow(add(x, y), i3), integer(1));
+    assert(eq(expand_parallel(e, 4), expand(e)));
+}
+
+void test_iadd_imul()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> i2 = integer(2);
+    RCP<const Basic> r, r2, s, e;
+
+    // Sums of many terms agree with add()
+    r = zero;
+    s = zero;
+    for (int i = 0; i < 100; i++) {
+        e = mul(integer(i % 7 - 3), pow(x, integer(i % 13)));
+        iadd(outArg(r), e);
+        s = add(s, e);
+    }
+    assert(eq(r, s));
+
+    // A shared Add is not modified
+    r = add(x, y);
+    r2 = r;
+    iadd(outArg(r), mul(i2, x));
+    assert(eq(r, add(mul(integer(3), x), y)));
+    assert(eq(r2, add(x, y)));
+
+    // Adds that cancel, numbers and Adds as the second argument
+    iadd(outArg(r), add(y, integer(5)));
+    assert(eq(r, add(mul(integer(3), x), add(mul(i2, y), integer(5)))));
+    iadd(outArg(r), mul(integer(-3), x));
+    iadd(outArg(r), mul(integer(-2), y));
+    assert(eq(r, integer(5)));
+
+    // Products of many factors agree with mul()
+    r = one;
+    s = one;
+    for (int i = 0; i < 50; i++) {
+        e = pow(i % 2 == 0 ? x : y, integer(i % 5 - 2));
+        imul(outArg(r), e);
+        s = mul(s, e);
+    }
+    assert(eq(r, s));
+
+    r = mul(x, y);
+    r2 = r;
+    imul(outArg(r), mul(i2, pow(x, integer(-1))));
+    assert(eq(r, mul(i2, y)));
+    assert(eq(r2, mul(x, y)));
+    r = mul(mul(i2, x), y);
+    imul(outArg(r), div(one, mul(x, y)));
+    assert(eq(r, i2));
+}
+
+void test_from_terms()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> i2 = integer(2);
+    RCP<const Basic> r, s;
+    CSymPy::vec_basic v;
+
+    assert(eq(Add::from_terms(v), zero));
+    assert(eq(Mul::from_factors(v), one));
+
+    v = {x, mul(i2, y), add(x, integer(3)), integer(-3), pow(x, i2)};
+    s = zero;
+    for (auto &t: v) s = add(s, t);
+    assert(eq(Add::from_terms(v), s));
+    s = one;
+    for (auto &t: v) s = mul(s, t);
+    assert(eq(Mul::from_factors(v), s));
+
+    assert(eq(Add::from_terms({x, mul(integer(-1), x)}), zero));
+    assert(eq(Add::from_terms({x}), x));
+    assert(eq(Mul::from_factors({x, pow(x, integer(-1))}), one));
+    assert(eq(Mul::from_factors({x, zero, y}), zero));
+    r = Mul::from_factors({sqrt(i2), x, sqrt(i2)});
+    assert(eq(r, mul(i2, x)));
+}
+
 int main(int argc, char* argv[])
 {
     print_stack_on_segfault();
@@ -774,9 +1009,15 @@ int main(int argc, char* argv[])
     test_sub();
     test_div();
     test_multinomial();
+    test_multinomial_generator();
     test_expand1();
     test_expand2();
     test_expand3();
+    test_expand_factors();
+    test_expand_limits();
+    test_expand_parallel();
+    test_iadd_imul();
+    test_from_terms();
 
     return 0;
 }
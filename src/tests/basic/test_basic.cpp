@@ -1,5 +1,7 @@
 #include <cmath>
+#include <complex>
 #include <iostream>
+#include <thread>
 
 #include "basic.h"
 #include "add.h"
@@ -13,6 +15,9 @@
 #include "functions.h"
 #include "visitor.h"
 #include "eval_double.h"
+#include "unique_table.h"
+#include "pool_allocator.h"
+#include "deferred_release.h"
 
 using CSymPy::Basic;
 using CSymPy::Add;
@@ -21,6 +26,7 @@ using CSymPy::Symbol;
 using CSymPy::symbol;
 using CSymPy::umap_basic_num;
 using CSymPy::map_basic_basic;
+using CSymPy::vec_basic;
 using CSymPy::Integer;
 using CSymPy::integer;
 using CSymPy::Rational;
@@ -32,6 +38,30 @@ using CSymPy::RCP;
 using CSymPy::print_stack_on_segfault;
 using CSymPy::Complex;
 using CSymPy::has_symbol;
+using CSymPy::set_hash_consing;
+using CSymPy::unique_table_size;
+using CSymPy::pool_allocate;
+using CSymPy::pool_deallocate;
+using CSymPy::FlatHashMap;
+using CSymPy::FlatMap;
+using CSymPy::RCPBasicKeyLess;
+using CSymPy::mul_monomials;
+using CSymPy::RCPBasicHash;
+using CSymPy::RCPBasicKeyEq;
+using CSymPy::PoolAllocator;
+using CSymPy::CompiledDouble;
+using CSymPy::compile_double;
+using CSymPy::eval_double_batch;
+using CSymPy::eval_complex_double;
+using CSymPy::pi;
+using CSymPy::set_deferred_release;
+using CSymPy::release_pending;
+using CSymPy::pending_release_count;
+using CSymPy::Differentiator;
+using CSymPy::minus_one;
+using CSymPy::is_a;
+using CSymPy::gradient;
+using CSymPy::eval_double_gradient;
 
 void test_symbol_hash()
 {
@@ -115,6 +145,15 @@ void test_add()
     assert(vec_basic_eq_perm(r->get_args(),
                 {integer(5), mul(mul(integer(2), x), y), pow(x, integer(2))}));
     std::cout << *r << std::endl;
+
+    // The hash does not depend on the order in which the terms were added
+    RCP<const Basic> z = symbol("z");
+    RCP<const Basic> r1 = add(add(add(x, mul(integer(2), y)), z), integer(3));
+    RCP<const Basic> r2 = add(add(add(integer(3), z), mul(integer(2), y)), x);
+    assert(eq(r1, r2) && r1->hash() == r2->hash());
+    r1 = add(x, mul(integer(2), y));
+    r2 = add(mul(integer(2), x), y);
+    assert(r1->hash() != r2->hash());
 }
 
 void test_integer()
@@ -295,6 +334,20 @@ void test_mul()
 
     r = div(x, x);
     assert(vec_basic_eq(r->get_args(), {}));
+
+    // Products of monomials agree with mul()
+    RCP<const Basic> z = symbol("z");
+    RCP<const Basic> s2 = pow(integer(2), div(one, integer(2)));
+    RCP<const Basic> sx = pow(x, div(one, integer(2)));
+    vec_basic monomials = {x, y, pow(x, integer(2)), pow(x, integer(-1)),
+        mul(x, y), mul(pow(x, integer(-1)), z), mul(y, pow(z, x)),
+        pow(z, x), sx, s2, mul(s2, y), CSymPy::sin(x)};
+    for (auto &p: monomials)
+        for (auto &q: monomials)
+            assert(eq(mul_monomials(p, q), mul(p, q)));
+    assert(eq(mul_monomials(sx, sx), x));
+    assert(eq(mul_monomials(s2, s2), integer(2)));
+    assert(eq(mul_monomials(pow(x, integer(-1)), x), one));
 }
 
 void test_diff()
@@ -327,6 +380,104 @@ void test_diff()
     assert(eq(r1->diff(x)->diff(x), i10));
 }
 
+void test_diff_dag()
+{
+    RCP<const Symbol> x = symbol("x");
+    RCP<const Symbol> y = symbol("y");
+
+    // A DAG of 40 levels whose tree has 2**40 leaves
+    vec_basic a = {mul(x, y)};
+    for (unsigned i = 0; i < 40; i++)
+        a.push_back(add(sin(a[i]), cos(a[i])));
+
+    RCP<const Basic> da = y;
+    for (unsigned i = 0; i < 3; i++)
+        da = add(mul(cos(a[i]), da), mul(mul(minus_one, sin(a[i])), da));
+    assert(eq(a[3]->diff(x), da));
+
+    // The factor `da` of both terms of a derivative
+    auto factor_da = [](const RCP<const Basic> &term) {
+        for (auto &f: term->get_args())
+            if (is_a<Add>(*f)) return f.get();
+        return (const Basic *)nullptr;
+    };
+
+    // Each shared node is differentiated once, and its derivative is shared
+    RCP<const Basic> r = a[40]->diff(x);
+    vec_basic args = r->get_args();
+    assert(args.size() == 2);
+    assert(factor_da(args[0]) != nullptr);
+    assert(factor_da(args[0]) == factor_da(args[1]));
+
+    // The cache of a Differentiator is shared between its calls
+    Differentiator d;
+    RCP<const Basic> r1 = d.diff(a[40], x);
+    RCP<const Basic> r2 = d.diff(a[39], x);
+    assert(d.diff(a[40], x).get() == r1.get());
+    for (auto &f: r1->get_args())
+        assert(factor_da(f) == r2.get());
+    assert(eq(d.diff(a[2], y), a[2]->diff(y)));
+}
+
+void test_gradient()
+{
+    RCP<const Symbol> x = symbol("x");
+    RCP<const Symbol> y = symbol("y");
+    RCP<const Symbol> z = symbol("z");
+    RCP<const Basic> s = sin(mul(x, y));
+    vec_basic symbols = {x, y, z};
+    std::vector<double> v = {0.5, -1.25, 2.0};
+    std::vector<double> grad;
+
+    vec_basic fs = {
+        add(mul(x, y), integer(3)),
+        add(add(s, mul(s, pow(x, integer(3)))), mul(integer(2), log(z))),
+        mul(mul(pow(add(x, z), integer(-2)), cos(s)), pow(z, y)),
+        pow(add(integer(1), mul(x, x)), add(y, s)),
+        div(tan(x), log(add(mul(y, y), z))),
+        mul(x, integer(0)),
+    };
+    for (auto &f: fs) {
+        vec_basic g = gradient(f, symbols);
+        double r = eval_double_gradient(*f, symbols, v, grad);
+        assert(std::abs(r - eval_double(*f, symbols, v)) < 1e-12);
+        assert(g.size() == 3 && grad.size() == 3);
+        for (unsigned i = 0; i < 3; i++) {
+            RCP<const Symbol> xi =
+                CSymPy::rcp_static_cast<const Symbol>(symbols[i]);
+            double d = eval_double(*f->diff(xi), symbols, v);
+            assert(std::abs(eval_double(*g[i], symbols, v) - d) < 1e-12);
+            assert(std::abs(grad[i] - d) < 1e-12);
+        }
+    }
+
+    // Functions of several arguments, some equal or containing others
+    RCP<const Basic> f = CSymPy::function_symbol("f", {x, mul(x, y), x});
+    vec_basic g = gradient(f, symbols);
+    assert(is_a<Add>(*g[0]) && g[0]->get_args().size() == 3);
+    assert(is_a<Mul>(*g[1]));
+    assert(eq(g[2], zero));
+
+    eval_double_gradient(*abs(sub(x, y)), {x, y}, {0.5, 2.0}, grad);
+    assert(grad[0] == -1 && grad[1] == 1);
+
+    // Only symbols
+    CSYMPY_CHECK_THROW(gradient(x, {mul(x, y)}), std::runtime_error);
+    // Unknown symbol, unsupported class
+    CSYMPY_CHECK_THROW(eval_double_gradient(*add(x, z), {x}, {1.0}, grad),
+        std::runtime_error);
+    CSYMPY_CHECK_THROW(eval_double_gradient(*CSymPy::asin(x), {x}, {0.5},
+        grad), std::runtime_error);
+
+    // A DAG whose tree has 2**40 leaves: each distinct node is walked once
+    f = mul(x, y);
+    for (unsigned i = 0; i < 40; i++) f = add(sin(f), cos(f));
+    g = gradient(f, {x, y});
+    assert(g.size() == 2);
+    eval_double_gradient(*f, {x, y}, {0.5, 0.25}, grad);
+    assert(std::abs(grad[0] / grad[1] - 0.5) < 1e-12);
+}
+
 void test_compare()
 {
     RCP<const Basic> r1, r2;
@@ -604,6 +755,69 @@ void test_has()
     assert(has_symbol(*r1, x));
     assert(has_symbol(*r1, y));
     assert(!has_symbol(*r1, z));
+
+    // Symbols that only appear in exponents and coefficients
+    r1 = add(mul(integer(2), pow(y, x)), mul(x, z));
+    assert(has_symbol(*r1, x));
+    r1 = add(mul(pow(y, add(x, integer(2))), z), integer(3));
+    assert(has_symbol(*r1, x));
+    assert(!has_symbol(*sin(y), x));
+}
+
+void test_for_each_arg()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> i2 = integer(2);
+    RCP<const Basic> i3 = integer(3);
+    RCP<const Basic> r;
+    std::vector<const Basic *> args;
+    auto collect = [&args](const Basic &arg) {
+        args.push_back(&arg);
+        return true;
+    };
+
+    // 2*x**3: the coefficient, then the base and its exponent, borrowed from
+    // the Mul
+    r = mul(i2, pow(x, i3));
+    assert(r->for_each_arg(collect));
+    const Mul &m = static_cast<const Mul &>(*r);
+    assert(args.size() == 3);
+    assert(args[0] == m.coef_.get());
+    assert(args[1] == m.dict_.begin()->first.get());
+    assert(args[2] == m.dict_.begin()->second.get());
+    assert(args[1]->__eq__(*x) && args[2]->__eq__(*i3));
+
+    // 2*x + 3: the coefficient, then the term and its coefficient
+    args.clear();
+    r = add(mul(i2, x), i3);
+    assert(r->for_each_arg(collect));
+    assert(args.size() == 3);
+    assert(args[0]->__eq__(*i3) && args[1]->__eq__(*x));
+    assert(args[2]->__eq__(*i2));
+
+    // Zero coefficient of an Add and unit coefficient of a Mul are skipped
+    args.clear();
+    assert(add(x, y)->for_each_arg(collect));
+    assert(args.size() == 4);
+    args.clear();
+    assert(mul(x, y)->for_each_arg(collect));
+    assert(args.size() == 4);
+
+    // Classes without an override fall back to get_args()
+    args.clear();
+    assert(sin(x)->for_each_arg(collect));
+    assert(args.size() == 1 && args[0]->__eq__(*x));
+    assert(x->for_each_arg(collect));
+    assert(args.size() == 1);
+
+    // Stops at the first argument for which the callback returns false
+    int n = 0;
+    assert(!add(x, y)->for_each_arg([&n](const Basic &) {
+        n++;
+        return false;
+    }));
+    assert(n == 1);
 }
 
 void test_eval_double()
@@ -630,6 +844,120 @@ void test_eval_double()
     r3 = tan(pow(r1, r2));
     assert(::fabs(eval_double(*r3) - 1.314847038576) < 1e-12);
 
+    // Coefficients and exponents in the dictionaries of Add and Mul
+    r3 = add(add(mul(integer(3), pow(r1, integer(2))), mul(integer(2), r2)),
+        integer(5));
+    assert(::fabs(eval_double(*r3) - 8.083071332029) < 1e-12);
+
+    r3 = div(mul(r1, pow(r2, integer(-3))), integer(7));
+    assert(::fabs(eval_double(*r3) - 1.090881585992) < 1e-12);
+
+    // Compiled expressions, evaluated at several points
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> z = symbol("z");
+    r1 = add(mul(sin(add(x, y)), cos(add(x, y))), pow(x, integer(-2)));
+    r1 = add(r1,
+        mul(div(integer(3), integer(4)), pow(y, div(one, integer(3)))));
+    r1 = add(r1,
+        mul(log(add(x, integer(5))), tan(div(mul(pi, y), integer(7)))));
+    CompiledDouble f = compile_double(*r1, {x, y});
+    for (int i = 1; i <= 5; i++) {
+        double a = i / 3.0, b = i;
+        double d[] = {a, b};
+        double r = ::sin(a + b) * ::cos(a + b) + 1 / (a * a)
+            + 0.75 * ::pow(b, 1 / 3.0)
+            + ::log(a + 5) * ::tan(::acos(-1.0) * b / 7);
+        assert(::fabs(f(d) - r) < 1e-12);
+    }
+    r2 = add(mul(integer(2), pow(x, integer(3))), div(y, integer(3)));
+    f = compile_double(*r2, {x, y});
+    r3 = r2->subs({{x, div(integer(1), integer(3))}, {y, integer(2)}});
+    assert(::fabs(f({1.0 / 3, 2.0}) - eval_double(*r3)) < 1e-12);
+
+    // Batches (with an incomplete last batch), compared point by point
+    f = compile_double(*r1, {x, y});
+    std::vector<double> points, out(19);
+    for (int i = 0; i < 19; i++) {
+        points.push_back(0.1 * (i + 1));
+        points.push_back(0.2 * i + 0.5);
+    }
+    f.eval_batch(points.data(), 19, out.data());
+    for (int i = 0; i < 19; i++)
+        assert(::fabs(out[i] - f(&points[2*i])) < 1e-12 * ::fabs(out[i]));
+    r2 = add(pow(x, integer(-3)), pow(y, integer(5)));
+    eval_double_batch(*r2, {x, y}, points.data(), 19, out.data());
+    for (int i = 0; i < 19; i++) {
+        double a = points[2*i], b = points[2*i + 1];
+        double r = 1 / (a * a * a) + ::pow(b, 5);
+        assert(::fabs(out[i] - r) < 1e-12 * ::fabs(r));
+    }
+
+    // The same results, bit for bit, with any number of threads
+    int n = 3 * CompiledDouble::parallel_chunk + 7;
+    points.resize(2 * n);
+    for (int i = 0; i < 2 * n; i++) points[i] = 0.01 * (i + 1);
+    std::vector<double> serial(n), parallel(n);
+    f.eval_batch(points.data(), n, serial.data());
+    for (unsigned threads = 0; threads <= 5; threads++) {
+        std::fill(parallel.begin(), parallel.end(), 0);
+        f.eval_batch_parallel(points.data(), n, parallel.data(), threads);
+        assert(parallel == serial);
+    }
+    eval_double_batch(*r2, {x, y}, points.data(), n, parallel.data(), 3);
+    f = compile_double(*r2, {x, y});
+    f.eval_batch(points.data(), n, serial.data());
+    assert(parallel == serial);
+
+    // x + y is computed once
+    CompiledDouble g = compile_double(*sin(add(x, y)), {x, y});
+    assert(g.size() == 2);
+    g = compile_double(*add(sin(add(x, y)), cos(add(x, y))), {x, y});
+    assert(g.size() == 4);
+    assert(::fabs(g({1.0, 2.0}) - ::sin(3.0) - ::cos(3.0)) < 1e-12);
+    assert(compile_double(*integer(2), {})({}) == 2);
+    assert(compile_double(*x, {y, x})({1.0, 2.0}) == 2);
+
+    CSYMPY_CHECK_THROW(compile_double(*r1, {x}), std::runtime_error)
+    CSYMPY_CHECK_THROW(compile_double(*r1, {x, add(y, z)}), std::runtime_error)
+    CSYMPY_CHECK_THROW(compile_double(*cot(x), {x}), std::runtime_error)
+
+    // Values of the symbols, without subs()
+    map_basic_basic values;
+    values[x] = div(integer(1), integer(3));
+    values[y] = add(integer(2), pi);
+    double a = 1 / 3.0, b = 2 + ::acos(-1.0);
+    f = compile_double(*r1, {x, y});
+    assert(::fabs(eval_double(*r1, values) - f({a, b})) < 1e-12);
+    assert(::fabs(eval_double(*r1, {x, y}, {a, b}) - f({a, b})) < 1e-12);
+    r2 = add(pow(x, integer(2)), y);
+    assert(::fabs(eval_double(*r2, values) - eval_double(*r2->subs(values)))
+        < 1e-12);
+    assert(eval_double(*add(x, y), {y, x}, {1.0, 2.0}) == 3);
+    CSYMPY_CHECK_THROW(eval_double(*r1, {x}, {a}), std::runtime_error)
+    CSYMPY_CHECK_THROW(eval_double(*r1, {x, y}, {a}), std::runtime_error)
+    values[add(x, y)] = one;
+    CSYMPY_CHECK_THROW(eval_double(*r1, values), std::runtime_error)
+
+    // Complex numbers, principal branches
+    RCP<const Basic> i = Complex::from_mpq(0, 1);
+    std::complex<double> c = eval_complex_double(*pow(i, integer(2)));
+    assert(c == std::complex<double>(-1, 0));
+    std::vector<std::complex<double>> v = {std::complex<double>(-4, 0)};
+    c = eval_complex_double(*sqrt(x), {x}, v);
+    assert(std::abs(c - std::complex<double>(0, 2)) < 1e-12);
+    c = eval_complex_double(*log(add(x, integer(3))), {x}, v);
+    assert(std::abs(c - std::complex<double>(0, ::acos(-1.0))) < 1e-12);
+    c = eval_complex_double(*add(mul(i, x), pow(y, integer(3))), {x, y},
+        {std::complex<double>(2, 0), std::complex<double>(1, 1)});
+    assert(c == std::complex<double>(-2, 4));
+    values.clear();
+    values[x] = i;
+    c = eval_complex_double(*mul(x, x), values);
+    assert(c == std::complex<double>(-1, 0));
+    assert(std::abs(eval_complex_double(*r3) - eval_double(*r3)) < 1e-12);
+    CSYMPY_CHECK_THROW(eval_double(*i), std::runtime_error)
+
     // Symbol must raise an exception
     CSYMPY_CHECK_THROW(eval_double(*symbol("x")), std::runtime_error)
 
@@ -642,6 +970,292 @@ void test_eval_double()
     // ... we don't test the rest of functions that are not implemented.
 }
 
+void test_hash_consing()
+{
+#if defined(WITH_CSYMPY_RCP)
+    std::size_t n = unique_table_size();
+    set_hash_consing(true);
+    {
+        RCP<const Basic> x1 = symbol("x");
+        RCP<const Basic> x2 = symbol("x");
+        RCP<const Basic> y = symbol("y");
+        assert(x1.get() == x2.get());
+        assert(x1.get() != y.get());
+        assert(x1->is_interned());
+
+        RCP<const Basic> i2 = integer(2);
+        assert(i2.get() == integer(2).get());
+
+        RCP<const Basic> r1 = add(x1, i2);
+        RCP<const Basic> r2 = add(i2, x2);
+        assert(r1.get() == r2.get());
+
+        r1 = mul(pow(x1, i2), y);
+        r2 = mul(y, pow(x2, integer(2)));
+        assert(r1.get() == r2.get());
+        assert(pow(x1, i2).get() == pow(x2, i2).get());
+
+        // Nodes built directly through constructors are not interned, but
+        // still compare equal:
+        RCP<const Basic> x3 = rcp(new Symbol("x"));
+        assert(!x3->is_interned());
+        assert(x3.get() != x1.get());
+        assert(eq(x3, x1));
+
+        assert(unique_table_size() > n);
+    }
+    // Entries are weak, all of them went away with the last reference:
+    assert(unique_table_size() == n);
+    set_hash_consing(false);
+
+    RCP<const Basic> x1 = symbol("x");
+    RCP<const Basic> x2 = symbol("x");
+    assert(x1.get() != x2.get());
+    assert(!x1->is_interned());
+    assert(unique_table_size() == n);
+#endif
+}
+
+void test_pool_allocator()
+{
+    // Freed blocks are reused for the same size class
+    void *p = pool_allocate(40);
+    pool_deallocate(p, 40);
+    void *q = pool_allocate(33);
+    assert(p == q);
+    pool_deallocate(q, 33);
+
+    // Large blocks bypass the pool
+    void *r = pool_allocate(10000);
+    pool_deallocate(r, 10000);
+
+    std::map<int, int, std::less<int>,
+        PoolAllocator<std::pair<const int, int>>> m;
+    for (int i = 0; i < 1000; i++) m[i] = 2*i;
+    for (int i = 0; i < 1000; i += 2) m.erase(i);
+    assert(m.size() == 500);
+    assert(m[999] == 1998);
+
+    umap_basic_num d;
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    insert(d, x, integer(2));
+    insert(d, y, integer(3));
+    RCP<const Basic> r1 = Add::from_dict(one, std::move(d));
+    RCP<const Basic> r2 = add(add(mul(integer(3), y), one), mul(integer(2), x));
+    assert(eq(r1, r2));
+}
+
+void test_refcount_threads()
+{
+#if defined(WITH_CSYMPY_THREAD_SAFE) && defined(WITH_CSYMPY_RCP)
+    std::size_t n = unique_table_size();
+    set_hash_consing(true);
+    {
+        RCP<const Basic> x = symbol("x");
+        const int nthreads = 4;
+        std::vector<vec_basic> results(nthreads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nthreads; t++) {
+            threads.push_back(std::thread([t, x, &results]() {
+                // Copies of objects created by the main thread, and objects
+                // created here that are handed back to the main thread
+                for (int i = 0; i < 100; i++) {
+                    RCP<const Basic> y = x;
+                    RCP<const Basic> e = pow(add(y, integer(t + i)),
+                        integer(2));
+                    results[t].push_back(expand(e));
+                    results[t].push_back(symbol("x"));
+                }
+            }));
+        }
+        for (auto &t: threads) t.join();
+        for (int t = 0; t < nthreads; t++) {
+            for (int i = 0; i < 100; i++) {
+                RCP<const Basic> e = pow(add(x, integer(t + i)), integer(2));
+                assert(eq(results[t][2*i], expand(e)));
+                assert(results[t][2*i + 1].get() == x.get());
+            }
+        }
+        // The main thread drops the last references to the objects of
+        // threads that have exited
+        results.clear();
+        assert(unique_table_size() > n);
+    }
+    // Everything was deleted, whichever thread dropped the last reference
+    assert(unique_table_size() == n);
+    set_hash_consing(false);
+#endif
+}
+
+void test_deferred_release()
+{
+#if defined(WITH_CSYMPY_DEFERRED_RELEASE)
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> r = x;
+    // Deleting this deeply nested expression recursively would overflow
+    // the stack
+    for (int i = 0; i < 1000000; i++) r = sin(r);
+    r = x;
+    assert(pending_release_count() == 0);
+
+    set_deferred_release(true);
+    r = add(mul(x, integer(2)), sin(add(x, symbol("y"))));
+    // Temporaries dropped while building `r`
+    assert(release_pending() == 0);
+    r = x;
+    assert(pending_release_count() == 1);
+    // Deleting the Add queues its terms and coefficients, and so on
+    assert(release_pending(1) > 0);
+    int slices = 1;
+    while (release_pending(1) > 0) slices++;
+    assert(slices >= 3);
+
+    // Queued nodes are not returned by hash-consing
+    set_hash_consing(true);
+    RCP<const Basic> s1 = symbol("s");
+    const Basic *p = s1.get();
+    s1 = x;
+    assert(pending_release_count() == 1);
+    RCP<const Basic> s2 = symbol("s");
+    assert(s2.get() != p);
+    set_hash_consing(false);
+
+    // Disabling deletes everything that is queued
+    s2 = x;
+    assert(pending_release_count() == 2);
+    set_deferred_release(false);
+    assert(pending_release_count() == 0);
+#else
+    set_deferred_release(true);
+    assert(release_pending() == 0);
+    set_deferred_release(false);
+#endif
+}
+
+void test_flat_hash_map()
+{
+    // A weak hash, so that there are long probe sequences
+    struct WeakHash {
+        std::size_t operator()(int i) const { return i % 100; }
+    };
+    FlatHashMap<int, int, WeakHash> m;
+    std::unordered_map<int, int> r;
+    for (int i = 0; i < 5000; i++) {
+        int k = (i * 7919) % 3001;
+        m[k] += i;
+        r[k] += i;
+        if (i % 3 == 0) {
+            int e = (i * 104729) % 3001;
+            assert(m.erase(e) == r.erase(e));
+        }
+    }
+    assert(m.size() == r.size());
+    for (auto &p: r) {
+        assert(m.count(p.first) == 1);
+        assert(m.at(p.first) == p.second);
+    }
+    std::size_t n = 0;
+    for (auto &p: m) {
+        assert(r[p.first] == p.second);
+        n++;
+    }
+    assert(n == m.size());
+    assert(m.find(-1) == m.end());
+    assert(!m.insert(std::make_pair(r.begin()->first, 0)).second);
+
+    // Erasing while iterating
+    for (auto it = m.begin(); it != m.end(); ) {
+        if (it->second % 2 == 0)
+            it = m.erase(it);
+        else
+            ++it;
+    }
+    for (auto &p: m) assert(p.second % 2 == 1);
+
+    FlatHashMap<int, int, WeakHash> m2 = m, m3;
+    assert(m2.size() == m.size());
+    for (auto &p: m) assert(m2.at(p.first) == p.second);
+    m3 = std::move(m2);
+    assert(m3.size() == m.size() && m2.size() == 0);
+    m3.clear();
+    assert(m3.size() == 0 && m3.begin() == m3.end());
+
+    FlatHashMap<RCP<const Basic>, RCP<const Number>,
+        RCPBasicHash, RCPBasicKeyEq> d = {{symbol("x"), integer(2)}};
+    d.reserve(100);
+    insert(d, symbol("y"), integer(3));
+    assert(d.size() == 2);
+    assert(eq(d[symbol("x")], integer(2)));
+    assert(eq(d.find(symbol("y"))->second, integer(3)));
+}
+
+void test_flat_map()
+{
+    // Inline storage (N = 4) and heap storage
+    FlatMap<int, int> m;
+    std::map<int, int> r;
+    for (int i = 0; i < 2000; i++) {
+        int k = (i * 7919) % 1009;
+        m[k] += i;
+        r[k] += i;
+        if (i % 3 == 0) {
+            int e = (i * 104729) % 1009;
+            assert(m.erase(e) == r.erase(e));
+        }
+    }
+    assert(m.size() == r.size());
+    auto it = m.begin();
+    for (auto &p: r) {
+        assert(it->first == p.first && it->second == p.second);
+        ++it;
+    }
+    assert(it == m.end());
+    assert(m.find(-1) == m.end());
+    assert(!m.insert(std::make_pair(r.begin()->first, 0)).second);
+
+    // Hinted inserts, in order and out of order
+    FlatMap<int, int> h;
+    h.insert(h.end(), std::make_pair(1, 1));
+    h.insert(h.end(), std::make_pair(5, 5));
+    h.insert(h.end(), std::make_pair(3, 3));
+    h.insert(h.begin(), std::make_pair(5, 0));
+    assert(h.size() == 3 && h.begin()->first == 1 && h.at(5) == 5);
+
+    // Copies and moves, inline and on the heap
+    for (std::size_t n: {3, 100}) {
+        FlatMap<int, int> a(r.begin(), r.end()), b;
+        while (a.size() > n) a.erase(a.begin());
+        b = a;
+        assert(b.size() == a.size());
+        for (auto &p: a) assert(b.at(p.first) == p.second);
+        FlatMap<int, int> c(std::move(b));
+        assert(c.size() == a.size() && b.size() == 0);
+        b = std::move(c);
+        assert(b.size() == a.size() && c.size() == 0);
+        b.clear();
+        assert(b.empty() && b.begin() == b.end());
+    }
+
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    FlatMap<RCP<const Basic>, RCP<const Basic>, RCPBasicKeyLess> d;
+    insert(d, y, integer(3));
+    insert(d, x, integer(2));
+    assert(d.size() == 2);
+    assert(RCPBasicKeyLess()(d.begin()->first, (d.begin() + 1)->first));
+    assert(eq(d[x], integer(2)));
+    assert(eq(d.find(y)->second, integer(3)));
+
+    // Products of Muls merge their dictionaries
+    RCP<const Basic> z = symbol("z");
+    RCP<const Basic> r1 = mul(mul(x, y), mul(y, z));
+    RCP<const Basic> r2 = mul(mul(x, pow(y, integer(2))), z);
+    assert(eq(r1, r2));
+    r1 = mul(mul(x, y), mul(pow(y, integer(-1)), z));
+    assert(eq(r1, mul(x, z)));
+}
+
 int main(int argc, char* argv[])
 {
     print_stack_on_segfault();
@@ -659,6 +1273,8 @@ int main(int argc, char* argv[])
     test_mul();
 
     test_diff();
+    test_diff_dag();
+    test_gradient();
 
     test_compare();
 
@@ -666,7 +1282,21 @@ int main(int argc, char* argv[])
 
     test_has();
 
+    test_for_each_arg();
+
     test_eval_double();
 
+    test_hash_consing();
+
+    test_pool_allocator();
+
+    test_refcount_threads();
+
+    test_deferred_release();
+
+    test_flat_hash_map();
+
+    test_flat_map();
+
     return 0;
 }
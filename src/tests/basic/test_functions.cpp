@@ -792,7 +792,12 @@ void test_Subs()
 
     // Test Subs::subs
     r1 = rcp(new Subs(rcp(new Derivative(function_symbol("f", {y, x}), {x})), {{x, add(x, y)}}));
+    // The terms of an Add are printed in the iteration order of its dictionary
+#if defined(WITH_CSYMPY_FLAT_HASH_MAP)
+    assert(r1->__str__() == "Subs(Derivative(f(y, x), x), (x), (x + y))");
+#else
     assert(r1->__str__() == "Subs(Derivative(f(y, x), x), (x), (y + x))");
+#endif
 
     r2 = rcp(new Subs(rcp(new Derivative(function_symbol("f", {y, x}), {x})), {{x, z}, {y, z}}));
     r3 = rcp(new Subs(rcp(new Derivative(function_symbol("f", {y, x}), {x})), {{y, z}, {x, z}}));
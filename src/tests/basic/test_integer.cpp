@@ -1,3 +1,5 @@
+#include <climits>
+
 #include "integer.h"
 
 using CSymPy::print_stack_on_segfault;
@@ -5,6 +7,8 @@ using CSymPy::RCP;
 using CSymPy::Integer;
 using CSymPy::integer;
 using CSymPy::isqrt;
+using CSymPy::integer_cache_max;
+using CSymPy::integer_cache_min;
 
 void test_isqrt()
 {
@@ -65,6 +69,42 @@ void test_iabs()
     assert(eq(iabs(*i12), integer(12)));
 }
 
+void test_small_integers()
+{
+    // Small Integers are shared
+    assert(integer(5).get() == integer(5).get());
+    assert(integer(integer_cache_min).get() == integer(integer_cache_min).get());
+    assert(integer(integer_cache_max).get() == integer(integer_cache_max).get());
+    assert(integer(integer_cache_max + 1).get()
+            != integer(integer_cache_max + 1).get());
+    assert(integer(mpz_class(7)).get() == integer(7).get());
+    assert(integer(3)->addint(*integer(4)).get() == integer(7).get());
+    assert(integer(3)->neg().get() == integer(-3).get());
+
+    RCP<const Integer> a = integer(mpz_class(LONG_MAX));
+    RCP<const Integer> b = integer(mpz_class(LONG_MIN));
+    RCP<const Integer> r;
+
+    // Overflow of the machine word falls back to GMP
+    r = a->addint(*integer(1));
+    assert(r->as_mpz() == mpz_class(LONG_MAX) + 1);
+    r = b->subint(*integer(1));
+    assert(r->as_mpz() == mpz_class(LONG_MIN) - 1);
+    r = a->mulint(*a);
+    assert(r->as_mpz() == mpz_class(LONG_MAX) * mpz_class(LONG_MAX));
+    r = b->neg();
+    assert(r->as_mpz() == -mpz_class(LONG_MIN));
+    r = b->mulint(*integer(-1));
+    assert(r->as_mpz() == -mpz_class(LONG_MIN));
+
+    r = a->subint(*a);
+    assert(r.get() == integer(0).get());
+    r = integer(-1000)->mulint(*integer(1000));
+    assert(r->as_mpz() == -1000000);
+    r = integer(mpz_class(LONG_MAX) + 5)->subint(*a);
+    assert(r.get() == integer(5).get());
+}
+
 int main(int argc, char *argv[])
 {
     print_stack_on_segfault();
@@ -73,6 +113,7 @@ int main(int argc, char *argv[])
     test_i_nth_root();
     test_perfect_power_square();
     test_iabs();
+    test_small_integers();
 
     return 0;
 }
@@ -10,6 +10,7 @@
 #include "pow.h"
 #include "rings.h"
 #include "monomials.h"
+#include "polynomial.h"
 
 using CSymPy::Basic;
 using CSymPy::Add;
@@ -19,6 +20,9 @@ using CSymPy::Symbol;
 using CSymPy::umap_basic_num;
 using CSymPy::map_vec_int;
 using CSymPy::Integer;
+using CSymPy::integer;
+using CSymPy::add;
+using CSymPy::mul;
 using CSymPy::multinomial_coefficients;
 using CSymPy::map_vec_mpz;
 using CSymPy::expr2poly;
@@ -26,9 +30,30 @@ using CSymPy::vec_int;
 using CSymPy::monomial_mul;
 using CSymPy::poly_mul;
 using CSymPy::umap_vec_mpz;
+using CSymPy::umap_ull_mpz;
+using CSymPy::MonomialPacking;
+using CSymPy::vec_ull_mpz;
+using CSymPy::poly_sort;
+using CSymPy::poly_mul_heap;
+using CSymPy::poly_mul_parallel;
+using CSymPy::Polynomial;
+using CSymPy::polynomial;
+using CSymPy::polynomial_add;
+using CSymPy::polynomial_mul;
+using CSymPy::polynomial_pow;
+using CSymPy::polynomial_sub;
+using CSymPy::polynomial_divexact;
+using CSymPy::polynomials;
+using CSymPy::is_polynomial;
+using CSymPy::vec_basic;
+using CSymPy::symbol;
+using CSymPy::sub;
+using CSymPy::mul_expand;
 using CSymPy::RCP;
 using CSymPy::rcp;
 using CSymPy::rcp_dynamic_cast;
+using CSymPy::rcp_static_cast;
+using CSymPy::is_a;
 using CSymPy::print_stack_on_segfault;
 
 void test_monomial_mul()
@@ -94,12 +119,316 @@ void test_expand()
         << "ms" << std::endl;
 }
 
+void test_packed_monomials()
+{
+    MonomialPacking p(4, 10);
+    assert(p.bits_ == 5);
+    vec_int a, b, c(4);
+    a = {1, 2, 3, 4};
+    b = {2, 3, 2, 5};
+    unsigned long long pa = p.pack(a), pb = p.pack(b);
+    p.unpack(monomial_mul(pa, pb), c);
+    vec_int d = {3, 5, 5, 9};
+    assert(c == d);
+    assert(!p.overflows(monomial_mul(pa, pb)));
+    // Packed monomials compare lexicographically
+    assert(pa < pb);
+    a = {1, 9, 0, 0};
+    assert(p.pack(a) < pb);
+
+    // 10 + 10 > 15 sets the guard bit
+    a = {0, 10, 0, 0};
+    assert(p.overflows(monomial_mul(p.pack(a), p.pack(a))));
+
+    a = {0, 16, 0, 0};
+    CSYMPY_CHECK_THROW(p.pack(a), std::runtime_error)
+    a = {0, -1, 0, 0};
+    CSYMPY_CHECK_THROW(p.pack(a), std::runtime_error)
+    CSYMPY_CHECK_THROW(MonomialPacking(10, 100), std::runtime_error)
+}
+
+void test_packed_poly_mul()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> z = rcp(new Symbol("z"));
+    RCP<const Basic> w = rcp(new Symbol("w"));
+    RCP<const Basic> i4 = rcp(new Integer(4));
+
+    RCP<const Basic> e, f1, f2;
+
+    e = pow(add(add(add(x, y), z), w), i4);
+    f1 = expand(e);
+    f2 = expand(add(e, w));
+
+    umap_basic_num syms;
+    insert(syms, x, rcp(new Integer(0)));
+    insert(syms, y, rcp(new Integer(1)));
+    insert(syms, z, rcp(new Integer(2)));
+    insert(syms, w, rcp(new Integer(3)));
+
+    umap_vec_mpz P1, P2, C;
+    expr2poly(f1, syms, P1);
+    expr2poly(f2, syms, P2);
+    poly_mul(P1, P2, C);
+
+    MonomialPacking packing(4, 8);
+    umap_ull_mpz Q1, Q2, D;
+    expr2poly(f1, syms, packing, Q1);
+    expr2poly(f2, syms, packing, Q2);
+    poly_mul(Q1, Q2, D, packing);
+
+    assert(C.size() == D.size());
+    vec_int exp(4);
+    for (auto &p: D) {
+        packing.unpack(p.first, exp);
+        assert(C.at(exp) == p.second);
+    }
+
+    // Degree bound too small for the product
+    MonomialPacking small(4, 7);
+    umap_ull_mpz R1, R2;
+    expr2poly(f1, syms, small, R1);
+    expr2poly(f2, syms, small, R2);
+    D.clear();
+    CSYMPY_CHECK_THROW(poly_mul(R1, R2, D, small), std::runtime_error)
+}
+
+void test_poly_mul_heap()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> z = rcp(new Symbol("z"));
+    RCP<const Basic> i6 = rcp(new Integer(6));
+
+    umap_basic_num syms;
+    insert(syms, x, rcp(new Integer(0)));
+    insert(syms, y, rcp(new Integer(1)));
+    insert(syms, z, rcp(new Integer(2)));
+    MonomialPacking packing(3, 13);
+
+    // Dense: (x + y + z)^6 * ((x + y + z)^6 + z)
+    RCP<const Basic> e = pow(add(add(x, y), z), i6);
+    umap_ull_mpz Q1, Q2, D;
+    expr2poly(expand(e), syms, packing, Q1);
+    expr2poly(expand(add(e, z)), syms, packing, Q2);
+    poly_mul(Q1, Q2, D, packing);
+
+    vec_ull_mpz S1, S2, R1, R2;
+    poly_sort(Q1, S1);
+    poly_sort(Q2, S2);
+    for (std::size_t k = 1; k < S1.size(); k++)
+        assert(S1[k-1].first > S1[k].first);
+    poly_mul_heap(S1, S2, R1, packing);
+    poly_mul(S1, S2, R2, packing);
+    assert(R1.size() == D.size());
+    assert(R2.size() == D.size());
+    for (std::size_t k = 0; k < R1.size(); k++) {
+        assert(D.at(R1[k].first) == R1[k].second);
+        assert(R1[k] == R2[k]);
+        if (k > 0) assert(R1[k-1].first > R1[k].first);
+    }
+
+    // Sparse, with cancellation: (x^3 - y^5 + z) * (x^3 + y^5 - z) =
+    // x^6 - y^10 + 2*y^5*z - z^2
+    RCP<const Basic> a = add(add(pow(x, integer(3)),
+        mul(integer(-1), pow(y, integer(5)))), z);
+    RCP<const Basic> b = add(add(pow(x, integer(3)), pow(y, integer(5))),
+        mul(integer(-1), z));
+    Q1.clear(); Q2.clear();
+    expr2poly(a, syms, packing, Q1);
+    expr2poly(b, syms, packing, Q2);
+    poly_sort(Q1, S1);
+    poly_sort(Q2, S2);
+    poly_mul_heap(S1, S2, R1, packing);
+    poly_mul(S1, S2, R2, packing);
+    assert(R1.size() == 4);
+    assert(R1 == R2);
+    vec_int exp(3);
+    packing.unpack(R1[0].first, exp);
+    assert(exp == vec_int({6, 0, 0}));
+    assert(R1[0].second == 1);
+    packing.unpack(R1[3].first, exp);
+    assert(exp == vec_int({0, 0, 2}));
+    assert(R1[3].second == -1);
+}
+
+void test_poly_mul_parallel()
+{
+    RCP<const Basic> x = rcp(new Symbol("x"));
+    RCP<const Basic> y = rcp(new Symbol("y"));
+    RCP<const Basic> z = rcp(new Symbol("z"));
+    RCP<const Basic> w = rcp(new Symbol("w"));
+    RCP<const Basic> i5 = rcp(new Integer(5));
+
+    RCP<const Basic> e = pow(add(add(add(x, y), z), w), i5);
+
+    umap_basic_num syms;
+    insert(syms, x, rcp(new Integer(0)));
+    insert(syms, y, rcp(new Integer(1)));
+    insert(syms, z, rcp(new Integer(2)));
+    insert(syms, w, rcp(new Integer(3)));
+
+    MonomialPacking packing(4, 11);
+    umap_ull_mpz P1, P2, C;
+    expr2poly(expand(e), syms, packing, P1);
+    expr2poly(expand(add(e, w)), syms, packing, P2);
+    poly_mul(P1, P2, C, packing);
+
+    for (unsigned threads = 1; threads <= 5; threads++) {
+        umap_ull_mpz D;
+        poly_mul_parallel(P1, P2, D, packing, threads);
+        assert(D == C);
+    }
+
+    // Errors in the workers are propagated
+    MonomialPacking small(4, 7);
+    umap_ull_mpz Q1, D;
+    expr2poly(expand(e), syms, small, Q1);
+    CSYMPY_CHECK_THROW(poly_mul_parallel(Q1, Q1, D, small, 3),
+        std::runtime_error)
+}
+
+void test_polynomial()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> z = symbol("z");
+    RCP<const Basic> i2 = integer(2);
+    RCP<const Basic> i3 = integer(3);
+
+    // 2*x^2*y + 3*x - 1
+    RCP<const Basic> e = add(add(mul(i2, mul(pow(x, i2), y)), mul(i3, x)),
+        integer(-1));
+    assert(is_polynomial(*e));
+    RCP<const Polynomial> p = polynomial(e, {x, y});
+    assert(p->size() == 3);
+    // Terms are sorted by decreasing monomials
+    assert(p->get_exps() == vec_int({2, 1, 1, 0, 0, 0}));
+    assert(p->get_coefs()[0] == 2);
+    assert(p->get_coefs()[2] == -1);
+    assert(eq(p->as_basic(), e));
+    assert(eq(p, polynomial(e, {x, y})));
+    assert(neq(p, polynomial(e, {y, x})));
+    assert(p->__hash__() == polynomial(e, {x, y})->__hash__());
+    assert(p->compare(*polynomial(e, {x, y})) == 0);
+
+    // Symbols are collected if no generators are given
+    assert(polynomial(e)->get_vars().size() == 2);
+
+    assert(p->eval({2, 5}) == 2*4*5 + 3*2 - 1);
+    assert(std::abs(p->eval_double({0.5, 2.0}) - (1.0 + 1.5 - 1)) < 1e-12);
+
+    // Arithmetic, also with different generators
+    RCP<const Polynomial> q = polynomial(add(x, z));
+    RCP<const Polynomial> r = polynomial_add(*p, *q);
+    assert(r->get_vars().size() == 3);
+    assert(eq(r->as_basic(), expand(add(e, add(x, z)))));
+    r = polynomial_mul(*p, *q);
+    assert(eq(r->as_basic(), mul_expand(rcp_static_cast<const Mul>(
+        mul(e, add(x, z))))));
+    r = polynomial_add(*p, *polynomial(mul(integer(-1), e)));
+    assert(r->is_zero());
+    assert(eq(r->as_basic(), integer(0)));
+
+    r = polynomial_pow(*q, 3);
+    assert(eq(r->as_basic(), expand(pow(add(x, z), i3))));
+    r = polynomial_pow(*q, 0);
+    assert(eq(r->as_basic(), integer(1)));
+    r = polynomial_pow(*polynomial(mul(i2, x)), 5);
+    assert(eq(r->as_basic(), mul(integer(32), pow(x, integer(5)))));
+    r = polynomial_pow(*polynomial(sub(mul(i2, x), y)), 4);
+    assert(eq(r->as_basic(), expand(pow(sub(mul(i2, x), y), integer(4)))));
+
+    // d/dx (2*x^2*y + 3*x - 1) = 4*x*y + 3
+    RCP<const Basic> d = p->diff(rcp_static_cast<const Symbol>(x));
+    assert(is_a<Polynomial>(*d));
+    assert(eq(rcp_static_cast<const Polynomial>(d)->as_basic(),
+        add(mul(integer(4), mul(x, y)), i3)));
+    d = p->diff(rcp_static_cast<const Symbol>(z));
+    assert(rcp_static_cast<const Polynomial>(d)->is_zero());
+
+    // Nested products and powers
+    e = mul(pow(add(x, y), i3), add(mul(i2, z), pow(add(x, integer(1)), i2)));
+    RCP<const Basic> f = expand(e);
+    RCP<const Basic> g = mul_expand(rcp_static_cast<const Mul>(e));
+    assert(eq(f, g));
+
+    // Not polynomials
+    assert(!is_polynomial(*pow(x, integer(-1))));
+    assert(!is_polynomial(*pow(x, y)));
+    assert(!is_polynomial(*mul(div(integer(1), i2), x)));
+    CSYMPY_CHECK_THROW(polynomial(pow(x, y)), std::runtime_error)
+    CSYMPY_CHECK_THROW(polynomial(add(x, z), {x, y}), std::runtime_error)
+}
+
+void test_polynomial_divexact()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> z = symbol("z");
+    RCP<const Basic> i2 = integer(2);
+
+    // Common generators
+    std::vector<RCP<const Polynomial>> v;
+    polynomials({add(x, y), mul(i2, z), integer(3)}, v);
+    assert(v.size() == 3);
+    for (auto &p: v)
+        assert(p->get_vars().size() == 3);
+    assert(eq(v[1]->as_basic(), mul(i2, z)));
+    assert(eq(v[2]->as_basic(), integer(3)));
+
+    RCP<const Polynomial> a = polynomial(add(mul(i2, pow(x, i2)), y));
+    RCP<const Polynomial> b = polynomial(add(x, z));
+    RCP<const Polynomial> r = polynomial_sub(*a, *b);
+    assert(eq(r->as_basic(), expand(sub(add(mul(i2, pow(x, i2)), y),
+        add(x, z)))));
+    assert(polynomial_sub(*a, *a)->is_zero());
+
+    // (2*x^2 + y) * (x + z) - 3 * (y - 1)^2 * (x + z)
+    RCP<const Polynomial> c = polynomial_sub(*polynomial_mul(*a, *b),
+        *polynomial_mul(*polynomial(mul(integer(3),
+        pow(sub(y, integer(1)), i2))), *b));
+    r = polynomial_divexact(*c, *b);
+    assert(eq(r->as_basic(), expand(sub(add(mul(i2, pow(x, i2)), y),
+        mul(integer(3), pow(sub(y, integer(1)), i2))))));
+    assert(eq(polynomial_mul(*r, *b), c));
+    r = polynomial_divexact(*polynomial(mul(integer(6), x)),
+        *polynomial(integer(-3)));
+    assert(eq(r->as_basic(), mul(integer(-2), x)));
+    assert(polynomial_divexact(*polynomial(integer(0)), *b)->is_zero());
+
+    // Degrees too large to be packed into a word
+    RCP<const Basic> e = add(pow(x, integer(40)), pow(y, integer(40)));
+    vec_basic g;
+    for (unsigned i = 0; i < 12; i++) g.push_back(symbol("g" + std::to_string(i)));
+    a = polynomial(add(e, g[11]));
+    b = polynomial(sub(x, g[0]));
+    r = polynomial_divexact(*polynomial_mul(*a, *b), *b);
+    assert(eq(r->as_basic(), add(e, g[11])));
+
+    CSYMPY_CHECK_THROW(polynomial_divexact(*polynomial(add(x, integer(1))),
+        *polynomial(x)), std::runtime_error)
+    CSYMPY_CHECK_THROW(polynomial_divexact(*polynomial(mul(i2, x)),
+        *polynomial(mul(integer(4), x))), std::runtime_error)
+    CSYMPY_CHECK_THROW(polynomial_divexact(*polynomial(x),
+        *polynomial(y)), std::runtime_error)
+    CSYMPY_CHECK_THROW(polynomial_divexact(*polynomial(x),
+        *polynomial(integer(0))), std::runtime_error)
+}
+
 int main(int argc, char* argv[])
 {
     print_stack_on_segfault();
 
     test_monomial_mul();
     test_expand();
+    test_packed_monomials();
+    test_packed_poly_mul();
+    test_poly_mul_heap();
+    test_poly_mul_parallel();
+    test_polynomial();
+    test_polynomial_divexact();
 
     return 0;
 }
@@ -6,10 +6,13 @@
 #include "symbol.h"
 #include "dict.h"
 #include "integer.h"
+#include "rational.h"
+#include "complex.h"
 #include "mul.h"
 #include "pow.h"
 #include "functions.h"
 #include "constants.h"
+#include "visitor.h"
 
 using CSymPy::Basic;
 using CSymPy::Add;
@@ -29,6 +32,15 @@ using CSymPy::rcp;
 using CSymPy::rcp_dynamic_cast;
 using CSymPy::map_basic_basic;
 using CSymPy::print_stack_on_segfault;
+using CSymPy::vec_basic;
+using CSymPy::vec_pair;
+using CSymPy::symbol;
+using CSymPy::add;
+using CSymPy::mul;
+using CSymPy::pow;
+using CSymPy::cos;
+using CSymPy::eq;
+using CSymPy::cse;
 
 void test_symbol()
 {
@@ -193,6 +205,110 @@ void test_trig()
     assert(eq(r1->subs(d), r2));
 }
 
+// \return a DAG of `n` levels over `x` whose tree has 2**n leaves
+RCP<const Basic> sin_cos_dag(const RCP<const Basic> &x, unsigned n)
+{
+    RCP<const Basic> r = x;
+    for (unsigned i = 0; i < n; i++) r = add(sin(r), cos(r));
+    return r;
+}
+
+void test_dag()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> z = symbol("z");
+    map_basic_basic d;
+    d[x] = y;
+
+    assert(eq(sin_cos_dag(x, 3)->subs(d), sin_cos_dag(y, 3)));
+
+    // Each shared node is substituted once (the tree has 2**40 leaves), and
+    // its copy is shared as well
+    RCP<const Basic> r = sin_cos_dag(x, 40)->subs(d);
+    for (unsigned i = 0; i < 3; i++) {
+        vec_basic args = r->get_args();
+        assert(args.size() == 2);
+        RCP<const Basic> a0 = args[0]->get_args()[0];
+        RCP<const Basic> a1 = args[1]->get_args()[0];
+        assert(a0.get() == a1.get());
+        r = a0;
+    }
+
+    // Untouched subtrees are returned as they are
+    d.clear();
+    d[z] = y;
+    r = sin_cos_dag(x, 40);
+    assert(r->subs(d).get() == r.get());
+    r = mul(x, pow(add(x, sin(x)), integer(3)));
+    assert(r->subs(d).get() == r.get());
+    r = add(r, pow(z, x));
+    RCP<const Basic> s = r->subs(d);
+    assert(eq(s, add(mul(x, pow(add(x, sin(x)), integer(3))), pow(y, x))));
+}
+
+// Substitutes the replacements of cse() back into `reduced`
+RCP<const Basic> cse_expand(const vec_pair &replacements,
+        const RCP<const Basic> &reduced)
+{
+    RCP<const Basic> r = reduced;
+    for (auto it = replacements.rbegin(); it != replacements.rend(); ++it) {
+        map_basic_basic d;
+        d[it->first] = it->second;
+        r = r->subs(d);
+    }
+    return r;
+}
+
+void test_cse()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> z = symbol("z");
+    RCP<const Basic> x0 = symbol("x0");
+    RCP<const Basic> s = add(x, y);
+    vec_pair replacements;
+    vec_basic reduced;
+
+    // sin(x + y)*cos(x + y)
+    cse({mul(sin(s), cos(s))}, replacements, reduced);
+    assert(replacements.size() == 1);
+    assert(eq(replacements[0].first, x0));
+    assert(eq(replacements[0].second, s));
+    assert(reduced.size() == 1);
+    assert(eq(reduced[0], mul(sin(x0), cos(x0))));
+
+    // Nested: sin(x + y) is shared, x + y only occurs inside it
+    RCP<const Basic> e1 = add(sin(s), z);
+    RCP<const Basic> e2 = mul(sin(s), pow(z, integer(2)));
+    RCP<const Basic> e3 = add(pow(z, integer(2)), one);
+    cse({e1, e2, e3}, replacements, reduced);
+    assert(replacements.size() == 2);
+    assert(eq(reduced[0], add(replacements[0].first, z)) ||
+           eq(reduced[0], add(replacements[1].first, z)));
+    assert(eq(cse_expand(replacements, reduced[0]), e1));
+    assert(eq(cse_expand(replacements, reduced[1]), e2));
+    assert(eq(cse_expand(replacements, reduced[2]), e3));
+
+    // The names of the new symbols do not clash
+    cse({mul(sin(s), cos(s)), x0}, replacements, reduced);
+    assert(replacements.size() == 1);
+    assert(eq(replacements[0].first, symbol("x1")));
+    assert(eq(reduced[1], x0));
+
+    // A subexpression of a replaced subexpression is replaced first
+    RCP<const Basic> t = sin(pow(s, integer(3)));
+    cse({mul(t, s), mul(t, x)}, replacements, reduced);
+    assert(replacements.size() == 2);
+    assert(eq(replacements[0].second, s));
+    assert(eq(replacements[1].second,
+        sin(pow(replacements[0].first, integer(3)))));
+
+    // Nothing to eliminate
+    cse({x, add(x, y)}, replacements, reduced);
+    assert(replacements.empty());
+    assert(eq(reduced[1], add(x, y)));
+}
 
 int main(int argc, char* argv[])
 {
@@ -203,6 +319,8 @@ int main(int argc, char* argv[])
     test_mul();
     test_pow();
     test_trig();
+    test_dag();
+    test_cse();
 
     return 0;
 }
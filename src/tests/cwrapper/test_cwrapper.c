@@ -26,6 +26,17 @@ void test_cwrapper() {
     printf("Basic : %s\n", s);
     basic_str_free(s);
 
+    basic terms[3] = {x, y, e};
+    basic_add_terms(e, terms, 3);
+    s = basic_str(e);
+    printf("Basic : %s\n", s);
+    basic_str_free(s);
+
+    basic_mul_factors(e, terms, 2);
+    s = basic_str(e);
+    printf("Basic : %s\n", s);
+    basic_str_free(s);
+
     basic_diff(e, e, z);
     s = basic_str(e);
     printf("Basic : %s\n", s);
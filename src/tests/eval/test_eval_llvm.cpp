@@ -0,0 +1,119 @@
+#include <cmath>
+#include <thread>
+
+#include "basic.h"
+#include "symbol.h"
+#include "integer.h"
+#include "rational.h"
+#include "add.h"
+#include "mul.h"
+#include "pow.h"
+#include "functions.h"
+#include "constants.h"
+#include "matrix.h"
+#include "eval_double.h"
+#include "eval_llvm.h"
+
+using CSymPy::RCP;
+using CSymPy::Basic;
+using CSymPy::symbol;
+using CSymPy::integer;
+using CSymPy::div;
+using CSymPy::add;
+using CSymPy::sub;
+using CSymPy::mul;
+using CSymPy::pow;
+using CSymPy::sin;
+using CSymPy::cos;
+using CSymPy::tan;
+using CSymPy::log;
+using CSymPy::abs;
+using CSymPy::cot;
+using CSymPy::one;
+using CSymPy::pi;
+using CSymPy::DenseMatrix;
+using CSymPy::LLVMDouble;
+using CSymPy::eval_double;
+using CSymPy::compile_llvm_double;
+using CSymPy::print_stack_on_segfault;
+
+void test_expression()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> r;
+    r = add(mul(sin(add(x, y)), cos(add(x, y))), pow(x, integer(-2)));
+    r = add(r, mul(div(integer(3), integer(4)), pow(y, div(one, integer(3)))));
+    r = add(r, mul(log(add(x, integer(5))), tan(div(mul(pi, y), integer(7)))));
+    r = add(r, mul(abs(sub(x, y)), pow(add(x, y), integer(5))));
+
+    LLVMDouble f = compile_llvm_double(*r, {x, y});
+    for (int i = 1; i <= 5; i++) {
+        double a = i / 3.0, b = i;
+        double e = eval_double(*r, {x, y}, {a, b});
+        assert(::fabs(f({a, b}) - e) < 1e-12 * ::fabs(e));
+    }
+    assert(compile_llvm_double(*integer(2), {})({}) == 2);
+    assert(compile_llvm_double(*x, {y, x})({1.0, 2.0}) == 2);
+    assert(compile_llvm_double(*pow(x, integer(0)), {x})({3.0}) == 1);
+
+    CSYMPY_CHECK_THROW(compile_llvm_double(*r, {x}), std::runtime_error)
+    CSYMPY_CHECK_THROW(compile_llvm_double(*r, {x, add(x, y)}),
+        std::runtime_error)
+    CSYMPY_CHECK_THROW(compile_llvm_double(*cot(x), {x}), std::runtime_error)
+}
+
+void test_matrix()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    DenseMatrix A(2, 2, {x, mul(x, y), sin(y), integer(7)});
+    LLVMDouble f = compile_llvm_double(A, {x, y});
+    double in[] = {2, 3}, out[4];
+    f(in, out);
+    assert(out[0] == 2);
+    assert(out[1] == 6);
+    assert(out[2] == ::sin(3.0));
+    assert(out[3] == 7);
+}
+
+void test_cache()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> r = add(sin(x), mul(x, y));
+    LLVMDouble f = compile_llvm_double(*r, {x, y});
+    LLVMDouble g = compile_llvm_double(*add(mul(y, x), sin(x)), {x, y});
+    assert(f.get_function() == g.get_function());
+    g = compile_llvm_double(*r, {y, x});
+    assert(f.get_function() != g.get_function());
+    assert(f({1.0, 2.0}) == g({2.0, 1.0}));
+}
+
+void test_threads()
+{
+    // Compiled functions can be called by several threads at once
+    RCP<const Basic> x = symbol("x");
+    LLVMDouble f = compile_llvm_double(*pow(add(x, one), integer(3)), {x});
+    std::vector<double> sums(4);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < sums.size(); t++) {
+        threads.push_back(std::thread([&, t]() {
+            for (int i = 0; i < 1000; i++) sums[t] += f({double(i)});
+        }));
+    }
+    for (auto &t: threads) t.join();
+    for (double s: sums) assert(s == sums[0]);
+}
+
+int main(int argc, char* argv[])
+{
+    print_stack_on_segfault();
+
+    test_expression();
+    test_matrix();
+    test_cache();
+    test_threads();
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <chrono>
+#include <cmath>
 
 #include "matrix.h"
 #include "integer.h"
@@ -6,6 +7,10 @@
 #include "add.h"
 #include "mul.h"
 #include "pow.h"
+#include "functions.h"
+#include "polynomial.h"
+#include "eval_double.h"
+#include "dense_matrix_double.h"
 
 using CSymPy::print_stack_on_segfault;
 using CSymPy::RCP;
@@ -22,6 +27,9 @@ using CSymPy::sub;
 using CSymPy::eye;
 using CSymPy::diag;
 using CSymPy::vec_basic;
+using CSymPy::jacobian;
+using CSymPy::mul_dense_dense_parallel;
+using CSymPy::Symbol;
 
 void test_get_set()
 {
@@ -201,6 +209,32 @@ void test_dense_dense_multiplication()
             mul(symbol("r"), symbol("z"))),
         add(add(mul(symbol("u"), symbol("x")), mul(symbol("v"), symbol("y"))),
             mul(symbol("w"), symbol("z")))}));
+
+    // Several tiles, the last ones partial
+    unsigned n = 37, m = 19;
+    A = DenseMatrix(n, m);
+    B = DenseMatrix(m, n);
+    for (unsigned i = 0; i < n; i++) {
+        for (unsigned j = 0; j < m; j++) {
+            A.set(i, j, add(symbol("x"), integer(i*m + j)));
+            B.set(j, i, mul(integer((int)i - (int)j), symbol("y")));
+        }
+    }
+    C = DenseMatrix(n, n);
+    mul_dense_dense(A, B, C);
+    for (unsigned i = 0; i < n; i += 5) {
+        for (unsigned j = 0; j < n; j += 3) {
+            RCP<const Basic> r = integer(0);
+            for (unsigned k = 0; k < m; k++)
+                r = add(r, mul(A.get(i, k), B.get(k, j)));
+            assert(eq(C.get(i, j), r));
+        }
+    }
+    for (unsigned threads = 0; threads < 4; threads++) {
+        DenseMatrix D(n, n);
+        mul_dense_dense_parallel(A, B, D, threads);
+        assert(D == C);
+    }
 }
 
 void test_mul_dense_scalar()
@@ -217,6 +251,24 @@ void test_mul_dense_scalar()
                                    integer(6), integer(8)}));
 }
 
+void test_inplace_dense()
+{
+    RCP<const Basic> x = symbol("x");
+    CSymPy::vec_basic v = {integer(1), x, integer(3), integer(4)};
+    DenseMatrix A = DenseMatrix(2, 2, std::move(v));
+    assert(v.empty());
+    assert(A == DenseMatrix(2, 2, {integer(1), x, integer(3), integer(4)}));
+
+    DenseMatrix B = DenseMatrix(2, 2, {x, integer(1), integer(-3), integer(2)});
+    iadd_dense_dense(A, B);
+    assert(A == DenseMatrix(2, 2, {add(x, integer(1)), add(x, integer(1)),
+                                   integer(0), integer(6)}));
+
+    imul_dense_scalar(B, integer(2));
+    assert(B == DenseMatrix(2, 2, {CSymPy::mul(integer(2), x), integer(2),
+                                   integer(-6), integer(4)}));
+}
+
 void test_transpose_dense()
 {
     DenseMatrix A = DenseMatrix(2, 2, {integer(1), integer(2), integer(3), integer(4)});
@@ -270,6 +322,55 @@ void test_submatrix_dense()
 
 }
 
+void test_dense_views()
+{
+    RCP<const Basic> x = symbol("x");
+    DenseMatrix A = DenseMatrix(3, 4, {integer(1), integer(2), integer(3), x,
+                                       integer(5), integer(6), integer(7), integer(8),
+                                       integer(9), x, integer(11), integer(12)});
+
+    CSymPy::ConstDenseMatrixView V = A.view().submatrix(1, 2, 1, 3);
+    assert(V.nrows() == 2 && V.ncols() == 3);
+    assert(eq(V.get(1, 0), x) && eq(V(0, 2), integer(8)));
+    V = V.transpose();
+    assert(V.nrows() == 3 && V.ncols() == 2);
+    assert(eq(V.get(0, 1), x) && eq(V(2, 0), integer(8)));
+    assert(eq(A.view().column(3)(0, 0), x));
+
+    // Products of blocks and transposes, against copies
+    DenseMatrix B = DenseMatrix(3, 3), C = DenseMatrix(3, 3);
+    DenseMatrix S = DenseMatrix(3, 2), T = DenseMatrix(2, 3);
+    submatrix_dense(A, 0, 2, 2, 3, S);
+    transpose_dense(S, T);
+    mul_dense_dense(S, T, B);
+    mul_dense_dense(A.view().submatrix(0, 2, 2, 3),
+        A.view().submatrix(0, 2, 2, 3).transpose(), C.view());
+    assert(B == C);
+
+    // Results written into a block
+    DenseMatrix D = DenseMatrix(4, 4, {integer(0), integer(0), integer(0), integer(0),
+                                       integer(0), integer(0), integer(0), integer(0),
+                                       integer(0), integer(0), integer(0), integer(0),
+                                       integer(0), integer(0), integer(0), integer(0)});
+    add_dense_dense(A.view().submatrix(0, 1, 0, 1),
+        A.view().submatrix(1, 2, 2, 3), D.view().submatrix(2, 3, 1, 2));
+    assert(D == DenseMatrix(4, 4, {integer(0), integer(0), integer(0), integer(0),
+                                   integer(0), integer(0), integer(0), integer(0),
+                                   integer(0), integer(8), integer(10), integer(0),
+                                   integer(0), integer(16), integer(18), integer(0)}));
+    copy_dense(A.view().row(0), D.view().column(0).transpose());
+    assert(eq(D.get(3, 0), x));
+
+    // Row operations on a view change the matrix
+    CSymPy::DenseMatrixView W = A.view().submatrix(1, 2, 0, 1);
+    row_exchange_dense(W, 0, 1);
+    row_add_row_dense(W, 1, 0, integer(-1));
+    row_mul_scalar_dense(W.transpose(), 1, integer(2));
+    assert(A == DenseMatrix(3, 4, {integer(1), integer(2), integer(3), x,
+                                   integer(9), CSymPy::mul(integer(2), x), integer(7), integer(8),
+                                   integer(-4), CSymPy::mul(integer(2), CSymPy::sub(integer(6), x)), integer(11), integer(12)}));
+}
+
 void test_pivoted_gaussian_elimination()
 {
     auto pivotlist = std::vector<unsigned>(2);
@@ -756,6 +857,51 @@ void test_fraction_free_LU()
 
     assert(b == DenseMatrix(4, 1, {
                             integer(1), integer(1), integer(1), integer(1)}));
+
+    // Entries whose products overflow machine words, against the symbolic
+    // algorithm with `y` for them
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> p = pow(integer(2), integer(40));
+    A = DenseMatrix(3, 3, {y, integer(2), integer(3),
+                           integer(2), y, integer(-3),
+                           integer(3), integer(3), mul(integer(2), y)});
+    DenseMatrix N = DenseMatrix(3, 3, {p, integer(2), integer(3),
+                                       integer(2), p, integer(-3),
+                                       integer(3), integer(3), mul(integer(2), p)});
+    CSymPy::map_basic_basic s;
+    s[y] = p;
+    LU = DenseMatrix(3, 3);
+    U = DenseMatrix(3, 3);
+    fraction_free_LU(A, LU);
+    fraction_free_LU(N, U);
+    for (unsigned i = 0; i < 3; i++)
+        for (unsigned j = 0; j < 3; j++)
+            assert(eq(CSymPy::expand(LU.get(i, j)->subs(s)), U.get(i, j)));
+
+    // Polynomial entries stay expanded polynomials (the minors of A)
+    RCP<const Basic> z = symbol("z");
+    unsigned n = 10;
+    A = DenseMatrix(n, n);
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned j = 0; j < n; j++)
+            if ((i + 2*j) % 5 == 0)
+                A.set(i, j, z);
+            else if ((i*j) % 7 == 3)
+                A.set(i, j, y);
+            else
+                A.set(i, j, integer((int)(i*j % 5) - 2 + 3*(i == j)));
+    LU = DenseMatrix(n, n);
+    fraction_free_LU(A, LU);
+    for (unsigned i = 0; i < n; i++)
+        for (unsigned j = 0; j < n; j++)
+            assert(CSymPy::is_polynomial(*LU.get(i, j)));
+    RCP<const Basic> d = det_berkowitz(A);
+    assert(eq(LU.get(n - 1, n - 1), d));
+    assert(eq(det_bareis(A), d));
+    U = DenseMatrix(n, n);
+    fraction_free_gaussian_elimination(A, U);
+    assert(eq(U.get(n - 1, n - 1), d));
+    assert(eq(U.get(n - 1, 0), CSymPy::zero));
 }
 
 void test_LU()
@@ -802,6 +948,18 @@ void test_LU()
     mul_dense_dense(L, U, B);
 
     assert(A == B);
+
+    // In place: L below the diagonal, U on and above it
+    A = DenseMatrix(4, 4, {integer(1), integer(2), integer(6), integer(3),
+                           integer(3), integer(5), integer(6), integer(-5),
+                           integer(2), integer(4), integer(5), integer(6),
+                           integer(6), integer(-10), integer(2), integer(-30)});
+    LU_inplace(A);
+    assert(A == DenseMatrix(4, 4, {
+        integer(1), integer(2), integer(6), integer(3),
+        integer(3), integer(-1), integer(-12), integer(-14),
+        integer(2), integer(0), integer(-7), integer(0),
+        integer(6), integer(22), div(integer(-230), integer(7)), integer(260)}));
 }
 
 void test_fraction_free_LDU()
@@ -1000,6 +1158,23 @@ void test_determinant()
         integer(1), integer(0), integer(0), integer(0), integer(1)});
     assert(eq(det_bareis(M), integer(123)));
     assert(eq(det_berkowitz(M), integer(123)));
+
+    // Entries whose minors overflow machine words
+    RCP<const Basic> p = pow(integer(2), integer(40));
+    M = DenseMatrix(5, 5, {
+        p, integer(7), integer(-1), integer(3), integer(2),
+        integer(0), integer(0), add(p, integer(1)), integer(0), integer(1),
+        integer(-2), p, integer(7), integer(0), integer(2),
+        integer(-3), integer(-2), integer(4), mul(integer(-3), p), integer(3),
+        integer(1), integer(0), integer(0), integer(5), p});
+    assert(eq(det_bareis(M), det_berkowitz(M)));
+
+    M = DenseMatrix(4, 4, {
+        div(integer(1), integer(2)), integer(0), integer(3), integer(1),
+        integer(0), integer(0), div(integer(2), integer(3)), integer(4),
+        integer(2), div(integer(-1), integer(5)), integer(0), integer(1),
+        integer(1), integer(1), integer(1), div(integer(7), integer(4))});
+    assert(eq(det_bareis(M), det_berkowitz(M)));
 }
 
 void test_berkowitz()
@@ -1142,6 +1317,30 @@ void test_char_poly()
     assert(B == DenseMatrix(3, 1, {integer(1),
                                    add(mul(integer(-1), t), mul(integer(-1), x)),
                                    add(mul(integer(-1), mul(y, z)), mul(t, x))}));
+
+    // Products with enough entries for several threads
+    for (unsigned n: {8, 12}) {
+        A = DenseMatrix(n, n);
+        for (unsigned i = 0; i < n; i++)
+            for (unsigned j = 0; j < n; j++)
+                if ((i + 2*j) % 5 == 0)
+                    A.set(i, j, x);
+                else if ((i*j) % 7 == 3)
+                    A.set(i, j, y);
+                else
+                    A.set(i, j, integer((int)(i*j % 5) - 2));
+        B = DenseMatrix(n + 1, 1);
+        char_poly(A, B);
+        if (n == 8) {
+            std::vector<DenseMatrix> polys;
+            berkowitz(A, polys);
+            assert(B == polys[n - 1]);
+        }
+        DenseMatrix C = DenseMatrix(n + 1, 1);
+        char_poly_parallel(A, C, 4);
+        assert(C == B);
+        assert(eq(det_berkowitz_parallel(A, 4), det_berkowitz(A)));
+    }
 }
 
 void test_inverse()
@@ -1197,6 +1396,18 @@ void test_inverse()
     inverse_gauss_jordan(A, B);
     mul_dense_dense(A, B, C);
     assert(C == I3);
+
+    A = DenseMatrix(3, 3, {div(integer(1), integer(2)), integer(3), integer(0),
+                           integer(2), div(integer(-2), integer(3)), integer(1),
+                           pow(integer(2), integer(40)), integer(5),
+                           div(integer(1), integer(7))});
+
+    inverse_fraction_free_LU(A, B);
+    mul_dense_dense(A, B, C);
+    assert(C == I3);
+
+    inverse_gauss_jordan(A, C);
+    assert(B == C);
 }
 
 void test_csr_has_canonical_format()
@@ -1329,6 +1540,155 @@ void test_csr_binop_csr_canonical()
             integer(4), integer(5), integer(6)}));
 }
 
+void test_csr_arithmetic()
+{
+    CSRMatrix A = CSRMatrix(3, 3, {0, 2, 3, 6}, {0, 2, 2, 0, 1, 2},
+        {integer(1), integer(2), integer(3), integer(4), integer(5), integer(6)});
+    CSRMatrix C = CSRMatrix(3, 3, {0, 1, 3, 3}, {1, 0, 1},
+        {integer(7), integer(8), integer(9)});
+    CSRMatrix B = CSRMatrix(3, 3);
+    DenseMatrix Ad = DenseMatrix(3, 3, {integer(1), integer(0), integer(2),
+                                        integer(0), integer(0), integer(3),
+                                        integer(4), integer(5), integer(6)});
+
+    A.add_matrix(C, B);
+    assert(B == CSRMatrix(3, 3, {0, 3, 6, 9}, {0, 1, 2, 0, 1, 2, 0, 1, 2},
+        {integer(1), integer(7), integer(2), integer(8), integer(9), integer(3),
+            integer(4), integer(5), integer(6)}));
+
+    // A 3x2 factor, against the dense product
+    CSRMatrix D = CSRMatrix(3, 2, {0, 1, 1, 3}, {1, 0, 1},
+        {symbol("x"), integer(-1), integer(2)});
+    DenseMatrix Dd = DenseMatrix(3, 2, {integer(0), symbol("x"),
+                                        integer(0), integer(0),
+                                        integer(-1), integer(2)});
+    CSRMatrix E = CSRMatrix(3, 2);
+    DenseMatrix Ed = DenseMatrix(3, 2);
+    A.mul_matrix(D, E);
+    mul_dense_dense(Ad, Dd, Ed);
+    assert(E.eq(Ed));
+    assert(E == CSRMatrix(3, 2, {0, 2, 4, 6}, {0, 1, 0, 1, 0, 1},
+        {integer(-2), add(symbol("x"), integer(4)), integer(-3), integer(6),
+            integer(-6), add(mul(integer(4), symbol("x")), integer(12))}));
+
+    csr_mul_dense(A, Dd, Ed);
+    assert(E.eq(Ed));
+
+    // Entries that cancel are dropped
+    CSRMatrix F = CSRMatrix(2, 2, {0, 2, 4}, {0, 1, 0, 1},
+        {integer(1), integer(1), integer(1), integer(1)});
+    CSRMatrix G = CSRMatrix(2, 2, {0, 1, 2}, {0, 0},
+        {integer(1), integer(-1)});
+    csr_mul_csr(F, G, B);
+    assert(B == CSRMatrix(2, 2));
+
+    A.transpose(B);
+    assert(B == CSRMatrix(3, 3, {0, 2, 3, 6}, {0, 2, 2, 0, 1, 2},
+        {integer(1), integer(4), integer(5), integer(2), integer(3), integer(6)}));
+
+    A.mul_scalar(integer(2), B);
+    assert(B == CSRMatrix(3, 3, {0, 2, 3, 6}, {0, 2, 2, 0, 1, 2},
+        {integer(2), integer(4), integer(6), integer(8), integer(10), integer(12)}));
+    A.mul_scalar(integer(0), B);
+    assert(B == CSRMatrix(3, 3));
+
+    // Sparse matrices with several chunks of rows, some entries cancel
+    std::vector<unsigned> ri, rj;
+    vec_basic rx;
+    unsigned long seed = 1;
+    for (unsigned k = 0; k < 2000; k++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        ri.push_back((seed >> 33) % 300);
+        rj.push_back((seed >> 13) % 200);
+        if (k % 3 == 0)
+            rx.push_back(symbol("x"));
+        else
+            rx.push_back(integer((int)(seed >> 60) - 8));
+    }
+    A = CSRMatrix::from_coo(300, 200, ri, rj, rx);
+    B = CSRMatrix::from_coo(200, 300, rj, ri, rx);
+    csr_mul_csr(A, B, E);
+    csr_mul_csr_parallel(A, B, F, 3);
+    assert(E == F);
+}
+
+void test_csr_fraction_free_LU()
+{
+    std::vector<unsigned> rows, perm;
+
+    // Example 3 of test_fraction_free_LU()
+    CSRMatrix A = CSRMatrix(4, 4, {0, 4, 8, 12, 16},
+        {0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3},
+        {integer(1), integer(2), integer(3), integer(4),
+         integer(2), integer(2), integer(3), integer(4),
+         integer(3), integer(3), integer(3), integer(4),
+         integer(9), integer(8), integer(7), integer(6)});
+    CSRMatrix LU = CSRMatrix(4, 4);
+    A.FFLU(LU);
+    assert(LU.eq(DenseMatrix(4, 4, {integer(1), integer(2), integer(3), integer(4),
+                                    integer(2), integer(-2), integer(-3), integer(-4),
+                                    integer(3), integer(-3), integer(3), integer(4),
+                                    integer(9), integer(-10), integer(10), integer(-10)})));
+
+    // A zero pivot exchanges the rows
+    A = CSRMatrix(3, 3, {0, 1, 3, 5}, {2, 0, 1, 1, 2},
+        {integer(1), integer(2), integer(3), integer(4), integer(5)});
+    csr_fraction_free_LU(A, LU, rows);
+    assert(rows == std::vector<unsigned>({1, 2, 0}));
+    CSYMPY_CHECK_THROW(A.FFLU(LU), std::runtime_error);
+
+    // An arrow matrix: eliminating the dense row and column last causes no
+    // fill, and the rows of U only hold the entries of A
+    A = CSRMatrix(5, 5, {0, 5, 7, 9, 11, 13},
+        {0, 1, 2, 3, 4, 0, 1, 0, 2, 0, 3, 0, 4},
+        {integer(5), integer(1), integer(1), integer(1), integer(1),
+         integer(1), integer(2), integer(1), integer(3), integer(1),
+         integer(4), integer(1), integer(5)});
+    csr_minimum_degree_ordering(A, perm);
+    assert(perm[0] != 0);
+    CSRMatrix B;
+    csr_permute(A, perm, perm, B);
+    csr_fraction_free_LU(B, LU, rows);
+    unsigned nnz = 0;
+    for (unsigned i = 0; i < 5; i++)
+        for (unsigned j = 0; j < 5; j++)
+            if (neq(LU.get(i, j), CSymPy::zero)) nnz++;
+    assert(nnz == 13);
+
+    assert(eq(csr_det(A), integer(446)));
+    DenseMatrix Ad = DenseMatrix(5, 5);
+    for (unsigned i = 0; i < 5; i++)
+        for (unsigned j = 0; j < 5; j++)
+            Ad.set(i, j, A.get(i, j));
+    assert(eq(A.det(), det_bareis(Ad)));
+
+    DenseMatrix b = DenseMatrix(5, 2, {integer(1), integer(0),
+                                       integer(0), integer(0),
+                                       integer(0), symbol("y"),
+                                       integer(0), integer(0),
+                                       integer(0), integer(0)});
+    DenseMatrix x = DenseMatrix(5, 2), y = DenseMatrix(5, 2);
+    A.LU_solve(b, x);
+    mul_dense_dense(Ad, x, y);
+    for (unsigned i = 0; i < 5; i++)
+        for (unsigned j = 0; j < 2; j++)
+            assert(eq(CSymPy::expand(y.get(i, j)), b.get(i, j)));
+
+    // Symbolic entries
+    RCP<const Basic> s = symbol("s");
+    A = CSRMatrix(3, 3, {0, 2, 4, 6}, {0, 1, 0, 2, 1, 2},
+        {s, integer(1), integer(1), s, integer(2), integer(3)});
+    assert(eq(CSymPy::expand(csr_det(A)),
+        add(mul(integer(-2), pow(s, integer(2))), integer(-3))));
+
+    A = CSRMatrix(3, 3, {0, 1, 2, 2}, {0, 1},
+        {integer(1), integer(2)});
+    assert(eq(csr_det(A), integer(0)));
+    b = DenseMatrix(3, 1, {integer(1), integer(1), integer(1)});
+    x = DenseMatrix(3, 1);
+    CSYMPY_CHECK_THROW(A.LU_solve(b, x), std::runtime_error);
+}
+
 void test_eye()
 {
     DenseMatrix A;
@@ -1398,6 +1758,154 @@ void test_ones_zeros()
                                    integer(0), integer(0)}));
 }
 
+void test_jacobian()
+{
+    RCP<const Symbol> x = symbol("x");
+    RCP<const Symbol> y = symbol("y");
+    RCP<const Basic> s = sin(mul(x, y));
+    DenseMatrix J;
+
+    jacobian({add(s, x), mul(s, y), pow(x, integer(2))}, {x, y}, J);
+    assert(J == DenseMatrix(3, 2, {
+        add(mul(cos(mul(x, y)), y), integer(1)), mul(cos(mul(x, y)), x),
+        mul(cos(mul(x, y)), pow(y, integer(2))),
+        add(s, mul(mul(cos(mul(x, y)), x), y)),
+        mul(integer(2), x), integer(0)}));
+
+    CSYMPY_CHECK_THROW(jacobian({x}, {add(x, y)}, J), std::runtime_error);
+}
+
+void test_multimodular()
+{
+    DenseMatrix A = DenseMatrix(5, 5, {
+        integer(2), integer(7), integer(-1), integer(3), integer(2),
+        integer(0), integer(0), integer(1), integer(0), integer(1),
+        integer(-2), integer(0), integer(7), integer(0), integer(2),
+        integer(-3), integer(-2), integer(4), integer(5), integer(3),
+        integer(1), integer(0), integer(0), integer(0), integer(1)});
+    assert(eq(det_multimodular(A), integer(123)));
+
+    A = DenseMatrix(3, 3, {integer(1), integer(2), integer(3),
+                           integer(4), integer(5), integer(6),
+                           integer(7), integer(8), integer(9)});
+    assert(eq(det_multimodular(A), integer(0)));
+    DenseMatrix b = DenseMatrix(3, 1, {integer(1), integer(2), integer(3)});
+    DenseMatrix x = DenseMatrix(3, 1);
+    CSYMPY_CHECK_THROW(multimodular_solve(A, b, x), std::runtime_error);
+
+    A = DenseMatrix(2, 2, {div(integer(1), integer(2)), integer(3),
+                           integer(2), div(integer(-2), integer(3))});
+    b = DenseMatrix(2, 2, {integer(1), integer(0), integer(0), integer(1)});
+    x = DenseMatrix(2, 2);
+    DenseMatrix y = DenseMatrix(2, 2);
+    assert(eq(det_multimodular(A), det_bareis(A)));
+    multimodular_solve(A, b, x);
+    inverse_gauss_jordan(A, y);
+    assert(x == y);
+
+    A = DenseMatrix(2, 2, {symbol("x"), integer(1), integer(2), integer(3)});
+    CSYMPY_CHECK_THROW(det_multimodular(A), std::runtime_error);
+
+    // Entries of about 40 bits, against the fraction-free algorithms
+    unsigned n = 12;
+    vec_basic entries(n*n), rhs(n);
+    RCP<const Basic> p = pow(integer(2), integer(40));
+    unsigned long seed = 1;
+    for (unsigned i = 0; i < n*n + n; i++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        RCP<const Basic> e = integer((int)(seed >> 58) - 32);
+        e = add(mul(e, p), integer((int)(seed >> 40 & 0xffff)));
+        if (i < n*n) entries[i] = e;
+        else rhs[i - n*n] = e;
+    }
+    A = DenseMatrix(n, n, entries);
+    b = DenseMatrix(n, 1, rhs);
+    x = DenseMatrix(n, 1);
+    y = DenseMatrix(n, 1);
+    RCP<const Basic> d = det_bareis(A);
+    assert(eq(det_multimodular(A, 1), d));
+    assert(eq(det_multimodular(A, 3), d));
+    multimodular_solve(A, b, x, 3);
+    fraction_free_gaussian_elimination_solve(A, b, y);
+    assert(x == y);
+}
+
+void test_dense_double()
+{
+    // A = [[2, 1, 1], [4, -6, 0], [-2, 7, 2]] with a sqrt(2) on top
+    DenseMatrix A = DenseMatrix(3, 3, {integer(2), integer(1), integer(1),
+        integer(4), integer(-6), integer(0),
+        integer(-2), integer(7), add(integer(2), CSymPy::sqrt(integer(2)))});
+    std::vector<double> a, x, ainv;
+    eval_double(A, a);
+    assert(a.size() == 9 && a[3] == 4);
+    assert(std::abs(a[8] - 2 - std::sqrt(2.0)) < 1e-15);
+
+    RCP<const Basic> d = det_bareis(A);
+    assert(std::abs(det_double(A) - CSymPy::eval_double(*d)) < 1e-12);
+
+    DenseMatrix b = DenseMatrix(3, 2, {integer(5), integer(1), integer(-2),
+        integer(0), integer(9), integer(0)});
+    LU_solve_double(A, b, x);
+    assert(x.size() == 6);
+    for (unsigned i = 0; i < 3; i++)
+        for (unsigned j = 0; j < 2; j++) {
+            double r = -CSymPy::eval_double(*b.get(i, j));
+            for (unsigned k = 0; k < 3; k++)
+                r += a[i*3 + k] * x[k*2 + j];
+            assert(std::abs(r) < 1e-12);
+        }
+
+    inverse_double(A, ainv);
+    for (unsigned i = 0; i < 3; i++)
+        for (unsigned j = 0; j < 3; j++) {
+            double r = (i == j) ? -1 : 0;
+            for (unsigned k = 0; k < 3; k++)
+                r += a[i*3 + k] * ainv[k*3 + j];
+            assert(std::abs(r) < 1e-12);
+        }
+
+    A = DenseMatrix(2, 2, {integer(1), integer(2), integer(2), integer(4)});
+    assert(det_double(A) == 0);
+    CSYMPY_CHECK_THROW(inverse_double(A, ainv), std::runtime_error);
+    CSYMPY_CHECK_THROW(LU_solve_double(A, DenseMatrix(2, 1, {integer(1),
+        integer(1)}), x), std::runtime_error);
+    CSYMPY_CHECK_THROW(det_double(DenseMatrix(2, 1, {integer(1),
+        integer(1)})), std::runtime_error);
+
+    // Larger than a block of the built-in kernel, diagonally dominant
+    unsigned n = 100;
+    unsigned long seed = 1;
+    a.resize(n*n);
+    std::vector<double> c(n);
+    for (unsigned i = 0; i < n*n; i++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        a[i] = (double)(seed >> 40) / (1UL << 24) - 0.5;
+    }
+    for (unsigned i = 0; i < n; i++) {
+        a[i*n + i] += n;
+        c[i] = i;
+    }
+    CSymPy::LU_solve_double(n, a, 1, c, x);
+    for (unsigned i = 0; i < n; i++) {
+        double r = -c[i];
+        for (unsigned k = 0; k < n; k++)
+            r += a[i*n + k] * x[k];
+        assert(std::abs(r) < 1e-9);
+    }
+    CSymPy::inverse_double(n, a, ainv);
+    for (unsigned i = 0; i < n; i += 7)
+        for (unsigned j = 0; j < n; j++) {
+            double r = (i == j) ? -1 : 0;
+            for (unsigned k = 0; k < n; k++)
+                r += a[i*n + k] * ainv[k*n + j];
+            assert(std::abs(r) < 1e-12);
+        }
+    // det(a) = 1/det(ainv), both about n^n
+    assert(std::abs(CSymPy::det_double(n, a) * CSymPy::det_double(n, ainv)
+        - 1) < 1e-9);
+}
+
 int main(int argc, char* argv[])
 {
     print_stack_on_segfault();
@@ -1412,10 +1920,14 @@ int main(int argc, char* argv[])
 
     test_mul_dense_scalar();
 
+    test_inplace_dense();
+
     test_transpose_dense();
 
     test_submatrix_dense();
 
+    test_dense_views();
+
     test_pivoted_gaussian_elimination();
 
     test_fraction_free_gaussian_elimination();
@@ -1468,12 +1980,22 @@ int main(int argc, char* argv[])
 
     test_csr_binop_csr_canonical();
 
+    test_csr_arithmetic();
+
+    test_csr_fraction_free_LU();
+
     test_eye();
 
     test_diag();
 
     test_ones_zeros();
 
+    test_jacobian();
+
+    test_multimodular();
+
+    test_dense_double();
+
     return 0;
 }
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 
 #include "ntheory.h"
@@ -286,6 +287,30 @@ void test_sieve()
         << "us" << std::endl;
     std::cout << "Number of primes up to " << MAX << ": " << v.size() << std::endl;
     assert(v.size() == 9593);
+
+    // Many small segments split between threads, against trial division
+    std::vector<unsigned> w;
+    CSymPy::Sieve::set_sieve_size(1);
+    CSymPy::Sieve::set_num_threads(3);
+    CSymPy::Sieve::generate_primes(w, 1000003);
+    assert(w.size() == 78499);
+    assert(std::equal(v.begin(), v.end(), w.begin()));
+    for (unsigned i = 9593; i < w.size(); i += 101)
+        for (unsigned j = 0; v[j] * v[j] <= w[i]; j++)
+            assert(w[i] % v[j] != 0);
+
+    // Extending the stored primes
+    CSymPy::Sieve::set_clear(false);
+    v.clear();
+    CSymPy::Sieve::generate_primes(v, 1000003);
+    assert(v == w);
+    v.clear();
+    CSymPy::Sieve::generate_primes(v, 30);
+    assert(v.size() == 10 && v.back() == 29);
+    CSymPy::Sieve::set_clear(true);
+    CSymPy::Sieve::clear();
+    CSymPy::Sieve::set_num_threads(0);
+    CSymPy::Sieve::set_sieve_size(32);
 }
 
 void test_sieve_iterator()
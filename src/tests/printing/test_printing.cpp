@@ -9,6 +9,9 @@
 #include "complex.h"
 #include "add.h"
 #include "matrix.h"
+#include "functions.h"
+#include "constants.h"
+#include "ccode.h"
 
 using CSymPy::RCP;
 using CSymPy::Basic;
@@ -25,6 +28,17 @@ using CSymPy::add;
 using CSymPy::Symbol;
 using CSymPy::Integer;
 using CSymPy::DenseMatrix;
+using CSymPy::sqrt;
+using CSymPy::sin;
+using CSymPy::cos;
+using CSymPy::cot;
+using CSymPy::zeta;
+using CSymPy::one;
+using CSymPy::pi;
+using CSymPy::E;
+using CSymPy::I;
+using CSymPy::ccode;
+using CSymPy::ccode_function;
 
 void test_printing()
 {
@@ -136,18 +150,24 @@ void test_printing()
     r1 = mul(x, y);
     assert(r1->__str__() == "x*y" );
 
+    // The terms of an Add are printed in the iteration order of its dictionary
+#if defined(WITH_CSYMPY_FLAT_HASH_MAP)
+    const std::string y_x = "x + y";
+#else
+    const std::string y_x = "y + x";
+#endif
     r = div(x, add(x, y));
     r1 = div(x, pow(add(x, y), div(integer(2), integer(3))));
     r2 = div(x, pow(add(x, y), div(integer(-2), integer(3))));
-    assert(r->__str__() == "x/(y + x)");
-    assert(r1->__str__() == "x/(y + x)^(2/3)" );
-    assert(r2->__str__() == "(y + x)^(2/3)*x" );
+    assert(r->__str__() == "x/(" + y_x + ")");
+    assert(r1->__str__() == "x/(" + y_x + ")^(2/3)" );
+    assert(r2->__str__() == "(" + y_x + ")^(2/3)*x" );
 
     r = div(integer(1), mul(x, add(x, y)));
     r1 = div(mul(y, integer(-1)), mul(x, add(x, y)));
     r2 = mul(pow(y, x), pow(x, y));
-    assert(r->__str__() == "1/((y + x)*x)");
-    assert(r1->__str__() == "-y/((y + x)*x)");
+    assert(r->__str__() == "1/((" + y_x + ")*x)");
+    assert(r1->__str__() == "-y/((" + y_x + ")*x)");
     assert(r2->__str__() == "x^y*y^x");
 
     r = pow(y, pow(x, integer(2)));
@@ -175,6 +195,56 @@ void test_matrix()
     assert(A.__str__() == "[1, 0]\n[0, 1]\n");
 }
 
+void test_ccode()
+{
+    RCP<const Basic> x = symbol("x");
+    RCP<const Basic> y = symbol("y");
+    RCP<const Basic> z = symbol("z");
+    RCP<const Basic> s = add(x, one);
+
+    assert(ccode(*pow(x, integer(3))) == "x*x*x");
+    assert(ccode(*pow(x, integer(-2))) == "1.0/(x*x)");
+    assert(ccode(*pow(x, integer(12))) == "pow(x, 12.0)");
+    assert(ccode(*pow(s, integer(2))) == "(x + 1.0)*(x + 1.0)");
+    assert(ccode(*sqrt(x)) == "sqrt(x)");
+    assert(ccode(*div(one, sqrt(x))) == "1.0/sqrt(x)");
+    assert(ccode(*pow(E, x)) == "exp(x)");
+    assert(ccode(*div(x, mul(y, z))) == "x/(y*z)");
+    assert(ccode(*div(x, s)) == "x/(x + 1.0)");
+    assert(ccode(*div(integer(-2), y)) == "-2.0/y");
+    assert(ccode(*mul(div(integer(3), integer(4)), x)) == "0.75*x");
+    assert(ccode(*add(x, integer(-5))) == "x - 5.0");
+    assert(ccode(*cot(x)) == "1.0/tan(x)");
+    assert(ccode(*div(one, integer(3))) == "0.3333333333333333");
+    assert(ccode(*integer(-7)) == "-7.0");
+    assert(ccode(*pi) == "3.141592653589793");
+    CSYMPY_CHECK_THROW(ccode(*I), std::runtime_error)
+    CSYMPY_CHECK_THROW(ccode(*zeta(x)), std::runtime_error)
+
+    // Common subexpressions and the bases of powers are computed once
+    std::string f = ccode_function("f",
+        {mul(sin(s), cos(s)), pow(sin(s), integer(3))}, {x, y});
+    assert(f ==
+        "void f(const double *in, double *out)\n"
+        "{\n"
+        "    const double x = in[0];\n"
+        "    const double cse0 = x + 1.0;\n"
+        "    const double cse1 = sin(cse0);\n"
+        "    out[0] = cse1*cos(cse0);\n"
+        "    out[1] = cse1*cse1*cse1;\n"
+        "}\n");
+    DenseMatrix A(1, 2, {x, integer(2)});
+    assert(ccode_function("g", A, {x}, "__device__") ==
+        "__device__ void g(const double *in, double *out)\n"
+        "{\n"
+        "    const double x = in[0];\n"
+        "    out[0] = x;\n"
+        "    out[1] = 2.0;\n"
+        "}\n");
+    CSYMPY_CHECK_THROW(ccode_function("h", {y}, {x}), std::runtime_error)
+    CSYMPY_CHECK_THROW(ccode_function("h", {y}, {s}), std::runtime_error)
+}
+
 int main(int argc, char* argv[])
 {
     print_stack_on_segfault();
@@ -183,5 +253,7 @@ int main(int argc, char* argv[])
 
     test_matrix();
 
+    test_ccode();
+
     return 0;
 }
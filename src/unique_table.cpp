@@ -0,0 +1,132 @@
+#include <unordered_map>
+#include <mutex>
+
+#include "unique_table.h"
+
+namespace CSymPy {
+
+#if defined(WITH_CSYMPY_THREAD_SAFE)
+std::atomic<bool> hash_consing_{false};
+#else
+bool hash_consing_ = false;
+#endif
+
+namespace {
+
+// The table maps the cached hash to the (non-owning) node pointers. Entries
+// are removed by the node itself in its destructor, so the stored pointers are
+// always alive. The key is the hash (and not the node), because by the time
+// `~Basic()` runs the derived class is already destroyed and `__eq__` can't
+// be called on it any more; erasing only needs `hash_` and pointer identity.
+typedef std::unordered_multimap<std::size_t, const Basic *> unique_table_t;
+
+// The table (and its mutex) are never destroyed, so that nodes that outlive
+// static destruction can still unregister themselves.
+unique_table_t &unique_table()
+{
+    static unique_table_t *table = new unique_table_t();
+    return *table;
+}
+
+#if defined(WITH_CSYMPY_THREAD_SAFE)
+// Recursive, because releasing a node while holding the lock can trigger its
+// destructor (and the destructors of its children), which erase themselves
+// from the table.
+std::recursive_mutex &unique_table_mutex()
+{
+    static std::recursive_mutex *m = new std::recursive_mutex();
+    return *m;
+}
+#endif
+
+#if defined(WITH_CSYMPY_RCP)
+// Returns an owning RCP to `b` if `b` is still alive, otherwise null.
+// In the thread safe build another thread might have just dropped the last
+// reference to `b` (its refcount_ is zero and it is waiting for the lock in
+// its destructor), in which case it must not be resurrected.
+RCP<const Basic> try_acquire(const Basic *b)
+{
+#if defined(WITH_CSYMPY_BIASED_REFCOUNT)
+    if (!b->refcount_.try_acquire()) return null;
+    RCP<const Basic> r = rcp(b);
+    b->refcount_.release(b);
+    return r;
+#elif defined(WITH_CSYMPY_THREAD_SAFE)
+    unsigned int c = b->refcount_.load();
+    while (c != 0) {
+        if (b->refcount_.compare_exchange_weak(c, c + 1)) {
+            RCP<const Basic> r = rcp(b);
+            --(b->refcount_);
+            return r;
+        }
+    }
+    return null;
+#else
+#if defined(WITH_CSYMPY_DEFERRED_RELEASE)
+    // Queued for deletion (see deferred_release.h)
+    if (b->refcount_ == 0) return null;
+#endif
+    return rcp(b);
+#endif
+}
+#endif
+
+} // anonymous namespace
+
+void set_hash_consing(bool enable)
+{
+#if defined(WITH_CSYMPY_RCP)
+    hash_consing_ = enable;
+#endif
+}
+
+RCP<const Basic> intern_basic(const RCP<const Basic> &b)
+{
+#if defined(WITH_CSYMPY_RCP)
+    if (b->interned_) return b;
+    std::size_t h = b->hash();
+    // Candidates are released only after the lock and the iteration are
+    // done: dropping the last reference would erase the entry we are
+    // iterating over.
+    vec_basic candidates;
+#if defined(WITH_CSYMPY_THREAD_SAFE)
+    std::lock_guard<std::recursive_mutex> lock(unique_table_mutex());
+#endif
+    unique_table_t &table = unique_table();
+    auto range = table.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        RCP<const Basic> c = try_acquire(it->second);
+        if (c.is_null()) continue;
+        if (c->__eq__(*b)) return c;
+        candidates.push_back(c);
+    }
+    b->interned_ = true;
+    table.insert(std::make_pair(h, b.get()));
+#endif
+    return b;
+}
+
+void unique_table_erase(const Basic *b, std::size_t h)
+{
+#if defined(WITH_CSYMPY_THREAD_SAFE)
+    std::lock_guard<std::recursive_mutex> lock(unique_table_mutex());
+#endif
+    unique_table_t &table = unique_table();
+    auto range = table.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == b) {
+            table.erase(it);
+            return;
+        }
+    }
+}
+
+std::size_t unique_table_size()
+{
+#if defined(WITH_CSYMPY_THREAD_SAFE)
+    std::lock_guard<std::recursive_mutex> lock(unique_table_mutex());
+#endif
+    return unique_table().size();
+}
+
+} // CSymPy
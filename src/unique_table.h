@@ -0,0 +1,62 @@
+/**
+ *  \file unique_table.h
+ *  Hash-consing (interning) of Basic nodes
+ *
+ **/
+#ifndef CSYMPY_UNIQUE_TABLE_H
+#define CSYMPY_UNIQUE_TABLE_H
+
+#include "basic.h"
+
+namespace CSymPy {
+
+/*  When hash-consing is enabled, `add()`, `mul()`, `pow()`, `symbol()` and
+    `integer()` return the canonical shared node for their result: if a node
+    equal to the result (according to `hash()` and `__eq__`) is alive, that
+    node is returned instead of the freshly constructed one. Identical
+    subexpressions are then stored only once and compare equal by pointer.
+
+    The unique table does not own its nodes. It holds weak entries that are
+    removed in `Basic::~Basic()` as soon as the last RCP to a node goes away,
+    so interning never keeps an expression alive.
+
+    Hash-consing requires CSYMPY_RCP (it needs access to `refcount_`); with
+    Teuchos::RCP the functions below are no-ops.
+*/
+
+#if defined(WITH_CSYMPY_THREAD_SAFE)
+extern std::atomic<bool> hash_consing_;
+#else
+extern bool hash_consing_;
+#endif
+
+//! Enables (`true`) or disables (`false`) hash-consing. Disabled by default.
+void set_hash_consing(bool enable);
+
+//! \return `true` if hash-consing is enabled
+inline bool hash_consing_enabled()
+{
+    return hash_consing_;
+}
+
+//! \return the canonical node equal to `b`; registers `b` if there is none
+RCP<const Basic> intern_basic(const RCP<const Basic> &b);
+
+//! Typed version of `intern_basic()`, used by the public constructors
+template <class T>
+inline RCP<const T> intern(const RCP<T> &b)
+{
+    if (!hash_consing_enabled()) return b;
+    return rcp_static_cast<const T>(intern_basic(b));
+}
+
+//! \return number of live nodes registered in the unique table
+std::size_t unique_table_size();
+
+//! Removes `b`, registered under the hash `h`, from the unique table.
+//! Only called from `Basic::~Basic()`.
+void unique_table_erase(const Basic *b, std::size_t h);
+
+} // CSymPy
+
+#endif
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <set>
 
 #include "basic.h"
 #include "symbol.h"
@@ -10,6 +11,7 @@
 #include "pow.h"
 #include "functions.h"
 #include "constants.h"
+#include "polynomial.h"
 #include "visitor.h"
 
 #define ACCEPT(CLASS) void CLASS::accept(Visitor &v) const { v.visit(*this); }
@@ -58,16 +60,27 @@ ACCEPT(UpperGamma)
 ACCEPT(Constant)
 ACCEPT(Abs)
 ACCEPT(Subs)
+ACCEPT(Polynomial)
+
+// The traversals walk the arguments with for_each_arg(), which borrows them
+// from the parent: no vector of arguments is built and no reference counts
+// change.
 
 void preorder_traversal(const Basic &b, Visitor &v)
 {
     b.accept(v);
-    for (auto &p: b.get_args()) preorder_traversal(*p, v);
+    b.for_each_arg([&v](const Basic &arg) {
+        preorder_traversal(arg, v);
+        return true;
+    });
 }
 
 void postorder_traversal(const Basic &b, Visitor &v)
 {
-    for (auto &p: b.get_args()) postorder_traversal(*p, v);
+    b.for_each_arg([&v](const Basic &arg) {
+        postorder_traversal(arg, v);
+        return true;
+    });
     b.accept(v);
 }
 
@@ -75,10 +88,10 @@ void preorder_traversal_stop(const Basic &b, StopVisitor &v)
 {
     b.accept(v);
     if (v.stop_) return;
-    for (auto &p: b.get_args()) {
-        preorder_traversal_stop(*p, v);
-        if (v.stop_) return;
-    }
+    b.for_each_arg([&v](const Basic &arg) {
+        preorder_traversal_stop(arg, v);
+        return !v.stop_;
+    });
 }
 
 bool has_symbol(const Basic &b, const RCP<const Symbol> &x)
@@ -94,5 +107,230 @@ RCP<const Basic> coeff(const Basic &b, const RCP<const Symbol> &x,
     return v.apply(b, x, n);
 }
 
+namespace {
+
+// Counts the occurrences of the subexpressions that subs() replaces: the
+// terms of Add, the factors `base**exp` of Mul and the arguments of the
+// other classes. The arguments of a subexpression are walked the first
+// time it is seen only.
+class SubexpressionCounter {
+public:
+    std::unordered_map<RCP<const Basic>, unsigned, RCPBasicHash,
+        RCPBasicKeyEq> counts;
+    // The distinct subexpressions, in postorder
+    vec_basic order;
+    // The names of the symbols
+    std::set<std::string> names;
+
+    void count(const RCP<const Basic> &b) {
+        if (is_a<Symbol>(*b)) {
+            names.insert(static_cast<const Symbol &>(*b).get_name());
+            return;
+        }
+        if (is_a_Number(*b) || is_a<Constant>(*b)) return;
+        auto it = counts.find(b);
+        if (it != counts.end()) {
+            it->second++;
+            return;
+        }
+        if (is_a<Add>(*b)) {
+            for (auto &p: static_cast<const Add &>(*b).dict_) count(p.first);
+        } else if (is_a<Mul>(*b)) {
+            for (auto &p: static_cast<const Mul &>(*b).dict_)
+                count(pow(p.first, p.second));
+        } else {
+            b->for_each_arg([this](const Basic &arg) {
+                count(rcp(&arg));
+                return true;
+            });
+        }
+        counts[b] = 1;
+        order.push_back(b);
+    }
+};
+
+} // anonymous namespace
+
+void cse(const vec_basic &exprs, vec_pair &replacements, vec_basic &reduced)
+{
+    SubexpressionCounter c;
+    for (auto &e: exprs) c.count(e);
+
+    // The subexpressions of a repeated subexpression come before it in
+    // postorder, so they are already replaced in its definition
+    map_basic_basic subs_dict;
+    replacements.clear();
+    unsigned n = 0;
+    for (auto &b: c.order) {
+        if (c.counts[b] < 2) continue;
+        std::string name;
+        do {
+            name = "x" + std::to_string(n++);
+        } while (c.names.count(name) > 0);
+        RCP<const Basic> s = symbol(name);
+        replacements.push_back(std::make_pair(s, b->subs(subs_dict)));
+        subs_dict[b] = s;
+    }
+    reduced.clear();
+    for (auto &e: exprs) reduced.push_back(e->subs(subs_dict));
+}
+
+namespace {
+
+// The reverse mode differentiation of one expression: the nodes of its DAG
+// in postorder, then their adjoints (the derivatives of the expression by
+// the nodes) from the root down to the leaves
+class AdjointBuilder {
+public:
+    AdjointBuilder(const RCP<const Basic> &f) : f_{f} {
+        walk(f);
+    }
+
+    //! \return the adjoints of `x` (which must be Symbols)
+    vec_basic adjoints(const vec_basic &x) {
+        for (auto &s: x)
+            if (!is_a<Symbol>(*s))
+                throw std::runtime_error(
+                    "gradient: x must contain Symbols only");
+        auto root = index_.find(f_);
+        if (root != index_.end())
+            nodes_[root->second].contributions.push_back(one);
+        for (size_t i = nodes_.size(); i-- > 0; ) {
+            Node &n = nodes_[i];
+            if (n.contributions.empty()) continue;
+            RCP<const Basic> a = n.contributions.size() == 1 ?
+                n.contributions[0] : Add::from_terms(n.contributions);
+            n.contributions.clear();
+            n.adjoint = a;
+            propagate(n.node, a);
+        }
+        vec_basic g;
+        for (auto &s: x) {
+            auto it = index_.find(s);
+            if (it == index_.end() || nodes_[it->second].adjoint.is_null())
+                g.push_back(zero);
+            else
+                g.push_back(nodes_[it->second].adjoint);
+        }
+        return g;
+    }
+
+private:
+    struct Node {
+        RCP<const Basic> node;
+        // The terms of the adjoint, one per use of the node
+        vec_basic contributions;
+        RCP<const Basic> adjoint;
+    };
+    RCP<const Basic> f_;
+    std::vector<Node> nodes_;
+    std::unordered_map<RCP<const Basic>, size_t, RCPBasicHash,
+        RCPBasicKeyEq> index_;
+    // The symbols `u` of the derivatives `g(u).diff(u)` of the functions
+    std::vector<RCP<const Symbol>> dummies_;
+    // The names of the symbols of `f`
+    std::set<std::string> names_;
+    unsigned next_dummy_ = 0;
+
+    // \return the `i`-th of the symbols `_u0`, `_u1`, ... that are not in `f`
+    RCP<const Symbol> dummy(size_t i) {
+        while (dummies_.size() <= i) {
+            RCP<const Symbol> s;
+            do {
+                s = symbol("_u" + std::to_string(next_dummy_++));
+            } while (names_.count(s->get_name()) > 0);
+            dummies_.push_back(s);
+        }
+        return dummies_[i];
+    }
+
+    // Adds the nodes of `b` (the terms of Add, the bases and non numeric
+    // exponents of Mul and Pow, the arguments of the other classes) in
+    // postorder, walking each distinct node once
+    void walk(const RCP<const Basic> &b) {
+        if (is_a_Number(*b) || is_a<Constant>(*b)) return;
+        if (index_.find(b) != index_.end()) return;
+        if (is_a<Symbol>(*b)) {
+            names_.insert(static_cast<const Symbol &>(*b).get_name());
+        } else if (is_a<Add>(*b)) {
+            for (auto &p: static_cast<const Add &>(*b).dict_) walk(p.first);
+        } else if (is_a<Mul>(*b)) {
+            for (auto &p: static_cast<const Mul &>(*b).dict_) {
+                walk(p.first);
+                walk(p.second);
+            }
+        } else {
+            b->for_each_arg([this](const Basic &arg) {
+                walk(rcp(&arg));
+                return true;
+            });
+        }
+        index_[b] = nodes_.size();
+        nodes_.push_back({b, {}, RCP<const Basic>()});
+    }
+
+    // Adds `a * d` to the adjoint of `b`
+    void contribute(const RCP<const Basic> &b, const RCP<const Basic> &a,
+            const RCP<const Basic> &d) {
+        if (is_a_Number(*b) || is_a<Constant>(*b)) return;
+        RCP<const Basic> t = mul(a, d);
+        if (is_a_Number(*t) && rcp_static_cast<const Number>(t)->is_zero())
+            return;
+        nodes_[index_[b]].contributions.push_back(t);
+    }
+
+    // Adds the adjoint `a` of `b` times the partial derivatives of `b` by
+    // its arguments to the adjoints of the arguments
+    void propagate(const RCP<const Basic> &b, const RCP<const Basic> &a) {
+        if (is_a<Symbol>(*b)) return;
+        if (is_a<Add>(*b)) {
+            for (auto &p: static_cast<const Add &>(*b).dict_)
+                contribute(p.first, a, p.second);
+        } else if (is_a<Mul>(*b)) {
+            for (auto &p: static_cast<const Mul &>(*b).dict_) {
+                // b = c * base**exp: b * exp / base, b * log(base)
+                contribute(p.first, a,
+                    mul(b, mul(p.second, pow(p.first, minus_one))));
+                if (!is_a_Number(*p.second))
+                    contribute(p.second, a, mul(b, log(p.first)));
+            }
+        } else if (is_a<Pow>(*b)) {
+            const Pow &p = static_cast<const Pow &>(*b);
+            RCP<const Basic> base = p.get_base(), exp = p.get_exp();
+            contribute(base, a, mul(exp, pow(base, sub(exp, one))));
+            if (!is_a_Number(*exp))
+                contribute(exp, a, mul(b, log(base)));
+        } else {
+            // The distinct arguments `arg[i]` are replaced by symbols `u[i]`,
+            // the partial derivatives are `b(u).diff(u[i])` at `u = arg`
+            vec_basic args;
+            for (auto &arg: b->get_args()) {
+                if (is_a_Number(*arg) || is_a<Constant>(*arg)) continue;
+                bool found = false;
+                for (auto &p: args) if (eq(p, arg)) found = true;
+                if (!found) args.push_back(arg);
+            }
+            map_basic_basic to_dummy, from_dummy;
+            for (size_t i = 0; i < args.size(); i++) {
+                to_dummy[args[i]] = dummy(i);
+                from_dummy[dummy(i)] = args[i];
+            }
+            RCP<const Basic> g = b->subs(to_dummy);
+            if (!args.empty() && g == b)
+                throw std::runtime_error("Not implemented.");
+            for (size_t i = 0; i < args.size(); i++)
+                contribute(args[i], a, g->diff(dummy(i))->subs(from_dummy));
+        }
+    }
+};
+
+} // anonymous namespace
+
+vec_basic gradient(const RCP<const Basic> &f, const vec_basic &x)
+{
+    AdjointBuilder b(f);
+    return b.adjoints(x);
+}
+
 } // CSymPy
 
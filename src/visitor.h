@@ -54,6 +54,7 @@ public:
     virtual void visit(const Constant &) = 0;
     virtual void visit(const Abs &) = 0;
     virtual void visit(const Subs &) = 0;
+    virtual void visit(const Polynomial &) = 0;
 };
 
 void preorder_traversal(const Basic &b, Visitor &v);
@@ -125,6 +126,7 @@ public:
     virtual void visit(const Constant &) { };
     virtual void visit(const Abs &) { };
     virtual void visit(const Subs &) { };
+    virtual void visit(const Polynomial &) { };
 };
 
 bool has_symbol(const Basic &b, const RCP<const Symbol> &x);
@@ -188,11 +190,37 @@ public:
     virtual void visit(const Constant &) { };
     virtual void visit(const Abs &) { };
     virtual void visit(const Subs &) { };
+    virtual void visit(const Polynomial &) { };
 };
 
 RCP<const Basic> coeff(const Basic &b, const RCP<const Symbol> &x,
         const RCP<const Integer> &n);
 
+/*! Common subexpression elimination: finds the subexpressions that occur
+    more than once in `exprs` and replaces each by a new symbol (`x0`, `x1`,
+    ..., skipping the names of the symbols in `exprs`).
+
+    `replacements` receives the pairs (symbol, subexpression), in an order
+    where each subexpression only uses the symbols before it, and `reduced`
+    the expressions with the replacements done. The subexpressions are the
+    terms of Add, the factors of Mul, the base and the exponent of Pow and
+    the arguments of functions, found by hash in one postorder traversal
+    that walks each distinct subexpression once.
+*/
+void cse(const vec_basic &exprs, vec_pair &replacements, vec_basic &reduced);
+
+/*! \return the gradient of `f` by `x` (which must be Symbols): the partial
+    derivatives `f->diff(x[i])`, not necessarily in the same form.
+
+    Reverse mode differentiation: one postorder traversal of the distinct
+    subexpressions of `f`, then one pass from `f` down to the symbols that
+    builds the derivative of `f` by each subexpression (its adjoint) from
+    the adjoints of the subexpressions that use it. The cost does not grow
+    with the number of symbols, and the partial derivatives share the
+    adjoints of the intermediate subexpressions.
+*/
+vec_basic gradient(const RCP<const Basic> &f, const vec_basic &x);
+
 } // CSymPy
 
 #endif